@@ -3,6 +3,7 @@
 #include "Rodin.h"
 #include "RodinPluginStyle.h"
 #include "RodinPluginCommands.h"
+#include "RodinWSServerStats.h"
 #if WITH_EDITOR
 #include "Misc/MessageDialog.h"
 #include "ToolMenus.h"
@@ -16,6 +17,9 @@ static const FName RodinPluginTabName("Rodin");
 
 void FRodinModule::StartupModule()
 {
+	StatsTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+		FTickerDelegate::CreateStatic(&FRodinWSServerCounters::PublishStats));
+
 #if WITH_EDITOR
 	FRodinPluginStyle::Initialize();
 	FRodinPluginStyle::ReloadTextures();
@@ -35,6 +39,8 @@ void FRodinModule::StartupModule()
 
 void FRodinModule::ShutdownModule()
 {
+	FTSTicker::GetCoreTicker().RemoveTicker(StatsTickerHandle);
+
 #if WITH_EDITOR
 	UToolMenus::UnRegisterStartupCallback(this);
 
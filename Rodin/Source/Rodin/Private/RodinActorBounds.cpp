@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinActorBounds.h"
+
+#include "RodinTrace.h"
+#include "Async/ParallelFor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/SkinnedAsset.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/Actor.h"
+
+namespace
+{
+	struct FComponentBounds
+	{
+		/** Cached world bounds of the component, instances included. */
+		FBox World;
+
+		/** Bounds of the mesh asset, in component space. */
+		FBox Local;
+
+		FMatrix ComponentToWorld;
+
+		/** Component space instance transforms, copied on the game thread. Local is then per instance. */
+		TArray<FTransform> Instances;
+
+		bool bInstanced = false;
+	};
+
+	bool GetComponentBounds(UPrimitiveComponent* Component, FComponentBounds& OutBounds)
+	{
+		if (!IsValid(Component) || !Component->IsRegistered())
+		{
+			return false;
+		}
+
+		if (UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(Component))
+		{
+			// Nanite meshes keep the same asset bounds as their fallback.
+			const UStaticMesh* StaticMesh = StaticMeshComponent->GetStaticMesh();
+			if (!StaticMesh)
+			{
+				return false;
+			}
+
+			OutBounds.Local = StaticMesh->GetBounds().GetBox();
+
+			if (const UInstancedStaticMeshComponent* Instanced = Cast<UInstancedStaticMeshComponent>(StaticMeshComponent))
+			{
+				const int32 NumInstances = Instanced->GetInstanceCount();
+				if (NumInstances == 0)
+				{
+					return false;
+				}
+
+				OutBounds.bInstanced = true;
+				OutBounds.Instances.SetNumUninitialized(NumInstances);
+				for (int32 Index = 0; Index < NumInstances; ++Index)
+				{
+					Instanced->GetInstanceTransform(Index, OutBounds.Instances[Index], false);
+				}
+			}
+		}
+		else if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+		{
+			// Reference pose, the world box below follows the animation.
+			const USkinnedAsset* SkinnedAsset = SkinnedComponent->GetSkinnedAsset();
+			if (!SkinnedAsset)
+			{
+				return false;
+			}
+
+			OutBounds.Local = SkinnedAsset->GetBounds().GetBox();
+		}
+		else
+		{
+			return false;
+		}
+
+		OutBounds.World = Component->Bounds.GetBox();
+		OutBounds.ComponentToWorld = Component->GetComponentTransform().ToMatrixWithScale();
+		return true;
+	}
+
+	/** Mesh components of the actor and of everything attached to it, recursively. */
+	void GatherComponents(AActor* Root, TArray<FComponentBounds>& OutComponents)
+	{
+		TArray<AActor*> ActorsToCheck;
+		TSet<AActor*> VisitedActors;
+		ActorsToCheck.Add(Root);
+		VisitedActors.Add(Root);
+
+		while (ActorsToCheck.Num() > 0)
+		{
+			AActor* CurrentActor = ActorsToCheck.Pop();
+
+			TArray<UPrimitiveComponent*> Components;
+			CurrentActor->GetComponents<UPrimitiveComponent>(Components);
+			for (UPrimitiveComponent* Component : Components)
+			{
+				FComponentBounds Bounds;
+				if (GetComponentBounds(Component, Bounds))
+				{
+					OutComponents.Add(MoveTemp(Bounds));
+				}
+			}
+
+			TArray<AActor*> ChildActors;
+			CurrentActor->GetAttachedActors(ChildActors);
+			for (AActor* Child : ChildActors)
+			{
+				if (IsValid(Child) && !VisitedActors.Contains(Child))
+				{
+					ActorsToCheck.Add(Child);
+					VisitedActors.Add(Child);
+				}
+			}
+		}
+	}
+
+	/** Fills the boxes of Result from its components, in the frame of the actor's rotation. Any thread, it only reads the copies made by GatherComponents. */
+	void Combine(const TArray<FComponentBounds>& Components, const FQuat& Rotation, FRodinActorBounds& Result)
+	{
+		const FMatrix WorldToFrame = FRotationMatrix::Make(Rotation).GetTransposed();
+
+		FBox World(ForceInit);
+		FBox Oriented(ForceInit);
+
+		for (const FComponentBounds& Component : Components)
+		{
+			World += Component.World;
+
+			const FMatrix ComponentToFrame = Component.ComponentToWorld * WorldToFrame;
+
+			if (Component.bInstanced)
+			{
+				for (const FTransform& InstanceTransform : Component.Instances)
+				{
+					Oriented += Component.Local.TransformBy(InstanceTransform.ToMatrixWithScale() * ComponentToFrame);
+				}
+			}
+			else
+			{
+				Oriented += Component.Local.TransformBy(ComponentToFrame);
+			}
+		}
+
+		Result.WorldBox = World;
+
+		if (Oriented.IsValid)
+		{
+			Result.OrientedTransform = FTransform(Rotation, Rotation.RotateVector(Oriented.GetCenter()));
+			Result.OrientedExtent = Oriented.GetExtent();
+		}
+	}
+}
+
+namespace NRodinActorBounds
+{
+	TArray<FRodinActorBounds> Measure(const TArray<AActor*>& Actors)
+	{
+		RODIN_TRACE_SCOPE("MeasureActorBounds");
+		check(IsInGameThread());
+
+		TArray<FRodinActorBounds> Results;
+		Results.SetNum(Actors.Num());
+
+		TArray<TArray<FComponentBounds>> Components;
+		Components.SetNum(Actors.Num());
+
+		TArray<FQuat> Rotations;
+		Rotations.SetNum(Actors.Num());
+
+		{
+			RODIN_TRACE_SCOPE("GatherComponents");
+			for (int32 Index = 0; Index < Actors.Num(); ++Index)
+			{
+				AActor* Actor = Actors[Index];
+				Results[Index].Actor = Actor;
+
+				if (!IsValid(Actor))
+				{
+					continue;
+				}
+
+				GatherComponents(Actor, Components[Index]);
+				Rotations[Index] = Actor->GetActorQuat();
+
+				Results[Index].Components = Components[Index].Num();
+				Results[Index].bValid = Components[Index].Num() > 0;
+			}
+		}
+
+		ParallelFor(Actors.Num(), [&](const int32 Index) -> void
+		{
+			if (Results[Index].bValid)
+			{
+				Combine(Components[Index], Rotations[Index], Results[Index]);
+			}
+		});
+
+		return Results;
+	}
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+
+class AActor;
+
+/**
+ * Bounds of actor hierarchies for height conditioning, measured from the bounds the engine already keeps:
+ * the components' world bounds and the mesh assets' local bounds. No geometry is read.
+ */
+namespace NRodinActorBounds
+{
+	/**
+	 * One result per actor, in order. Components are gathered on the game thread, boxes are combined in parallel.
+	 * Game thread only.
+	 */
+	TArray<FRodinActorBounds> Measure(const TArray<AActor*>& Actors);
+}
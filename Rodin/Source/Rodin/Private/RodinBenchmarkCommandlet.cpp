@@ -0,0 +1,511 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinBenchmarkCommandlet.h"
+
+#include "RodinWSServer.h"
+#include "RodinMeshExport.h"
+#include "RodinSyntheticData.h"
+#include "Rodin.h"
+
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "TopicTree.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	struct FBenchmarkResult
+	{
+		FString Name;
+		int64   InputBytes  = 0;
+		int32   Iterations  = 0;
+		double  MinSeconds  = 0.0;
+		double  MeanSeconds = 0.0;
+		int64   PeakGrowth  = 0;
+	};
+
+	TArray<int32> ParseList(const TCHAR* Params, const TCHAR* Key, const TArray<int32>& Default)
+	{
+		FString Value;
+		if (!FParse::Value(Params, Key, Value, false))
+		{
+			return Default;
+		}
+
+		TArray<FString> Parts;
+		Value.ParseIntoArray(Parts, TEXT(","));
+
+		TArray<int32> Out;
+		for (const FString& Part : Parts)
+		{
+			Out.Add(FCString::Atoi(*Part));
+		}
+		return Out;
+	}
+
+	/**
+	 * Exports the first triangle of the engine plane, as is and mirrored, and checks that its glTF
+	 * (counter-clockwise) normal matches the one the vertex buffer stores for it.
+	 */
+	bool CheckMeshExportWinding()
+	{
+		const UStaticMesh* Plane = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Plane.Plane"));
+		const FStaticMeshRenderData* RenderData = Plane ? Plane->GetRenderData() : nullptr;
+		if (!RenderData || RenderData->LODResources.Num() == 0)
+		{
+			UE_LOG(LogWSServer, Error, TEXT("Mesh export check: could not load the engine plane."));
+			return false;
+		}
+
+		const FStaticMeshLODResources& LOD = RenderData->LODResources[0];
+
+		TArray<uint32> LODIndices;
+		LOD.IndexBuffer.GetCopy(LODIndices);
+
+		if (LODIndices.Num() < 3 || !LOD.VertexBuffers.PositionVertexBuffer.GetVertexData())
+		{
+			UE_LOG(LogWSServer, Error, TEXT("Mesh export check: no CPU geometry for the engine plane."));
+			return false;
+		}
+
+		const FVector3f Triangle[3] =
+		{
+			LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(LODIndices[0]),
+			LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(LODIndices[1]),
+			LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(LODIndices[2]),
+		};
+		const uint32 TriangleIndices[3] = { 0, 1, 2 };
+
+		const FVector Normal(FVector3f(LOD.VertexBuffers.StaticMeshVertexBuffer.VertexTangentZ(LODIndices[0])));
+
+		for (const FVector& Scale : { FVector(1.0), FVector(1.0, 1.0, -1.0) })
+		{
+			const FTransform Transform(FQuat::Identity, FVector::ZeroVector, Scale);
+
+			NRodinMeshExport::FMeshSnapshot Snapshot;
+			NRodinMeshExport::AppendTriangles(Transform, MakeArrayView(Triangle), MakeArrayView(TriangleIndices), Snapshot);
+
+			const FVector3f& A = Snapshot.Positions[Snapshot.Indices[0]];
+			const FVector3f& B = Snapshot.Positions[Snapshot.Indices[1]];
+			const FVector3f& C = Snapshot.Positions[Snapshot.Indices[2]];
+			const FVector3f Exported = (B - A) ^ (C - A);
+
+			// Normals go through the inverse transpose, then the same Y/Z swap as the positions.
+			const FVector World(Transform.ToMatrixWithScale().Inverse().GetTransposed().TransformVector(Normal));
+			const FVector3f Expected(World.X, World.Z, World.Y);
+
+			if ((Exported | Expected) <= 0.f)
+			{
+				UE_LOG(LogWSServer, Error, TEXT("Mesh export check: the triangle faces inwards with scale %s, exported normal %s, expected %s."),
+					*Scale.ToString(), *Exported.ToString(), *Expected.ToString());
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Fan-out of task updates through the server's pub/sub tree: Clients subscribers, each topic
+	 * watched by Watchers of them plus one client following every task through a wildcard.
+	 */
+	class FRodinPubSubFixture
+	{
+	public:
+		FRodinPubSubFixture(const int32 InNumTopics, const int32 InNumClients, const int32 InWatchers)
+			: NumTopics(FMath::Max(InNumTopics, 1))
+			, NumClients(FMath::Max(InNumClients, 1))
+			, Watchers(FMath::Clamp(InWatchers, 1, NumClients))
+			, Tree([this](uWS::Subscriber* Subscriber, uWS::Intersection& Intersection) -> int
+			{
+				Intersection.forSubscriber(Tree.getSenderFor(Subscriber), [this](std::pair<std::string_view, std::string_view> Data, bool)
+				{
+					DeliveredBytes += static_cast<int64>(Data.first.length());
+				});
+				return 0;
+			})
+		{
+			// Subscribers are referenced by address, the array must never grow past this.
+			Clients.Reserve(NumClients + 1);
+			for (int32 Index = 0; Index <= NumClients; ++Index)
+			{
+				Clients.Emplace(nullptr);
+			}
+
+			Topics.Reserve(NumTopics);
+			for (int32 Index = 0; Index < NumTopics; ++Index)
+			{
+				Topics.Add(std::string("task/") + std::to_string(Index));
+			}
+		}
+
+		~FRodinPubSubFixture()
+		{
+			UnsubscribeAll();
+		}
+
+		void SubscribeAll()
+		{
+			for (int32 Index = 0; Index < NumTopics; ++Index)
+			{
+				for (int32 Watcher = 0; Watcher < Watchers; ++Watcher)
+				{
+					Tree.subscribe(Topics[Index], &Clients[(Index + Watcher) % NumClients]);
+				}
+			}
+			Tree.subscribe("task/#", &Clients[NumClients]);
+		}
+
+		void UnsubscribeAll()
+		{
+			for (uWS::Subscriber& Client : Clients)
+			{
+				Tree.unsubscribeAll(&Client, false);
+			}
+		}
+
+		/** Publishes Message once to every topic and flushes, returns the bytes delivered. */
+		int64 PublishAll(const std::string_view Message)
+		{
+			DeliveredBytes = 0;
+			for (const std::string& Topic : Topics)
+			{
+				Tree.publish(Topic, { Message, Message });
+			}
+			Tree.drain();
+			return DeliveredBytes;
+		}
+
+		/**
+		 * Has the first watcher of every topic report on it and on the next topic in one batch, like
+		 * a page driving two tasks. The sender must not get its own messages back, returns the bytes delivered.
+		 */
+		int64 PublishAsWatchers(const std::string_view Message)
+		{
+			DeliveredBytes = 0;
+			for (int32 Index = 0; Index < NumTopics; ++Index)
+			{
+				uWS::Subscriber* const Sender = &Clients[Index % NumClients];
+				Tree.publish(Topics[(Index + 1) % NumTopics], { Message, Message }, Sender);
+				Tree.publish(Topics[Index], { Message, Message }, Sender);
+			}
+			Tree.drain();
+			return DeliveredBytes;
+		}
+
+		/** Bytes PublishAsWatchers must deliver: each message once to every subscriber of its topic but the sender. */
+		int64 ExpectedAsWatchers(const int64 MessageBytes) const
+		{
+			int64 Deliveries = 0;
+			for (int32 Index = 0; Index < NumTopics; ++Index)
+			{
+				const int32 Sender = Index % NumClients;
+				for (const int32 Topic : { (Index + 1) % NumTopics, Index })
+				{
+					// The wildcard client never sends, so it always counts.
+					Deliveries += Watchers + 1 - (IsWatching(Sender, Topic) ? 1 : 0);
+				}
+			}
+			return Deliveries * MessageBytes;
+		}
+
+	private:
+		bool IsWatching(const int32 Client, const int32 Topic) const
+		{
+			return (Client - Topic % NumClients + NumClients) % NumClients < Watchers;
+		}
+
+		const int32 NumTopics;
+		const int32 NumClients;
+		const int32 Watchers;
+
+		uWS::TopicTree           Tree;
+		TArray<uWS::Subscriber>  Clients;
+		TArray<std::string>      Topics;
+		int64                    DeliveredBytes = 0;
+	};
+
+	class FRodinBenchmark
+	{
+	public:
+		explicit FRodinBenchmark(const int32 InIterations)
+			: Iterations(FMath::Max(InIterations, 1))
+		{
+		}
+
+		void Run(const FString& Name, const int64 InputBytes, TFunctionRef<void()> Body)
+		{
+			// Warm up caches and lazily loaded modules.
+			Body();
+
+			FBenchmarkResult Result;
+			Result.Name       = Name;
+			Result.InputBytes = InputBytes;
+			Result.Iterations = Iterations;
+			Result.MinSeconds = TNumericLimits<double>::Max();
+
+			// Allocation counts come from Memory Insights (-trace=memalloc) between these bookmarks, the
+			// allocator is shared with every engine thread and is not swapped out per case.
+			TRACE_BOOKMARK(TEXT("RodinBenchmark %s begin"), *Name);
+
+			const uint64 UsedBefore = FPlatformMemory::GetStats().UsedPhysical;
+			uint64 UsedPeak = UsedBefore;
+
+			double Total = 0.0;
+			for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+			{
+				const double Start = FPlatformTime::Seconds();
+				Body();
+				const double Elapsed = FPlatformTime::Seconds() - Start;
+
+				Total += Elapsed;
+				Result.MinSeconds = FMath::Min(Result.MinSeconds, Elapsed);
+
+				UsedPeak = FMath::Max(UsedPeak, static_cast<uint64>(FPlatformMemory::GetStats().UsedPhysical));
+			}
+
+			TRACE_BOOKMARK(TEXT("RodinBenchmark %s end"), *Name);
+
+			Result.PeakGrowth  = static_cast<int64>(UsedPeak - UsedBefore);
+			Result.MeanSeconds = Total / Iterations;
+
+			UE_LOG(LogWSServer, Display, TEXT("%-40s %10.2f MB %9.3f ms %9.1f MB/s %9.2f MB peak growth"),
+				*Name, InputBytes / (1024.0 * 1024.0), Result.MeanSeconds * 1000.0, Throughput(Result),
+				Result.PeakGrowth / (1024.0 * 1024.0));
+
+			Results.Add(MoveTemp(Result));
+		}
+
+		bool Write(const FString& OutputPath) const
+		{
+			TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+			const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("Rodin"));
+			Root->SetStringField(TEXT("plugin_version"), Plugin ? Plugin->GetDescriptor().VersionName : TEXT("unknown"));
+			Root->SetStringField(TEXT("engine_version"), FEngineVersion::Current().ToString());
+			Root->SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+			Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+			Root->SetNumberField(TEXT("process_peak_used_physical"), static_cast<double>(FPlatformMemory::GetStats().PeakUsedPhysical));
+
+			TArray<TSharedPtr<FJsonValue>> Cases;
+			for (const FBenchmarkResult& Result : Results)
+			{
+				TSharedRef<FJsonObject> Case = MakeShared<FJsonObject>();
+				Case->SetStringField(TEXT("name"), Result.Name);
+				Case->SetNumberField(TEXT("input_bytes"), static_cast<double>(Result.InputBytes));
+				Case->SetNumberField(TEXT("iterations"), Result.Iterations);
+				Case->SetNumberField(TEXT("mean_ms"), Result.MeanSeconds * 1000.0);
+				Case->SetNumberField(TEXT("min_ms"), Result.MinSeconds * 1000.0);
+				Case->SetNumberField(TEXT("throughput_mb_s"), Throughput(Result));
+				Case->SetNumberField(TEXT("peak_used_physical_growth_bytes"), static_cast<double>(Result.PeakGrowth));
+				Cases.Add(MakeShared<FJsonValueObject>(Case));
+			}
+			Root->SetArrayField(TEXT("cases"), Cases);
+
+			FString Json;
+			TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+			if (!FJsonSerializer::Serialize(Root, Writer))
+			{
+				return false;
+			}
+
+			return FFileHelper::SaveStringToFile(Json, *OutputPath);
+		}
+
+	private:
+		static double Throughput(const FBenchmarkResult& Result)
+		{
+			return Result.MeanSeconds > 0.0 ? (Result.InputBytes / (1024.0 * 1024.0)) / Result.MeanSeconds : 0.0;
+		}
+
+	private:
+		const int32 Iterations;
+
+		TArray<FBenchmarkResult> Results;
+	};
+}
+
+URodinBenchmarkCommandlet::URodinBenchmarkCommandlet()
+{
+	IsClient        = false;
+	IsServer        = false;
+	IsEditor        = true;
+	LogToConsole    = true;
+	ShowErrorCount  = true;
+}
+
+int32 URodinBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TArray<int32> ImageEdges = ParseList(*Params, TEXT("ImageEdges="), { 512, 2048 });
+	const TArray<int32> FbxMB      = ParseList(*Params, TEXT("FbxMB="),      { 1, 16 });
+	const TArray<int32> UsdzMB     = ParseList(*Params, TEXT("UsdzMB="),     { 1, 16 });
+	const TArray<int32> Topics     = ParseList(*Params, TEXT("Topics="),     { 10, 100, 1000, 10000, 100000 });
+
+	int32 Iterations = 5;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+
+	int32 MultiCount = 4;
+	FParse::Value(*Params, TEXT("MultiCount="), MultiCount);
+
+	int32 PubSubClients = 16;
+	FParse::Value(*Params, TEXT("PubSubClients="), PubSubClients);
+
+	int32 PubSubWatchers = 4;
+	FParse::Value(*Params, TEXT("PubSubWatchers="), PubSubWatchers);
+
+	int32 PubSubMessageBytes = 256;
+	FParse::Value(*Params, TEXT("PubSubMessageBytes="), PubSubMessageBytes);
+
+	const FString WorkDir = FPaths::ProjectSavedDir() / TEXT("Rodin") / TEXT("Benchmark");
+
+	FString OutputPath = WorkDir / FString::Printf(TEXT("Results-%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	IFileManager::Get().MakeDirectory(*WorkDir, true);
+
+	if (!CheckMeshExportWinding())
+	{
+		return 1;
+	}
+
+	FRodinBenchmark Benchmark(Iterations);
+
+	URodinWSServer* const Server = URodinWSServer::CreateRodinWSServer();
+	Server->AddToRoot();
+
+	auto Submit = [Server](const FString& ImagePath, const FString& ModelPath)
+	{
+		bool bLoaded = true, bSent = false;
+		FString Json, TaskId;
+		Server->ST_SubmitInfo(TEXT("None"), TEXT("benchmark"), TEXT("OneClick"), true, false, false, false,
+			TEXT("Basic"), TEXT("Bottom"), ImagePath, TEXT("18K"), ModelPath, TEXT(""), TEXT(""),
+			1.f, 1.f, 0.f, 0, bLoaded, bSent, Json, TaskId);
+	};
+
+	for (const int32 Edge : ImageEdges)
+	{
+		TArray<FString> Paths;
+		int64 TotalBytes = 0;
+
+		for (int32 Index = 0; Index < FMath::Max(MultiCount, 1); ++Index)
+		{
+			const TArray<uint8> Png  = NRodinSyntheticData::MakeImage(Edge, Edge, EImageFormat::PNG, Index);
+			const FString       Path = WorkDir / FString::Printf(TEXT("Image_%d_%d.png"), Edge, Index);
+			FFileHelper::SaveArrayToFile(Png, *Path);
+
+			Paths.Add(Path);
+			TotalBytes += Png.Num();
+		}
+
+		Benchmark.Run(FString::Printf(TEXT("ST_SubmitInfo/Image_%dpx"), Edge), IFileManager::Get().FileSize(*Paths[0]), [&]()
+		{
+			Submit(Paths[0], FString());
+		});
+
+		Benchmark.Run(FString::Printf(TEXT("ST_SubmitInfo_Multi/Image_%dpx_x%d"), Edge, Paths.Num()), TotalBytes, [&]()
+		{
+			bool bLoaded = true, bSent = false;
+			FString Json, TaskId;
+			Server->ST_SubmitInfo_Multi(TEXT("None"), TEXT("benchmark"), TEXT("OneClick"), true, false, false, false,
+				TEXT("Basic"), TEXT("Bottom"), Paths, TEXT("18K"), FString(), TEXT(""), TEXT(""),
+				1.f, 1.f, 0.f, 0, bLoaded, bSent, Json, TaskId);
+		});
+	}
+
+	for (const int32 MB : FbxMB)
+	{
+		const TArray<uint8> Fbx  = NRodinSyntheticData::MakeFbx(static_cast<int64>(MB) * 1024 * 1024, MB);
+		const FString       Path = WorkDir / FString::Printf(TEXT("Model_%dMB.fbx"), MB);
+		FFileHelper::SaveArrayToFile(Fbx, *Path);
+
+		Benchmark.Run(FString::Printf(TEXT("ST_SubmitInfo/Fbx_%dMB"), MB), Fbx.Num(), [&]()
+		{
+			Submit(FString(), Path);
+		});
+	}
+
+	for (const int32 MB : UsdzMB)
+	{
+		const FString Message = NRodinSyntheticData::MakeResultMessage(TEXT("benchmark"),
+			NRodinSyntheticData::MakeUsdz(static_cast<int64>(MB) * 1024 * 1024, MB));
+
+		Benchmark.Run(FString::Printf(TEXT("ST_MessageParse/Usdz_%dMB"), MB), Message.Len(), [&]()
+		{
+			bool bEndDownload = false;
+			FString ModelPath;
+			Server->ST_MessageParse(Message, bEndDownload, ModelPath);
+
+			if (bEndDownload)
+			{
+				IFileManager::Get().Delete(*ModelPath);
+			}
+		});
+	}
+
+	Server->RemoveFromRoot();
+
+	const std::string Progress(FMath::Max(PubSubMessageBytes, 1), 'p');
+	for (const int32 NumTopics : Topics)
+	{
+		FRodinPubSubFixture PubSub(NumTopics, PubSubClients, PubSubWatchers);
+
+		// Keep every case near a hundred thousand publishes so small trees are still measurable.
+		const int32 Rounds = FMath::Max(100000 / FMath::Max(NumTopics, 1), 1);
+
+		Benchmark.Run(FString::Printf(TEXT("TopicTree_Subscribe/Topics_%d"), NumTopics), 0, [&]()
+		{
+			PubSub.SubscribeAll();
+			PubSub.UnsubscribeAll();
+		});
+
+		PubSub.SubscribeAll();
+		const int64 DeliveredBytes = PubSub.PublishAll(Progress) * Rounds;
+
+		Benchmark.Run(FString::Printf(TEXT("TopicTree_Publish/Topics_%d_x%d"), NumTopics, Rounds), DeliveredBytes, [&]()
+		{
+			for (int32 Round = 0; Round < Rounds; ++Round)
+			{
+				PubSub.PublishAll(Progress);
+			}
+		});
+
+		const int64 SenderBytes = PubSub.PublishAsWatchers(Progress);
+		const int64 ExpectedSenderBytes = PubSub.ExpectedAsWatchers(static_cast<int64>(Progress.length()));
+		if (SenderBytes != ExpectedSenderBytes)
+		{
+			UE_LOG(LogWSServer, Error, TEXT("TopicTree delivered %lld bytes for %d topics published by their watchers, expected %lld."),
+				SenderBytes, NumTopics, ExpectedSenderBytes);
+			return 1;
+		}
+
+		Benchmark.Run(FString::Printf(TEXT("TopicTree_PublishAsSender/Topics_%d_x%d"), NumTopics, Rounds), SenderBytes * Rounds, [&]()
+		{
+			for (int32 Round = 0; Round < Rounds; ++Round)
+			{
+				PubSub.PublishAsWatchers(Progress);
+			}
+		});
+	}
+
+	if (!Benchmark.Write(OutputPath))
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Failed to write benchmark results to %s."), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogWSServer, Display, TEXT("Benchmark results written to %s."), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RodinBenchmarkCommandlet.generated.h"
+
+/**
+ * Times the submit and parse pipeline on synthetic payloads, and the pub/sub fan-out of task
+ * updates for growing topic counts, including watchers reporting on two tasks at once, then
+ * writes the results as JSON.
+ *
+ * UnrealEditor-Cmd <Project> -run=RodinBenchmark -nullrhi -unattended
+ *     [-ImageEdges=512,2048] [-MultiCount=4] [-FbxMB=1,16] [-UsdzMB=1,16]
+ *     [-Topics=10,100,1000,10000,100000] [-PubSubClients=16] [-PubSubWatchers=4]
+ *     [-PubSubMessageBytes=256] [-Iterations=5] [-Output=<file.json>]
+ *
+ * Add -trace=memalloc to get per-case allocation counts in Memory Insights, between the
+ * "RodinBenchmark <case> begin/end" bookmarks.
+ *
+ * Fails before timing anything if an exported triangle of the engine plane does not face the way
+ * its stored normal does.
+ */
+UCLASS()
+class URodinBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	URodinBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
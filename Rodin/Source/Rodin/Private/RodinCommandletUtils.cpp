@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinCommandletUtils.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+
+namespace NRodinCommandletUtils
+{
+	bool PumpUntil(TFunctionRef<bool()> Predicate, const double Timeout)
+	{
+		const double Deadline = FPlatformTime::Seconds() + Timeout;
+		double LastTime = FPlatformTime::Seconds();
+
+		while (!Predicate())
+		{
+			const double Now = FPlatformTime::Seconds();
+			if (Now > Deadline)
+			{
+				return false;
+			}
+
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+			FTSTicker::GetCoreTicker().Tick(static_cast<float>(Now - LastTime));
+			LastTime = Now;
+
+			FPlatformProcess::SleepNoStats(0.f);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Helpers shared by the commandlets driving a local server.
+ */
+namespace NRodinCommandletUtils
+{
+	/** Runs game thread tasks and ticks the core ticker until Predicate holds or Timeout expires. False on timeout. */
+	bool PumpUntil(TFunctionRef<bool()> Predicate, const double Timeout);
+}
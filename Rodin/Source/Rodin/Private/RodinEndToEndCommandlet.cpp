@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinEndToEndCommandlet.h"
+
+#include "RodinCommandletUtils.h"
+#include "RodinMessageDispatch.h"
+#include "RodinMockWebPage.h"
+#include "RodinSyntheticData.h"
+#include "Rodin.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	const FName FetchTaskType   (TEXT("fetch_task"));
+	const FName SendModelType   (TEXT("send_model"));
+	const FName TaskProgressType(TEXT("task_progress"));
+
+	double Percentile(TArray<double> Values, const double Fraction)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		Values.Sort();
+		return Values[FMath::Clamp(FMath::CeilToInt(Values.Num() * Fraction) - 1, 0, Values.Num() - 1)];
+	}
+}
+
+URodinEndToEndCommandlet::URodinEndToEndCommandlet()
+{
+	IsClient        = false;
+	IsServer        = false;
+	IsEditor        = true;
+	LogToConsole    = true;
+	ShowErrorCount  = true;
+}
+
+void URodinEndToEndCommandlet::HandleOpened(URodinWS* Socket)
+{
+	Opened.Add(Socket->GetHandle());
+}
+
+void URodinEndToEndCommandlet::HandleText(URodinWS* Socket, FUtf8StringView Message)
+{
+	// Result messages are several megabytes, the type comes first and is found without a parse.
+	FName Type;
+	if (!NRodinMessageDispatch::PeekType(TArrayView<const uint8>(reinterpret_cast<const uint8*>(Message.GetData()), Message.Len()), Type))
+	{
+		return;
+	}
+
+	if (Type == TaskProgressType && Tasks.Num() == 0)
+	{
+		++OpenProgress;
+	}
+	else if (Type == FetchTaskType)
+	{
+		FTaskTiming& Task = Tasks.AddDefaulted_GetRef();
+		Task.FetchSeconds = FPlatformTime::Seconds();
+
+		// New task id, like the panel does before each submission.
+		URodinWSServer::WebURL();
+
+		bool bLoaded = true, bSent = false;
+		FString Json;
+		Server->ST_SubmitInfo(TEXT("None"), TEXT("end to end"), TEXT("OneClick"), true, false, false, false,
+			TEXT("Basic"), TEXT("Bottom"), ImagePath, TEXT("18K"), FString(), TEXT(""), TEXT(""),
+			1.f, 1.f, 0.f, 0, bLoaded, bSent, Json, Task.TaskId);
+
+		Task.SubmitMs = (FPlatformTime::Seconds() - Task.FetchSeconds) * 1000.0;
+
+		Socket->Send(MoveTemp(Json));
+	}
+	else if (Type == SendModelType)
+	{
+		if (Completed >= Tasks.Num())
+		{
+			UE_LOG(LogWSServer, Warning, TEXT("Result received without a pending task."));
+			return;
+		}
+
+		FTaskTiming& Task = Tasks[Completed++];
+
+		const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Message.GetData()), Message.Len());
+		const FString ResultMessage(Converter.Length(), Converter.Get());
+
+		const double ParseStart = FPlatformTime::Seconds();
+
+		FString ModelPath;
+		Server->ST_MessageParse(ResultMessage, Task.bSaved, ModelPath);
+
+		const double Now = FPlatformTime::Seconds();
+		Task.ParseMs     = (Now - ParseStart) * 1000.0;
+		Task.RoundTripMs = (Now - Task.FetchSeconds) * 1000.0;
+
+		if (Task.bSaved)
+		{
+			IFileManager::Get().Delete(*ModelPath);
+		}
+	}
+}
+
+int32 URodinEndToEndCommandlet::Main(const FString& Params)
+{
+	FRodinMockWebPageSettings Settings;
+	Settings.Port = 61994;
+
+	int32 UsdzMB = 4, ChunkKB = 0, ImageEdge = 1024;
+
+	FParse::Value(*Params, TEXT("Port="),      Settings.Port);
+	FParse::Value(*Params, TEXT("Tasks="),     Settings.Tasks);
+	FParse::Value(*Params, TEXT("LatencyMs="), Settings.LatencyMs);
+	FParse::Value(*Params, TEXT("Progress="),  Settings.ProgressMessages);
+	FParse::Value(*Params, TEXT("UsdzMB="),    UsdzMB);
+	FParse::Value(*Params, TEXT("ChunkKB="),   ChunkKB);
+	FParse::Value(*Params, TEXT("ImageEdge="), ImageEdge);
+
+	Settings.bProgressOnOpen = !FParse::Param(*Params, TEXT("NoProgressOnOpen"));
+
+	Settings.UsdzBytes  = static_cast<int64>(UsdzMB) * 1024 * 1024;
+	Settings.ChunkBytes = ChunkKB * 1024;
+
+	const FString WorkDir = FPaths::ProjectSavedDir() / TEXT("Rodin") / TEXT("EndToEnd");
+
+	FString OutputPath = WorkDir / FString::Printf(TEXT("Results-%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	IFileManager::Get().MakeDirectory(*WorkDir, true);
+
+	ImagePath = WorkDir / FString::Printf(TEXT("Condition_%d.png"), ImageEdge);
+	FFileHelper::SaveArrayToFile(NRodinSyntheticData::MakeImage(ImageEdge, ImageEdge, EImageFormat::PNG, 0), *ImagePath);
+
+	Server = URodinWSServer::CreateRodinWSServer();
+
+	// Base64 and JSON framing roughly double the archive.
+	Server->SetMaxPayloadLength(FMath::Max<int64>(Settings.UsdzBytes * 2, 16 * 1024 * 1024));
+	Server->OnRodinWSOpened .AddDynamic(this, &ThisClass::HandleOpened);
+	Server->OnTextNative.AddUObject(this, &ThisClass::HandleText);
+
+	TOptional<bool> bListening;
+	Server->Listen(Settings.Host, TEXT("/*"), Settings.Port, FOnRodinWSServerListening::CreateLambda([&bListening](bool bSuccess) -> void
+	{
+		bListening = bSuccess;
+	}));
+
+	if (!NRodinCommandletUtils::PumpUntil([&bListening]() { return bListening.IsSet(); }, 10.0) || !bListening.GetValue())
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Failed to listen on %s:%d."), *Settings.Host, Settings.Port);
+		return 1;
+	}
+
+	FRodinMockWebPage Page(Settings);
+	Page.Start();
+
+	const double Timeout = 60.0 + Settings.Tasks * (Settings.LatencyMs / 1000.0 + 10.0);
+	const bool bCompleted = NRodinCommandletUtils::PumpUntil([this, &Page, &Settings]()
+	{
+		return Completed >= Settings.Tasks || Page.IsDone();
+	}, Timeout);
+
+	// With listeners bound, a page reconnecting after the first one left must get the recycled socket object.
+	const bool bCheckReuse = !FParse::Param(*Params, TEXT("NoReconnect")) && Opened.Num() == 1;
+	TOptional<FRodinMockWebPage> Reconnected;
+
+	if (bCheckReuse)
+	{
+		if (URodinWS* const First = Opened[0].Get())
+		{
+			First->Close();
+		}
+
+		NRodinCommandletUtils::PumpUntil([&Page]() { return Page.IsDone(); }, 10.0);
+
+		FRodinMockWebPageSettings ReconnectSettings = Settings;
+		ReconnectSettings.Tasks           = 0;
+		ReconnectSettings.bProgressOnOpen = false;
+
+		Reconnected.Emplace(ReconnectSettings);
+		Reconnected->Start();
+
+		NRodinCommandletUtils::PumpUntil([this]() { return Opened.Num() >= 2; }, 10.0);
+	}
+
+	const bool bReused = !bCheckReuse
+		|| (Opened.Num() >= 2 && Opened[1].Object == Opened[0].Object && !Opened[0].IsValid() && Opened[1].IsValid());
+	if (!bReused)
+	{
+		UE_LOG(LogWSServer, Error, TEXT("The reconnecting page was not given the first page's recycled socket object (%d connections opened)."), Opened.Num());
+	}
+
+	// Closing the server ends the pages' connections and their loops.
+	Server->StopListening();
+	NRodinCommandletUtils::PumpUntil([this]() { return Server->GetServerState() == ERodinWSServerState::Closed; }, 5.0);
+
+	const FRodinMockWebPageResult PageResult = Page.Wait();
+	if (Reconnected.IsSet())
+	{
+		Reconnected->Wait();
+	}
+
+	if (!bCompleted || Completed < Settings.Tasks)
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Only %d/%d tasks completed (page connected: %d, results sent: %d)."),
+			Completed, Settings.Tasks, PageResult.bConnected, PageResult.ResultsSent);
+	}
+
+	// Coalesced types arriving before the editor side of the socket exists must wait for it, not get lost.
+	const bool bOpenProgressDelivered = !Settings.bProgressOnOpen || !PageResult.bConnected || OpenProgress == 1;
+	if (!bOpenProgressDelivered)
+	{
+		UE_LOG(LogWSServer, Error, TEXT("The progress sent right after connecting was delivered %d times instead of once."), OpenProgress);
+	}
+
+	TArray<double> RoundTrips, Overheads;
+	TArray<TSharedPtr<FJsonValue>> TaskValues;
+
+	for (int32 Index = 0; Index < Completed; ++Index)
+	{
+		const FTaskTiming& Task = Tasks[Index];
+
+		RoundTrips.Add(Task.RoundTripMs);
+		Overheads .Add(Task.RoundTripMs - Settings.LatencyMs);
+
+		TSharedRef<FJsonObject> Value = MakeShared<FJsonObject>();
+		Value->SetStringField(TEXT("task_id"), Task.TaskId);
+		Value->SetNumberField(TEXT("submit_ms"), Task.SubmitMs);
+		Value->SetNumberField(TEXT("parse_ms"), Task.ParseMs);
+		Value->SetNumberField(TEXT("round_trip_ms"), Task.RoundTripMs);
+		Value->SetBoolField(TEXT("saved"), Task.bSaved);
+		TaskValues.Add(MakeShared<FJsonValueObject>(Value));
+
+		UE_LOG(LogWSServer, Display, TEXT("Task %s: submit %.2f ms, parse %.2f ms, round trip %.2f ms."),
+			*Task.TaskId, Task.SubmitMs, Task.ParseMs, Task.RoundTripMs);
+	}
+
+	const double OverheadP50 = Percentile(Overheads, 0.50);
+	const double OverheadMax = Percentile(Overheads, 1.00);
+
+	UE_LOG(LogWSServer, Display, TEXT("%d tasks, round trip p50 %.2f ms, bridge overhead p50 %.2f ms / max %.2f ms over %.0f ms simulated generation."),
+		Completed, Percentile(RoundTrips, 0.50), OverheadP50, OverheadMax, Settings.LatencyMs);
+
+	TSharedRef<FJsonObject> Config = MakeShared<FJsonObject>();
+	Config->SetNumberField(TEXT("tasks"), Settings.Tasks);
+	Config->SetNumberField(TEXT("latency_ms"), Settings.LatencyMs);
+	Config->SetNumberField(TEXT("progress_messages"), Settings.ProgressMessages);
+	Config->SetNumberField(TEXT("usdz_bytes"), static_cast<double>(Settings.UsdzBytes));
+	Config->SetNumberField(TEXT("chunk_bytes"), Settings.ChunkBytes);
+	Config->SetNumberField(TEXT("image_edge"), ImageEdge);
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetObjectField(TEXT("config"), Config);
+	Root->SetNumberField(TEXT("completed"), Completed);
+	Root->SetBoolField(TEXT("open_progress_delivered"), bOpenProgressDelivered);
+	Root->SetBoolField(TEXT("socket_object_reused"), bReused);
+	Root->SetNumberField(TEXT("result_bytes"), static_cast<double>(PageResult.ResultBytes));
+	Root->SetNumberField(TEXT("coalesced_messages"), static_cast<double>(Server->GetServerStats().CoalescedMessages));
+	Root->SetNumberField(TEXT("round_trip_p50_ms"), Percentile(RoundTrips, 0.50));
+	Root->SetNumberField(TEXT("round_trip_max_ms"), Percentile(RoundTrips, 1.00));
+	Root->SetNumberField(TEXT("overhead_p50_ms"), OverheadP50);
+	Root->SetNumberField(TEXT("overhead_max_ms"), OverheadMax);
+	Root->SetArrayField(TEXT("tasks"), TaskValues);
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutputPath), true);
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Failed to write end to end results to %s."), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogWSServer, Display, TEXT("End to end results written to %s."), *OutputPath);
+
+	return Completed >= Settings.Tasks && bOpenProgressDelivered && bReused ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RodinWSServer.h"
+#include "RodinEndToEndCommandlet.generated.h"
+
+/**
+ * Runs the bridge against a local mock of the web page and times submit -> result for every task.
+ * The server side does what the task panel does: answer fetch_task with ST_SubmitInfo, feed send_model to ST_MessageParse.
+ *
+ * UnrealEditor-Cmd <Project> -run=RodinEndToEnd -nullrhi -unattended
+ *     [-Port=61994] [-Tasks=5] [-LatencyMs=0] [-Progress=0] [-UsdzMB=4] [-ChunkKB=0] [-ImageEdge=1024]
+ *     [-NoProgressOnOpen] [-NoReconnect] [-Output=<file.json>]
+ *
+ * Once the tasks are done the page is disconnected and a second one connects, it must be given the same recycled socket object.
+ */
+UCLASS()
+class URodinEndToEndCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	URodinEndToEndCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	UFUNCTION()
+	void HandleOpened(URodinWS* Socket);
+
+	void HandleText(URodinWS* Socket, FUtf8StringView Message);
+
+private:
+	struct FTaskTiming
+	{
+		FString TaskId;
+		double  FetchSeconds  = 0.0;
+		double  SubmitMs      = 0.0;
+		double  ParseMs       = 0.0;
+		double  RoundTripMs   = 0.0;
+		bool    bSaved        = false;
+	};
+
+	UPROPERTY()
+	URodinWSServer* Server;
+
+	FString ImagePath;
+
+	TArray<FTaskTiming> Tasks;
+	int32 Completed = 0;
+
+	/** Progress delivered before the first fetch_task, the page sends one on open unless -NoProgressOnOpen. */
+	int32 OpenProgress = 0;
+
+	TArray<FRodinWSHandle> Opened;
+};
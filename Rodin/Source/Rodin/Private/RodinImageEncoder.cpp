@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinImageEncoder.h"
+
+#include "RodinTrace.h"
+#include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "ImageCore.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+namespace
+{
+	constexpr int32 JpegQuality = 90;
+
+	bool ReadTexture2D(UTexture2D* Texture, FRodinImagePixels& OutPixels)
+	{
+#if WITH_EDITOR
+		if (Texture->Source.IsValid())
+		{
+			FImage Image;
+			if (Texture->Source.GetMipImage(Image, 0, 0, 0))
+			{
+				Image.ChangeFormat(ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+				const TArrayView64<FColor> Colors = Image.AsBGRA8();
+
+				OutPixels.Width  = Image.SizeX;
+				OutPixels.Height = Image.SizeY;
+				OutPixels.Pixels = TArray<FColor>(Colors.GetData(), static_cast<int32>(Colors.Num()));
+				return true;
+			}
+		}
+#endif
+
+		// Transient textures, like the ones made by BP_PreviewImg, only have their platform data.
+		FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+		if (!PlatformData || PlatformData->PixelFormat != PF_B8G8R8A8 || PlatformData->Mips.Num() == 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Texture %s has no source data and isn't a BGRA8 transient texture."), *Texture->GetName());
+			return false;
+		}
+
+		FTexture2DMipMap& Mip = PlatformData->Mips[0];
+		const int64 Count = static_cast<int64>(Mip.SizeX) * Mip.SizeY;
+
+		const FColor* Data = static_cast<const FColor*>(Mip.BulkData.LockReadOnly());
+		if (!Data || Mip.BulkData.GetBulkDataSize() < Count * static_cast<int64>(sizeof(FColor)))
+		{
+			Mip.BulkData.Unlock();
+			UE_LOG(LogTemp, Error, TEXT("Texture %s has no CPU copy of its pixels."), *Texture->GetName());
+			return false;
+		}
+
+		OutPixels.Width  = Mip.SizeX;
+		OutPixels.Height = Mip.SizeY;
+		OutPixels.Pixels = TArray<FColor>(Data, static_cast<int32>(Count));
+
+		Mip.BulkData.Unlock();
+		return true;
+	}
+
+	bool ReadRenderTarget(UTextureRenderTarget2D* RenderTarget, FRodinImagePixels& OutPixels)
+	{
+		FTextureRenderTargetResource* Resource = RenderTarget->GameThread_GetRenderTargetResource();
+		if (!Resource)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Render target %s has no resource."), *RenderTarget->GetName());
+			return false;
+		}
+
+		if (!Resource->ReadPixels(OutPixels.Pixels))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to read back render target %s."), *RenderTarget->GetName());
+			return false;
+		}
+
+		OutPixels.Width  = RenderTarget->SizeX;
+		OutPixels.Height = RenderTarget->SizeY;
+		return true;
+	}
+}
+
+namespace NRodinImageEncoder
+{
+	bool ReadPixels(UTexture* Texture, FRodinImagePixels& OutPixels)
+	{
+		RODIN_TRACE_SCOPE("ReadPixels");
+		check(IsInGameThread());
+
+		if (UTexture2D* Texture2D = Cast<UTexture2D>(Texture))
+		{
+			return ReadTexture2D(Texture2D, OutPixels);
+		}
+
+		if (UTextureRenderTarget2D* RenderTarget = Cast<UTextureRenderTarget2D>(Texture))
+		{
+			return ReadRenderTarget(RenderTarget, OutPixels);
+		}
+
+		UE_LOG(LogTemp, Error, TEXT("Unsupported texture type: %s"), Texture ? *Texture->GetClass()->GetName() : TEXT("None"));
+		return false;
+	}
+
+	bool Encode(IImageWrapperModule& ImageWrapperModule, const FRodinImagePixels& Pixels, const ERodinImageEncoding Encoding, TArray64<uint8>& OutData)
+	{
+		RODIN_TRACE_SCOPE("EncodeImage");
+
+		if (Pixels.Width <= 0 || Pixels.Height <= 0 || Pixels.Pixels.Num() != Pixels.Width * Pixels.Height)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Invalid image: %dx%d with %d pixels"), Pixels.Width, Pixels.Height, Pixels.Pixels.Num());
+			return false;
+		}
+
+		const bool bJpeg = Encoding == ERodinImageEncoding::JPEG;
+
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(bJpeg ? EImageFormat::JPEG : EImageFormat::PNG);
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Pixels.Pixels.GetData(), Pixels.Pixels.Num() * sizeof(FColor), Pixels.Width, Pixels.Height, ERGBFormat::BGRA, 8))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to set raw image data"));
+			return false;
+		}
+
+		OutData = ImageWrapper->GetCompressed(bJpeg ? JpegQuality : 0);
+		return OutData.Num() > 0;
+	}
+
+	const TCHAR* GetFormatName(const ERodinImageEncoding Encoding)
+	{
+		return Encoding == ERodinImageEncoding::JPEG ? TEXT("jpg") : TEXT("png");
+	}
+
+	const TCHAR* GetMimeType(const ERodinImageEncoding Encoding)
+	{
+		return Encoding == ERodinImageEncoding::JPEG ? TEXT("image/jpeg") : TEXT("image/png");
+	}
+
+	FFormatInfo DetectFormat(IImageWrapperModule& ImageWrapperModule, const void* Data, const int64 Size)
+	{
+		FFormatInfo Info;
+		Info.Format = Size > 0 ? ImageWrapperModule.DetectImageFormat(Data, Size) : EImageFormat::Invalid;
+
+		switch (Info.Format)
+		{
+		case EImageFormat::PNG:  Info.Name = TEXT("png");  Info.MimeType = TEXT("image/png");  break;
+		case EImageFormat::JPEG: Info.Name = TEXT("jpg");  Info.MimeType = TEXT("image/jpeg"); break;
+		case EImageFormat::BMP:  Info.Name = TEXT("bmp");  Info.MimeType = TEXT("image/bmp");  break;
+		case EImageFormat::EXR:  Info.Name = TEXT("exr");  Info.MimeType = TEXT("image/x-exr"); break;
+		case EImageFormat::TGA:  Info.Name = TEXT("tga");  Info.MimeType = TEXT("image/x-tga"); break;
+		default:
+			Info.Format = EImageFormat::Invalid;
+			break;
+		}
+
+		return Info;
+	}
+}
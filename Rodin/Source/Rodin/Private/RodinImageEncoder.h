@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+#include "IImageWrapper.h"
+
+class IImageWrapperModule;
+
+/**
+ * In-memory image path for submissions: texture readback, compression and format detection without going through files.
+ */
+namespace NRodinImageEncoder
+{
+	/**
+	 * Reads the top mip of a UTexture2D (source data, or transient BGRA8 platform data) or of a render target.
+	 * Game thread only, render targets are flushed.
+	 */
+	bool ReadPixels(UTexture* Texture, FRodinImagePixels& OutPixels);
+
+	/** Any thread, as long as the ImageWrapper module was loaded beforehand. */
+	bool Encode(IImageWrapperModule& ImageWrapperModule, const FRodinImagePixels& Pixels, const ERodinImageEncoding Encoding, TArray64<uint8>& OutData);
+
+	/** Value for the "format" field of an image encoded this way, "jpg" as the page has always received for JPEG. */
+	const TCHAR* GetFormatName(const ERodinImageEncoding Encoding);
+
+	/** MIME type for the data URI of an image encoded this way. */
+	const TCHAR* GetMimeType(const ERodinImageEncoding Encoding);
+
+	struct FFormatInfo
+	{
+		EImageFormat Format   = EImageFormat::Invalid;
+		const TCHAR* Name     = nullptr;
+		const TCHAR* MimeType = nullptr;
+	};
+
+	/** Format of compressed image data from its signature, Invalid when unknown. Only the header is read. Name follows GetFormatName. */
+	FFormatInfo DetectFormat(IImageWrapperModule& ImageWrapperModule, const void* Data, const int64 Size);
+}
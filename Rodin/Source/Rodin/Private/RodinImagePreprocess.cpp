@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinImagePreprocess.h"
+
+#include "RodinTrace.h"
+#include "Async/ParallelFor.h"
+#include "Dom/JsonValue.h"
+#include "Hash/CityHash.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/ScopeLock.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <atomic>
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	constexpr int32 RowsPerTask = 16;
+
+	FCriticalSection OptionsLock;
+	FRodinImagePreprocessOptions Options;
+
+	struct FCounters
+	{
+		std::atomic<int64> Images    { 0 };
+		std::atomic<int64> Resized   { 0 };
+		std::atomic<int64> CacheHits { 0 };
+		std::atomic<int64> BytesIn   { 0 };
+		std::atomic<int64> BytesOut  { 0 };
+	};
+	FCounters Counters;
+
+	struct FCacheEntry
+	{
+		TSharedPtr<FJsonValue> Value;
+		int64 Bytes = 0;
+	};
+
+	FCriticalSection CacheLock;
+	TMap<uint64, FCacheEntry> Cache;
+	TArray<uint64> CacheOrder;
+	int64 CacheBytes = 0;
+
+	/** Oldest entries go first. Needs CacheLock. */
+	void TrimCache(const int64 Budget)
+	{
+		while (CacheBytes > Budget && CacheOrder.Num() > 0)
+		{
+			FCacheEntry Entry;
+			if (Cache.RemoveAndCopyValue(CacheOrder[0], Entry))
+			{
+				CacheBytes -= Entry.Bytes;
+			}
+			CacheOrder.RemoveAt(0);
+		}
+	}
+
+	/** Source taps of every destination pixel along one axis, weighted by covered area. */
+	struct FAxisTaps
+	{
+		TArray<int32> First;
+		TArray<int32> Offset;
+		TArray<int32> Count;
+		TArray<float> Weights;
+
+		FAxisTaps(const int32 SrcSize, const int32 DstSize)
+		{
+			const double Scale = static_cast<double>(SrcSize) / DstSize;
+
+			First .SetNumUninitialized(DstSize);
+			Offset.SetNumUninitialized(DstSize);
+			Count .SetNumUninitialized(DstSize);
+
+			for (int32 Dst = 0; Dst < DstSize; ++Dst)
+			{
+				const double Begin = Dst * Scale;
+				const double End   = FMath::Min((Dst + 1) * Scale, static_cast<double>(SrcSize));
+
+				const int32 Lower = FMath::FloorToInt(Begin);
+				const int32 Upper = FMath::Clamp(FMath::CeilToInt(End), Lower + 1, SrcSize);
+
+				First [Dst] = Lower;
+				Offset[Dst] = Weights.Num();
+				Count [Dst] = Upper - Lower;
+
+				for (int32 Src = Lower; Src < Upper; ++Src)
+				{
+					Weights.Add(static_cast<float>((FMath::Min(End, Src + 1.0) - FMath::Max(Begin, static_cast<double>(Src))) / (End - Begin)));
+				}
+			}
+		}
+	};
+
+	/** Box filter over the covered source area, separable, one task per band of destination rows. */
+	void Resize(const FColor* Src, const int32 SrcWidth, const int32 SrcHeight, FColor* Dst, const int32 DstWidth, const int32 DstHeight)
+	{
+		RODIN_TRACE_SCOPE("ResizeImage");
+
+		const FAxisTaps Horizontal(SrcWidth, DstWidth);
+		const FAxisTaps Vertical(SrcHeight, DstHeight);
+
+		ParallelFor(FMath::DivideAndRoundUp(DstHeight, RowsPerTask), [&](const int32 Task) -> void
+		{
+			TArray<float> Row;
+			Row.SetNumUninitialized(SrcWidth * 4);
+
+			const int32 FirstRow = Task * RowsPerTask;
+			const int32 LastRow  = FMath::Min(FirstRow + RowsPerTask, DstHeight);
+
+			for (int32 Y = FirstRow; Y < LastRow; ++Y)
+			{
+				FMemory::Memzero(Row.GetData(), Row.Num() * sizeof(float));
+
+				for (int32 Tap = 0; Tap < Vertical.Count[Y]; ++Tap)
+				{
+					const float Weight = Vertical.Weights[Vertical.Offset[Y] + Tap];
+					const FColor* SrcRow = Src + static_cast<int64>(Vertical.First[Y] + Tap) * SrcWidth;
+
+					for (int32 X = 0; X < SrcWidth; ++X)
+					{
+						Row[X * 4 + 0] += SrcRow[X].B * Weight;
+						Row[X * 4 + 1] += SrcRow[X].G * Weight;
+						Row[X * 4 + 2] += SrcRow[X].R * Weight;
+						Row[X * 4 + 3] += SrcRow[X].A * Weight;
+					}
+				}
+
+				FColor* DstRow = Dst + static_cast<int64>(Y) * DstWidth;
+
+				for (int32 X = 0; X < DstWidth; ++X)
+				{
+					float Sum[4] = {};
+					for (int32 Tap = 0; Tap < Horizontal.Count[X]; ++Tap)
+					{
+						const float Weight = Horizontal.Weights[Horizontal.Offset[X] + Tap];
+						const float* Pixel = &Row[(Horizontal.First[X] + Tap) * 4];
+
+						Sum[0] += Pixel[0] * Weight;
+						Sum[1] += Pixel[1] * Weight;
+						Sum[2] += Pixel[2] * Weight;
+						Sum[3] += Pixel[3] * Weight;
+					}
+
+					DstRow[X].B = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Sum[0]), 0, 255));
+					DstRow[X].G = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Sum[1]), 0, 255));
+					DstRow[X].R = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Sum[2]), 0, 255));
+					DstRow[X].A = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Sum[3]), 0, 255));
+				}
+			}
+		});
+	}
+
+	/** Size with the longest edge at MaxEdge, or the same size when already small enough. */
+	FIntPoint FitTo(const int32 Width, const int32 Height, const int32 MaxEdge)
+	{
+		const int32 Longest = FMath::Max(Width, Height);
+		if (MaxEdge <= 0 || Longest <= MaxEdge)
+		{
+			return FIntPoint(Width, Height);
+		}
+
+		const double Scale = static_cast<double>(MaxEdge) / Longest;
+		return FIntPoint(
+			FMath::Max(1, FMath::RoundToInt(Width * Scale)),
+			FMath::Max(1, FMath::RoundToInt(Height * Scale)));
+	}
+}
+
+namespace NRodinImagePreprocess
+{
+	void SetOptions(const FRodinImagePreprocessOptions& InOptions)
+	{
+		{
+			FScopeLock Lock(&OptionsLock);
+			Options = InOptions;
+		}
+
+		FScopeLock Lock(&CacheLock);
+		TrimCache(InOptions.bEnabled ? InOptions.CacheBytes : 0);
+	}
+
+	FRodinImagePreprocessOptions GetOptions()
+	{
+		FScopeLock Lock(&OptionsLock);
+		return Options;
+	}
+
+	FRodinImagePreprocessStats GetStats()
+	{
+		FRodinImagePreprocessStats Stats;
+		Stats.Images    = Counters.Images;
+		Stats.Resized   = Counters.Resized;
+		Stats.CacheHits = Counters.CacheHits;
+		Stats.BytesIn   = Counters.BytesIn;
+		Stats.BytesOut  = Counters.BytesOut;
+		Stats.BytesSaved = Stats.BytesIn - Stats.BytesOut;
+		return Stats;
+	}
+
+	uint64 MakeKey(const TArray<uint8>& Data, const FString& Format, const FRodinImagePreprocessOptions& InOptions)
+	{
+		RODIN_TRACE_SCOPE("ImageHash");
+
+		const uint32 Seed = HashCombine(GetTypeHash(Format), HashCombine(GetTypeHash(InOptions.MaxEdge), GetTypeHash(InOptions.Quality)));
+		return CityHash64WithSeed(reinterpret_cast<const char*>(Data.GetData()), Data.Num(), Seed);
+	}
+
+	TSharedPtr<FJsonValue> FindCached(const uint64 Key)
+	{
+		FScopeLock Lock(&CacheLock);
+
+		const FCacheEntry* Entry = Cache.Find(Key);
+		if (!Entry)
+		{
+			return nullptr;
+		}
+
+		++Counters.CacheHits;
+		return Entry->Value;
+	}
+
+	void AddCached(const uint64 Key, const TSharedPtr<FJsonValue>& Value, const int64 Bytes)
+	{
+		const int64 Budget = GetOptions().CacheBytes;
+		if (Bytes > Budget)
+		{
+			return;
+		}
+
+		FScopeLock Lock(&CacheLock);
+
+		if (Cache.Contains(Key))
+		{
+			return;
+		}
+
+		Cache.Add(Key, FCacheEntry{ Value, Bytes });
+		CacheOrder.Add(Key);
+		CacheBytes += Bytes;
+
+		TrimCache(Budget);
+	}
+
+	void Process(IImageWrapperModule& ImageWrapperModule, TArray<uint8>& InOutData, const EImageFormat Format, const FRodinImagePreprocessOptions& InOptions)
+	{
+		RODIN_TRACE_SCOPE("PreprocessImage");
+
+		++Counters.Images;
+		Counters.BytesIn += InOutData.Num();
+
+		ON_SCOPE_EXIT
+		{
+			Counters.BytesOut += InOutData.Num();
+		};
+
+		if (Format != EImageFormat::PNG && Format != EImageFormat::JPEG)
+		{
+			return;
+		}
+
+		TSharedPtr<IImageWrapper> Decoder = ImageWrapperModule.CreateImageWrapper(Format);
+		if (!Decoder.IsValid() || !Decoder->SetCompressed(InOutData.GetData(), InOutData.Num()))
+		{
+			return;
+		}
+
+		const int32 Width  = static_cast<int32>(Decoder->GetWidth());
+		const int32 Height = static_cast<int32>(Decoder->GetHeight());
+
+		const FIntPoint Target = FitTo(Width, Height, InOptions.MaxEdge);
+		if (Target == FIntPoint(Width, Height))
+		{
+			return;
+		}
+
+		TArray64<uint8> Raw;
+		{
+			RODIN_TRACE_SCOPE("DecodeImage");
+			if (!Decoder->GetRaw(ERGBFormat::BGRA, 8, Raw) || Raw.Num() < static_cast<int64>(Width) * Height * 4)
+			{
+				return;
+			}
+		}
+
+		TArray64<uint8> Resized;
+		Resized.SetNumUninitialized(static_cast<int64>(Target.X) * Target.Y * 4);
+		Resize(reinterpret_cast<const FColor*>(Raw.GetData()), Width, Height, reinterpret_cast<FColor*>(Resized.GetData()), Target.X, Target.Y);
+
+		TSharedPtr<IImageWrapper> Encoder = ImageWrapperModule.CreateImageWrapper(Format);
+		if (!Encoder.IsValid() || !Encoder->SetRaw(Resized.GetData(), Resized.Num(), Target.X, Target.Y, ERGBFormat::BGRA, 8))
+		{
+			return;
+		}
+
+		TArray64<uint8> Compressed;
+		{
+			RODIN_TRACE_SCOPE("EncodeImage");
+			Compressed = Encoder->GetCompressed(Format == EImageFormat::JPEG ? InOptions.Quality : 0);
+		}
+
+		if (Compressed.Num() == 0 || Compressed.Num() >= InOutData.Num())
+		{
+			return;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Image downsized from %dx%d (%d bytes) to %dx%d (%lld bytes)"),
+			Width, Height, InOutData.Num(), Target.X, Target.Y, Compressed.Num());
+
+		++Counters.Resized;
+		InOutData = TArray<uint8>(Compressed.GetData(), static_cast<int32>(Compressed.Num()));
+	}
+
+	void Process(FRodinImagePixels& InOutPixels, const FRodinImagePreprocessOptions& InOptions)
+	{
+		RODIN_TRACE_SCOPE("PreprocessImage");
+
+		// Raw pixels have no encoded size, count what they take in memory.
+		++Counters.Images;
+		Counters.BytesIn += InOutPixels.Pixels.Num() * static_cast<int64>(sizeof(FColor));
+
+		ON_SCOPE_EXIT
+		{
+			Counters.BytesOut += InOutPixels.Pixels.Num() * static_cast<int64>(sizeof(FColor));
+		};
+
+		if (InOutPixels.Pixels.Num() != InOutPixels.Width * InOutPixels.Height)
+		{
+			return;
+		}
+
+		const FIntPoint Target = FitTo(InOutPixels.Width, InOutPixels.Height, InOptions.MaxEdge);
+		if (Target == FIntPoint(InOutPixels.Width, InOutPixels.Height))
+		{
+			return;
+		}
+
+		TArray<FColor> Resized;
+		Resized.SetNumUninitialized(Target.X * Target.Y);
+		Resize(InOutPixels.Pixels.GetData(), InOutPixels.Width, InOutPixels.Height, Resized.GetData(), Target.X, Target.Y);
+
+		++Counters.Resized;
+
+		InOutPixels.Width  = Target.X;
+		InOutPixels.Height = Target.Y;
+		InOutPixels.Pixels = MoveTemp(Resized);
+	}
+}
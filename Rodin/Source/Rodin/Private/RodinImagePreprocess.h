@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+#include "IImageWrapper.h"
+
+class IImageWrapperModule;
+class FJsonValue;
+
+/**
+ * Optional stage between loading a submitted image and uploading it: images larger than the configured
+ * edge are decoded, downsized with an area filter and re-encoded in their own format.
+ * Finished image entries are cached by content hash so resubmitting the same picture costs a hash.
+ * Everything here is thread safe.
+ */
+namespace NRodinImagePreprocess
+{
+	void SetOptions(const FRodinImagePreprocessOptions& InOptions);
+	FRodinImagePreprocessOptions GetOptions();
+
+	FRodinImagePreprocessStats GetStats();
+
+	/** Cache key of an image file's content under the given options and upload format. */
+	uint64 MakeKey(const TArray<uint8>& Data, const FString& Format, const FRodinImagePreprocessOptions& Options);
+
+	TSharedPtr<FJsonValue> FindCached(const uint64 Key);
+	void AddCached(const uint64 Key, const TSharedPtr<FJsonValue>& Value, const int64 Bytes);
+
+	/**
+	 * Downsizes PNG and JPEG data in place when over MaxEdge. Other formats and failures leave the data untouched.
+	 * Format is what the caller already sniffed from the data, so it isn't detected twice.
+	 */
+	void Process(IImageWrapperModule& ImageWrapperModule, TArray<uint8>& InOutData, const EImageFormat Format, const FRodinImagePreprocessOptions& Options);
+
+	/** Same for pixels about to be encoded. */
+	void Process(FRodinImagePixels& InOutPixels, const FRodinImagePreprocessOptions& Options);
+}
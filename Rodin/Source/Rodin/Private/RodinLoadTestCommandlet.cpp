@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinLoadTestCommandlet.h"
+
+#include "RodinCommandletUtils.h"
+#include "RodinWSLoadGenerator.h"
+#include "Rodin.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	const TCHAR* const LoadTopic = TEXT("rodin/load");
+}
+
+URodinLoadTestCommandlet::URodinLoadTestCommandlet()
+{
+	IsClient        = false;
+	IsServer        = false;
+	IsEditor        = true;
+	LogToConsole    = true;
+	ShowErrorCount  = true;
+}
+
+void URodinLoadTestCommandlet::HandleOpened(URodinWS* Socket)
+{
+	// Tell the client it can start once publishes will reach it.
+	Socket->Subscribe(FString(LoadTopic), FOnRodinWSSubscribed::CreateWeakLambda(Socket, [Socket](bool, int32) -> void
+	{
+		Socket->Send(FString(TEXT("R")));
+	}));
+}
+
+void URodinLoadTestCommandlet::HandleMessage(URodinWS* Socket, const FString& Message, ERodinWSOpCode OpCode)
+{
+	if (Message.Len() > 0 && Message[0] == NRodinWSLoad::Publish)
+	{
+		Server->Publish(FString(LoadTopic), Message, OpCode);
+	}
+	else
+	{
+		Socket->Send(Message);
+	}
+}
+
+void URodinLoadTestCommandlet::HandleRawMessage(URodinWS* Socket, const TArray<uint8>& Message, ERodinWSOpCode OpCode)
+{
+	if (Message.Num() > 0 && Message[0] == NRodinWSLoad::Publish)
+	{
+		// Load payloads are plain ASCII, the conversion is lossless.
+		const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Message.GetData()), Message.Num());
+		Server->Publish(FString(LoadTopic), FString(Converter.Length(), Converter.Get()), OpCode);
+	}
+	else
+	{
+		Socket->Send(Message);
+	}
+}
+
+int32 URodinLoadTestCommandlet::Main(const FString& Params)
+{
+	FRodinWSLoadSettings Settings;
+	Settings.Port = 61993;
+
+	FParse::Value(*Params, TEXT("Port="),         Settings.Port);
+	FParse::Value(*Params, TEXT("Connections="),  Settings.Connections);
+	FParse::Value(*Params, TEXT("Duration="),     Settings.DurationSeconds);
+	FParse::Value(*Params, TEXT("InFlight="),     Settings.InFlight);
+	FParse::Value(*Params, TEXT("TextRatio="),    Settings.TextRatio);
+	FParse::Value(*Params, TEXT("PublishRatio="), Settings.PublishRatio);
+	FParse::Value(*Params, TEXT("Unix="),         Settings.UnixSocketPath);
+
+	int32 BusyPoll = 0;
+	FParse::Value(*Params, TEXT("BusyPoll="), BusyPoll);
+
+	int32 RecvBufferKB = 0;
+	FParse::Value(*Params, TEXT("RecvBufferKB="), RecvBufferKB);
+
+	FString Sizes;
+	if (FParse::Value(*Params, TEXT("Sizes="), Sizes, false))
+	{
+		TArray<FString> Parts;
+		Sizes.ParseIntoArray(Parts, TEXT(","));
+
+		Settings.Sizes.Reset();
+		for (const FString& Part : Parts)
+		{
+			Settings.Sizes.Add(FCString::Atoi(*Part));
+		}
+	}
+
+	ERodinWSCompressOptions Compression = ERodinWSCompressOptions::DISABLED;
+
+	FString CompressionName;
+	if (FParse::Value(*Params, TEXT("Compression="), CompressionName))
+	{
+		const int64 Value = StaticEnum<ERodinWSCompressOptions>()->GetValueByNameString(CompressionName);
+		if (Value == INDEX_NONE)
+		{
+			UE_LOG(LogWSServer, Error, TEXT("Unknown compression option %s."), *CompressionName);
+			return 1;
+		}
+
+		Compression = static_cast<ERodinWSCompressOptions>(Value);
+	}
+
+	Settings.bCompression = Compression != ERodinWSCompressOptions::DISABLED;
+
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Rodin") / TEXT("LoadTest")
+		/ FString::Printf(TEXT("Results-%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	int32 MaxSize = 0;
+	for (const int32 Size : Settings.Sizes)
+	{
+		MaxSize = FMath::Max(MaxSize, Size);
+	}
+
+	Server = URodinWSServer::CreateRodinWSServer();
+	Server->SetCompression(Compression);
+	Server->SetBusyPoll(BusyPoll);
+	Server->SetReceiveBufferSize(RecvBufferKB);
+	Server->SetUnixSocket(Settings.UnixSocketPath, true);
+	Server->SetMaxPayloadLength(FMath::Max<int64>(MaxSize, 16 * 1024));
+	Server->SetMaxBackPressure(FMath::Max<int64>(static_cast<int64>(MaxSize) * Settings.InFlight * Settings.Connections, 1024 * 1024));
+
+	Server->OnRodinWSOpened    .AddDynamic(this, &ThisClass::HandleOpened);
+	Server->OnRodinWSMessage   .AddDynamic(this, &ThisClass::HandleMessage);
+	Server->OnRodinWSRawMessage.AddDynamic(this, &ThisClass::HandleRawMessage);
+
+	TOptional<bool> bListening;
+	Server->Listen(Settings.Host, TEXT("/*"), Settings.Port, FOnRodinWSServerListening::CreateLambda([&bListening](bool bSuccess) -> void
+	{
+		bListening = bSuccess;
+	}));
+
+	if (!NRodinCommandletUtils::PumpUntil([&bListening]() { return bListening.IsSet(); }, 10.0) || !bListening.GetValue())
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Failed to listen on %s."), *NRodinWSLoad::GetEndpoint(Settings));
+		return 1;
+	}
+
+	const FRodinWSServerStats Before = Server->GetServerStats();
+
+	FRodinWSLoadGenerator Generator(Settings);
+	Generator.Start();
+
+	NRodinCommandletUtils::PumpUntil([&Generator]() { return Generator.IsDone(); }, TNumericLimits<double>::Max());
+
+	const FRodinWSLoadResult Result = Generator.Wait();
+	const FRodinWSServerStats After = Server->GetServerStats();
+
+	Server->StopListening();
+	NRodinCommandletUtils::PumpUntil([this]() { return Server->GetServerState() == ERodinWSServerState::Closed; }, 5.0);
+
+	const double ServerCpu  = After.ServerThreadCpuSeconds >= 0.0 ? After.ServerThreadCpuSeconds - Before.ServerThreadCpuSeconds : -1.0;
+	const double Seconds    = FMath::Max(Result.Seconds, UE_SMALL_NUMBER);
+	const double Throughput = Result.MessagesReceived / Seconds;
+
+	UE_LOG(LogWSServer, Display, TEXT("[%s, %s] Connections %d ok / %d failed, %lld sent, %lld received in %.2fs: %.0f msg/s, %.2f MB/s in, p50 %.3f ms, p99 %.3f ms, max %.3f ms, server thread CPU %.1f%%, wakeup p50 %.3f ms, p99 %.3f ms."),
+		NRodinWSLoad::GetEventBackend(), Settings.UnixSocketPath.IsEmpty() ? TEXT("tcp") : TEXT("unix"), Result.Connected, Result.Failed, Result.MessagesSent, Result.MessagesReceived, Result.Seconds,
+		Throughput, Result.BytesReceived / (1024.0 * 1024.0) / Seconds,
+		Result.LatencyP50Ms, Result.LatencyP99Ms, Result.LatencyMaxMs,
+		ServerCpu >= 0.0 ? ServerCpu / Seconds * 100.0 : -1.0,
+		After.WakeupLatencyP50Ms, After.WakeupLatencyP99Ms);
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	TSharedRef<FJsonObject> Config = MakeShared<FJsonObject>();
+	Config->SetNumberField(TEXT("connections"), Settings.Connections);
+	Config->SetNumberField(TEXT("duration_s"), Settings.DurationSeconds);
+	Config->SetNumberField(TEXT("in_flight"), Settings.InFlight);
+	Config->SetNumberField(TEXT("text_ratio"), Settings.TextRatio);
+	Config->SetNumberField(TEXT("publish_ratio"), Settings.PublishRatio);
+	Config->SetStringField(TEXT("compression"), StaticEnum<ERodinWSCompressOptions>()->GetNameStringByValue(static_cast<int64>(Compression)));
+	Config->SetStringField(TEXT("event_backend"), NRodinWSLoad::GetEventBackend());
+	Config->SetNumberField(TEXT("busy_poll_us"), BusyPoll);
+	Config->SetNumberField(TEXT("recv_buffer_kb"), RecvBufferKB);
+	Config->SetStringField(TEXT("transport"), Settings.UnixSocketPath.IsEmpty() ? TEXT("tcp") : TEXT("unix"));
+
+	TArray<TSharedPtr<FJsonValue>> SizeValues;
+	for (const int32 Size : Settings.Sizes)
+	{
+		SizeValues.Add(MakeShared<FJsonValueNumber>(Size));
+	}
+	Config->SetArrayField(TEXT("sizes"), SizeValues);
+
+	Root->SetObjectField(TEXT("config"), Config);
+	Root->SetNumberField(TEXT("connected"), Result.Connected);
+	Root->SetNumberField(TEXT("failed"), Result.Failed);
+	Root->SetNumberField(TEXT("seconds"), Result.Seconds);
+	Root->SetNumberField(TEXT("messages_sent"), static_cast<double>(Result.MessagesSent));
+	Root->SetNumberField(TEXT("messages_received"), static_cast<double>(Result.MessagesReceived));
+	Root->SetNumberField(TEXT("bytes_sent"), static_cast<double>(Result.BytesSent));
+	Root->SetNumberField(TEXT("bytes_received"), static_cast<double>(Result.BytesReceived));
+	Root->SetNumberField(TEXT("messages_per_s"), Throughput);
+	Root->SetNumberField(TEXT("latency_p50_ms"), Result.LatencyP50Ms);
+	Root->SetNumberField(TEXT("latency_p99_ms"), Result.LatencyP99Ms);
+	Root->SetNumberField(TEXT("latency_max_ms"), Result.LatencyMaxMs);
+	Root->SetNumberField(TEXT("server_thread_cpu_s"), ServerCpu);
+	Root->SetNumberField(TEXT("server_wakeup_p50_ms"), After.WakeupLatencyP50Ms);
+	Root->SetNumberField(TEXT("server_wakeup_p99_ms"), After.WakeupLatencyP99Ms);
+	Root->SetNumberField(TEXT("server_backpressure_events"), static_cast<double>(After.BackpressureEvents - Before.BackpressureEvents));
+	Root->SetNumberField(TEXT("server_dropped_messages"), static_cast<double>(After.DroppedMessages - Before.DroppedMessages));
+	Root->SetNumberField(TEXT("server_compress_ratio"), After.CompressRatio);
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutputPath), true);
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Failed to write load test results to %s."), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogWSServer, Display, TEXT("Load test results written to %s."), *OutputPath);
+
+	return Result.Connected > 0 ? 0 : 1;
+}
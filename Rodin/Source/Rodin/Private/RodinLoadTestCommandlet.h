@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RodinWSServer.h"
+#include "RodinLoadTestCommandlet.generated.h"
+
+/**
+ * Starts a local URodinWSServer and loads it from loopback clients, then reports throughput,
+ * round-trip latency and server thread CPU as JSON.
+ *
+ * UnrealEditor-Cmd <Project> -run=RodinLoadTest -nullrhi -unattended
+ *     [-Port=61993] [-Connections=64] [-Duration=10] [-InFlight=1] [-Sizes=64,4096]
+ *     [-TextRatio=0.5] [-PublishRatio=0] [-Compression=DISABLED|SHARED_COMPRESSOR|DEDICATED_COMPRESSOR...]
+ *     [-BusyPoll=0] [-RecvBufferKB=0] [-Unix=<path>|@<name>] [-Output=<file.json>]
+ *
+ * Server and clients share the uSockets event loop, config.event_backend tells which one. To compare io_uring
+ * against epoll on Linux, run once from a build made with RODIN_USE_IO_URING=1 and once from a regular build.
+ * -BusyPoll sets the server loop spin budget in microseconds; weigh server_wakeup_p99_ms against server_thread_cpu_s.
+ * -RecvBufferKB sizes the server loop's receive buffer, 0 keeps the 512 KB default; large -Sizes benefit the most.
+ * -Unix moves server and clients off TCP onto a Unix domain socket (an '@' name is abstract, Linux only); run the
+ * same settings with and without it and compare messages_per_s and latency_p99_ms, config.transport tells them apart.
+ */
+UCLASS()
+class URodinLoadTestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	URodinLoadTestCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	UFUNCTION()
+	void HandleOpened(URodinWS* Socket);
+
+	UFUNCTION()
+	void HandleMessage(URodinWS* Socket, const FString& Message, ERodinWSOpCode OpCode);
+
+	UFUNCTION()
+	void HandleRawMessage(URodinWS* Socket, const TArray<uint8>& Message, ERodinWSOpCode OpCode);
+
+private:
+	UPROPERTY()
+	URodinWSServer* Server;
+};
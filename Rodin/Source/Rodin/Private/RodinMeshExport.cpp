@@ -0,0 +1,414 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinMeshExport.h"
+
+#include "RodinTrace.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/Actor.h"
+#include "StaticMeshResources.h"
+#include "Dom/JsonObject.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	constexpr uint32 GlbMagic     = 0x46546C67; // "glTF"
+	constexpr uint32 GlbChunkJson = 0x4E4F534A; // "JSON"
+	constexpr uint32 GlbChunkBin  = 0x004E4942; // "BIN\0"
+
+	constexpr int32 GltfUnsignedShort = 5123;
+	constexpr int32 GltfUnsignedInt   = 5125;
+	constexpr int32 GltfFloat         = 5126;
+
+	constexpr int32 GltfArrayBuffer        = 34962;
+	constexpr int32 GltfElementArrayBuffer = 34963;
+
+	/** Unreal is left-handed Z up in centimeters, glTF right-handed Y up in meters. */
+	FVector3f ToGltf(const FVector& Position)
+	{
+		return FVector3f(Position.X, Position.Z, Position.Y) * 0.01f;
+	}
+
+	void AppendComponent(UStaticMeshComponent* Component, NRodinMeshExport::FMeshSnapshot& OutSnapshot)
+	{
+		UStaticMesh* StaticMesh = Component->GetStaticMesh();
+		const FStaticMeshRenderData* RenderData = StaticMesh ? StaticMesh->GetRenderData() : nullptr;
+		if (!RenderData || RenderData->LODResources.Num() == 0)
+		{
+			return;
+		}
+
+		const FStaticMeshLODResources& LOD = RenderData->LODResources[0];
+		const FPositionVertexBuffer& PositionBuffer = LOD.VertexBuffers.PositionVertexBuffer;
+		const uint32 NumVertices = PositionBuffer.GetNumVertices();
+
+		TArray<uint32> LODIndices;
+		LOD.IndexBuffer.GetCopy(LODIndices);
+
+		if (NumVertices == 0 || LODIndices.Num() < 3 || !PositionBuffer.GetVertexData())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("No CPU geometry for %s, skipped"), *StaticMesh->GetName());
+			return;
+		}
+
+		TArray<FVector3f> LODPositions;
+		LODPositions.SetNumUninitialized(NumVertices);
+		for (uint32 Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			LODPositions[Vertex] = PositionBuffer.VertexPosition(Vertex);
+		}
+
+		TArray<FTransform> Transforms;
+		if (UInstancedStaticMeshComponent* Instanced = Cast<UInstancedStaticMeshComponent>(Component))
+		{
+			for (int32 Index = 0; Index < Instanced->GetInstanceCount(); ++Index)
+			{
+				Instanced->GetInstanceTransform(Index, Transforms.AddDefaulted_GetRef(), true);
+			}
+		}
+		else
+		{
+			Transforms.Add(Component->GetComponentTransform());
+		}
+
+		for (const FTransform& Transform : Transforms)
+		{
+			NRodinMeshExport::AppendTriangles(Transform, LODPositions, LODIndices, OutSnapshot);
+		}
+	}
+
+	TArray<TSharedPtr<FJsonValue>> MakeVector(const double X, const double Y, const double Z)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		Values.Add(MakeShared<FJsonValueNumber>(X));
+		Values.Add(MakeShared<FJsonValueNumber>(Y));
+		Values.Add(MakeShared<FJsonValueNumber>(Z));
+		return Values;
+	}
+
+	TSharedPtr<FJsonValue> MakeValue(const TSharedRef<FJsonObject>& Object)
+	{
+		return MakeShared<FJsonValueObject>(Object);
+	}
+
+	void AppendUInt32(TArray64<uint8>& Buffer, const uint32 Value)
+	{
+		Buffer.Append(reinterpret_cast<const uint8*>(&Value), sizeof(Value));
+	}
+
+	void PadTo4(TArray64<uint8>& Buffer, const uint8 Padding)
+	{
+		while (Buffer.Num() % 4)
+		{
+			Buffer.Add(Padding);
+		}
+	}
+}
+
+namespace NRodinMeshExport
+{
+	bool Capture(const TArray<AActor*>& Actors, FMeshSnapshot& OutSnapshot)
+	{
+		RODIN_TRACE_SCOPE("CaptureMeshes");
+		check(IsInGameThread());
+
+		TArray<AActor*> ActorsToCheck;
+		TSet<AActor*> VisitedActors;
+		for (AActor* Actor : Actors)
+		{
+			if (IsValid(Actor) && !VisitedActors.Contains(Actor))
+			{
+				ActorsToCheck.Add(Actor);
+				VisitedActors.Add(Actor);
+			}
+		}
+
+		while (ActorsToCheck.Num() > 0)
+		{
+			AActor* CurrentActor = ActorsToCheck.Pop();
+
+			TArray<UStaticMeshComponent*> Components;
+			CurrentActor->GetComponents<UStaticMeshComponent>(Components);
+			for (UStaticMeshComponent* Component : Components)
+			{
+				AppendComponent(Component, OutSnapshot);
+			}
+
+			TArray<AActor*> ChildActors;
+			CurrentActor->GetAttachedActors(ChildActors);
+			for (AActor* Child : ChildActors)
+			{
+				if (IsValid(Child) && !VisitedActors.Contains(Child))
+				{
+					ActorsToCheck.Add(Child);
+					VisitedActors.Add(Child);
+				}
+			}
+		}
+
+		return OutSnapshot.Indices.Num() > 0;
+	}
+
+	void AppendTriangles(const FTransform& Transform, TArrayView<const FVector3f> Positions, TArrayView<const uint32> Indices, FMeshSnapshot& OutSnapshot)
+	{
+		const uint32 Base = OutSnapshot.Positions.Num();
+
+		OutSnapshot.Positions.Reserve(OutSnapshot.Positions.Num() + Positions.Num());
+		for (const FVector3f& Position : Positions)
+		{
+			OutSnapshot.Positions.Add(ToGltf(Transform.TransformPosition(FVector(Position))));
+		}
+
+		// The Y/Z swap of ToGltf is a reflection, it reverses the winding of every triangle. Unreal front
+		// faces are clockwise and glTF ones counter-clockwise, which reverses it back: the index order
+		// only changes when the transform itself mirrors the mesh.
+		const bool bReverse = Transform.GetDeterminant() < 0.f;
+
+		OutSnapshot.Indices.Reserve(OutSnapshot.Indices.Num() + Indices.Num());
+		for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+		{
+			OutSnapshot.Indices.Add(Base + Indices[Index]);
+			OutSnapshot.Indices.Add(Base + Indices[Index + (bReverse ? 2 : 1)]);
+			OutSnapshot.Indices.Add(Base + Indices[Index + (bReverse ? 1 : 2)]);
+		}
+	}
+
+	void Weld(FMeshSnapshot& Snapshot, const float Tolerance)
+	{
+		RODIN_TRACE_SCOPE("WeldMesh");
+
+		// Snapshot positions are in meters.
+		const double Cell = FMath::Max(Tolerance * 0.01, 1e-6);
+
+		TMap<TTuple<int64, int64, int64>, uint32> Cells;
+		Cells.Reserve(Snapshot.Positions.Num());
+
+		TArray<uint32> Remap;
+		Remap.SetNumUninitialized(Snapshot.Positions.Num());
+
+		TArray<FVector3f> Positions;
+		Positions.Reserve(Snapshot.Positions.Num());
+
+		for (int32 Index = 0; Index < Snapshot.Positions.Num(); ++Index)
+		{
+			const FVector3f& Position = Snapshot.Positions[Index];
+			const TTuple<int64, int64, int64> Key(
+				FMath::RoundToInt64(Position.X / Cell),
+				FMath::RoundToInt64(Position.Y / Cell),
+				FMath::RoundToInt64(Position.Z / Cell));
+
+			if (const uint32* Found = Cells.Find(Key))
+			{
+				Remap[Index] = *Found;
+			}
+			else
+			{
+				Remap[Index] = Positions.Add(Position);
+				Cells.Add(Key, Remap[Index]);
+			}
+		}
+
+		TArray<uint32> Indices;
+		Indices.Reserve(Snapshot.Indices.Num());
+
+		for (int32 Index = 0; Index + 2 < Snapshot.Indices.Num(); Index += 3)
+		{
+			const uint32 A = Remap[Snapshot.Indices[Index]];
+			const uint32 B = Remap[Snapshot.Indices[Index + 1]];
+			const uint32 C = Remap[Snapshot.Indices[Index + 2]];
+
+			if (A != B && B != C && A != C)
+			{
+				Indices.Add(A);
+				Indices.Add(B);
+				Indices.Add(C);
+			}
+		}
+
+		Snapshot.Positions = MoveTemp(Positions);
+		Snapshot.Indices   = MoveTemp(Indices);
+	}
+
+	TArray64<uint8> WriteGlb(const FMeshSnapshot& Snapshot, const bool bQuantize)
+	{
+		RODIN_TRACE_SCOPE("WriteGlb");
+
+		const int32 NumVertices = Snapshot.Positions.Num();
+		if (NumVertices == 0 || Snapshot.Indices.Num() == 0)
+		{
+			return TArray64<uint8>();
+		}
+
+		FVector3f Min(TNumericLimits<float>::Max()), Max(TNumericLimits<float>::Lowest());
+		for (const FVector3f& Position : Snapshot.Positions)
+		{
+			Min = Min.ComponentMin(Position);
+			Max = Max.ComponentMax(Position);
+		}
+
+		TArray64<uint8> Bin;
+
+		FVector3f Scale(1.f);
+		FVector3f AccessorMin = Min, AccessorMax = Max;
+
+		if (bQuantize)
+		{
+			const FVector3f Extent = Max - Min;
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				Scale[Axis] = Extent[Axis] > 0.f ? Extent[Axis] / MAX_uint16 : 1.f;
+			}
+
+			AccessorMin = FVector3f(MAX_uint16);
+			AccessorMax = FVector3f(0.f);
+
+			// Vertex attributes need a 4 byte aligned stride, the 4th component is padding.
+			Bin.Reserve(static_cast<int64>(NumVertices) * 8);
+			for (const FVector3f& Position : Snapshot.Positions)
+			{
+				uint16 Quantized[4] = {};
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					Quantized[Axis] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt((Position[Axis] - Min[Axis]) / Scale[Axis]), 0, MAX_uint16));
+					AccessorMin[Axis] = FMath::Min<float>(AccessorMin[Axis], Quantized[Axis]);
+					AccessorMax[Axis] = FMath::Max<float>(AccessorMax[Axis], Quantized[Axis]);
+				}
+				Bin.Append(reinterpret_cast<const uint8*>(Quantized), sizeof(Quantized));
+			}
+		}
+		else
+		{
+			Bin.Append(reinterpret_cast<const uint8*>(Snapshot.Positions.GetData()), static_cast<int64>(NumVertices) * sizeof(FVector3f));
+		}
+
+		const int64 PositionBytes = Bin.Num();
+
+		const bool bWideIndices = NumVertices > MAX_uint16;
+		const int64 IndexOffset = PositionBytes;
+
+		if (bWideIndices)
+		{
+			Bin.Append(reinterpret_cast<const uint8*>(Snapshot.Indices.GetData()), static_cast<int64>(Snapshot.Indices.Num()) * sizeof(uint32));
+		}
+		else
+		{
+			for (const uint32 Index : Snapshot.Indices)
+			{
+				const uint16 Narrow = static_cast<uint16>(Index);
+				Bin.Append(reinterpret_cast<const uint8*>(&Narrow), sizeof(Narrow));
+			}
+		}
+
+		const int64 IndexBytes = Bin.Num() - IndexOffset;
+		PadTo4(Bin, 0);
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+		TSharedRef<FJsonObject> Asset = MakeShared<FJsonObject>();
+		Asset->SetStringField(TEXT("version"), TEXT("2.0"));
+		Asset->SetStringField(TEXT("generator"), TEXT("Rodin for Unreal"));
+		Root->SetObjectField(TEXT("asset"), Asset);
+
+		if (bQuantize)
+		{
+			TArray<TSharedPtr<FJsonValue>> Extensions;
+			Extensions.Add(MakeShared<FJsonValueString>(TEXT("KHR_mesh_quantization")));
+			Root->SetArrayField(TEXT("extensionsUsed"), Extensions);
+			Root->SetArrayField(TEXT("extensionsRequired"), Extensions);
+		}
+
+		TArray<TSharedPtr<FJsonValue>> SceneNodes;
+		SceneNodes.Add(MakeShared<FJsonValueNumber>(0));
+		TSharedRef<FJsonObject> Scene = MakeShared<FJsonObject>();
+		Scene->SetArrayField(TEXT("nodes"), SceneNodes);
+		Root->SetNumberField(TEXT("scene"), 0);
+		Root->SetArrayField(TEXT("scenes"), { MakeValue(Scene) });
+
+		TSharedRef<FJsonObject> Node = MakeShared<FJsonObject>();
+		Node->SetNumberField(TEXT("mesh"), 0);
+		if (bQuantize)
+		{
+			Node->SetArrayField(TEXT("translation"), MakeVector(Min.X, Min.Y, Min.Z));
+			Node->SetArrayField(TEXT("scale"), MakeVector(Scale.X, Scale.Y, Scale.Z));
+		}
+		Root->SetArrayField(TEXT("nodes"), { MakeValue(Node) });
+
+		TSharedRef<FJsonObject> Attributes = MakeShared<FJsonObject>();
+		Attributes->SetNumberField(TEXT("POSITION"), 0);
+		TSharedRef<FJsonObject> Primitive = MakeShared<FJsonObject>();
+		Primitive->SetObjectField(TEXT("attributes"), Attributes);
+		Primitive->SetNumberField(TEXT("indices"), 1);
+		Primitive->SetNumberField(TEXT("mode"), 4);
+		TSharedRef<FJsonObject> Mesh = MakeShared<FJsonObject>();
+		Mesh->SetArrayField(TEXT("primitives"), { MakeValue(Primitive) });
+		Root->SetArrayField(TEXT("meshes"), { MakeValue(Mesh) });
+
+		TSharedRef<FJsonObject> Buffer = MakeShared<FJsonObject>();
+		Buffer->SetNumberField(TEXT("byteLength"), static_cast<double>(Bin.Num()));
+		Root->SetArrayField(TEXT("buffers"), { MakeValue(Buffer) });
+
+		TSharedRef<FJsonObject> PositionView = MakeShared<FJsonObject>();
+		PositionView->SetNumberField(TEXT("buffer"), 0);
+		PositionView->SetNumberField(TEXT("byteOffset"), 0);
+		PositionView->SetNumberField(TEXT("byteLength"), static_cast<double>(PositionBytes));
+		if (bQuantize)
+		{
+			PositionView->SetNumberField(TEXT("byteStride"), 8);
+		}
+		PositionView->SetNumberField(TEXT("target"), GltfArrayBuffer);
+
+		TSharedRef<FJsonObject> IndexView = MakeShared<FJsonObject>();
+		IndexView->SetNumberField(TEXT("buffer"), 0);
+		IndexView->SetNumberField(TEXT("byteOffset"), static_cast<double>(IndexOffset));
+		IndexView->SetNumberField(TEXT("byteLength"), static_cast<double>(IndexBytes));
+		IndexView->SetNumberField(TEXT("target"), GltfElementArrayBuffer);
+
+		Root->SetArrayField(TEXT("bufferViews"), { MakeValue(PositionView), MakeValue(IndexView) });
+
+		TSharedRef<FJsonObject> PositionAccessor = MakeShared<FJsonObject>();
+		PositionAccessor->SetNumberField(TEXT("bufferView"), 0);
+		PositionAccessor->SetNumberField(TEXT("componentType"), bQuantize ? GltfUnsignedShort : GltfFloat);
+		PositionAccessor->SetNumberField(TEXT("count"), NumVertices);
+		PositionAccessor->SetStringField(TEXT("type"), TEXT("VEC3"));
+		PositionAccessor->SetArrayField(TEXT("min"), MakeVector(AccessorMin.X, AccessorMin.Y, AccessorMin.Z));
+		PositionAccessor->SetArrayField(TEXT("max"), MakeVector(AccessorMax.X, AccessorMax.Y, AccessorMax.Z));
+
+		TSharedRef<FJsonObject> IndexAccessor = MakeShared<FJsonObject>();
+		IndexAccessor->SetNumberField(TEXT("bufferView"), 1);
+		IndexAccessor->SetNumberField(TEXT("componentType"), bWideIndices ? GltfUnsignedInt : GltfUnsignedShort);
+		IndexAccessor->SetNumberField(TEXT("count"), Snapshot.Indices.Num());
+		IndexAccessor->SetStringField(TEXT("type"), TEXT("SCALAR"));
+
+		Root->SetArrayField(TEXT("accessors"), { MakeValue(PositionAccessor), MakeValue(IndexAccessor) });
+
+		FString Json;
+		TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+		FJsonSerializer::Serialize(Root, Writer);
+
+		const FTCHARToUTF8 JsonUtf8(*Json);
+
+		TArray64<uint8> JsonChunk;
+		JsonChunk.Append(reinterpret_cast<const uint8*>(JsonUtf8.Get()), JsonUtf8.Length());
+		PadTo4(JsonChunk, ' ');
+
+		TArray64<uint8> Glb;
+		Glb.Reserve(12 + 8 + JsonChunk.Num() + 8 + Bin.Num());
+
+		AppendUInt32(Glb, GlbMagic);
+		AppendUInt32(Glb, 2);
+		AppendUInt32(Glb, static_cast<uint32>(12 + 8 + JsonChunk.Num() + 8 + Bin.Num()));
+
+		AppendUInt32(Glb, static_cast<uint32>(JsonChunk.Num()));
+		AppendUInt32(Glb, GlbChunkJson);
+		Glb.Append(JsonChunk);
+
+		AppendUInt32(Glb, static_cast<uint32>(Bin.Num()));
+		AppendUInt32(Glb, GlbChunkBin);
+		Glb.Append(Bin);
+
+		return Glb;
+	}
+}
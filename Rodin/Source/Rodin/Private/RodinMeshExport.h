@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+
+class AActor;
+
+/**
+ * In-memory GLB export of static mesh geometry, used as the condition model of a submission.
+ * Only positions and triangles are written, that is all the condition needs.
+ */
+namespace NRodinMeshExport
+{
+	/** World space triangles, in glTF axes and meters. */
+	struct FMeshSnapshot
+	{
+		TArray<FVector3f> Positions;
+		TArray<uint32>    Indices;
+	};
+
+	/** Copies the LOD 0 triangles of every static mesh (and instance) under the actors and their attached actors. Game thread only. */
+	bool Capture(const TArray<AActor*>& Actors, FMeshSnapshot& OutSnapshot);
+
+	/** Appends the triangles of a mesh, moved by Transform and converted to glTF axes and winding. */
+	void AppendTriangles(const FTransform& Transform, TArrayView<const FVector3f> Positions, TArrayView<const uint32> Indices, FMeshSnapshot& OutSnapshot);
+
+	/** Merges vertices falling in the same Tolerance sized cell (in centimeters) and drops the triangles that collapse. */
+	void Weld(FMeshSnapshot& Snapshot, const float Tolerance);
+
+	/** Binary glTF. Quantized positions are 16-bit integers mapped back by the node transform (KHR_mesh_quantization). */
+	TArray64<uint8> WriteGlb(const FMeshSnapshot& Snapshot, const bool bQuantize);
+}
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinMessageDispatch.h"
+
+#include "Misc/StringBuilder.h"
+
+namespace
+{
+	const ANSICHAR TaskTopicPrefix[] = "task/";
+
+	/** Cursor over the message, every step checks the end so truncated input just fails. */
+	struct FScanner
+	{
+		const ANSICHAR* Cursor;
+		const ANSICHAR* End;
+
+		bool AtEnd() const
+		{
+			return Cursor >= End;
+		}
+
+		void SkipWhitespace()
+		{
+			while (!AtEnd() && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\n' || *Cursor == '\r'))
+			{
+				++Cursor;
+			}
+		}
+
+		bool Consume(const ANSICHAR Char)
+		{
+			SkipWhitespace();
+			if (AtEnd() || *Cursor != Char)
+			{
+				return false;
+			}
+			++Cursor;
+			return true;
+		}
+
+		/** Reads a string, the cursor being on its opening quote. Out spans the raw, still escaped, content. */
+		bool ReadString(const ANSICHAR*& OutBegin, int32& OutLength, bool& bOutEscaped)
+		{
+			if (!Consume('"'))
+			{
+				return false;
+			}
+
+			OutBegin = Cursor;
+			bOutEscaped = false;
+
+			while (!AtEnd())
+			{
+				if (*Cursor == '\\')
+				{
+					bOutEscaped = true;
+					Cursor += 2;
+					continue;
+				}
+
+				if (*Cursor == '"')
+				{
+					OutLength = static_cast<int32>(Cursor - OutBegin);
+					++Cursor;
+					return true;
+				}
+
+				++Cursor;
+			}
+
+			return false;
+		}
+
+		/** Skips any value: strings, numbers, literals, and whole objects or arrays by bracket depth. */
+		bool SkipValue()
+		{
+			SkipWhitespace();
+			if (AtEnd())
+			{
+				return false;
+			}
+
+			if (*Cursor == '"')
+			{
+				const ANSICHAR* Begin;
+				int32 Length;
+				bool bEscaped;
+				return ReadString(Begin, Length, bEscaped);
+			}
+
+			if (*Cursor == '{' || *Cursor == '[')
+			{
+				int32 Depth = 0;
+				while (!AtEnd())
+				{
+					switch (*Cursor)
+					{
+					case '"':
+					{
+						const ANSICHAR* Begin;
+						int32 Length;
+						bool bEscaped;
+						if (!ReadString(Begin, Length, bEscaped))
+						{
+							return false;
+						}
+						continue;
+					}
+					case '{':
+					case '[':
+						++Depth;
+						break;
+					case '}':
+					case ']':
+						if (--Depth == 0)
+						{
+							++Cursor;
+							return true;
+						}
+						break;
+					default:
+						break;
+					}
+					++Cursor;
+				}
+				return false;
+			}
+
+			while (!AtEnd() && *Cursor != ',' && *Cursor != '}' && *Cursor != ']')
+			{
+				++Cursor;
+			}
+			return true;
+		}
+	};
+}
+
+namespace NRodinMessageDispatch
+{
+	bool PeekType(TArrayView<const uint8> Message, FName& OutType)
+	{
+		FAnsiStringView Type;
+		if (!PeekString(Message, "type", Type) || Type.Len() == 0 || Type.Len() >= NAME_SIZE)
+		{
+			return false;
+		}
+
+		OutType = FName(Type.Len(), Type.GetData(), FNAME_Find);
+		return !OutType.IsNone();
+	}
+
+	bool PeekString(TArrayView<const uint8> Message, FAnsiStringView Key, FAnsiStringView& OutValue)
+	{
+		FScanner Scanner{ reinterpret_cast<const ANSICHAR*>(Message.GetData()), reinterpret_cast<const ANSICHAR*>(Message.GetData()) + Message.Num() };
+
+		if (!Scanner.Consume('{'))
+		{
+			return false;
+		}
+
+		if (Scanner.Consume('}'))
+		{
+			return false;
+		}
+
+		do
+		{
+			Scanner.SkipWhitespace();
+
+			const ANSICHAR* Name;
+			int32 NameLength;
+			bool bNameEscaped;
+			if (!Scanner.ReadString(Name, NameLength, bNameEscaped) || !Scanner.Consume(':'))
+			{
+				return false;
+			}
+
+			if (!bNameEscaped && FAnsiStringView(Name, NameLength) == Key)
+			{
+				Scanner.SkipWhitespace();
+
+				const ANSICHAR* Value;
+				int32 ValueLength;
+				bool bValueEscaped;
+				if (!Scanner.ReadString(Value, ValueLength, bValueEscaped) || bValueEscaped)
+				{
+					return false;
+				}
+
+				OutValue = FAnsiStringView(Value, ValueLength);
+				return true;
+			}
+
+			if (!Scanner.SkipValue())
+			{
+				return false;
+			}
+		}
+		while (Scanner.Consume(','));
+
+		return false;
+	}
+
+	FString MakeTaskTopic(const FString& TaskId)
+	{
+		return FString(TaskTopicPrefix) + TaskId;
+	}
+
+	bool MakeTaskTopic(FAnsiStringView TaskId, const bool bAllowWildcard, FAnsiStringBuilderBase& OutTopic)
+	{
+		if (TaskId.Len() == 0)
+		{
+			return false;
+		}
+
+		if (!(bAllowWildcard && TaskId == "+"))
+		{
+			for (const ANSICHAR Char : TaskId)
+			{
+				if (Char == '/' || Char == '+' || Char == '#')
+				{
+					return false;
+				}
+			}
+		}
+
+		OutTopic.Reset();
+		OutTopic << TaskTopicPrefix << TaskId;
+		return true;
+	}
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Routing of inbound JSON messages on their top-level "type" key, without building a DOM.
+ */
+namespace NRodinMessageDispatch
+{
+	/**
+	 * Scans a UTF-8 JSON object for its top-level "type" string. Nested values are skipped, not parsed.
+	 * Only finds names that already exist, so network input never grows the name table: a type nobody
+	 * registered a handler for yields false, as do malformed input and escaped type strings.
+	 */
+	bool PeekType(TArrayView<const uint8> Message, FName& OutType);
+
+	/**
+	 * Same scan for any top-level string. OutValue points into Message and is only set when the value has no
+	 * escape sequence, which is all that is needed to compare or key on identifiers.
+	 */
+	bool PeekString(TArrayView<const uint8> Message, FAnsiStringView Key, FAnsiStringView& OutValue);
+
+	/** Topic the messages of a task are published to, "task/<id>". */
+	FString MakeTaskTopic(const FString& TaskId);
+
+	/**
+	 * Same for an id peeked from a message. False when the id is empty or would not name exactly one topic level
+	 * ('/', '+' or '#' in it), except for "+", every task, when bAllowWildcard is set.
+	 */
+	bool MakeTaskTopic(FAnsiStringView TaskId, const bool bAllowWildcard, FAnsiStringBuilderBase& OutTopic);
+}
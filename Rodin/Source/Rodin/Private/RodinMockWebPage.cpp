@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinMockWebPage.h"
+
+#include "RodinWSTestClient.h"
+#include "RodinSyntheticData.h"
+#include "Rodin.h"
+
+#include "Misc/Base64.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	class FMockPage final : public FRodinWSTestClient
+	{
+	public:
+		FMockPage(const FRodinMockWebPageSettings& InSettings, FRodinMockWebPageResult& InResult, us_timer_t* InTimer)
+			: Settings(InSettings)
+			, Result(InResult)
+			, Timer(InTimer)
+		{
+			*static_cast<FMockPage**>(us_timer_ext(Timer)) = this;
+
+			// Encoded once, every result carries the same archive.
+			UsdzBase64 = FBase64::Encode(NRodinSyntheticData::MakeUsdz(Settings.UsdzBytes, Settings.Seed));
+		}
+
+		/** Lets the loop exit when no connection could be started. */
+		void Abort()
+		{
+			OnClosed(false);
+		}
+
+	protected:
+		virtual void OnUpgraded() override
+		{
+			Result.bConnected = true;
+
+			if (Settings.bProgressOnOpen)
+			{
+				SendText(NRodinSyntheticData::MakeProgressMessage(TEXT("open"), 0.f));
+			}
+
+			if (Settings.Tasks > 0)
+			{
+				SendText(NRodinSyntheticData::MakeFetchTaskMessage());
+			}
+		}
+
+		virtual void OnMessage(const char* Data, const SIZE_T Length, const uWS::OpCode Code) override
+		{
+			if (Code != uWS::OpCode::TEXT)
+			{
+				return;
+			}
+
+			const FUTF8ToTCHAR Converter(Data, static_cast<int32>(Length));
+			TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FString(Converter.Length(), Converter.Get()));
+
+			TSharedPtr<FJsonObject> Object;
+			if (!FJsonSerializer::Deserialize(Reader, Object) || !Object.IsValid())
+			{
+				UE_LOG(LogWSServer, Warning, TEXT("Mock web page: ignoring a message that isn't JSON."));
+				return;
+			}
+
+			FString Type;
+			if (!Object->TryGetStringField(TEXT("type"), Type) || Type != TEXT("fetch_task_return"))
+			{
+				return;
+			}
+
+			CurrentTask.Reset();
+			Object->TryGetStringField(TEXT("sid"), CurrentTask);
+
+			++Result.TasksFetched;
+			Result.TaskIds.Add(CurrentTask);
+
+			Generate();
+		}
+
+		virtual void OnClosed(const bool /*bWasUpgraded*/) override
+		{
+			if (Timer)
+			{
+				us_timer_close(Timer);
+				Timer = nullptr;
+			}
+		}
+
+	private:
+		void SendText(const FString& Message, const SIZE_T FragmentSize = 0)
+		{
+			const FTCHARToUTF8 Converter(*Message);
+			Send(Converter.Get(), Converter.Length(), uWS::OpCode::TEXT, FragmentSize);
+		}
+
+		void Generate()
+		{
+			Step = 0;
+
+			if (Settings.LatencyMs <= 0.0)
+			{
+				Finish();
+				return;
+			}
+
+			const int32 Interval = FMath::Max(1, FMath::RoundToInt(Settings.LatencyMs / (Settings.ProgressMessages + 1)));
+			us_timer_set(Timer, &FMockPage::OnTimer, Interval, Interval);
+		}
+
+		void Finish()
+		{
+			if (Timer)
+			{
+				us_timer_set(Timer, &FMockPage::OnTimer, 0, 0);
+			}
+
+			const FString Message = NRodinSyntheticData::MakeResultMessage(CurrentTask, UsdzBase64, Settings.UsdzBytes);
+			SendText(Message, FMath::Max(Settings.ChunkBytes, 0));
+
+			++Result.ResultsSent;
+			Result.ResultBytes += Message.Len();
+
+			if (Result.TasksFetched < Settings.Tasks)
+			{
+				SendText(NRodinSyntheticData::MakeFetchTaskMessage());
+			}
+		}
+
+		static void OnTimer(us_timer_t* InTimer)
+		{
+			FMockPage* const Self = *static_cast<FMockPage**>(us_timer_ext(InTimer));
+
+			if (Self->Step < Self->Settings.ProgressMessages)
+			{
+				++Self->Step;
+
+				const float Progress = static_cast<float>(Self->Step) / (Self->Settings.ProgressMessages + 1);
+				Self->SendText(NRodinSyntheticData::MakeProgressMessage(Self->CurrentTask, Progress));
+				return;
+			}
+
+			Self->Finish();
+		}
+
+	private:
+		const FRodinMockWebPageSettings& Settings;
+		FRodinMockWebPageResult&         Result;
+
+		us_timer_t* Timer;
+
+		FString UsdzBase64;
+		FString CurrentTask;
+
+		int32 Step = 0;
+	};
+
+	void OnLoopNoop(us_loop_t* /*Loop*/)
+	{
+	}
+}
+
+FRodinMockWebPage::FRodinMockWebPage(const FRodinMockWebPageSettings& InSettings)
+	: Settings(InSettings)
+	, bDone(false)
+{
+}
+
+FRodinMockWebPage::~FRodinMockWebPage()
+{
+	if (Thread && Thread->joinable())
+	{
+		Thread->join();
+	}
+}
+
+void FRodinMockWebPage::Start()
+{
+	check(!Thread);
+
+	Thread.Reset(new std::thread([this]() -> void
+	{
+		Run();
+		bDone = true;
+	}));
+}
+
+bool FRodinMockWebPage::IsDone() const
+{
+	return bDone;
+}
+
+FRodinMockWebPageResult FRodinMockWebPage::Wait()
+{
+	if (Thread && Thread->joinable())
+	{
+		Thread->join();
+	}
+
+	return Result;
+}
+
+void FRodinMockWebPage::Run()
+{
+	us_loop_t* const Loop = us_create_loop(nullptr, &OnLoopNoop, &OnLoopNoop, &OnLoopNoop, 0);
+	if (!Loop)
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Mock web page: could not create an event loop."));
+		return;
+	}
+
+	us_socket_context_options_t Options = {};
+	us_socket_context_t* const Context = us_create_socket_context(0, Loop, 0, Options);
+	FRodinWSTestClient::InitContext(Context);
+
+	{
+		TUniquePtr<FMockPage> Page = MakeUnique<FMockPage>(Settings, Result, us_create_timer(Loop, 0, sizeof(FMockPage*)));
+
+		if (!Page->Connect(Context, Settings.Host, Settings.Port, Settings.Path, false))
+		{
+			UE_LOG(LogWSServer, Error, TEXT("Mock web page: could not connect to %s:%d."), *Settings.Host, Settings.Port);
+			Page->Abort();
+		}
+
+		us_loop_run(Loop);
+	}
+
+	us_socket_context_free(0, Context);
+	us_loop_free(Loop);
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <atomic>
+#include <thread>
+THIRD_PARTY_INCLUDES_END
+
+struct FRodinMockWebPageSettings
+{
+	FString Host = TEXT("127.0.0.1");
+	int32   Port = 0;
+	FString Path = TEXT("/");
+
+	/** Tasks fetched before going idle, 0 only connects. */
+	int32 Tasks = 5;
+
+	/** Simulated generation time between fetch_task_return and the result. */
+	double LatencyMs = 0.0;
+
+	/** Progress messages spread over the generation time. */
+	int32 ProgressMessages = 0;
+
+	int64 UsdzBytes = 4 * 1024 * 1024;
+
+	/** Fragment size of the result message, 0 sends it as a single frame. */
+	int32 ChunkBytes = 0;
+
+	/** Sends a progress message as soon as the connection is upgraded, before the editor may have its side of the socket. */
+	bool bProgressOnOpen = true;
+
+	int32 Seed = 0;
+};
+
+struct FRodinMockWebPageResult
+{
+	bool bConnected = false;
+
+	int32 TasksFetched = 0;
+	int32 ResultsSent  = 0;
+
+	int64 ResultBytes = 0;
+
+	TArray<FString> TaskIds;
+};
+
+/**
+ * Stand-in for the hyper3d.ai page on the other side of the bridge.
+ *
+ * Connects to the bridge server, polls with fetch_task, answers every fetch_task_return with
+ * optional progress messages then a send_model result carrying a synthetic USDZ, as ST_MessageParse expects.
+ * Runs on its own uSockets loop until the server closes the connection.
+ */
+class FRodinMockWebPage
+{
+public:
+	explicit FRodinMockWebPage(const FRodinMockWebPageSettings& InSettings);
+	FRodinMockWebPage(const FRodinMockWebPage&) = delete;
+	~FRodinMockWebPage();
+
+	void Start();
+
+	bool IsDone() const;
+
+	/** Blocks until the connection is gone. */
+	FRodinMockWebPageResult Wait();
+
+private:
+	void Run();
+
+private:
+	const FRodinMockWebPageSettings Settings;
+
+	TUniquePtr<std::thread> Thread;
+
+	std::atomic<bool> bDone;
+
+	FRodinMockWebPageResult Result;
+};
@@ -0,0 +1,1272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinShmTransport.h"
+
+#include "RodinWSPool.h"
+#include "RodinTrace.h"
+#include "Async/Async.h"
+
+#if PLATFORM_LINUX
+THIRD_PARTY_INCLUDES_START
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+THIRD_PARTY_INCLUDES_END
+#endif
+
+///////////////////////////////////////////////////////////////
+// FRodinShmRing
+
+FRodinShmRing::FRodinShmRing(FRodinShmRingHeader* InHeader, uint8* InData, const uint64 InCapacity)
+	: Header(InHeader)
+	, Data(InData)
+	, Capacity(InCapacity)
+{
+}
+
+uint32 FRodinShmRing::GetMaxPayload(const uint64 Capacity)
+{
+	return static_cast<uint32>(FMath::Min<uint64>(Capacity / 2 - sizeof(FRodinShmRecord), MAX_uint32));
+}
+
+bool FRodinShmRing::HasRoom(const uint64 Tail, const uint64 Needed) const
+{
+	return Capacity - (Tail - Header->Head.load(std::memory_order_seq_cst)) >= Needed;
+}
+
+uint8* FRodinShmRing::BeginWrite(const uint32 Length)
+{
+	if (Length > GetMaxPayload(Capacity))
+	{
+		return nullptr;
+	}
+
+	const uint64 Size       = Align(sizeof(FRodinShmRecord) + Length, NRodinShm::RecordAlignment);
+	const uint64 Tail       = Header->Tail.load(std::memory_order_relaxed);
+	const uint64 Contiguous = Capacity - (Tail & (Capacity - 1));
+	const uint64 Skip       = Contiguous < Size ? Contiguous : 0;
+
+	if (!HasRoom(Tail, Skip + Size))
+	{
+		// Flag before looking again: either the reader sees the flag, or we see the room it freed.
+		Header->bWriterWaiting.store(1, std::memory_order_seq_cst);
+
+		if (!HasRoom(Tail, Skip + Size))
+		{
+			return nullptr;
+		}
+	}
+
+	PendingSkip = Skip;
+
+	return Data + ((Tail + Skip) & (Capacity - 1)) + sizeof(FRodinShmRecord);
+}
+
+bool FRodinShmRing::CommitWrite(const uint32 Length, const uint8 OpCode)
+{
+	const uint64 Tail = Header->Tail.load(std::memory_order_relaxed);
+
+	if (PendingSkip > 0)
+	{
+		FRodinShmRecord* const Padding = reinterpret_cast<FRodinShmRecord*>(Data + (Tail & (Capacity - 1)));
+		Padding->Length = static_cast<uint32>(PendingSkip - sizeof(FRodinShmRecord));
+		Padding->OpCode = NRodinShm::Wrap;
+	}
+
+	FRodinShmRecord* const Record = reinterpret_cast<FRodinShmRecord*>(Data + ((Tail + PendingSkip) & (Capacity - 1)));
+	Record->Length = Length;
+	Record->OpCode = OpCode;
+
+	Header->Tail.store(Tail + PendingSkip + Align(sizeof(FRodinShmRecord) + Length, NRodinShm::RecordAlignment), std::memory_order_seq_cst);
+	PendingSkip = 0;
+
+	// The reader had caught up with everything before this record, it may be asleep.
+	return Header->Head.load(std::memory_order_seq_cst) == Tail;
+}
+
+ERodinShmRead FRodinShmRing::Peek(FRodinShmRecord& OutRecord, const uint8*& OutPayload)
+{
+	uint64 Head = Header->Head.load(std::memory_order_relaxed);
+	const uint64 Tail = Header->Tail.load(std::memory_order_seq_cst);
+
+	if (Head == Tail)
+	{
+		return ERodinShmRead::Empty;
+	}
+
+	// The other side may be hostile: read each header once and check it against what we know.
+	FRodinShmRecord Record;
+	FMemory::Memcpy(&Record, Data + (Head & (Capacity - 1)), sizeof(FRodinShmRecord));
+
+	if (Tail - Head > Capacity || (Head & (NRodinShm::RecordAlignment - 1)) != 0)
+	{
+		return ERodinShmRead::Corrupt;
+	}
+
+	if (Record.OpCode == NRodinShm::Wrap)
+	{
+		const uint64 Contiguous = Capacity - (Head & (Capacity - 1));
+		if (Record.Length + sizeof(FRodinShmRecord) != Contiguous || Tail - Head <= Contiguous)
+		{
+			return ERodinShmRead::Corrupt;
+		}
+
+		Head += Contiguous;
+		FMemory::Memcpy(&Record, Data, sizeof(FRodinShmRecord));
+	}
+
+	const uint64 Size = Align(sizeof(FRodinShmRecord) + static_cast<uint64>(Record.Length), NRodinShm::RecordAlignment);
+	if (Record.OpCode == NRodinShm::Wrap || Size > Tail - Head || Size > Capacity - (Head & (Capacity - 1)))
+	{
+		return ERodinShmRead::Corrupt;
+	}
+
+	OutRecord  = Record;
+	OutPayload = Data + (Head & (Capacity - 1)) + sizeof(FRodinShmRecord);
+	PeekedEnd  = Head + Size;
+
+	return ERodinShmRead::Ready;
+}
+
+bool FRodinShmRing::Pop()
+{
+	Header->Head.store(PeekedEnd, std::memory_order_seq_cst);
+
+	return Header->bWriterWaiting.load(std::memory_order_seq_cst) != 0
+		&& Header->bWriterWaiting.exchange(0, std::memory_order_seq_cst) != 0;
+}
+
+#if PLATFORM_LINUX
+
+class FRodinShmConnection;
+
+namespace
+{
+	/** epoll tags of the transport's own fds, connections use pointers to their FWatch. */
+	constexpr uint64 ListenTag = 0;
+	constexpr uint64 WakeTag   = 1;
+
+	constexpr int32 MaxEvents = 64;
+
+	/** Records read from one connection before the others get a turn. */
+	constexpr int32 MaxReadBatch = 256;
+
+	/** Shared-memory socket IDs count down from the top so they never meet the WebSocket ones. */
+	std::atomic<uint64> NextSocketId(MAX_uint64);
+
+	socklen_t MakeAddress(const FString& Path, sockaddr_un& OutAddress)
+	{
+		const FTCHARToUTF8 Utf8Path(*Path);
+
+		FMemory::Memzero(OutAddress);
+		OutAddress.sun_family = AF_UNIX;
+
+		if (Utf8Path.Length() == 0 || Utf8Path.Length() >= static_cast<int32>(sizeof(OutAddress.sun_path)))
+		{
+			return 0;
+		}
+
+		FMemory::Memcpy(OutAddress.sun_path, Utf8Path.Get(), Utf8Path.Length());
+
+		if (OutAddress.sun_path[0] == '@')
+		{
+			OutAddress.sun_path[0] = 0;
+			return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + Utf8Path.Length());
+		}
+
+		return sizeof(sockaddr_un);
+	}
+
+	void Signal(const int32 Fd)
+	{
+		const uint64 One = 1;
+		const ssize_t Written = write(Fd, &One, sizeof(One));
+		(void)Written;
+	}
+
+	void Drain(const int32 Fd)
+	{
+		uint64 Value;
+		const ssize_t Read = read(Fd, &Value, sizeof(Value));
+		(void)Read;
+	}
+
+	TArray<uint8> MakeClosePayload(const int32 Code, const FString& Reason)
+	{
+		const FTCHARToUTF8 Utf8Reason(*Reason);
+
+		TArray<uint8> Payload;
+		Payload.Reserve(2 + Utf8Reason.Length());
+		Payload.Add(static_cast<uint8>((Code >> 8) & 0xFF));
+		Payload.Add(static_cast<uint8>(Code & 0xFF));
+		Payload.Append(reinterpret_cast<const uint8*>(Utf8Reason.Get()), Utf8Reason.Length());
+
+		return Payload;
+	}
+
+	enum class EWatch : uint8
+	{
+		Control,
+		Event
+	};
+
+	struct FWatch
+	{
+		EWatch Kind;
+		FRodinShmConnection* Connection;
+	};
+}
+
+///////////////////////////////////////////////////////////////
+// FRodinShmConnection
+
+class FRodinShmConnection
+{
+public:
+	FRodinShmConnection(const int32 InControlFd, const int32 InServerEvent, const int32 InClientEvent, void* InMapping, const uint64 InRingCapacity)
+		: ControlFd(InControlFd)
+		, ServerEvent(InServerEvent)
+		, ClientEvent(InClientEvent)
+		, Mapping(InMapping)
+		, RingCapacity(InRingCapacity)
+		, ControlWatch{ EWatch::Control, this }
+		, EventWatch{ EWatch::Event, this }
+	{
+		FRodinShmSegment* const Segment = static_cast<FRodinShmSegment*>(Mapping);
+		uint8* const RingData = static_cast<uint8*>(Mapping) + FRodinShmSegment::GetDataOffset();
+
+		In  = FRodinShmRing(&Segment->ToServer, RingData, RingCapacity);
+		Out = FRodinShmRing(&Segment->ToClient, RingData + RingCapacity, RingCapacity);
+	}
+
+	~FRodinShmConnection()
+	{
+		close(ControlFd);
+		close(ServerEvent);
+		close(ClientEvent);
+		munmap(Mapping, FRodinShmSegment::GetSize(RingCapacity));
+	}
+
+	/** Writes the message, or queues it behind earlier ones until the feeder makes room. False when it can never fit. */
+	bool Send(TConstArrayView<uint8> Payload, const uint8 OpCode, bool& bOutQueued)
+	{
+		bOutQueued = false;
+
+		if (static_cast<uint32>(Payload.Num()) > FRodinShmRing::GetMaxPayload(RingCapacity))
+		{
+			return false;
+		}
+
+		if (Backlog.Num() == 0)
+		{
+			if (uint8* const Destination = Out.BeginWrite(Payload.Num()))
+			{
+				FMemory::Memcpy(Destination, Payload.GetData(), Payload.Num());
+
+				if (Out.CommitWrite(Payload.Num(), OpCode))
+				{
+					Signal(ClientEvent);
+				}
+				return true;
+			}
+		}
+
+		Backlog.Add(FQueuedMessage{ TArray<uint8>(Payload.GetData(), Payload.Num()), OpCode });
+		BackloggedBytes += Payload.Num();
+		bOutQueued = true;
+
+		return true;
+	}
+
+	/** Moves queued messages to the ring as far as it has room. */
+	void Flush()
+	{
+		bool bWakeReader = false;
+
+		int32 Written = 0;
+		for (; Written < Backlog.Num(); ++Written)
+		{
+			const FQueuedMessage& Message = Backlog[Written];
+
+			uint8* const Destination = Out.BeginWrite(Message.Payload.Num());
+			if (!Destination)
+			{
+				break;
+			}
+
+			FMemory::Memcpy(Destination, Message.Payload.GetData(), Message.Payload.Num());
+			bWakeReader |= Out.CommitWrite(Message.Payload.Num(), Message.OpCode);
+
+			BackloggedBytes -= Message.Payload.Num();
+		}
+
+		Backlog.RemoveAt(0, Written, false);
+
+		if (bWakeReader)
+		{
+			Signal(ClientEvent);
+		}
+	}
+
+public:
+	const int32 ControlFd;
+	const int32 ServerEvent;
+	const int32 ClientEvent;
+
+	void* const  Mapping;
+	const uint64 RingCapacity;
+
+	FWatch ControlWatch;
+	FWatch EventWatch;
+
+	FRodinShmRing In;
+	FRodinShmRing Out;
+
+	TSharedPtr<class FRodinShmProxy, ESPMode::ThreadSafe> Proxy;
+
+	struct FQueuedMessage
+	{
+		TArray<uint8> Payload;
+		uint8         OpCode;
+	};
+
+	TArray<FQueuedMessage> Backlog;
+	uint64 BackloggedBytes = 0;
+
+	bool bClosed = false;
+};
+
+///////////////////////////////////////////////////////////////
+// FRodinShmProxy
+
+class FRodinShmProxy final
+	: public IRodinWSProxy
+	, public TSharedFromThis<FRodinShmProxy, ESPMode::ThreadSafe>
+{
+public:
+	FRodinShmProxy(const TSharedRef<FRodinShmTransport, ESPMode::ThreadSafe>& InTransport, FRodinShmConnection* InConnection)
+		: Transport(InTransport)
+		, Stats(InTransport->GetSettings().Stats)
+		, Connection(InConnection)
+		, bIsSocketValid(true)
+		, SocketId(NextSocketId.fetch_sub(1, std::memory_order_relaxed))
+	{
+	}
+
+	/** Transport thread. */
+	void OnOpen(const FOnOpened& UserCallback)
+	{
+		Stats->OnSocketOpened();
+
+		AsyncTask(ENamedThreads::GameThread, [Self = this->AsShared(), UserCallback]() -> void
+		{
+			Self->RodinWS = FRodinWSPool::Get().Acquire();
+
+			URodinWS* const NewRodinWS = Self->RodinWS.Get();
+			NewRodinWS->SocketProxy = Self;
+			NewRodinWS->SocketId    = Self->SocketId;
+
+			UserCallback.ExecuteIfBound(NewRodinWS);
+		});
+	}
+
+	/** Transport thread. Message points into the ring. */
+	void OnMessage(TConstArrayView<uint8> Message, const ERodinWSOpCode Code, const FRodinShmTransport::FSettings& Settings)
+	{
+		RODIN_TRACE_SCOPE("ShmProxy::OnMessage");
+
+		Stats->OnMessageReceived(Code, Message.Num());
+
+		if (Settings.ServerThreadHandler.IsBound() && Settings.ServerThreadHandler.Execute(SocketId, Message, Code))
+		{
+			return;
+		}
+
+		AsyncTask(ENamedThreads::GameThread,
+			[
+				Self           = this->AsShared(),
+				BinMessage     = TArray<uint8>(Message.GetData(), Message.Num()),
+				UserCallback   = Settings.OnMessage,
+				ReceivedCycles = FPlatformTime::Cycles64(),
+				Code
+			]() -> void
+		{
+			RODIN_TRACE_SCOPE("ShmProxy::DeliverMessage");
+
+			check(Self->RodinWS.IsValid());
+
+			Self->Stats->OnDelivered(ReceivedCycles);
+
+			UserCallback.ExecuteIfBound(Self->RodinWS.Get(), BinMessage, Code);
+		});
+	}
+
+	/** Transport thread. */
+	void OnClosed(const int32 Code, FString&& Reason, const FOnClosed& UserCallback)
+	{
+		bIsSocketValid = false;
+		Connection     = nullptr;
+
+		Stats->OnSocketClosed();
+
+		AsyncTask(ENamedThreads::GameThread, [Self = this->AsShared(), Reason = MoveTemp(Reason), UserCallback, Code]() -> void
+		{
+			check(Self->RodinWS.IsValid());
+
+			UserCallback.ExecuteIfBound(Self->RodinWS.Get(), Code, Reason);
+
+			// Also clears the object's SocketProxy.
+			FRodinWSPool::Get().Release(Self->RodinWS);
+		});
+	}
+
+	virtual void SendMessage(FString&& Message) override
+	{
+		ExecuteOnTransportThread([Self = this->AsShared(), Message = MoveTemp(Message)](FRodinShmTransport&, FRodinShmConnection& InConnection) -> void
+		{
+			const FTCHARToUTF8 Utf8Message(*Message);
+			Self->Send(InConnection, TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Utf8Message.Get()), Utf8Message.Length()), ERodinWSOpCode::TEXT);
+		});
+	}
+
+	virtual void SendData(TArray<uint8>&& Data) override
+	{
+		ExecuteOnTransportThread([Self = this->AsShared(), Data = MoveTemp(Data)](FRodinShmTransport&, FRodinShmConnection& InConnection) -> void
+		{
+			Self->Send(InConnection, Data, ERodinWSOpCode::BINARY);
+		});
+	}
+
+	virtual void Close() override
+	{
+		ExecuteOnTransportThread([](FRodinShmTransport& InTransport, FRodinShmConnection& InConnection) -> void
+		{
+			InTransport.CloseConnection(InConnection, 1006, FString());
+		});
+	}
+
+	virtual void End(const int32 Code, FString&& Message) override
+	{
+		ExecuteOnTransportThread([Self = this->AsShared(), Code, Message = MoveTemp(Message)](FRodinShmTransport& InTransport, FRodinShmConnection& InConnection) mutable -> void
+		{
+			Self->Send(InConnection, MakeClosePayload(Code, Message), ERodinWSOpCode::CLOSE);
+			InTransport.CloseConnection(InConnection, Code, MoveTemp(Message));
+		});
+	}
+
+	virtual void Ping(FString&& Message) override
+	{
+		ExecuteOnTransportThread([Self = this->AsShared(), Message = MoveTemp(Message)](FRodinShmTransport&, FRodinShmConnection& InConnection) -> void
+		{
+			const FTCHARToUTF8 Utf8Message(*Message);
+			Self->Send(InConnection, TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Utf8Message.Get()), Utf8Message.Length()), ERodinWSOpCode::PING);
+		});
+	}
+
+	virtual void Pong(FString&& Message) override
+	{
+		ExecuteOnTransportThread([Self = this->AsShared(), Message = MoveTemp(Message)](FRodinShmTransport&, FRodinShmConnection& InConnection) -> void
+		{
+			const FTCHARToUTF8 Utf8Message(*Message);
+			Self->Send(InConnection, TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Utf8Message.Get()), Utf8Message.Length()), ERodinWSOpCode::PONG);
+		});
+	}
+
+	virtual bool IsSocketValid() const override
+	{
+		return bIsSocketValid;
+	}
+
+	virtual void Subscribe(FString&& Topic, FOnRodinWSSubscribed&& Callback, bool bNonStrict) override
+	{
+		Callback.ExecuteIfBound(false, 0);
+	}
+
+	virtual void Unsubscribe(FString&& Topic, FOnRodinWSSubscribed&& Callback, bool bNonStrict) override
+	{
+		Callback.ExecuteIfBound(false, 0);
+	}
+
+	virtual void Publish(FString&& Topic, FString&& Message, FOnRodinWSPublished&& Callback) override
+	{
+		Callback.ExecuteIfBound(false);
+	}
+
+	/** Transport thread. */
+	void Send(FRodinShmConnection& InConnection, TConstArrayView<uint8> Payload, const ERodinWSOpCode Code)
+	{
+		bool bQueued = false;
+		const bool bSent = InConnection.Send(Payload, static_cast<uint8>(Code), bQueued);
+
+		if (!bSent)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Dropped a %d bytes message, the shared-memory ring takes at most %u."),
+				Payload.Num(), FRodinShmRing::GetMaxPayload(InConnection.RingCapacity));
+		}
+
+		Stats->OnMessageSent(Code, Payload.Num(), Align(sizeof(FRodinShmRecord) + Payload.Num(), NRodinShm::RecordAlignment), false,
+			bQueued, !bSent, InConnection.BackloggedBytes);
+	}
+
+private:
+	void ExecuteOnTransportThread(TUniqueFunction<void(FRodinShmTransport&, FRodinShmConnection&)>&& Function)
+	{
+		if (!bIsSocketValid)
+		{
+			return;
+		}
+
+		const TSharedPtr<FRodinShmTransport, ESPMode::ThreadSafe> PinnedTransport = Transport.Pin();
+		if (!PinnedTransport)
+		{
+			return;
+		}
+
+		PinnedTransport->Execute([Self = this->AsShared(), Function = MoveTemp(Function), Owner = PinnedTransport.Get()]() -> void
+		{
+			if (Self->Connection)
+			{
+				Function(*Owner, *Self->Connection);
+			}
+		});
+	}
+
+private:
+	TWeakPtr<FRodinShmTransport, ESPMode::ThreadSafe> Transport;
+
+	const FRodinWSServerCountersPtr Stats;
+
+	/** Transport thread only, null once closed. */
+	FRodinShmConnection* Connection;
+
+	TAtomic<bool> bIsSocketValid;
+
+	/** Pooled socket object, released when the close is delivered. */
+	FRodinWSHandle RodinWS;
+
+	const uint64 SocketId;
+};
+
+#endif // PLATFORM_LINUX
+
+///////////////////////////////////////////////////////////////
+// FRodinShmTransport
+
+FRodinShmTransport::FRodinShmTransport(FSettings&& InSettings)
+	: Settings(MoveTemp(InSettings))
+	, ListenFd(-1)
+	, WakeFd(-1)
+	, PollFd(-1)
+	, bStopping(false)
+{
+}
+
+FRodinShmTransport::~FRodinShmTransport()
+{
+	Stop();
+
+#if PLATFORM_LINUX
+	// Closed last, proxies still pinning us may signal it.
+	for (const int32 Fd : { ListenFd, WakeFd, PollFd })
+	{
+		if (Fd >= 0)
+		{
+			close(Fd);
+		}
+	}
+#endif
+}
+
+#if PLATFORM_LINUX
+
+bool FRodinShmTransport::Start()
+{
+	check(!Thread);
+
+	sockaddr_un Address;
+	const socklen_t AddressLength = MakeAddress(Settings.Path, Address);
+	if (AddressLength == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Invalid shared-memory socket path %s."), *Settings.Path);
+		return false;
+	}
+
+	ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	WakeFd   = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	PollFd   = epoll_create1(EPOLL_CLOEXEC);
+
+	if (ListenFd < 0 || WakeFd < 0 || PollFd < 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to create the shared-memory transport: %s."), UTF8_TO_TCHAR(strerror(errno)));
+		return false;
+	}
+
+	// Same as the WebSocket unix listener: a socket file left behind by a crash is ours to replace.
+	if (Address.sun_path[0])
+	{
+		struct stat Status;
+		if (stat(Address.sun_path, &Status) == 0 && S_ISSOCK(Status.st_mode))
+		{
+			unlink(Address.sun_path);
+		}
+	}
+
+	if (bind(ListenFd, reinterpret_cast<const sockaddr*>(&Address), AddressLength) != 0 || listen(ListenFd, 64) != 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to listen for shared-memory feeders on %s: %s."), *Settings.Path, UTF8_TO_TCHAR(strerror(errno)));
+		return false;
+	}
+
+	epoll_event ListenEvent = {};
+	ListenEvent.events   = EPOLLIN;
+	ListenEvent.data.u64 = ListenTag;
+
+	epoll_event WakeEvent = {};
+	WakeEvent.events   = EPOLLIN;
+	WakeEvent.data.u64 = WakeTag;
+
+	epoll_ctl(PollFd, EPOLL_CTL_ADD, ListenFd, &ListenEvent);
+	epoll_ctl(PollFd, EPOLL_CTL_ADD, WakeFd, &WakeEvent);
+
+	UE_LOG(LogTemp, Log, TEXT("Shared-memory transport listening on %s, %llu MB rings."), *Settings.Path, Settings.RingCapacity >> 20);
+
+	Thread.Reset(new std::thread([this]() -> void
+	{
+		Run();
+	}));
+
+	return true;
+}
+
+void FRodinShmTransport::Stop()
+{
+	if (!Thread)
+	{
+		return;
+	}
+
+	bStopping = true;
+	Signal(WakeFd);
+
+	Thread->join();
+	Thread.Reset();
+
+	sockaddr_un Address;
+	if (MakeAddress(Settings.Path, Address) > 0 && Address.sun_path[0])
+	{
+		unlink(Address.sun_path);
+	}
+}
+
+void FRodinShmTransport::Execute(TUniqueFunction<void()>&& InWork)
+{
+	if (bStopping)
+	{
+		return;
+	}
+
+	Work.Enqueue(MoveTemp(InWork));
+	Signal(WakeFd);
+}
+
+void FRodinShmTransport::Run()
+{
+	epoll_event Events[MaxEvents];
+
+	while (!bStopping)
+	{
+		const int32 Count = epoll_wait(PollFd, Events, MaxEvents, -1);
+		if (Count < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			UE_LOG(LogTemp, Error, TEXT("Shared-memory transport stopped polling: %s."), UTF8_TO_TCHAR(strerror(errno)));
+			break;
+		}
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const epoll_event& Event = Events[Index];
+
+			if (Event.data.u64 == ListenTag)
+			{
+				Accept();
+				continue;
+			}
+
+			if (Event.data.u64 == WakeTag)
+			{
+				Drain(WakeFd);
+				RunWork();
+				continue;
+			}
+
+			const FWatch* const Watch = static_cast<const FWatch*>(Event.data.ptr);
+
+			// Closed earlier in this batch, freed after it.
+			if (Watch->Connection->bClosed)
+			{
+				continue;
+			}
+
+			if (Watch->Kind == EWatch::Control)
+			{
+				ReadControl(*Watch->Connection, Event.events);
+			}
+			else
+			{
+				Drain(Watch->Connection->ServerEvent);
+
+				// A wake means room for our backlog, data for us, or both.
+				Watch->Connection->Flush();
+				Read(*Watch->Connection);
+			}
+		}
+
+		Connections.RemoveAll([](const TUniquePtr<FRodinShmConnection>& Connection) -> bool
+		{
+			return Connection->bClosed;
+		});
+	}
+
+	// Sends nobody will read anymore.
+	Work.Empty();
+
+	for (const TUniquePtr<FRodinShmConnection>& Connection : Connections)
+	{
+		CloseConnection(*Connection, -1, TEXT("Server Closed"));
+	}
+	Connections.Reset();
+}
+
+void FRodinShmTransport::RunWork()
+{
+	TUniqueFunction<void()> Function;
+	while (Work.Dequeue(Function))
+	{
+		Function();
+	}
+}
+
+void FRodinShmTransport::Accept()
+{
+	for (;;)
+	{
+		const int32 ControlFd = accept4(ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (ControlFd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Failed to accept a shared-memory feeder: %s."), UTF8_TO_TCHAR(strerror(errno)));
+			}
+			return;
+		}
+
+		const uint64 Size = FRodinShmSegment::GetSize(Settings.RingCapacity);
+
+		const int32 MemFd       = memfd_create("rodin-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+		const int32 ServerEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		const int32 ClientEvent = eventfd(0, EFD_CLOEXEC);
+
+		void* Mapping = MAP_FAILED;
+
+		// Sealed so the feeder can't shrink the segment under us, our next access would fault.
+		bool bReady = MemFd >= 0 && ServerEvent >= 0 && ClientEvent >= 0
+			&& ftruncate(MemFd, static_cast<off_t>(Size)) == 0
+			&& fcntl(MemFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0
+			&& (Mapping = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, MemFd, 0)) != MAP_FAILED;
+
+		if (bReady)
+		{
+			FRodinShmSegment* const Segment = new (Mapping) FRodinShmSegment();
+			Segment->Magic        = NRodinShm::Magic;
+			Segment->Version      = NRodinShm::Version;
+			Segment->RingCapacity = Settings.RingCapacity;
+
+			const int32 Fds[3] = { MemFd, ServerEvent, ClientEvent };
+
+			alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(Fds))] = {};
+			char Byte = 'R';
+			iovec Vector = { &Byte, 1 };
+
+			msghdr Message = {};
+			Message.msg_iov        = &Vector;
+			Message.msg_iovlen     = 1;
+			Message.msg_control    = Control;
+			Message.msg_controllen = sizeof(Control);
+
+			cmsghdr* const Header = CMSG_FIRSTHDR(&Message);
+			Header->cmsg_level = SOL_SOCKET;
+			Header->cmsg_type  = SCM_RIGHTS;
+			Header->cmsg_len   = CMSG_LEN(sizeof(Fds));
+			FMemory::Memcpy(CMSG_DATA(Header), Fds, sizeof(Fds));
+
+			bReady = sendmsg(ControlFd, &Message, MSG_NOSIGNAL) == 1;
+		}
+
+		// The mapping keeps the memory alive, the feeder has its own fd.
+		if (MemFd >= 0)
+		{
+			close(MemFd);
+		}
+
+		if (!bReady)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to set up a shared-memory feeder: %s."), UTF8_TO_TCHAR(strerror(errno)));
+
+			if (Mapping != MAP_FAILED)
+			{
+				munmap(Mapping, Size);
+			}
+			for (const int32 Fd : { ServerEvent, ClientEvent, ControlFd })
+			{
+				if (Fd >= 0)
+				{
+					close(Fd);
+				}
+			}
+			continue;
+		}
+
+		FRodinShmConnection* const Connection = Connections.Add_GetRef(
+			MakeUnique<FRodinShmConnection>(ControlFd, ServerEvent, ClientEvent, Mapping, Settings.RingCapacity)).Get();
+
+		epoll_event ControlEvent = {};
+		ControlEvent.events   = EPOLLIN | EPOLLRDHUP;
+		ControlEvent.data.ptr = &Connection->ControlWatch;
+
+		epoll_event DataEvent = {};
+		DataEvent.events   = EPOLLIN;
+		DataEvent.data.ptr = &Connection->EventWatch;
+
+		epoll_ctl(PollFd, EPOLL_CTL_ADD, ControlFd, &ControlEvent);
+		epoll_ctl(PollFd, EPOLL_CTL_ADD, ServerEvent, &DataEvent);
+
+		Connection->Proxy = MakeShared<FRodinShmProxy, ESPMode::ThreadSafe>(AsShared(), Connection);
+		Connection->Proxy->OnOpen(Settings.OnOpened);
+	}
+}
+
+void FRodinShmTransport::Read(FRodinShmConnection& Connection)
+{
+	bool bWakeWriter = false;
+
+	int32 Records = 0;
+	for (; Records < MaxReadBatch; ++Records)
+	{
+		FRodinShmRecord Record;
+		const uint8* Payload = nullptr;
+
+		const ERodinShmRead Status = Connection.In.Peek(Record, Payload);
+		if (Status == ERodinShmRead::Empty)
+		{
+			break;
+		}
+
+		if (Status == ERodinShmRead::Corrupt)
+		{
+			CloseConnection(Connection, 1002, TEXT("Corrupt shared-memory ring"));
+			return;
+		}
+
+		const TConstArrayView<uint8> Message(Payload, Record.Length);
+		const ERodinWSOpCode Code = static_cast<ERodinWSOpCode>(Record.OpCode);
+
+		switch (Code)
+		{
+		case ERodinWSOpCode::TEXT:
+		case ERodinWSOpCode::BINARY:
+			Connection.Proxy->OnMessage(Message, Code, Settings);
+			break;
+
+		case ERodinWSOpCode::PING:
+			Connection.Proxy->Send(Connection, Message, ERodinWSOpCode::PONG);
+			break;
+
+		case ERodinWSOpCode::PONG:
+			break;
+
+		case ERodinWSOpCode::CLOSE:
+		{
+			const int32 CloseCode = Message.Num() >= 2 ? (Message[0] << 8) | Message[1] : 1005;
+			const FUTF8ToTCHAR Reason(reinterpret_cast<const ANSICHAR*>(Message.GetData()) + FMath::Min(Message.Num(), 2), FMath::Max(Message.Num() - 2, 0));
+
+			CloseConnection(Connection, CloseCode, FString(Reason.Length(), Reason.Get()));
+			return;
+		}
+
+		default:
+			CloseConnection(Connection, 1002, TEXT("Unknown op code"));
+			return;
+		}
+
+		bWakeWriter |= Connection.In.Pop();
+	}
+
+	if (bWakeWriter)
+	{
+		Signal(Connection.ClientEvent);
+	}
+
+	// Yield to the other connections, the level-triggered eventfd brings us back.
+	if (Records == MaxReadBatch)
+	{
+		Signal(Connection.ServerEvent);
+	}
+}
+
+void FRodinShmTransport::ReadControl(FRodinShmConnection& Connection, const uint32 Events)
+{
+	// Feeders don't talk on the socket, it only tells us when they are gone.
+	char Buffer[64];
+
+	ssize_t Received;
+	do
+	{
+		Received = recv(Connection.ControlFd, Buffer, sizeof(Buffer), 0);
+	}
+	while (Received > 0 || (Received < 0 && errno == EINTR));
+
+	const bool bGone = Received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || (Events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+	if (bGone)
+	{
+		CloseConnection(Connection, 1006, TEXT("Connection lost"));
+	}
+}
+
+void FRodinShmTransport::CloseConnection(FRodinShmConnection& Connection, const int32 Code, FString&& Reason)
+{
+	if (Connection.bClosed)
+	{
+		return;
+	}
+
+	Connection.bClosed = true;
+
+	epoll_ctl(PollFd, EPOLL_CTL_DEL, Connection.ControlFd, nullptr);
+	epoll_ctl(PollFd, EPOLL_CTL_DEL, Connection.ServerEvent, nullptr);
+
+	// The feeder learns it is over from the socket, before its fds are even closed.
+	shutdown(Connection.ControlFd, SHUT_RDWR);
+
+	Connection.Proxy->OnClosed(Code, MoveTemp(Reason), Settings.OnClosed);
+	Connection.Proxy.Reset();
+}
+
+///////////////////////////////////////////////////////////////
+// FRodinShmClient
+
+FRodinShmClient::~FRodinShmClient()
+{
+	Close();
+}
+
+bool FRodinShmClient::Connect(const FString& Path)
+{
+	check(!IsConnected());
+
+	sockaddr_un Address;
+	const socklen_t AddressLength = MakeAddress(Path, Address);
+	if (AddressLength == 0)
+	{
+		return false;
+	}
+
+	ControlFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (ControlFd < 0 || connect(ControlFd, reinterpret_cast<const sockaddr*>(&Address), AddressLength) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	int32 Fds[3] = { -1, -1, -1 };
+
+	alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(Fds))] = {};
+	char Byte = 0;
+	iovec Vector = { &Byte, 1 };
+
+	msghdr Message = {};
+	Message.msg_iov        = &Vector;
+	Message.msg_iovlen     = 1;
+	Message.msg_control    = Control;
+	Message.msg_controllen = sizeof(Control);
+
+	ssize_t Received;
+	do
+	{
+		Received = recvmsg(ControlFd, &Message, MSG_CMSG_CLOEXEC);
+	}
+	while (Received < 0 && errno == EINTR);
+
+	const cmsghdr* const Header = Received == 1 ? CMSG_FIRSTHDR(&Message) : nullptr;
+	if (!Header || Header->cmsg_type != SCM_RIGHTS || Header->cmsg_len != CMSG_LEN(sizeof(Fds)))
+	{
+		Close();
+		return false;
+	}
+
+	FMemory::Memcpy(Fds, CMSG_DATA(Header), sizeof(Fds));
+
+	const int32 MemFd = Fds[0];
+	ServerEvent = Fds[1];
+	ClientEvent = Fds[2];
+
+	struct stat Status;
+	if (fstat(MemFd, &Status) == 0 && static_cast<uint64>(Status.st_size) > FRodinShmSegment::GetDataOffset())
+	{
+		MappingSize = Status.st_size;
+		Mapping     = mmap(nullptr, MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, MemFd, 0);
+	}
+	close(MemFd);
+
+	if (!Mapping || Mapping == MAP_FAILED)
+	{
+		Mapping = nullptr;
+		Close();
+		return false;
+	}
+
+	FRodinShmSegment* const Segment = static_cast<FRodinShmSegment*>(Mapping);
+	RingCapacity = Segment->RingCapacity;
+
+	if (Segment->Magic != NRodinShm::Magic || Segment->Version != NRodinShm::Version
+		|| !FMath::IsPowerOfTwo(RingCapacity) || FRodinShmSegment::GetSize(RingCapacity) != MappingSize)
+	{
+		Close();
+		return false;
+	}
+
+	uint8* const RingData = static_cast<uint8*>(Mapping) + FRodinShmSegment::GetDataOffset();
+
+	Out = FRodinShmRing(&Segment->ToServer, RingData, RingCapacity);
+	In  = FRodinShmRing(&Segment->ToClient, RingData + RingCapacity, RingCapacity);
+
+	return true;
+}
+
+bool FRodinShmClient::Wait(const int32 TimeoutMs)
+{
+	pollfd Fds[2] = {};
+	Fds[0].fd     = ClientEvent;
+	Fds[0].events = POLLIN;
+	Fds[1].fd     = ControlFd;
+	Fds[1].events = POLLIN | POLLRDHUP;
+
+	int32 Ready;
+	do
+	{
+		Ready = poll(Fds, 2, TimeoutMs);
+	}
+	while (Ready < 0 && errno == EINTR);
+
+	if (Ready <= 0)
+	{
+		return false;
+	}
+
+	if (Fds[0].revents & POLLIN)
+	{
+		Drain(ClientEvent);
+		return true;
+	}
+
+	// The server never writes to the socket, anything there means it is gone. Records it wrote before are read first.
+	Close();
+	return false;
+}
+
+uint8* FRodinShmClient::BeginSend(const uint32 Length)
+{
+	while (IsConnected() && Length <= GetMaxPayload())
+	{
+		if (uint8* const Destination = Out.BeginWrite(Length))
+		{
+			return Destination;
+		}
+
+		if (!Wait(-1))
+		{
+			break;
+		}
+	}
+
+	return nullptr;
+}
+
+void FRodinShmClient::CommitSend(const uint32 Length, const ERodinWSOpCode OpCode)
+{
+	if (Out.CommitWrite(Length, static_cast<uint8>(OpCode)))
+	{
+		Signal(ServerEvent);
+	}
+}
+
+bool FRodinShmClient::Send(TConstArrayView<uint8> Payload, const ERodinWSOpCode OpCode)
+{
+	uint8* const Destination = BeginSend(Payload.Num());
+	if (!Destination)
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(Destination, Payload.GetData(), Payload.Num());
+	CommitSend(Payload.Num(), OpCode);
+
+	return true;
+}
+
+bool FRodinShmClient::Receive(TFunctionRef<void(TConstArrayView<uint8>, ERodinWSOpCode)> Visitor, const int32 TimeoutMs)
+{
+	while (IsConnected())
+	{
+		FRodinShmRecord Record;
+		const uint8* Payload = nullptr;
+
+		const ERodinShmRead Status = In.Peek(Record, Payload);
+		if (Status == ERodinShmRead::Corrupt)
+		{
+			Close();
+			return false;
+		}
+
+		if (Status == ERodinShmRead::Ready)
+		{
+			const ERodinWSOpCode Code = static_cast<ERodinWSOpCode>(Record.OpCode);
+
+			Visitor(TConstArrayView<uint8>(Payload, Record.Length), Code);
+
+			if (In.Pop())
+			{
+				Signal(ServerEvent);
+			}
+
+			if (Code == ERodinWSOpCode::CLOSE)
+			{
+				Close();
+			}
+			return true;
+		}
+
+		if (!Wait(TimeoutMs))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+void FRodinShmClient::Close()
+{
+	if (Mapping)
+	{
+		munmap(Mapping, MappingSize);
+		Mapping = nullptr;
+	}
+
+	for (int32* const Fd : { &ControlFd, &ServerEvent, &ClientEvent })
+	{
+		if (*Fd >= 0)
+		{
+			close(*Fd);
+			*Fd = -1;
+		}
+	}
+
+	Out = FRodinShmRing();
+	In  = FRodinShmRing();
+}
+
+#else // PLATFORM_LINUX
+
+bool FRodinShmTransport::Start()
+{
+	UE_LOG(LogTemp, Error, TEXT("The shared-memory transport needs memfd and eventfd, it is only available on Linux."));
+	return false;
+}
+
+void FRodinShmTransport::Stop()
+{
+}
+
+void FRodinShmTransport::Execute(TUniqueFunction<void()>&& InWork)
+{
+}
+
+void FRodinShmTransport::Run()
+{
+}
+
+void FRodinShmTransport::RunWork()
+{
+}
+
+void FRodinShmTransport::Accept()
+{
+}
+
+void FRodinShmTransport::Read(FRodinShmConnection& Connection)
+{
+}
+
+void FRodinShmTransport::ReadControl(FRodinShmConnection& Connection, const uint32 Events)
+{
+}
+
+void FRodinShmTransport::CloseConnection(FRodinShmConnection& Connection, const int32 Code, FString&& Reason)
+{
+}
+
+FRodinShmClient::~FRodinShmClient()
+{
+}
+
+bool FRodinShmClient::Connect(const FString& Path)
+{
+	return false;
+}
+
+bool FRodinShmClient::Wait(const int32 TimeoutMs)
+{
+	return false;
+}
+
+uint8* FRodinShmClient::BeginSend(const uint32 Length)
+{
+	return nullptr;
+}
+
+void FRodinShmClient::CommitSend(const uint32 Length, const ERodinWSOpCode OpCode)
+{
+}
+
+bool FRodinShmClient::Send(TConstArrayView<uint8> Payload, const ERodinWSOpCode OpCode)
+{
+	return false;
+}
+
+bool FRodinShmClient::Receive(TFunctionRef<void(TConstArrayView<uint8>, ERodinWSOpCode)> Visitor, const int32 TimeoutMs)
+{
+	return false;
+}
+
+void FRodinShmClient::Close()
+{
+}
+
+#endif // PLATFORM_LINUX
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "RodinWSServerInternal.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <atomic>
+#include <thread>
+THIRD_PARTY_INCLUDES_END
+
+/**
+ * Shared-memory transport for feeders running on the same machine (Linux only).
+ *
+ * A feeder connects to a Unix domain socket and is handed three fds over it: a sealed memfd and two eventfds.
+ * The memfd holds an FRodinShmSegment followed by two rings of RingCapacity bytes, feeder to server first.
+ * Each ring carries records: an FRodinShmRecord header and its payload padded to 8 bytes, the op codes being
+ * the WebSocket ones. A record with op code NRodinShm::Wrap pads the end of the ring, the next one is at its start.
+ * Head and Tail are byte positions that only grow, their ring offset is the position modulo RingCapacity.
+ *
+ * The server sleeps on the first eventfd, the feeder on the second. A writer signals the reader only when it
+ * turns an empty ring non-empty, a reader signals the writer only when the writer flagged it is waiting for room.
+ * Closing the Unix socket ends the connection; a CLOSE record (2 byte big-endian code, then a reason) does too.
+ */
+namespace NRodinShm
+{
+	constexpr uint32 Magic   = 0x4d485352;
+	constexpr uint32 Version = 1;
+
+	constexpr uint8 Wrap = 0xFF;
+
+	constexpr uint64 RecordAlignment = 8;
+	constexpr uint64 DataAlignment   = 4096;
+}
+
+struct FRodinShmRecord
+{
+	uint32 Length;
+	uint8  OpCode;
+	uint8  Padding[3];
+};
+
+struct FRodinShmRingHeader
+{
+	/** Reader position. */
+	alignas(64) std::atomic<uint64> Head;
+
+	/** Writer position. */
+	alignas(64) std::atomic<uint64> Tail;
+
+	/** Set by a writer out of room, the reader clears it when it signals. */
+	alignas(64) std::atomic<uint32> bWriterWaiting;
+};
+
+struct FRodinShmSegment
+{
+	uint32 Magic;
+	uint32 Version;
+	uint64 RingCapacity;
+
+	FRodinShmRingHeader ToServer;
+	FRodinShmRingHeader ToClient;
+
+	/** Offset of the first ring's data, the second follows it. */
+	static constexpr uint64 GetDataOffset() { return Align(sizeof(FRodinShmSegment), NRodinShm::DataAlignment); }
+
+	static constexpr uint64 GetSize(const uint64 RingCapacity) { return GetDataOffset() + 2 * RingCapacity; }
+};
+
+static_assert(std::atomic<uint64>::is_always_lock_free, "The shared-memory rings need lock-free 64-bit atomics.");
+
+enum class ERodinShmRead : uint8
+{
+	Empty,
+	Ready,
+	Corrupt
+};
+
+/** One direction of a connection as seen by one side, used from a single thread. */
+class FRodinShmRing
+{
+public:
+	FRodinShmRing() = default;
+	FRodinShmRing(FRodinShmRingHeader* InHeader, uint8* InData, const uint64 InCapacity);
+
+	/** Largest payload that always fits, half the ring so a wrap can't starve it. */
+	static uint32 GetMaxPayload(const uint64 Capacity);
+
+	/** Writer. Room for a Length byte payload, null when the ring is full: the reader then signals once it frees some. */
+	uint8* BeginWrite(const uint32 Length);
+
+	/** Writer. Publishes the payload BeginWrite returned, true when the reader has to be woken. */
+	bool CommitWrite(const uint32 Length, const uint8 OpCode);
+
+	/** Reader. Oldest record, its payload stays valid until Pop. */
+	ERodinShmRead Peek(FRodinShmRecord& OutRecord, const uint8*& OutPayload);
+
+	/** Reader. Releases the record Peek returned, true when the writer has to be woken. */
+	bool Pop();
+
+private:
+	bool HasRoom(const uint64 Tail, const uint64 Needed) const;
+
+private:
+	FRodinShmRingHeader* Header = nullptr;
+	uint8* Data = nullptr;
+	uint64 Capacity = 0;
+
+	/** Bytes of wrap padding the pending write starts with. */
+	uint64 PendingSkip = 0;
+
+	/** Head once the peeked record is popped. */
+	uint64 PeekedEnd = 0;
+};
+
+/**
+ * Accepts shared-memory connections and drives them from its own thread. They show up as regular URodinWS
+ * objects: Send, Ping, End and Close work as for WebSocket connections. Topics are not supported on them.
+ */
+class FRodinShmTransport final : public TSharedFromThis<FRodinShmTransport, ESPMode::ThreadSafe>
+{
+public:
+	struct FSettings
+	{
+		/** Unix socket feeders connect to, a leading '@' is in the abstract namespace. */
+		FString Path;
+
+		/** Bytes per ring, a power of 2. */
+		uint64 RingCapacity = 0;
+
+		FOnOpened  OnOpened;
+		FOnMessage OnMessage;
+		FOnClosed  OnClosed;
+
+		/** Runs on the transport thread instead of the server thread. */
+		FOnRodinWSServerThreadMessage ServerThreadHandler;
+
+		FRodinWSServerCountersPtr Stats;
+	};
+
+	explicit FRodinShmTransport(FSettings&& InSettings);
+	FRodinShmTransport(const FRodinShmTransport&) = delete;
+	~FRodinShmTransport();
+
+	/** Binds the socket and starts the thread. False on failure or on platforms without memfd. */
+	bool Start();
+
+	/** Closes every connection and joins the thread. */
+	void Stop();
+
+	/** Runs Work on the transport thread, dropped once stopped. */
+	void Execute(TUniqueFunction<void()>&& Work);
+
+	FORCEINLINE const FSettings& GetSettings() const { return Settings; }
+
+private:
+	friend class FRodinShmProxy;
+
+	void Run();
+	void RunWork();
+
+	void Accept();
+	void Read(class FRodinShmConnection& Connection);
+	void ReadControl(class FRodinShmConnection& Connection, const uint32 Events);
+
+	/** Connection is freed once the current events are handled. */
+	void CloseConnection(class FRodinShmConnection& Connection, const int32 Code, FString&& Reason);
+
+private:
+	const FSettings Settings;
+
+	int32 ListenFd;
+	int32 WakeFd;
+	int32 PollFd;
+
+	std::atomic<bool> bStopping;
+
+	TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> Work;
+
+	/** Transport thread only. */
+	TArray<TUniquePtr<class FRodinShmConnection>> Connections;
+
+	TUniquePtr<std::thread> Thread;
+};
+
+/**
+ * Feeder side of a shared-memory connection, for native tools. Blocking, used from one thread.
+ * Writes go straight into the ring: BeginSend hands out the payload memory, CommitSend publishes it.
+ */
+class FRodinShmClient
+{
+public:
+	FRodinShmClient() = default;
+	FRodinShmClient(const FRodinShmClient&) = delete;
+	~FRodinShmClient();
+
+	bool Connect(const FString& Path);
+
+	/** Room for a Length byte payload, waits for the server to free some. Null once disconnected or too large. */
+	uint8* BeginSend(const uint32 Length);
+	void CommitSend(const uint32 Length, const ERodinWSOpCode OpCode);
+
+	bool Send(TConstArrayView<uint8> Payload, const ERodinWSOpCode OpCode);
+
+	/** Hands the next message to Visitor straight from the ring. False on timeout or once disconnected. */
+	bool Receive(TFunctionRef<void(TConstArrayView<uint8>, ERodinWSOpCode)> Visitor, const int32 TimeoutMs = -1);
+
+	void Close();
+
+	FORCEINLINE bool IsConnected() const { return ControlFd >= 0; }
+	FORCEINLINE uint32 GetMaxPayload() const { return FRodinShmRing::GetMaxPayload(RingCapacity); }
+
+private:
+	/** Sleeps until the server signals, false once it is gone. */
+	bool Wait(const int32 TimeoutMs);
+
+private:
+	int32 ControlFd = -1;
+	int32 ServerEvent = -1;
+	int32 ClientEvent = -1;
+
+	void*  Mapping = nullptr;
+	uint64 MappingSize = 0;
+	uint64 RingCapacity = 0;
+
+	FRodinShmRing Out;
+	FRodinShmRing In;
+};
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinSyntheticData.h"
+
+#include "IImageWrapperModule.h"
+#include "Math/RandomStream.h"
+#include "Misc/Base64.h"
+#include "Modules/ModuleManager.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace NRodinSyntheticData
+{
+	static void FillRandom(TArray<uint8>& Data, const int32 Offset, const int32 Seed)
+	{
+		FRandomStream Stream(Seed);
+
+		for (int32 Index = Offset; Index < Data.Num(); ++Index)
+		{
+			Data[Index] = static_cast<uint8>(Stream.RandHelper(256));
+		}
+	}
+
+	TArray<uint8> MakeImage(const int32 Width, const int32 Height, const EImageFormat Format, const int32 Seed)
+	{
+		FRandomStream Stream(Seed);
+
+		TArray<uint8> Raw;
+		Raw.SetNumUninitialized(Width * Height * 4);
+
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			for (int32 X = 0; X < Width; ++X)
+			{
+				uint8* const Pixel = &Raw[(Y * Width + X) * 4];
+				const uint8  Noise = static_cast<uint8>(Stream.RandHelper(32));
+
+				Pixel[0] = static_cast<uint8>((X * 255) / FMath::Max(Width  - 1, 1)) ^ Noise;
+				Pixel[1] = static_cast<uint8>((Y * 255) / FMath::Max(Height - 1, 1)) ^ Noise;
+				Pixel[2] = static_cast<uint8>(((X + Y) * 255) / FMath::Max(Width + Height - 2, 1));
+				Pixel[3] = 255;
+			}
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule.CreateImageWrapper(Format);
+
+		if (!Wrapper || !Wrapper->SetRaw(Raw.GetData(), Raw.Num(), Width, Height, ERGBFormat::BGRA, 8))
+		{
+			return TArray<uint8>();
+		}
+
+		const TArray64<uint8> Compressed = Wrapper->GetCompressed(Format == EImageFormat::JPEG ? 90 : 0);
+		return TArray<uint8>(Compressed.GetData(), static_cast<int32>(Compressed.Num()));
+	}
+
+	TArray<uint8> MakeFbx(const int64 Size, const int32 Seed)
+	{
+		// 23 bytes magic, the literal's own terminator is not part of it.
+		static const ANSICHAR Header[] = "Kaydara FBX Binary  \x00\x1a\x00";
+		static constexpr int32 HeaderSize = sizeof(Header) - 1;
+
+		const uint32 Version = 7400;
+
+		TArray<uint8> Data;
+		Data.SetNumUninitialized(static_cast<int32>(FMath::Max<int64>(Size, HeaderSize + sizeof(Version))));
+
+		FMemory::Memcpy(Data.GetData(), Header, HeaderSize);
+		FMemory::Memcpy(Data.GetData() + HeaderSize, &Version, sizeof(Version));
+
+		FillRandom(Data, HeaderSize + sizeof(Version), Seed);
+
+		return Data;
+	}
+
+	TArray<uint8> MakeUsdz(const int64 Size, const int32 Seed)
+	{
+		static const uint8 Header[] = { 'P', 'K', 0x03, 0x04 };
+
+		TArray<uint8> Data;
+		Data.SetNumUninitialized(static_cast<int32>(FMath::Max<int64>(Size, sizeof(Header))));
+
+		FMemory::Memcpy(Data.GetData(), Header, sizeof(Header));
+		FillRandom(Data, sizeof(Header), Seed);
+
+		return Data;
+	}
+
+	static FString Serialize(const TSharedRef<FJsonObject>& Object)
+	{
+		FString Out;
+		TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer =
+			TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Out);
+		FJsonSerializer::Serialize(Object, Writer);
+		return Out;
+	}
+
+	FString MakeFetchTaskMessage()
+	{
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("type"), TEXT("fetch_task"));
+
+		return Serialize(Root);
+	}
+
+	FString MakeResultMessage(const FString& TaskId, const TArray<uint8>& Usdz)
+	{
+		return MakeResultMessage(TaskId, FBase64::Encode(Usdz), Usdz.Num());
+	}
+
+	FString MakeResultMessage(const FString& TaskId, const FString& UsdzBase64, const int64 UsdzLength)
+	{
+		TSharedRef<FJsonObject> File = MakeShared<FJsonObject>();
+		File->SetStringField(TEXT("name"), TEXT("model.usdz"));
+		File->SetNumberField(TEXT("length"), static_cast<double>(UsdzLength));
+		File->SetStringField(TEXT("content"), TEXT("data:model/usdz;base64,") + UsdzBase64);
+
+		TArray<TSharedPtr<FJsonValue>> Files;
+		Files.Add(MakeShared<FJsonValueObject>(File));
+
+		TSharedRef<FJsonObject> Data = MakeShared<FJsonObject>();
+		Data->SetArrayField(TEXT("files"), Files);
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("type"), TEXT("send_model"));
+		Root->SetStringField(TEXT("sid"), TaskId);
+		Root->SetObjectField(TEXT("data"), Data);
+
+		return Serialize(Root);
+	}
+
+	FString MakeProgressMessage(const FString& TaskId, const float Progress)
+	{
+		TSharedRef<FJsonObject> Data = MakeShared<FJsonObject>();
+		Data->SetNumberField(TEXT("progress"), Progress);
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("type"), TEXT("task_progress"));
+		Root->SetStringField(TEXT("sid"), TaskId);
+		Root->SetObjectField(TEXT("data"), Data);
+
+		return Serialize(Root);
+	}
+}
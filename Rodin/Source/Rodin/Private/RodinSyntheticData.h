@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IImageWrapper.h"
+
+/**
+ * Deterministic payload generators used by the benchmark commandlet and the mock web-page peer.
+ * Same seed, same bytes.
+ */
+namespace NRodinSyntheticData
+{
+	/** Gradient + noise image compressed as PNG or JPEG. */
+	TArray<uint8> MakeImage(const int32 Width, const int32 Height, const EImageFormat Format, const int32 Seed);
+
+	/** Opaque blob starting with a binary FBX header. Only meant to be loaded and uploaded, not imported. */
+	TArray<uint8> MakeFbx(const int64 Size, const int32 Seed);
+
+	/** Opaque blob starting with a zip local file header, like an USDZ archive. */
+	TArray<uint8> MakeUsdz(const int64 Size, const int32 Seed);
+
+	/** Task request the web page polls the bridge with, answered by ST_SubmitInfo's fetch_task_return. */
+	FString MakeFetchTaskMessage();
+
+	/** Result message as sent by the web page once a generation is done, as consumed by ST_MessageParse. */
+	FString MakeResultMessage(const FString& TaskId, const TArray<uint8>& Usdz);
+
+	/** Same, from an already base64 encoded archive so repeated results don't pay for the encoding. */
+	FString MakeResultMessage(const FString& TaskId, const FString& UsdzBase64, const int64 UsdzLength);
+
+	/** Progress message as pushed by the web page while a generation runs. */
+	FString MakeProgressMessage(const FString& TaskId, const float Progress);
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinTrace.h"
+
+#include "HAL/PlatformTLS.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(RodinChannel);
+
+UE_TRACE_EVENT_BEGIN(Rodin, TaskStage)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, TaskId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::AnsiString, Stage)
+UE_TRACE_EVENT_END()
+
+namespace NRodinTrace
+{
+	enum class ELoopPhase : uint8
+	{
+		None,
+		Waiting,
+		Dispatching
+	};
+
+	static thread_local ELoopPhase LoopPhase = ELoopPhase::None;
+
+	void TaskStage(const FString& TaskId, const ANSICHAR* Stage)
+	{
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(RodinChannel))
+		{
+			return;
+		}
+
+		UE_TRACE_LOG(Rodin, TaskStage, RodinChannel)
+			<< TaskStage.Cycle(FPlatformTime::Cycles64())
+			<< TaskStage.TaskId(*TaskId, TaskId.Len())
+			<< TaskStage.Stage(Stage);
+
+		TRACE_BOOKMARK(TEXT("Rodin %s: %hs"), *TaskId, Stage);
+	}
+
+	void RegisterServerThread()
+	{
+		UE::Trace::ThreadRegister(TEXT("RodinWS Server"), FPlatformTLS::GetCurrentThreadId(), 0);
+	}
+
+#if CPUPROFILERTRACE_ENABLED
+	static void EndLoopPhase()
+	{
+		if (LoopPhase != ELoopPhase::None)
+		{
+			FCpuProfilerTrace::OutputEndEvent();
+			LoopPhase = ELoopPhase::None;
+		}
+	}
+
+	void OnLoopPre()
+	{
+		static const uint32 WaitSpec = FCpuProfilerTrace::OutputEventType("Rodin::LoopWait");
+
+		EndLoopPhase();
+
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(RodinChannel))
+		{
+			FCpuProfilerTrace::OutputBeginEvent(WaitSpec);
+			LoopPhase = ELoopPhase::Waiting;
+		}
+	}
+
+	void OnLoopWoken()
+	{
+		static const uint32 IterationSpec = FCpuProfilerTrace::OutputEventType("Rodin::LoopIteration");
+
+		if (LoopPhase == ELoopPhase::Waiting)
+		{
+			FCpuProfilerTrace::OutputEndEvent();
+			FCpuProfilerTrace::OutputBeginEvent(IterationSpec);
+			LoopPhase = ELoopPhase::Dispatching;
+		}
+	}
+
+	void OnLoopPost()
+	{
+		EndLoopPhase();
+	}
+#else
+	void OnLoopPre() {}
+	void OnLoopWoken() {}
+	void OnLoopPost() {}
+#endif
+}
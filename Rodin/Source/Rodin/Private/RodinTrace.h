@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Enable with -trace=cpu,rodin (or Trace.Enable Rodin) and inspect in Unreal Insights.
+UE_TRACE_CHANNEL_EXTERN(RodinChannel);
+
+#define RODIN_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("Rodin::" Name, RodinChannel)
+
+namespace NRodinTrace
+{
+	/** Emits a Rodin.TaskStage event and a bookmark so one generation can be followed end to end. */
+	void TaskStage(const FString& TaskId, const ANSICHAR* Stage);
+
+	/** Names the calling thread in Insights. */
+	void RegisterServerThread();
+
+	/** Server loop hooks: split each iteration between waiting for events and dispatching them. */
+	void OnLoopPre();
+	void OnLoopWoken();
+	void OnLoopPost();
+}
@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinVoxelizer.h"
+
+#include "RodinTrace.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformAtomics.h"
+#include "Math/RandomStream.h"
+
+namespace
+{
+	constexpr int32 TrianglesPerTask = 1024;
+	constexpr int32 PointsPerTask    = 4096;
+
+	/** Separating axis test of a triangle against a box centered on the origin. */
+	bool OverlapsOnAxis(const FVector3f& Axis, const FVector3f& V0, const FVector3f& V1, const FVector3f& V2, const FVector3f& Half)
+	{
+		const float P0 = FVector3f::DotProduct(V0, Axis);
+		const float P1 = FVector3f::DotProduct(V1, Axis);
+		const float P2 = FVector3f::DotProduct(V2, Axis);
+		const float Radius = Half.X * FMath::Abs(Axis.X) + Half.Y * FMath::Abs(Axis.Y) + Half.Z * FMath::Abs(Axis.Z);
+
+		return FMath::Min3(P0, P1, P2) <= Radius && FMath::Max3(P0, P1, P2) >= -Radius;
+	}
+
+	/** Akenine-Moller triangle / box overlap: box faces, triangle plane and the 9 edge cross axes. */
+	bool TriangleBoxOverlap(const FVector3f& Center, const FVector3f& Half, const FVector3f& A, const FVector3f& B, const FVector3f& C)
+	{
+		const FVector3f V0 = A - Center;
+		const FVector3f V1 = B - Center;
+		const FVector3f V2 = C - Center;
+
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			if (FMath::Min3(V0[Axis], V1[Axis], V2[Axis]) > Half[Axis] || FMath::Max3(V0[Axis], V1[Axis], V2[Axis]) < -Half[Axis])
+			{
+				return false;
+			}
+		}
+
+		const FVector3f Edges[3] = { V1 - V0, V2 - V1, V0 - V2 };
+		const FVector3f Units[3] = { FVector3f::XAxisVector, FVector3f::YAxisVector, FVector3f::ZAxisVector };
+
+		for (const FVector3f& Edge : Edges)
+		{
+			for (const FVector3f& Unit : Units)
+			{
+				if (!OverlapsOnAxis(FVector3f::CrossProduct(Unit, Edge), V0, V1, V2, Half))
+				{
+					return false;
+				}
+			}
+		}
+
+		return OverlapsOnAxis(FVector3f::CrossProduct(Edges[0], Edges[1]), V0, V1, V2, Half);
+	}
+
+	void GetBounds(const NRodinMeshExport::FMeshSnapshot& Snapshot, FVector3f& OutMin, FVector3f& OutMax)
+	{
+		OutMin = FVector3f(TNumericLimits<float>::Max());
+		OutMax = FVector3f(TNumericLimits<float>::Lowest());
+
+		for (const FVector3f& Position : Snapshot.Positions)
+		{
+			OutMin = OutMin.ComponentMin(Position);
+			OutMax = OutMax.ComponentMax(Position);
+		}
+	}
+}
+
+namespace NRodinVoxelizer
+{
+	TArray<FVector3f> Voxelize(const NRodinMeshExport::FMeshSnapshot& Snapshot, const int32 InResolution, float& OutVoxelSize)
+	{
+		RODIN_TRACE_SCOPE("Voxelize");
+
+		OutVoxelSize = 0.f;
+
+		const int32 NumTriangles = Snapshot.Indices.Num() / 3;
+		if (NumTriangles == 0 || InResolution <= 0)
+		{
+			return TArray<FVector3f>();
+		}
+
+		// The UI clamps too, but Blueprint and C++ callers can pass anything.
+		const int32 Resolution = FMath::Min(InResolution, MaxResolution);
+
+		FVector3f Min, Max;
+		GetBounds(Snapshot, Min, Max);
+
+		const float VoxelSize = FMath::Max((Max - Min).GetMax() / Resolution, UE_KINDA_SMALL_NUMBER);
+		const FVector3f Half(VoxelSize * 0.5f);
+
+		FIntVector Dims;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			Dims[Axis] = FMath::Clamp(FMath::CeilToInt((Max[Axis] - Min[Axis]) / VoxelSize), 1, Resolution);
+		}
+
+		const int64 NumVoxels = static_cast<int64>(Dims.X) * Dims.Y * Dims.Z;
+
+		// One bit per voxel, set concurrently by the triangle tasks.
+		TArray64<int64> Words;
+		Words.SetNumZeroed((NumVoxels + 63) / 64);
+
+		const int32 NumTasks = FMath::DivideAndRoundUp(NumTriangles, TrianglesPerTask);
+
+		ParallelFor(NumTasks, [&](const int32 Task) -> void
+		{
+			const int32 First = Task * TrianglesPerTask;
+			const int32 Last  = FMath::Min(First + TrianglesPerTask, NumTriangles);
+
+			for (int32 Triangle = First; Triangle < Last; ++Triangle)
+			{
+				const FVector3f& A = Snapshot.Positions[Snapshot.Indices[Triangle * 3]];
+				const FVector3f& B = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 1]];
+				const FVector3f& C = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 2]];
+
+				FIntVector Lower, Upper;
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					Lower[Axis] = FMath::Clamp(FMath::FloorToInt((FMath::Min3(A[Axis], B[Axis], C[Axis]) - Min[Axis]) / VoxelSize), 0, Dims[Axis] - 1);
+					Upper[Axis] = FMath::Clamp(FMath::FloorToInt((FMath::Max3(A[Axis], B[Axis], C[Axis]) - Min[Axis]) / VoxelSize), 0, Dims[Axis] - 1);
+				}
+
+				for (int32 Z = Lower.Z; Z <= Upper.Z; ++Z)
+				{
+					for (int32 Y = Lower.Y; Y <= Upper.Y; ++Y)
+					{
+						for (int32 X = Lower.X; X <= Upper.X; ++X)
+						{
+							const FVector3f Center = Min + FVector3f(X + 0.5f, Y + 0.5f, Z + 0.5f) * VoxelSize;
+							if (!TriangleBoxOverlap(Center, Half, A, B, C))
+							{
+								continue;
+							}
+
+							const int64 Voxel = (static_cast<int64>(Z) * Dims.Y + Y) * Dims.X + X;
+							const int64 Mask  = static_cast<int64>(1ull << (Voxel & 63));
+
+							FPlatformAtomics::InterlockedOr(&Words[Voxel >> 6], Mask);
+						}
+					}
+				}
+			}
+		});
+
+		TArray<FVector3f> Centers;
+		for (int64 Word = 0; Word < Words.Num(); ++Word)
+		{
+			uint64 Bits = static_cast<uint64>(Words[Word]);
+			while (Bits)
+			{
+				const int64 Voxel = Word * 64 + FMath::CountTrailingZeros64(Bits);
+				Bits &= Bits - 1;
+
+				const int32 X = static_cast<int32>(Voxel % Dims.X);
+				const int32 Y = static_cast<int32>((Voxel / Dims.X) % Dims.Y);
+				const int32 Z = static_cast<int32>(Voxel / (static_cast<int64>(Dims.X) * Dims.Y));
+
+				Centers.Add(Min + FVector3f(X + 0.5f, Y + 0.5f, Z + 0.5f) * VoxelSize);
+			}
+		}
+
+		OutVoxelSize = VoxelSize;
+		return Centers;
+	}
+
+	TArray<FVector3f> SamplePoints(const NRodinMeshExport::FMeshSnapshot& Snapshot, const int32 Count, const int32 Seed)
+	{
+		RODIN_TRACE_SCOPE("SamplePoints");
+
+		const int32 NumTriangles = Snapshot.Indices.Num() / 3;
+		if (NumTriangles == 0 || Count <= 0)
+		{
+			return TArray<FVector3f>();
+		}
+
+		TArray<double> CumulativeArea;
+		CumulativeArea.SetNumUninitialized(NumTriangles);
+
+		double TotalArea = 0.0;
+		for (int32 Triangle = 0; Triangle < NumTriangles; ++Triangle)
+		{
+			const FVector3f& A = Snapshot.Positions[Snapshot.Indices[Triangle * 3]];
+			const FVector3f& B = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 1]];
+			const FVector3f& C = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 2]];
+
+			TotalArea += FVector3f::CrossProduct(B - A, C - A).Size() * 0.5;
+			CumulativeArea[Triangle] = TotalArea;
+		}
+
+		if (TotalArea <= 0.0)
+		{
+			return TArray<FVector3f>();
+		}
+
+		TArray<FVector3f> Points;
+		Points.SetNumUninitialized(Count);
+
+		const int32 NumTasks = FMath::DivideAndRoundUp(Count, PointsPerTask);
+
+		// One stream per task keeps the result independent of the scheduling.
+		ParallelFor(NumTasks, [&](const int32 Task) -> void
+		{
+			FRandomStream Random(Seed + Task);
+
+			const int32 First = Task * PointsPerTask;
+			const int32 Last  = FMath::Min(First + PointsPerTask, Count);
+
+			for (int32 Point = First; Point < Last; ++Point)
+			{
+				const int32 Triangle = FMath::Min(static_cast<int32>(Algo::UpperBound(CumulativeArea, Random.FRand() * TotalArea)), NumTriangles - 1);
+
+				const FVector3f& A = Snapshot.Positions[Snapshot.Indices[Triangle * 3]];
+				const FVector3f& B = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 1]];
+				const FVector3f& C = Snapshot.Positions[Snapshot.Indices[Triangle * 3 + 2]];
+
+				const float R1 = FMath::Sqrt(Random.FRand());
+				const float R2 = Random.FRand();
+
+				Points[Point] = A * (1.f - R1) + B * (R1 * (1.f - R2)) + C * (R1 * R2);
+			}
+		});
+
+		return Points;
+	}
+
+	TArray64<uint8> WritePly(const TArray<FVector3f>& Points, const FString& Comment)
+	{
+		RODIN_TRACE_SCOPE("WritePly");
+
+		const FString Header = FString::Printf(
+			TEXT("ply\nformat binary_little_endian 1.0\ncomment %s\nelement vertex %d\nproperty float x\nproperty float y\nproperty float z\nend_header\n"),
+			*Comment, Points.Num());
+
+		const FTCHARToUTF8 HeaderUtf8(*Header);
+
+		TArray64<uint8> Ply;
+		Ply.Reserve(HeaderUtf8.Length() + static_cast<int64>(Points.Num()) * sizeof(FVector3f));
+		Ply.Append(reinterpret_cast<const uint8*>(HeaderUtf8.Get()), HeaderUtf8.Length());
+		Ply.Append(reinterpret_cast<const uint8*>(Points.GetData()), static_cast<int64>(Points.Num()) * sizeof(FVector3f));
+
+		return Ply;
+	}
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinMeshExport.h"
+
+/**
+ * Voxel and point cloud conditions, built from the same snapshot as the GLB export.
+ * Both run over the triangles in parallel and are deterministic for a given snapshot.
+ */
+namespace NRodinVoxelizer
+{
+	/** Largest grid Voxelize builds, 128 MB of bits. */
+	constexpr int32 MaxResolution = 1024;
+
+	/** Centers of the voxels crossed by the surface, on a cubic grid of Resolution cells (at most MaxResolution) along the longest side. */
+	TArray<FVector3f> Voxelize(const NRodinMeshExport::FMeshSnapshot& Snapshot, const int32 Resolution, float& OutVoxelSize);
+
+	/** Area weighted uniform samples over the surface. */
+	TArray<FVector3f> SamplePoints(const NRodinMeshExport::FMeshSnapshot& Snapshot, const int32 Count, const int32 Seed);
+
+	/** Binary little endian PLY with float x, y, z vertices. */
+	TArray64<uint8> WritePly(const TArray<FVector3f>& Points, const FString& Comment);
+}
@@ -79,6 +79,21 @@ bool URodinWS::IsConnected() const
 	return Proxy && Proxy->IsSocketValid();
 }
 
+int64 URodinWS::GetGeneration() const
+{
+	return Generation;
+}
+
+FRodinWSHandle URodinWS::GetHandle() const
+{
+	return FRodinWSHandle{ const_cast<URodinWS*>(this), Generation };
+}
+
+uint64 URodinWS::GetSocketId() const
+{
+	return SocketId;
+}
+
 void URodinWS::Subscribe(const FString& Topic, const FOnRodinWSSubscribed& Callback, bool bNonStrict)
 {
 	Subscribe(FString(Topic), FOnRodinWSSubscribed(Callback), bNonStrict);
@@ -0,0 +1,364 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinWSLoadGenerator.h"
+
+#include "RodinWSTestClient.h"
+#include "Math/RandomStream.h"
+#include "Rodin.h"
+
+namespace
+{
+	struct FLoadRun;
+
+	enum class ELoadPhase : uint8
+	{
+		Connecting,
+		Running,
+		Stopping
+	};
+
+	class FLoadConnection final : public FRodinWSTestClient
+	{
+	public:
+		FLoadConnection(FLoadRun& InRun, const uint32 InIndex)
+			: Run(InRun)
+			, Index(InIndex)
+		{
+		}
+
+		void Fill();
+
+	protected:
+		virtual void OnMessage(const char* Data, const SIZE_T Length, const uWS::OpCode Code) override;
+		virtual void OnClosed(const bool bWasUpgraded) override;
+
+	private:
+		void SendNext();
+
+	private:
+		FLoadRun&    Run;
+		const uint32 Index;
+
+		bool  bReady   = false;
+		int32 InFlight = 0;
+	};
+
+	struct FLoadRun
+	{
+		FLoadRun(const FRodinWSLoadSettings& InSettings, FRodinWSLoadResult& InResult)
+			: Settings(InSettings)
+			, Result(InResult)
+			, Random(1234)
+		{
+		}
+
+		const FRodinWSLoadSettings& Settings;
+		FRodinWSLoadResult&         Result;
+
+		us_loop_t*           Loop    = nullptr;
+		us_socket_context_t* Context = nullptr;
+		us_timer_t*          Timer   = nullptr;
+
+		ELoadPhase Phase = ELoadPhase::Connecting;
+
+		TArray<TUniquePtr<FLoadConnection>> Connections;
+		int32 Settled = 0;
+
+		double StartSeconds = 0.0;
+
+		FRandomStream Random;
+		std::string   Payload;
+
+		TArray<uint32> LatencyMicros;
+	};
+
+	void OnTimer(us_timer_t* Timer);
+
+	void BeginRun(FLoadRun& Run)
+	{
+		Run.Phase        = ELoadPhase::Running;
+		Run.StartSeconds = FPlatformTime::Seconds();
+
+		UE_LOG(LogWSServer, Log, TEXT("Load generator: %d/%d connections ready, running for %.1fs."),
+			Run.Result.Connected, Run.Connections.Num(), Run.Settings.DurationSeconds);
+
+		us_timer_set(Run.Timer, &OnTimer, static_cast<int>(Run.Settings.DurationSeconds * 1000.0), 0);
+
+		for (const TUniquePtr<FLoadConnection>& Connection : Run.Connections)
+		{
+			Connection->Fill();
+		}
+	}
+
+	void Settle(FLoadRun& Run)
+	{
+		if (++Run.Settled == Run.Connections.Num() && Run.Phase == ELoadPhase::Connecting)
+		{
+			BeginRun(Run);
+		}
+	}
+
+	void StopRun(FLoadRun& Run)
+	{
+		if (Run.Phase == ELoadPhase::Running)
+		{
+			Run.Result.Seconds = FPlatformTime::Seconds() - Run.StartSeconds;
+		}
+
+		Run.Phase = ELoadPhase::Stopping;
+
+		for (const TUniquePtr<FLoadConnection>& Connection : Run.Connections)
+		{
+			Connection->Close();
+		}
+
+		us_timer_close(Run.Timer);
+		Run.Timer = nullptr;
+	}
+
+	void OnTimer(us_timer_t* Timer)
+	{
+		FLoadRun& Run = **static_cast<FLoadRun**>(us_timer_ext(Timer));
+
+		if (Run.Phase == ELoadPhase::Connecting)
+		{
+			UE_LOG(LogWSServer, Warning, TEXT("Load generator: %d connections still pending, starting without them."),
+				Run.Connections.Num() - Run.Settled);
+
+			BeginRun(Run);
+			return;
+		}
+
+		StopRun(Run);
+	}
+
+	void FLoadConnection::SendNext()
+	{
+		const FRodinWSLoadSettings& Settings = Run.Settings;
+
+		const int32 Size = FMath::Max(Settings.Sizes[Run.Random.RandHelper(Settings.Sizes.Num())], NRodinWSLoad::HeaderSize);
+
+		const bool bPublish = Run.Random.FRand() < Settings.PublishRatio;
+		const bool bText    = Run.Random.FRand() < Settings.TextRatio;
+
+		Run.Payload.assign(Size, 'x');
+
+		ANSICHAR Header[NRodinWSLoad::HeaderSize + 1];
+		FCStringAnsi::Snprintf(Header, sizeof(Header), "%c%08x%016llx",
+			bPublish ? NRodinWSLoad::Publish : NRodinWSLoad::Echo, Index,
+			static_cast<unsigned long long>(FPlatformTime::Cycles64()));
+		FMemory::Memcpy(Run.Payload.data(), Header, NRodinWSLoad::HeaderSize);
+
+		Send(Run.Payload.data(), Size, bText ? uWS::OpCode::TEXT : uWS::OpCode::BINARY);
+
+		++InFlight;
+		++Run.Result.MessagesSent;
+		Run.Result.BytesSent += Size;
+	}
+
+	void FLoadConnection::Fill()
+	{
+		while (Run.Phase == ELoadPhase::Running && bReady && IsUpgraded() && InFlight < Run.Settings.InFlight)
+		{
+			SendNext();
+		}
+	}
+
+	void FLoadConnection::OnMessage(const char* Data, const SIZE_T Length, const uWS::OpCode Code)
+	{
+		if (!bReady)
+		{
+			if (Code == uWS::OpCode::TEXT && Length == 1 && Data[0] == NRodinWSLoad::Ready)
+			{
+				bReady = true;
+				++Run.Result.Connected;
+
+				// Late handshake after the connect timeout, join the running load.
+				if (Run.Phase == ELoadPhase::Running)
+				{
+					Fill();
+				}
+				else
+				{
+					Settle(Run);
+				}
+			}
+			return;
+		}
+
+		if (Run.Phase != ELoadPhase::Running || Length < static_cast<SIZE_T>(NRodinWSLoad::HeaderSize))
+		{
+			return;
+		}
+
+		ANSICHAR Sender[9] = {}, Cycles[17] = {};
+		FMemory::Memcpy(Sender, Data + 1, 8);
+		FMemory::Memcpy(Cycles, Data + 9, 16);
+
+		const uint64 SentCycles = FCStringAnsi::Strtoui64(Cycles, nullptr, 16);
+		const double Micros     = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - SentCycles) * 1000.0;
+
+		Run.LatencyMicros.Add(static_cast<uint32>(FMath::Min(Micros, static_cast<double>(MAX_uint32))));
+
+		++Run.Result.MessagesReceived;
+		Run.Result.BytesReceived += Length;
+
+		// Published copies reach every client, only the sender's copy frees a slot.
+		if (static_cast<uint32>(FCStringAnsi::Strtoui64(Sender, nullptr, 16)) == Index)
+		{
+			--InFlight;
+			Fill();
+		}
+	}
+
+	void FLoadConnection::OnClosed(const bool /*bWasUpgraded*/)
+	{
+		if (Run.Phase == ELoadPhase::Connecting && !bReady)
+		{
+			++Run.Result.Failed;
+			Settle(Run);
+		}
+	}
+
+	void OnLoopNoop(us_loop_t* /*Loop*/)
+	{
+	}
+
+	double Percentile(const TArray<uint32>& Sorted, const double Fraction)
+	{
+		if (Sorted.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		const int32 Rank = FMath::Clamp(FMath::CeilToInt(Sorted.Num() * Fraction) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Rank] / 1000.0;
+	}
+}
+
+FRodinWSLoadGenerator::FRodinWSLoadGenerator(const FRodinWSLoadSettings& InSettings)
+	: Settings(InSettings)
+	, bDone(false)
+{
+}
+
+FRodinWSLoadGenerator::~FRodinWSLoadGenerator()
+{
+	if (Thread && Thread->joinable())
+	{
+		Thread->join();
+	}
+}
+
+void FRodinWSLoadGenerator::Start()
+{
+	check(!Thread);
+
+	Thread.Reset(new std::thread([this]() -> void
+	{
+		Run();
+		bDone = true;
+	}));
+}
+
+bool FRodinWSLoadGenerator::IsDone() const
+{
+	return bDone;
+}
+
+FRodinWSLoadResult FRodinWSLoadGenerator::Wait()
+{
+	if (Thread && Thread->joinable())
+	{
+		Thread->join();
+	}
+
+	return Result;
+}
+
+FString NRodinWSLoad::GetEndpoint(const FRodinWSLoadSettings& Settings)
+{
+	return Settings.UnixSocketPath.IsEmpty()
+		? FString::Printf(TEXT("%s:%d"), *Settings.Host, Settings.Port)
+		: FString::Printf(TEXT("unix:%s"), *Settings.UnixSocketPath);
+}
+
+const TCHAR* NRodinWSLoad::GetEventBackend()
+{
+#if defined(LIBUS_USE_IO_URING)
+	return TEXT("io_uring");
+#elif defined(LIBUS_USE_EPOLL)
+	return TEXT("epoll");
+#elif defined(LIBUS_USE_KQUEUE)
+	return TEXT("kqueue");
+#elif defined(LIBUS_USE_GCD)
+	return TEXT("gcd");
+#else
+	return TEXT("libuv");
+#endif
+}
+
+void FRodinWSLoadGenerator::Run()
+{
+	if (Settings.Connections <= 0 || Settings.Sizes.Num() == 0)
+	{
+		return;
+	}
+
+	FLoadRun Run(Settings, Result);
+
+	Run.Loop = us_create_loop(nullptr, &OnLoopNoop, &OnLoopNoop, &OnLoopNoop, 0);
+	if (!Run.Loop)
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Load generator: could not create a %s event loop."), NRodinWSLoad::GetEventBackend());
+		Result.Failed = Settings.Connections;
+		return;
+	}
+
+	us_socket_context_options_t Options = {};
+	Run.Context = us_create_socket_context(0, Run.Loop, 0, Options);
+	FRodinWSTestClient::InitContext(Run.Context);
+
+	Run.Timer = us_create_timer(Run.Loop, 0, sizeof(FLoadRun*));
+	*static_cast<FLoadRun**>(us_timer_ext(Run.Timer)) = &Run;
+
+	for (int32 Index = 0; Index < Settings.Connections; ++Index)
+	{
+		FLoadConnection* const Connection = Run.Connections.Add_GetRef(MakeUnique<FLoadConnection>(Run, static_cast<uint32>(Index))).Get();
+
+		const bool bConnecting = Settings.UnixSocketPath.IsEmpty()
+			? Connection->Connect(Run.Context, Settings.Host, Settings.Port, Settings.Path, Settings.bCompression)
+			: Connection->ConnectUnix(Run.Context, Settings.UnixSocketPath, Settings.Path, Settings.bCompression);
+
+		if (!bConnecting)
+		{
+			++Run.Result.Failed;
+			++Run.Settled;
+		}
+	}
+
+	if (Run.Settled == Run.Connections.Num())
+	{
+		UE_LOG(LogWSServer, Error, TEXT("Load generator: could not create any connection to %s."), *NRodinWSLoad::GetEndpoint(Settings));
+		StopRun(Run);
+	}
+	else
+	{
+		// Give slow handshakes a few seconds before starting with what we have.
+		us_timer_set(Run.Timer, &OnTimer, 5000, 0);
+	}
+
+	us_loop_run(Run.Loop);
+
+	// Closed sockets are only released by the loop, drop the clients before the context.
+	Run.Connections.Reset();
+
+	us_socket_context_free(0, Run.Context);
+	us_loop_free(Run.Loop);
+
+	Run.LatencyMicros.Sort();
+
+	Result.LatencyP50Ms = Percentile(Run.LatencyMicros, 0.50);
+	Result.LatencyP99Ms = Percentile(Run.LatencyMicros, 0.99);
+	Result.LatencyMaxMs = Run.LatencyMicros.Num() ? Run.LatencyMicros.Last() / 1000.0 : 0.0;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <atomic>
+#include <thread>
+THIRD_PARTY_INCLUDES_END
+
+struct FRodinWSLoadSettings
+{
+	FString Host = TEXT("127.0.0.1");
+	int32   Port = 0;
+	FString Path = TEXT("/");
+
+	/** Connects over this Unix domain socket instead of Host:Port when set. */
+	FString UnixSocketPath;
+
+	int32  Connections     = 64;
+	double DurationSeconds = 10.0;
+
+	/** Messages a connection keeps outstanding. 1 is a strict ping-pong. */
+	int32 InFlight = 1;
+
+	/** Payload sizes in bytes, picked uniformly. Clamped to the header size. */
+	TArray<int32> Sizes = { 64, 4096 };
+
+	/** Share of text frames, the rest is binary. */
+	float TextRatio = 0.5f;
+
+	/** Share of messages the server is asked to publish to every client instead of echoing. */
+	float PublishRatio = 0.f;
+
+	/** Offer permessage-deflate during the handshake. */
+	bool bCompression = false;
+};
+
+struct FRodinWSLoadResult
+{
+	int32 Connected = 0;
+	int32 Failed    = 0;
+
+	int64 MessagesSent     = 0;
+	int64 MessagesReceived = 0;
+	int64 BytesSent        = 0;
+	int64 BytesReceived    = 0;
+
+	double Seconds = 0.0;
+
+	double LatencyP50Ms = 0.0;
+	double LatencyP99Ms = 0.0;
+	double LatencyMaxMs = 0.0;
+};
+
+/**
+ * Loopback WebSocket clients driven from their own uSockets loop.
+ *
+ * Every payload starts with a small ASCII header: the request kind (NRodinWSLoad::Echo or NRodinWSLoad::Publish),
+ * the sending connection and the send time. The peer is expected to send NRodinWSLoad::Ready as a text frame
+ * once a connection can take load, then to echo or publish every message it gets unchanged.
+ */
+class FRodinWSLoadGenerator
+{
+public:
+	explicit FRodinWSLoadGenerator(const FRodinWSLoadSettings& InSettings);
+	FRodinWSLoadGenerator(const FRodinWSLoadGenerator&) = delete;
+	~FRodinWSLoadGenerator();
+
+	void Start();
+
+	bool IsDone() const;
+
+	/** Blocks until the run is over. */
+	FRodinWSLoadResult Wait();
+
+private:
+	void Run();
+
+private:
+	const FRodinWSLoadSettings Settings;
+
+	TUniquePtr<std::thread> Thread;
+
+	std::atomic<bool> bDone;
+
+	FRodinWSLoadResult Result;
+};
+
+namespace NRodinWSLoad
+{
+	constexpr ANSICHAR Echo    = 'E';
+	constexpr ANSICHAR Publish = 'P';
+	constexpr ANSICHAR Ready   = 'R';
+
+	/** Kind + 8 hex digits connection + 16 hex digits send cycles. */
+	constexpr int32 HeaderSize = 25;
+
+	/** Host:port or unix:path, for logs. */
+	FString GetEndpoint(const FRodinWSLoadSettings& Settings);
+
+	/** Eventing the embedded uSockets was built with, server and load generator share it. */
+	const TCHAR* GetEventBackend();
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinWSPool.h"
+
+#include "RodinWSServer.h"
+#include "RodinTrace.h"
+
+bool FRodinWSHandle::IsValid() const
+{
+	return Object && Object->Generation == Generation;
+}
+
+FRodinWSPool& FRodinWSPool::Get()
+{
+	static FRodinWSPool Pool;
+	return Pool;
+}
+
+FRodinWSHandle FRodinWSPool::Acquire()
+{
+	RODIN_TRACE_SCOPE("Pool::Acquire");
+	check(IsInGameThread());
+
+	URodinWS* Object = Free.Num() > 0 ? Free.Pop() : NewObject<URodinWS>();
+	InUse.Add(Object);
+
+	return FRodinWSHandle{ Object, Object->Generation };
+}
+
+void FRodinWSPool::Release(const FRodinWSHandle& Handle)
+{
+	check(IsInGameThread());
+
+	if (!Handle.IsValid() || InUse.RemoveSingleSwap(Handle.Object) == 0)
+	{
+		return;
+	}
+
+	// Invalidates every handle to the connection that just ended.
+	URodinWS* const Object = Handle.Object;
+	++Object->Generation;
+	Object->SocketProxy = nullptr;
+	Object->SocketId = 0;
+
+	if (Free.Num() < MaxFree)
+	{
+		Free.Add(Object);
+	}
+}
+
+void FRodinWSPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(InUse);
+	Collector.AddReferencedObjects(Free);
+}
+
+FString FRodinWSPool::GetReferencerName() const
+{
+	return TEXT("FRodinWSPool");
+}
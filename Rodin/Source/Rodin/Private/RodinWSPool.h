@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+#include "UObject/GCObject.h"
+
+/**
+ * Recycles the URodinWS objects handed out to connections, so reconnecting web pages don't
+ * allocate and garbage collect one object per connection. Pooled objects are kept alive by the pool.
+ * Releasing bumps the object's generation, so FRodinWSHandle and GetGeneration tell a reused object apart.
+ * Game thread only.
+ */
+class FRodinWSPool final : public FGCObject
+{
+public:
+	static FRodinWSPool& Get();
+
+	FRodinWSHandle Acquire();
+
+	/** Ends the object's connection and returns it to the pool. Stale handles, already released, are ignored. */
+	void Release(const FRodinWSHandle& Handle);
+
+	// FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+
+private:
+	/** Free objects above this count are left to the garbage collector. */
+	static constexpr int32 MaxFree = 64;
+
+	TArray<URodinWS*> InUse;
+	TArray<URodinWS*> Free;
+};
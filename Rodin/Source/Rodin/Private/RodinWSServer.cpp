@@ -10,6 +10,15 @@
 #include "Serialization/JsonSerializer.h"
 #include "Dom/JsonObject.h"
 #include "RodinWSServerInternal.h"
+#include "RodinTrace.h"
+#include "RodinImageEncoder.h"
+#include "RodinImagePreprocess.h"
+#include "RodinMeshExport.h"
+#include "RodinVoxelizer.h"
+#include "RodinActorBounds.h"
+#include "RodinMessageDispatch.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
 #include "Http.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
@@ -17,6 +26,8 @@
 #include "DesktopPlatformModule.h"
 #include "Components/StaticMeshComponent.h"
 #include "GameFramework/Actor.h"
+#include "Editor.h"
+#include "Selection.h"
 #include "TextureResource.h"
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
@@ -30,6 +41,238 @@ FString port = "";
 FString onlySID = "";
 FString URL = "";
 
+namespace
+{
+	/** Task settings shared by every ST_SubmitInfo variant, named after their Blueprint pins. */
+	struct FSubmitConfig
+	{
+		FString mode_controlNet;
+		FString prompt_partMode;
+		FString mode_windowsClick;
+		bool bUseShaded;
+		bool bUsePBR;
+		bool bBypass;
+		bool bTextTo;
+		FString resolution_mat;
+		FString align_noneMode;
+		FString polygons;
+		FString modelFilePath;
+		FString voxel_condition_cfg;
+		FString modeGenerationExpansion;
+		float height_model;
+		float voxel_condition_weight;
+		float pcd_condition_uncertainty;
+		int quality;
+	};
+
+	TSharedPtr<FJsonValue> MakeImageValue(const uint8* Data, const int64 Length, const FString& Format, const FString& MimeType)
+	{
+		FString MD5Hash;
+		{
+			RODIN_TRACE_SCOPE("MD5");
+			MD5Hash = FMD5::HashBytes(Data, Length);
+		}
+
+		TSharedPtr<FJsonObject> ImageObject = MakeShareable(new FJsonObject);
+		ImageObject->SetStringField("format", Format);
+		ImageObject->SetNumberField("length", Length);
+		ImageObject->SetStringField("md5", MD5Hash);
+		{
+			RODIN_TRACE_SCOPE("Base64Encode");
+			ImageObject->SetStringField("content", FString::Printf(TEXT("data:%s;base64,%s"), *MimeType, *FBase64::Encode(Data, static_cast<uint32>(Length))));
+		}
+
+		return MakeShareable(new FJsonValueObject(ImageObject));
+	}
+
+	TSharedPtr<FJsonObject> MakeConditionObject(const uint8* Data, const int64 Length, const FString& Format, const FString& MimeType)
+	{
+		FString MD5Hash;
+		{
+			RODIN_TRACE_SCOPE("MD5");
+			MD5Hash = FMD5::HashBytes(Data, Length);
+		}
+
+		TSharedPtr<FJsonObject> ConditionObject = MakeShareable(new FJsonObject);
+		ConditionObject->SetStringField("format", Format);
+		ConditionObject->SetNumberField("length", Length);
+		ConditionObject->SetStringField("md5", MD5Hash);
+		{
+			RODIN_TRACE_SCOPE("Base64Encode");
+			ConditionObject->SetStringField("content", FString::Printf(TEXT("data:%s;base64,%s"), *MimeType, *FBase64::Encode(Data, static_cast<uint32>(Length))));
+		}
+
+		return ConditionObject;
+	}
+
+	/**
+	 * Image entry for a loaded file, downsized and cached when preprocessing is on.
+	 * The format comes from the file's signature; FallbackFormat is only used for data it doesn't recognize.
+	 */
+	TSharedPtr<FJsonValue> MakeFileImageValue(IImageWrapperModule& ImageWrapperModule, TArray<uint8>&& ImageData, const FString& FallbackFormat)
+	{
+		const NRodinImageEncoder::FFormatInfo Info = NRodinImageEncoder::DetectFormat(ImageWrapperModule, ImageData.GetData(), ImageData.Num());
+		const FString Format   = Info.Name ? FString(Info.Name) : FallbackFormat;
+		const FString MimeType = Info.MimeType ? FString(Info.MimeType) : TEXT("image/") + FallbackFormat;
+
+		const FRodinImagePreprocessOptions Options = NRodinImagePreprocess::GetOptions();
+		if (!Options.bEnabled)
+		{
+			return MakeImageValue(ImageData.GetData(), ImageData.Num(), Format, MimeType);
+		}
+
+		const uint64 Key = NRodinImagePreprocess::MakeKey(ImageData, Format, Options);
+		if (TSharedPtr<FJsonValue> Cached = NRodinImagePreprocess::FindCached(Key))
+		{
+			return Cached;
+		}
+
+		NRodinImagePreprocess::Process(ImageWrapperModule, ImageData, Info.Format, Options);
+
+		TSharedPtr<FJsonValue> Value = MakeImageValue(ImageData.GetData(), ImageData.Num(), Format, MimeType);
+
+		// Dominated by the base64 content.
+		NRodinImagePreprocess::AddCached(Key, Value, FBase64::GetEncodedDataSize(ImageData.Num()) * sizeof(TCHAR));
+
+		return Value;
+	}
+
+	/** Image entries for files on disk, one task per image. The extension is only a fallback for unrecognized data. */
+	TArray<TSharedPtr<FJsonValue>> LoadImageValues(IImageWrapperModule& ImageWrapperModule, const TArray<FString>& ImagePaths, bool& loadFileSuccess)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		Values.SetNum(ImagePaths.Num());
+
+		TArray<bool> Failed;
+		Failed.SetNumZeroed(ImagePaths.Num());
+
+		ParallelFor(ImagePaths.Num(), [&](const int32 Index) -> void
+		{
+			const FString& ImagePath = ImagePaths[Index];
+			if (ImagePath.IsEmpty()) return;
+
+			TArray<uint8> ImageData;
+			{
+				RODIN_TRACE_SCOPE("LoadFile");
+				if (!FFileHelper::LoadFileToArray(ImageData, *ImagePath))
+				{
+					UE_LOG(LogTemp, Error, TEXT("Failed to load image file: %s"), *ImagePath);
+					Failed[Index] = true;
+					return;
+				}
+			}
+
+			FString Extension = FPaths::GetExtension(ImagePath, true).ToLower(); 
+			if (Extension.StartsWith(TEXT(".")))
+			{
+				Extension = Extension.RightChop(1);
+			}
+			if (Extension.IsEmpty())
+			{
+				Extension = TEXT("png");
+			}
+
+			Values[Index] = MakeFileImageValue(ImageWrapperModule, MoveTemp(ImageData), Extension);
+		});
+
+		TArray<TSharedPtr<FJsonValue>> ImageArray;
+		for (int32 Index = 0; Index < Values.Num(); ++Index)
+		{
+			if (Failed[Index])
+			{
+				loadFileSuccess = false;
+			}
+			else if (Values[Index].IsValid())
+			{
+				ImageArray.Add(MoveTemp(Values[Index]));
+			}
+		}
+
+		return ImageArray;
+	}
+
+	/**
+	 * Builds the fetch_task_return message around already loaded images.
+	 * Without an in-memory ConditionObject, the condition model is loaded from modelFilePath if any.
+	 */
+	void SerializeSubmit(const FString& TaskId, const FSubmitConfig& Config, TArray<TSharedPtr<FJsonValue>>&& ImageArray, TSharedPtr<FJsonObject> ConditionObject, bool& loadFileSuccess, FString& OutJson)
+	{
+		TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject);
+		RootObject->SetStringField("type", "fetch_task_return");
+		RootObject->SetStringField("sid", TaskId);
+
+		TSharedPtr<FJsonObject> TaskObject = MakeShareable(new FJsonObject);
+		TaskObject->SetStringField("type", Config.mode_controlNet);
+		TaskObject->SetStringField("id", TaskId);
+		TaskObject->SetStringField("prompt", Config.prompt_partMode.IsEmpty() ? "" : Config.prompt_partMode);
+
+		TSharedPtr<FJsonObject> ConfigObject = MakeShareable(new FJsonObject);
+		ConfigObject->SetStringField("type", Config.mode_windowsClick);
+
+		TSharedPtr<FJsonObject> MaterialObject = MakeShareable(new FJsonObject);
+		TArray<TSharedPtr<FJsonValue>> TypeArray;
+		if (Config.bUseShaded) TypeArray.Add(MakeShared<FJsonValueString>(TEXT("Shaded")));
+		if (Config.bUsePBR)    TypeArray.Add(MakeShared<FJsonValueString>(TEXT("PBR")));
+		MaterialObject->SetArrayField("type", TypeArray);
+		MaterialObject->SetStringField("resolution", Config.resolution_mat);
+
+		ConfigObject->SetObjectField("material", MaterialObject);
+		ConfigObject->SetNumberField("height", Config.height_model);
+		ConfigObject->SetStringField("align", Config.align_noneMode);
+		ConfigObject->SetStringField("voxel_condition_cfg", Config.voxel_condition_cfg);
+		ConfigObject->SetNumberField("voxel_condition_weight", Config.voxel_condition_weight);
+		ConfigObject->SetNumberField("pcd_condition_uncertainty", Config.pcd_condition_uncertainty);
+		ConfigObject->SetStringField("polygons", Config.polygons);
+		ConfigObject->SetStringField("mode", Config.modeGenerationExpansion);
+		ConfigObject->SetNumberField("quality", Config.quality);
+		ConfigObject->SetBoolField("textTo", Config.bTextTo);
+		ConfigObject->SetBoolField("bypass", Config.bBypass);
+		ConfigObject->SetStringField("text", Config.prompt_partMode);
+
+		TaskObject->SetObjectField("config", ConfigObject);
+		TaskObject->SetArrayField("image", ImageArray);
+
+		if (!ConditionObject.IsValid() && !Config.modelFilePath.IsEmpty())
+		{
+			TArray<uint8> fbxData;
+			bool bLoaded = false;
+			{
+				RODIN_TRACE_SCOPE("LoadFile");
+				bLoaded = FFileHelper::LoadFileToArray(fbxData, *Config.modelFilePath);
+			}
+
+			if (bLoaded)
+			{
+				ConditionObject = MakeConditionObject(fbxData.GetData(), fbxData.Num(), TEXT("fbx"), TEXT("model/fbx"));
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to load fbx file: %s"), *Config.modelFilePath);
+				loadFileSuccess = false;
+			}
+		}
+
+		if (ConditionObject.IsValid()) {
+			TaskObject->SetObjectField("condition", ConditionObject);
+		}
+		else {
+			TaskObject->SetObjectField("condition", MakeShareable(new FJsonObject));
+		}
+
+		RootObject->SetObjectField("task", TaskObject);
+
+		{
+			RODIN_TRACE_SCOPE("JsonSerialize");
+
+			TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutJson);
+			if (!FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to serialize JSON"));
+			}
+		}
+	}
+}
+
 UPARAM(DisplayName = "RodinWS Server")URodinWSServer* URodinWSServer::CreateRodinWSServer()
 {
 	return NewObject<URodinWSServer>();
@@ -96,52 +339,46 @@ bool URodinWSServer::BP_OpenFileDialog(const FString& DialogTitle, const FString
 
 UTexture2D* URodinWSServer::BP_PreviewImg(FString imgPath)
 {
+	RODIN_TRACE_SCOPE("BP_PreviewImg");
+
 	const FString AbsolutePath = FPaths::ConvertRelativePathToFull(imgPath);
 	if (!FPaths::FileExists(AbsolutePath)) {
 		UE_LOG(LogTemp, Error, TEXT("File not found: %s"), *AbsolutePath);
 		return nullptr;
 	}
 
-	const FString Extension = FPaths::GetExtension(AbsolutePath).ToLower();
-	EImageFormat ImageFormat = EImageFormat::Invalid;
-	if (Extension == TEXT("png")) ImageFormat = EImageFormat::PNG;
-	else if (Extension == TEXT("jpg") || Extension == TEXT("jpeg")) ImageFormat = EImageFormat::JPEG;
-	else if (Extension == TEXT("bmp")) ImageFormat = EImageFormat::BMP;
-	else if (Extension == TEXT("exr")) ImageFormat = EImageFormat::EXR;
-
-	if (ImageFormat == EImageFormat::Invalid) {
-		UE_LOG(LogTemp, Error, TEXT("Unsupported image format: %s"), *Extension);
-		return nullptr;
+	TArray<uint8> FileData;
+	{
+		RODIN_TRACE_SCOPE("LoadFile");
+		if (!FFileHelper::LoadFileToArray(FileData, *AbsolutePath)) {
+			UE_LOG(LogTemp, Error, TEXT("Failed to load file: %s"), *AbsolutePath);
+			return nullptr;
+		}
 	}
 
 	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
-	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(ImageFormat);
 
-	TArray<uint8> FileData;
-	if (!FFileHelper::LoadFileToArray(FileData, *AbsolutePath)) {
-		UE_LOG(LogTemp, Error, TEXT("Failed to load file: %s"), *AbsolutePath);
+	const NRodinImageEncoder::FFormatInfo Info = NRodinImageEncoder::DetectFormat(ImageWrapperModule, FileData.GetData(), FileData.Num());
+	if (Info.Format == EImageFormat::Invalid) {
+		UE_LOG(LogTemp, Error, TEXT("Unsupported image format: %s"), *AbsolutePath);
 		return nullptr;
 	}
 
-	TArray<EImageFormat> FormatsToTry = { EImageFormat::PNG, EImageFormat::JPEG, EImageFormat::BMP, EImageFormat::EXR };
-	for (EImageFormat Format : FormatsToTry) {
-		TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule.CreateImageWrapper(Format);
-		if (Wrapper->SetCompressed(FileData.GetData(), FileData.Num())) {
-			ImageWrapper = Wrapper;
-			break;
-		}
-	}
-	if (!ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num())) {
-		//UE_LOG(LogTemp, Error, TEXT("Failed to parse image data"));
-		UE_LOG(LogTemp, Error, TEXT("Failed to parse image data for file: %s. File size: %d bytes. This may be due to corrupt or unsupported image format."), *AbsolutePath, FileData.Num());
-
-		return nullptr;
-	}
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(Info.Format);
 
 	TArray64<uint8> RawData;
-	if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData)) {
-		UE_LOG(LogTemp, Error, TEXT("Failed to get raw image data"));
-		return nullptr;
+	{
+		RODIN_TRACE_SCOPE("DecodeImage");
+
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num())) {
+			UE_LOG(LogTemp, Error, TEXT("Failed to parse image data for file: %s. File size: %d bytes. This may be due to corrupt or unsupported image format."), *AbsolutePath, FileData.Num());
+			return nullptr;
+		}
+
+		if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData)) {
+			UE_LOG(LogTemp, Error, TEXT("Failed to get raw image data"));
+			return nullptr;
+		}
 	}
 
 	const int32 Width = ImageWrapper->GetWidth();
@@ -151,6 +388,8 @@ UTexture2D* URodinWSServer::BP_PreviewImg(FString imgPath)
 		return nullptr;
 	}
 
+	RODIN_TRACE_SCOPE("CreateTexture");
+
 	UTexture2D* NewTexture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
 	if (!NewTexture) {
 		UE_LOG(LogTemp, Error, TEXT("Failed to create transient texture"));
@@ -168,6 +407,16 @@ UTexture2D* URodinWSServer::BP_PreviewImg(FString imgPath)
 	return NewTexture;
 }
 
+void URodinWSServer::SetImagePreprocessOptions(const FRodinImagePreprocessOptions& Options)
+{
+	NRodinImagePreprocess::SetOptions(Options);
+}
+
+FRodinImagePreprocessStats URodinWSServer::GetImagePreprocessStats()
+{
+	return NRodinImagePreprocess::GetStats();
+}
+
 void URodinWSServer::ST_SubmitInfo(
 	FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
 	bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
@@ -176,108 +425,38 @@ void URodinWSServer::ST_SubmitInfo(
 	float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
 	bool& loadFileSuccess, bool& sendSuccess, FString& OutJson, FString& taskID)
 {
-	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject);
-	RootObject->SetStringField("type", "fetch_task_return");
-	RootObject->SetStringField("sid", onlySID);
-
-	TSharedPtr<FJsonObject> TaskObject = MakeShareable(new FJsonObject);
-	TaskObject->SetStringField("type", mode_controlNet);
-	TaskObject->SetStringField("id", onlySID);
-	if (!prompt_partMode.IsEmpty())
-	{
-		TaskObject->SetStringField("prompt", prompt_partMode);
-	}
-	else
-	{
-		TaskObject->SetStringField("prompt", "");
-	}
-
-	TSharedPtr<FJsonObject> ConfigObject = MakeShareable(new FJsonObject);
-	ConfigObject->SetStringField("type", mode_windowsClick);
+	RODIN_TRACE_SCOPE("ST_SubmitInfo");
+	NRodinTrace::TaskStage(onlySID, "SubmitBegin");
 
-	TSharedPtr<FJsonObject> MaterialObject = MakeShareable(new FJsonObject);
-	TArray<TSharedPtr<FJsonValue>> TypeArray;
-	if (bUseShaded) TypeArray.Add(MakeShared<FJsonValueString>(TEXT("Shaded")));
-	if (bUsePBR)    TypeArray.Add(MakeShared<FJsonValueString>(TEXT("PBR")));
-	MaterialObject->SetArrayField("type", TypeArray);
-	MaterialObject->SetStringField("resolution", resolution_mat);
-
-	ConfigObject->SetObjectField("material", MaterialObject);
-	ConfigObject->SetNumberField("height", height_model);
-	ConfigObject->SetStringField("align", align_noneMode);
-
-	ConfigObject->SetStringField("voxel_condition_cfg", voxel_condition_cfg);
-	ConfigObject->SetNumberField("voxel_condition_weight", voxel_condition_weight);
-	ConfigObject->SetNumberField("pcd_condition_uncertainty", pcd_condition_uncertainty);
-	ConfigObject->SetStringField("polygons", polygons);
-	ConfigObject->SetStringField("mode", modeGenerationExpansion);
-	ConfigObject->SetNumberField("quality", quality);
-	ConfigObject->SetBoolField("textTo", bTextTo);
-	ConfigObject->SetBoolField("bypass", bBypass);
-	ConfigObject->SetStringField("text", prompt_partMode);
-
-	TaskObject->SetObjectField("config", ConfigObject);
+	const FSubmitConfig Config{
+		mode_controlNet, prompt_partMode, mode_windowsClick,
+		bUseShaded, bUsePBR, bBypass, bTextTo,
+		resolution_mat, align_noneMode, polygons,
+		modelFilePath, voxel_condition_cfg, modeGenerationExpansion,
+		height_model, voxel_condition_weight, pcd_condition_uncertainty, quality };
 
 	TArray<TSharedPtr<FJsonValue>> ImageArray;
 	if (!ImagePath.IsEmpty())
 	{
 		TArray<uint8> ImageData;
-		if (!FFileHelper::LoadFileToArray(ImageData, *ImagePath))
-		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to load image file: %s"), *ImagePath);
-			loadFileSuccess = false;
-		}
-
-		FString MD5Hash = FMD5::HashBytes(ImageData.GetData(), ImageData.Num());
-
-		TSharedPtr<FJsonObject> ImageObject = MakeShareable(new FJsonObject);
-		ImageObject->SetStringField("format", "png");
-		ImageObject->SetNumberField("length", ImageData.Num());
-		ImageObject->SetStringField("md5", MD5Hash);
-		ImageObject->SetStringField("content", "data:image/png;base64," + FBase64::Encode(ImageData));
-
-		ImageArray.Add(MakeShareable(new FJsonValueObject(ImageObject)));
-	}
-	TaskObject->SetArrayField("image", ImageArray);
-
-	TSharedPtr<FJsonObject> ConditionObject = nullptr;
-
-	if (!modelFilePath.IsEmpty())
-	{
-		TArray<uint8> fbxData;
-		if (FFileHelper::LoadFileToArray(fbxData, *modelFilePath))
-		{
-			ConditionObject = MakeShareable(new FJsonObject);
-			FString MD5Hash = FMD5::HashBytes(fbxData.GetData(), fbxData.Num());
-			FString Base64Content = "data:model/fbx;base64," + FBase64::Encode(fbxData);
-
-			ConditionObject->SetStringField("format", "fbx");
-			ConditionObject->SetNumberField("length", fbxData.Num());
-			ConditionObject->SetStringField("md5", MD5Hash);
-			ConditionObject->SetStringField("content", Base64Content);
-		}
-		else
 		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to load fbx file: %s"), *modelFilePath);
-			loadFileSuccess = false;
+			RODIN_TRACE_SCOPE("LoadFile");
+			if (!FFileHelper::LoadFileToArray(ImageData, *ImagePath))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to load image file: %s"), *ImagePath);
+				loadFileSuccess = false;
+			}
 		}
-	}
 
-	if (ConditionObject.IsValid()) {
-		TaskObject->SetObjectField("condition", ConditionObject);
-	}
-	else {
-		TaskObject->SetObjectField("condition", MakeShareable(new FJsonObject));
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		ImageArray.Add(MakeFileImageValue(ImageWrapperModule, MoveTemp(ImageData), TEXT("png")));
 	}
 
-	RootObject->SetObjectField("task", TaskObject);
+	SerializeSubmit(onlySID, Config, MoveTemp(ImageArray), nullptr, loadFileSuccess, OutJson);
 
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutJson);
-	if (!FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer))
-	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to serialize JSON"));
-	}
 	taskID = onlySID;
+	FollowTaskFromHandledSocket(taskID);
+	NRodinTrace::TaskStage(taskID, "SubmitEnd");
 }
 
 void URodinWSServer::ST_SubmitInfo_Multi(
@@ -288,130 +467,263 @@ void URodinWSServer::ST_SubmitInfo_Multi(
 	FString modeGenerationExpansion, float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality, 
 	bool& loadFileSuccess, bool& sendSuccess, FString& OutJson, FString& taskID)
 {
+	RODIN_TRACE_SCOPE("ST_SubmitInfo_Multi");
+	NRodinTrace::TaskStage(onlySID, "SubmitBegin");
+
 	loadFileSuccess = true;
 	sendSuccess = false;
 
-	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject);
-	RootObject->SetStringField("type", "fetch_task_return");
-	RootObject->SetStringField("sid", onlySID);
-
-	TSharedPtr<FJsonObject> TaskObject = MakeShareable(new FJsonObject);
-	TaskObject->SetStringField("type", mode_controlNet);
-	TaskObject->SetStringField("id", onlySID);
-	TaskObject->SetStringField("prompt", prompt_partMode.IsEmpty() ? "" : prompt_partMode);
-
-	TSharedPtr<FJsonObject> ConfigObject = MakeShareable(new FJsonObject);
-	ConfigObject->SetStringField("type", mode_windowsClick);
-
-	TSharedPtr<FJsonObject> MaterialObject = MakeShareable(new FJsonObject);
-	TArray<TSharedPtr<FJsonValue>> TypeArray;
-	if (bUseShaded) TypeArray.Add(MakeShared<FJsonValueString>(TEXT("Shaded")));
-	if (bUsePBR)    TypeArray.Add(MakeShared<FJsonValueString>(TEXT("PBR")));
-	MaterialObject->SetArrayField("type", TypeArray);
-	MaterialObject->SetStringField("resolution", resolution_mat);
-
-	ConfigObject->SetObjectField("material", MaterialObject);
-	ConfigObject->SetNumberField("height", height_model);
-	ConfigObject->SetStringField("align", align_noneMode);
-	ConfigObject->SetStringField("voxel_condition_cfg", voxel_condition_cfg);
-	ConfigObject->SetNumberField("voxel_condition_weight", voxel_condition_weight);
-	ConfigObject->SetNumberField("pcd_condition_uncertainty", pcd_condition_uncertainty);
-	ConfigObject->SetStringField("polygons", polygons);
-	ConfigObject->SetStringField("mode", modeGenerationExpansion);
-	ConfigObject->SetNumberField("quality", quality);
-	ConfigObject->SetBoolField("textTo", bTextTo);
-	ConfigObject->SetBoolField("bypass", bBypass);
-	ConfigObject->SetStringField("text", prompt_partMode);
-
-	TaskObject->SetObjectField("config", ConfigObject);
+	const FSubmitConfig Config{
+		mode_controlNet, prompt_partMode, mode_windowsClick,
+		bUseShaded, bUsePBR, bBypass, bTextTo,
+		resolution_mat, align_noneMode, polygons,
+		modelFilePath, voxel_condition_cfg, modeGenerationExpansion,
+		height_model, voxel_condition_weight, pcd_condition_uncertainty, quality };
 
-	TArray<TSharedPtr<FJsonValue>> ImageArray;
-	for (const FString& ImagePath : ImagePaths)
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	TArray<TSharedPtr<FJsonValue>> ImageArray = LoadImageValues(ImageWrapperModule, ImagePaths, loadFileSuccess);
+
+	SerializeSubmit(onlySID, Config, MoveTemp(ImageArray), nullptr, loadFileSuccess, OutJson);
+
+	taskID = onlySID;
+	sendSuccess = true;
+	FollowTaskFromHandledSocket(taskID);
+	NRodinTrace::TaskStage(taskID, "SubmitEnd");
+}
+
+void URodinWSServer::ST_SubmitInfo_Textures(
+	FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+	bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+	FString resolution_mat, FString align_noneMode, TArray<UTexture*> Images, ERodinImageEncoding Encoding,
+	FString polygons, FString modelFilePath, FString voxel_condition_cfg, FString modeGenerationExpansion,
+	float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+	FOnRodinSubmitEncoded OnEncoded)
+{
+	RODIN_TRACE_SCOPE("ST_SubmitInfo_Textures");
+
+	TArray<FRodinImagePixels> Pixels;
+	Pixels.SetNum(Images.Num());
+
+	for (int32 Index = 0; Index < Images.Num(); ++Index)
 	{
-		if (ImagePath.IsEmpty()) continue;
+		// A failed readback leaves an empty image, reported by the encoder as a failed load.
+		NRodinImageEncoder::ReadPixels(Images[Index], Pixels[Index]);
+	}
 
-		TArray<uint8> ImageData;
-		if (!FFileHelper::LoadFileToArray(ImageData, *ImagePath))
+	ST_SubmitInfo_Pixels(
+		MoveTemp(mode_controlNet), MoveTemp(prompt_partMode), MoveTemp(mode_windowsClick),
+		bUseShaded, bUsePBR, bBypass, bTextTo,
+		MoveTemp(resolution_mat), MoveTemp(align_noneMode), MoveTemp(Pixels), Encoding,
+		MoveTemp(polygons), MoveTemp(modelFilePath), MoveTemp(voxel_condition_cfg), MoveTemp(modeGenerationExpansion),
+		height_model, voxel_condition_weight, pcd_condition_uncertainty, quality,
+		MoveTemp(OnEncoded));
+}
+
+void URodinWSServer::ST_SubmitInfo_Pixels(
+	FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+	bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+	FString resolution_mat, FString align_noneMode, TArray<FRodinImagePixels> Images, ERodinImageEncoding Encoding,
+	FString polygons, FString modelFilePath, FString voxel_condition_cfg, FString modeGenerationExpansion,
+	float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+	FOnRodinSubmitEncoded OnEncoded)
+{
+	RODIN_TRACE_SCOPE("ST_SubmitInfo_Pixels");
+
+	const FString TaskId = onlySID;
+	NRodinTrace::TaskStage(TaskId, "SubmitBegin");
+
+	// Subscribed now, the socket must follow the task before its progress comes in.
+	FollowTaskFromHandledSocket(TaskId);
+
+	FSubmitConfig Config{
+		MoveTemp(mode_controlNet), MoveTemp(prompt_partMode), MoveTemp(mode_windowsClick),
+		bUseShaded, bUsePBR, bBypass, bTextTo,
+		MoveTemp(resolution_mat), MoveTemp(align_noneMode), MoveTemp(polygons),
+		MoveTemp(modelFilePath), MoveTemp(voxel_condition_cfg), MoveTemp(modeGenerationExpansion),
+		height_model, voxel_condition_weight, pcd_condition_uncertainty, quality };
+
+	// Loaded here, creating wrappers from the worker is thread safe.
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	Async(EAsyncExecution::ThreadPool,
+		[TaskId, Config = MoveTemp(Config), Images = MoveTemp(Images), Encoding, &ImageWrapperModule, OnEncoded = MoveTemp(OnEncoded)]() mutable -> void
+	{
+		TArray<TArray64<uint8>> Encoded;
+		Encoded.SetNum(Images.Num());
+
+		const FRodinImagePreprocessOptions Preprocess = NRodinImagePreprocess::GetOptions();
+
+		ParallelFor(Images.Num(), [&](const int32 Index) -> void
 		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to load image file: %s"), *ImagePath);
-			loadFileSuccess = false;
-			continue;
-		}
+			if (Preprocess.bEnabled)
+			{
+				NRodinImagePreprocess::Process(Images[Index], Preprocess);
+			}
+
+			if (!NRodinImageEncoder::Encode(ImageWrapperModule, Images[Index], Encoding, Encoded[Index]))
+			{
+				Encoded[Index].Reset();
+			}
+		});
 
-		FString Extension = FPaths::GetExtension(ImagePath, true).ToLower(); 
-		if (Extension.StartsWith(TEXT(".")))
+		Images.Empty();
+
+		bool loadFileSuccess = true;
+
+		TArray<TSharedPtr<FJsonValue>> ImageArray;
+		for (const TArray64<uint8>& ImageData : Encoded)
 		{
-			Extension = Extension.RightChop(1);
+			if (ImageData.Num() == 0)
+			{
+				UE_LOG(LogTemp, Error, TEXT("Failed to encode image for task %s"), *TaskId);
+				loadFileSuccess = false;
+				continue;
+			}
+
+			const FString Format = NRodinImageEncoder::GetFormatName(Encoding);
+			ImageArray.Add(MakeImageValue(ImageData.GetData(), ImageData.Num(), Format, NRodinImageEncoder::GetMimeType(Encoding)));
 		}
-		if (Extension.IsEmpty())
+
+		Encoded.Empty();
+
+		FString OutJson;
+		SerializeSubmit(TaskId, Config, MoveTemp(ImageArray), nullptr, loadFileSuccess, OutJson);
+
+		NRodinTrace::TaskStage(TaskId, "SubmitEnd");
+
+		AsyncTask(ENamedThreads::GameThread,
+			[OnEncoded = MoveTemp(OnEncoded), loadFileSuccess, OutJson = MoveTemp(OutJson), TaskId]() -> void
 		{
-			Extension = TEXT("png");
-		}
+			OnEncoded.ExecuteIfBound(loadFileSuccess, OutJson, TaskId);
+		});
+	});
+}
 
-		FString MD5Hash = FMD5::HashBytes(ImageData.GetData(), ImageData.Num());
+void URodinWSServer::ST_SubmitInfo_Actors(
+	FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+	bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+	FString resolution_mat, FString align_noneMode, TArray<FString> ImagePaths,
+	FString polygons, TArray<AActor*> ConditionActors, FRodinMeshExportOptions ExportOptions,
+	FString voxel_condition_cfg, FString modeGenerationExpansion,
+	float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+	FOnRodinSubmitEncoded OnEncoded)
+{
+	RODIN_TRACE_SCOPE("ST_SubmitInfo_Actors");
 
-		TSharedPtr<FJsonObject> ImageObject = MakeShareable(new FJsonObject);
-		ImageObject->SetStringField("format", Extension);
-		ImageObject->SetNumberField("length", ImageData.Num());
-		ImageObject->SetStringField("md5", MD5Hash);
-		ImageObject->SetStringField("content", FString::Printf(TEXT("data:image/%s;base64,%s"), *Extension, *FBase64::Encode(ImageData)));
+	const FString TaskId = onlySID;
+	NRodinTrace::TaskStage(TaskId, "SubmitBegin");
 
-		ImageArray.Add(MakeShareable(new FJsonValueObject(ImageObject)));
-	}
-	TaskObject->SetArrayField("image", ImageArray);
+	FollowTaskFromHandledSocket(TaskId);
 
-	TSharedPtr<FJsonObject> ConditionObject = nullptr;
-	if (!modelFilePath.IsEmpty())
+#if WITH_EDITOR
+	if (ConditionActors.Num() == 0 && GEditor)
 	{
-		TArray<uint8> fbxData;
-		if (FFileHelper::LoadFileToArray(fbxData, *modelFilePath))
-		{
-			ConditionObject = MakeShareable(new FJsonObject);
-			FString MD5Hash = FMD5::HashBytes(fbxData.GetData(), fbxData.Num());
-			FString Base64Content = "data:model/fbx;base64," + FBase64::Encode(fbxData);
-
-			ConditionObject->SetStringField("format", "fbx");
-			ConditionObject->SetNumberField("length", fbxData.Num());
-			ConditionObject->SetStringField("md5", MD5Hash);
-			ConditionObject->SetStringField("content", Base64Content);
-		}
-		else
-		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to load fbx file: %s"), *modelFilePath);
-			loadFileSuccess = false;
-		}
+		GEditor->GetSelectedActors()->GetSelectedObjects<AActor>(ConditionActors);
 	}
+#endif
 
-	if (ConditionObject.IsValid()) {
-		TaskObject->SetObjectField("condition", ConditionObject);
-	}
-	else {
-		TaskObject->SetObjectField("condition", MakeShareable(new FJsonObject));
+	NRodinMeshExport::FMeshSnapshot Snapshot;
+	if (!NRodinMeshExport::Capture(ConditionActors, Snapshot))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No static mesh geometry to use as condition for task %s"), *TaskId);
 	}
 
-	RootObject->SetObjectField("task", TaskObject);
+	FSubmitConfig Config{
+		MoveTemp(mode_controlNet), MoveTemp(prompt_partMode), MoveTemp(mode_windowsClick),
+		bUseShaded, bUsePBR, bBypass, bTextTo,
+		MoveTemp(resolution_mat), MoveTemp(align_noneMode), MoveTemp(polygons),
+		FString(), MoveTemp(voxel_condition_cfg), MoveTemp(modeGenerationExpansion),
+		height_model, voxel_condition_weight, pcd_condition_uncertainty, quality };
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
 
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutJson);
-	if (!FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer))
+	Async(EAsyncExecution::ThreadPool,
+		[TaskId, Config = MoveTemp(Config), ImagePaths = MoveTemp(ImagePaths), Snapshot = MoveTemp(Snapshot), ExportOptions, &ImageWrapperModule, OnEncoded = MoveTemp(OnEncoded)]() mutable -> void
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to serialize JSON"));
-	}
+		bool loadFileSuccess = true;
 
-	taskID = onlySID;
-	sendSuccess = true;
+		TArray<TSharedPtr<FJsonValue>> ImageArray = LoadImageValues(ImageWrapperModule, ImagePaths, loadFileSuccess);
+
+		TSharedPtr<FJsonObject> ConditionObject;
+		if (Snapshot.Indices.Num() > 0)
+		{
+			switch (ExportOptions.Kind)
+			{
+			case ERodinConditionKind::Voxels:
+			{
+				float VoxelSize = 0.f;
+				const TArray<FVector3f> Centers = NRodinVoxelizer::Voxelize(Snapshot, ExportOptions.VoxelResolution, VoxelSize);
+				const TArray64<uint8> Ply = NRodinVoxelizer::WritePly(Centers, FString::Printf(TEXT("voxel_size %f"), VoxelSize));
+
+				ConditionObject = MakeConditionObject(Ply.GetData(), Ply.Num(), TEXT("ply"), TEXT("model/ply"));
+				break;
+			}
+			case ERodinConditionKind::Points:
+			{
+				const TArray<FVector3f> Points = NRodinVoxelizer::SamplePoints(Snapshot, ExportOptions.PointCount, 0);
+				const TArray64<uint8> Ply = NRodinVoxelizer::WritePly(Points, TEXT("surface_samples"));
+
+				ConditionObject = MakeConditionObject(Ply.GetData(), Ply.Num(), TEXT("ply"), TEXT("model/ply"));
+				break;
+			}
+			default:
+			{
+				if (ExportOptions.bWeld)
+				{
+					NRodinMeshExport::Weld(Snapshot, ExportOptions.WeldTolerance);
+				}
+
+				const TArray64<uint8> Glb = NRodinMeshExport::WriteGlb(Snapshot, ExportOptions.bQuantize);
+
+				ConditionObject = MakeConditionObject(Glb.GetData(), Glb.Num(), TEXT("glb"), TEXT("model/gltf-binary"));
+				break;
+			}
+			}
+
+			Snapshot = NRodinMeshExport::FMeshSnapshot();
+		}
+
+		FString OutJson;
+		SerializeSubmit(TaskId, Config, MoveTemp(ImageArray), MoveTemp(ConditionObject), loadFileSuccess, OutJson);
+
+		NRodinTrace::TaskStage(TaskId, "SubmitEnd");
+
+		AsyncTask(ENamedThreads::GameThread,
+			[OnEncoded = MoveTemp(OnEncoded), loadFileSuccess, OutJson = MoveTemp(OutJson), TaskId]() -> void
+		{
+			OnEncoded.ExecuteIfBound(loadFileSuccess, OutJson, TaskId);
+		});
+	});
 }
 
 void URodinWSServer::ST_MessageParse(FString JsonString, bool& endDownload, FString& modelPath)
 {
+	RODIN_TRACE_SCOPE("ST_MessageParse");
+
 	endDownload = false;
 
 	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
 	TSharedPtr<FJsonObject> JsonObject;
 
-	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON."));
-		return;
+		RODIN_TRACE_SCOPE("JsonParse");
+		if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to parse JSON."));
+			return;
+		}
+	}
+
+	FString TaskId;
+	if (!JsonObject->TryGetStringField(TEXT("sid"), TaskId))
+	{
+		TaskId = onlySID;
+	}
+	NRodinTrace::TaskStage(TaskId, "ResultReceived");
+
+	if (Internal->GetServerState() == ERodinWSServerState::Running)
+	{
+		Internal->SetTaskTimeout(FString(TaskId), 0);
 	}
 
 	const TSharedPtr<FJsonObject>* DataObject;
@@ -448,10 +760,13 @@ void URodinWSServer::ST_MessageParse(FString JsonString, bool& endDownload, FStr
 	}
 
 	TArray<uint8> DecodedBytes;
-	if (!FBase64::Decode(Content, DecodedBytes))
 	{
-		UE_LOG(LogTemp, Error, TEXT("Base64 decoding failed."));
-		return;
+		RODIN_TRACE_SCOPE("Base64Decode");
+		if (!FBase64::Decode(Content, DecodedBytes))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Base64 decoding failed."));
+			return;
+		}
 	}
 
 	FString SaveDir = FPaths::ProjectSavedDir() / TEXT("Models");
@@ -459,11 +774,18 @@ void URodinWSServer::ST_MessageParse(FString JsonString, bool& endDownload, FStr
 
 	FString SavePath = SaveDir / Filename;
 
-	if (FFileHelper::SaveArrayToFile(DecodedBytes, *SavePath))
+	bool bSaved = false;
+	{
+		RODIN_TRACE_SCOPE("SaveFile");
+		bSaved = FFileHelper::SaveArrayToFile(DecodedBytes, *SavePath);
+	}
+
+	if (bSaved)
 	{
 		UE_LOG(LogTemp, Log, TEXT("Model saved to: %s"), *SavePath);
 		endDownload = true;
 		modelPath = SavePath;
+		NRodinTrace::TaskStage(TaskId, "ResultSaved");
 	}
 	else
 	{
@@ -479,65 +801,26 @@ void URodinWSServer::BP_actorSize(AActor* TargetActor, float& sizeX, float& size
 		return;
 	}
 
-	TArray<AActor*> ActorsToCheck;
-	TSet<AActor*> VisitedActors;
-	ActorsToCheck.Add(TargetActor);
-	VisitedActors.Add(TargetActor);
-
-	TArray<UStaticMeshComponent*> AllMeshComponents;
-
-	while (ActorsToCheck.Num() > 0)
-	{
-		AActor* CurrentActor = ActorsToCheck.Pop();
-		TArray<UStaticMeshComponent*> CurrentComponents;
-		CurrentActor->GetComponents<UStaticMeshComponent>(CurrentComponents);
-		AllMeshComponents.Append(CurrentComponents);
-
-		TArray<AActor*> ChildActors;
-		CurrentActor->GetAttachedActors(ChildActors);
-		for (AActor* Child : ChildActors)
-		{
-			if (IsValid(Child) && !VisitedActors.Contains(Child))
-			{
-				ActorsToCheck.Add(Child);
-				VisitedActors.Add(Child);
-			}
-		}
-	}
-
-	if (AllMeshComponents.Num() == 0)
+	const FRodinActorBounds Bounds = NRodinActorBounds::Measure({ TargetActor })[0];
+	if (!Bounds.bValid)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No StaticMeshComponents in actor hierarchy"));
+		UE_LOG(LogTemp, Warning, TEXT("No mesh components in actor hierarchy"));
 		return;
 	}
 
-	FVector TotalMin(FLT_MAX);
-	FVector TotalMax(-FLT_MAX);
-	for (UStaticMeshComponent* MeshComp : AllMeshComponents)
-	{
-		if (MeshComp && MeshComp->GetStaticMesh())
-		{
-			FVector Origin, BoxExtent;
-			MeshComp->GetLocalBounds(Origin, BoxExtent);
-			const FTransform& Transform = MeshComp->GetComponentTransform();
-			FVector WorldOrigin = Transform.TransformPosition(Origin);
-			FVector WorldExtent = Transform.GetScale3D() * BoxExtent;
-
-			FVector Min = WorldOrigin - WorldExtent;
-			FVector Max = WorldOrigin + WorldExtent;
-
-			TotalMin = TotalMin.ComponentMin(Min);
-			TotalMax = TotalMax.ComponentMax(Max);
-		}
-	}
-
-	sizeX = TotalMax.X - TotalMin.X;
-	sizeY = TotalMax.Y - TotalMin.Y;
-	sizeZ = TotalMax.Z - TotalMin.Z;
+	const FVector Size = Bounds.WorldBox.GetSize();
+	sizeX = Size.X;
+	sizeY = Size.Y;
+	sizeZ = Size.Z;
 
 	UE_LOG(LogTemp, Log, TEXT("Actor Size - X:%.2f Y:%.2f Z:%.2f"), sizeX, sizeY, sizeZ);
 }
 
+void URodinWSServer::BP_actorsBounds(const TArray<AActor*>& TargetActors, TArray<FRodinActorBounds>& OutBounds)
+{
+	OutBounds = NRodinActorBounds::Measure(TargetActors);
+}
+
 
 void URodinWSServer::ST_Push()
 {
@@ -580,6 +863,7 @@ void URodinWSServer::Listen(FString Host, FString URI, const int32 Port, FOnRodi
 	Internal->OnPing().BindUObject(this, &URodinWSServer::InternalOnRodinWSMessage);
 	Internal->OnPong().BindUObject(this, &URodinWSServer::InternalOnRodinWSMessage);
 	Internal->OnClosed().BindUObject(this, &URodinWSServer::InternalOnRodinWSClosed);
+	Internal->OnTaskTimeout().BindUObject(this, &URodinWSServer::InternalOnTaskTimeout);
 
 	Internal->Listen(MoveTemp(Host), MoveTemp(URI), Port, MoveTemp(Callback),
 		FOnServerClosed::CreateUObject(this, &URodinWSServer::InternalOnServerClosed));
@@ -601,9 +885,14 @@ void URodinWSServer::StopListening()
 
 void URodinWSServer::SetIdleTimeout(const int64 InIdleTimeout)
 {
-	ensureMsgf(InIdleTimeout == 0 || InIdleTimeout >= 8, TEXT("Idle timeout must be 0 or in [8;inf[. Provided: %d."), InIdleTimeout);
+	SetIdleTimeoutMs(InIdleTimeout * 1000);
+}
+
+void URodinWSServer::SetIdleTimeoutMs(const int64 Milliseconds)
+{
+	ensureMsgf(Milliseconds >= 0, TEXT("Idle timeout must be 0 or positive. Provided: %lld ms."), Milliseconds);
 
-	Internal->SetIdleTimeout(InIdleTimeout);
+	Internal->SetIdleTimeoutMs(FMath::Max<int64>(Milliseconds, 0));
 }
 
 void URodinWSServer::SetMaxLifetime(const int64 InMaxLifetime)
@@ -616,6 +905,79 @@ void URodinWSServer::SetCompression(const ERodinWSCompressOptions InCompression)
 	Internal->SetCompression(InCompression);
 }
 
+void URodinWSServer::SetCoalescedMessageTypes(const TArray<FString>& Types)
+{
+	Internal->SetCoalescedMessageTypes(TArray<FString>(Types));
+}
+
+void URodinWSServer::SetTaskTopicRouting(const bool bEnabled)
+{
+	Internal->SetTaskTopicRouting(bEnabled);
+}
+
+void URodinWSServer::SetBusyPoll(const int32 Microseconds)
+{
+	Internal->SetBusyPoll(Microseconds);
+}
+
+void URodinWSServer::SetReceiveBufferSize(const int32 SizeKB)
+{
+	Internal->SetReceiveBufferSize(SizeKB);
+}
+
+void URodinWSServer::SetUnixSocket(const FString& Path, const bool bUnixSocketOnly)
+{
+	Internal->SetUnixSocket(FString(Path), bUnixSocketOnly);
+}
+
+void URodinWSServer::SetSharedMemoryTransport(const FString& Path, const int32 RingSizeMB)
+{
+	Internal->SetSharedMemory(FString(Path), RingSizeMB);
+}
+
+void URodinWSServer::SetSessionResumption(const bool bEnabled, const int32 CacheSize, const int32 TimeoutSeconds)
+{
+	Internal->SetSessionResumption(bEnabled, CacheSize, TimeoutSeconds);
+}
+
+void URodinWSServer::SetKernelTLS(const bool bEnabled)
+{
+	Internal->SetKernelTLS(bEnabled);
+}
+
+void URodinWSServer::ReloadCertificate(const FString& KeyFile, const FString& CertFile, const FString& PassPhrase)
+{
+	Internal->SetCertificate(FString(), { KeyFile, CertFile, PassPhrase },
+		FOnCertificateUpdated::CreateUObject(this, &URodinWSServer::InternalOnCertificateUpdated, FString()));
+}
+
+void URodinWSServer::SetServerNameCertificate(const FString& HostnamePattern, const FString& KeyFile, const FString& CertFile, const FString& PassPhrase)
+{
+	if (HostnamePattern.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to set a server name certificate: the host name pattern is empty, use ReloadCertificate."));
+		return;
+	}
+
+	Internal->SetCertificate(FString(HostnamePattern), { KeyFile, CertFile, PassPhrase },
+		FOnCertificateUpdated::CreateUObject(this, &URodinWSServer::InternalOnCertificateUpdated, HostnamePattern));
+}
+
+void URodinWSServer::RemoveServerNameCertificate(const FString& HostnamePattern)
+{
+	Internal->RemoveServerName(FString(HostnamePattern));
+}
+
+void URodinWSServer::SetTaskTimeout(const FString& TaskId, const int64 Milliseconds)
+{
+	Internal->SetTaskTimeout(FString(TaskId), Milliseconds);
+}
+
+void URodinWSServer::SetServerThreadMessageHandler(FOnRodinWSServerThreadMessage Handler)
+{
+	Internal->SetServerThreadMessageHandler(MoveTemp(Handler));
+}
+
 void URodinWSServer::Publish(const FString& Topic, const FString& Message, ERodinWSOpCode OpCode)
 {
 	Publish(FString(Topic), FString(Message), OpCode);
@@ -636,6 +998,27 @@ void URodinWSServer::Publish(FString&& Topic, FString&& Message, ERodinWSOpCode
 	Internal->Publish(MoveTemp(Topic), MoveTemp(Message), OpCode);
 }
 
+FString URodinWSServer::GetTaskTopic(const FString& TaskId)
+{
+	return NRodinMessageDispatch::MakeTaskTopic(TaskId);
+}
+
+void URodinWSServer::PublishToTask(const FString& TaskId, const FString& Message)
+{
+	Publish(GetTaskTopic(TaskId), FString(Message));
+}
+
+void URodinWSServer::FollowTaskFromHandledSocket(const FString& TaskId)
+{
+	if (!HandledSocket || !Internal->IsTaskTopicRouting())
+	{
+		return;
+	}
+
+	// Shared memory sockets have no topics, their Subscribe just fails.
+	HandledSocket->Subscribe(GetTaskTopic(TaskId));
+}
+
 void URodinWSServer::SetSendPingsAutomatically(const bool bInSendPingsAutomatically)
 {
 	Internal->SetSendPingsAutomatically(bInSendPingsAutomatically);
@@ -668,32 +1051,129 @@ UPARAM(DisplayName = "State")ERodinWSServerState URodinWSServer::GetServerState(
 	return UPARAM(DisplayName = "State")ERodinWSServerState();
 }
 
+UPARAM(DisplayName = "Stats")FRodinWSServerStats URodinWSServer::GetServerStats() const
+{
+	return Internal->GetStats();
+}
+
+void URodinWSServer::SetMessageHandler(const FName Type, FOnRodinWSTypedMessageNative Handler)
+{
+	NativeMessageHandlers.Add(Type, MoveTemp(Handler));
+}
+
+void URodinWSServer::ClearMessageHandler(const FName Type)
+{
+	NativeMessageHandlers.Remove(Type);
+}
+
+void URodinWSServer::BindMessageType(const FString& Type, FOnRodinWSTypedMessage Handler)
+{
+	MessageHandlers.Add(FName(*Type), MoveTemp(Handler));
+}
+
+void URodinWSServer::UnbindMessageType(const FString& Type)
+{
+	MessageHandlers.Remove(FName(*Type, FNAME_Find));
+}
+
+bool URodinWSServer::DispatchTypedMessage(URodinWS* Socket, const TArray<uint8>& Message)
+{
+	if (NativeMessageHandlers.Num() == 0 && MessageHandlers.Num() == 0)
+	{
+		return false;
+	}
+
+	FName Type;
+	{
+		RODIN_TRACE_SCOPE("Server::PeekType");
+		if (!NRodinMessageDispatch::PeekType(Message, Type))
+		{
+			return false;
+		}
+	}
+
+	if (const FOnRodinWSTypedMessageNative* Handler = NativeMessageHandlers.Find(Type))
+	{
+		if (Handler->IsBound())
+		{
+			Handler->Execute(Socket, Message);
+			return true;
+		}
+	}
+
+	if (const FOnRodinWSTypedMessage* Handler = MessageHandlers.Find(Type))
+	{
+		if (Handler->IsBound())
+		{
+			const FUTF8ToTCHAR Converter((const char*)Message.GetData(), Message.Num());
+			Handler->Execute(Socket, Type.ToString(), FString(Converter.Length(), Converter.Get()));
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void URodinWSServer::InternalOnServerClosed()
 {
 	OnRodinWSServerClosed.Broadcast();
 }
 
+void URodinWSServer::InternalOnTaskTimeout(const FString& TaskId)
+{
+	ST_setStatus(ERodinTaskStatus::TIMEOUT);
+	OnRodinTaskTimeout.Broadcast(TaskId);
+}
+
+void URodinWSServer::InternalOnCertificateUpdated(const bool bSuccess, FString HostnamePattern)
+{
+	OnRodinCertificateUpdated.Broadcast(HostnamePattern, bSuccess);
+}
+
 void URodinWSServer::InternalOnRodinWSOpened(URodinWS* Socket)
 {
+	OnOpenedNative.Broadcast(Socket);
 	OnRodinWSOpened.Broadcast(Socket);
 }
 
 void URodinWSServer::InternalOnRodinWSMessage(URodinWS* Socket, TArray<uint8> Message, ERodinWSOpCode Code)
 {
+	RODIN_TRACE_SCOPE("Server::BroadcastMessage");
+
 	auto ConvertMessage = [&]() -> FString
 		{
+			RODIN_TRACE_SCOPE("Server::ConvertUtf8");
 			const FUTF8ToTCHAR Converter((const char*)Message.GetData(), Message.Num());
 			return FString(Converter.Length(), Converter.Get());
 		};
 
+	// An ST_SubmitInfo* called from a handler subscribes the socket to its task.
+	TGuardValue<URodinWS*> HandledSocketGuard(HandledSocket, Socket);
+
+	if (OnMessageNative.IsBound())
+	{
+		OnMessageNative.Broadcast(Socket, Message, Code);
+	}
+
+	if (Code == ERodinWSOpCode::TEXT && OnTextNative.IsBound())
+	{
+		OnTextNative.Broadcast(Socket, FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Message.GetData()), Message.Num()));
+	}
+
 	switch (Code)
 	{
 	case ERodinWSOpCode::PING:
-		OnRodinWSPing.Broadcast(Socket, ConvertMessage(), Code);
+		if (OnRodinWSPing.IsBound())
+		{
+			OnRodinWSPing.Broadcast(Socket, ConvertMessage(), Code);
+		}
 		break;
 
 	case ERodinWSOpCode::PONG:
-		OnRodinWSPong.Broadcast(Socket, ConvertMessage(), Code);
+		if (OnRodinWSPong.IsBound())
+		{
+			OnRodinWSPong.Broadcast(Socket, ConvertMessage(), Code);
+		}
 		break;
 
 	case ERodinWSOpCode::BINARY:
@@ -705,13 +1185,22 @@ void URodinWSServer::InternalOnRodinWSMessage(URodinWS* Socket, TArray<uint8> Me
 
 	case ERodinWSOpCode::TEXT:
 	default:
+		if (Code == ERodinWSOpCode::TEXT && DispatchTypedMessage(Socket, Message))
+		{
+			break;
+		}
 
-		OnRodinWSMessage.Broadcast(Socket, ConvertMessage(), Code);
+		// Skip the conversion when only native handlers listen.
+		if (OnRodinWSMessage.IsBound())
+		{
+			OnRodinWSMessage.Broadcast(Socket, ConvertMessage(), Code);
+		}
 		break;
 	}
 }
 
 void URodinWSServer::InternalOnRodinWSClosed(URodinWS* Socket, const int32 Code, const FString& Message)
 {
+	OnClosedNative.Broadcast(Socket, Code, Message);
 	OnRodinWSClosed.Broadcast(Socket, Code, Message);
 }
@@ -2,23 +2,143 @@
 
 
 #include "RodinWSServerInternal.h"
+#include "RodinShmTransport.h"
+
+namespace
+{
+	/** Lives in the extension of each task's us_timeout_t. */
+	struct FTaskTimeoutData
+	{
+		FRodinWSServerSharedRessourcesManager* Owner;
+		FString TaskId;
+	};
+}
 
 FRodinWSServerSharedRessourcesManager::FRodinWSServerSharedRessourcesManager()
 	: ListenSocket(nullptr)
+	, UnixListenSocket(nullptr)
 	, ServerStatus(ERodinWSServerState::Closed)
 	, Loop(nullptr)
+	, Stats(MakeShared<FRodinWSServerCounters, ESPMode::ThreadSafe>())
+	, bTaskTopicRouting(false)
+{
+	FRodinWSServerCounters::Register(Stats.ToSharedRef());
+}
+
+void FRodinWSServerSharedRessourcesManager::SetTaskTimeout(const FString& TaskId, const int64 Milliseconds)
+{
+	const unsigned int Delay = static_cast<unsigned int>(FMath::Clamp<int64>(Milliseconds, 0, MAX_uint32));
+
+	if (us_timeout_t** const Existing = TaskTimeouts.Find(TaskId))
+	{
+		if (Delay > 0)
+		{
+			us_timeout_set(*Existing, Delay);
+		}
+		else
+		{
+			DestroyTaskTimeout(*Existing);
+			TaskTimeouts.Remove(TaskId);
+		}
+		return;
+	}
+
+	if (Delay == 0)
+	{
+		return;
+	}
+
+	us_timeout_t* const Timeout = us_create_timeout(reinterpret_cast<us_loop_t*>(uWS::Loop::get()),
+		&FRodinWSServerSharedRessourcesManager::OnTaskTimeoutExpired, sizeof(FTaskTimeoutData));
+	new (us_timeout_ext(Timeout)) FTaskTimeoutData{ this, TaskId };
+
+	us_timeout_set(Timeout, Delay);
+	TaskTimeouts.Add(TaskId, Timeout);
+}
+
+void FRodinWSServerSharedRessourcesManager::ClearTaskTimeouts()
+{
+	for (const TPair<FString, us_timeout_t*>& Pair : TaskTimeouts)
+	{
+		DestroyTaskTimeout(Pair.Value);
+	}
+	TaskTimeouts.Empty();
+}
+
+bool FRodinWSServerSharedRessourcesManager::StartSharedMemory(const FString& Path, const uint64 RingCapacity, const FOnOpened& OnOpened,
+	const FOnMessage& OnMessage, const FOnClosed& OnClosed, const FOnRodinWSServerThreadMessage& ServerThreadHandler)
 {
+	check(!SharedMemory);
+
+	FRodinShmTransport::FSettings Settings;
+	Settings.Path                = Path;
+	Settings.RingCapacity        = RingCapacity;
+	Settings.OnOpened            = OnOpened;
+	Settings.OnMessage           = OnMessage;
+	Settings.OnClosed            = OnClosed;
+	Settings.ServerThreadHandler = ServerThreadHandler;
+	Settings.Stats               = Stats;
+
+	SharedMemory = MakeShared<FRodinShmTransport, ESPMode::ThreadSafe>(MoveTemp(Settings));
+	if (!SharedMemory->Start())
+	{
+		SharedMemory.Reset();
+		return false;
+	}
+
+	return true;
+}
+
+void FRodinWSServerSharedRessourcesManager::StopSharedMemory()
+{
+	if (SharedMemory)
+	{
+		SharedMemory->Stop();
+		SharedMemory.Reset();
+	}
+}
+
+void FRodinWSServerSharedRessourcesManager::OnTaskTimeoutExpired(us_timeout_t* Timeout)
+{
+	FTaskTimeoutData* const Data = static_cast<FTaskTimeoutData*>(us_timeout_ext(Timeout));
+	FRodinWSServerSharedRessourcesManager* const Owner = Data->Owner;
+	FString TaskId = MoveTemp(Data->TaskId);
+
+	Owner->TaskTimeouts.Remove(TaskId);
+	DestroyTaskTimeout(Timeout);
+
+	UE_LOG(LogTemp, Warning, TEXT("Task %s timed out."), *TaskId);
+
+	AsyncTask(ENamedThreads::GameThread, [OnTaskTimeout = Owner->OnTaskTimeout, TaskId = MoveTemp(TaskId)]() -> void
+	{
+		OnTaskTimeout.ExecuteIfBound(TaskId);
+	});
+}
+
+void FRodinWSServerSharedRessourcesManager::DestroyTaskTimeout(us_timeout_t* Timeout)
+{
+	static_cast<FTaskTimeoutData*>(us_timeout_ext(Timeout))->~FTaskTimeoutData();
+	us_timeout_close(Timeout);
 }
 
 IRodinWSServerInternal::IRodinWSServerInternal()
 	: MaxLifetime(DefaultMaxLifetime)
 	, MaxPayloadLength(DefaultMaxPayloadLength)
-	, IdleTimeout(DefaultIdleTimeout)
+	, IdleTimeoutMs(DefaultIdleTimeoutMs)
 	, MaxBackPressure(DefaultMaxBackPressure)
 	, bCloseOnBackpressureLimit(false)
 	, bResetIdleTimeoutOnSend(false)
 	, bSendPingsAutomatically(true)
 	, Compression(ERodinWSCompressOptions::DISABLED)
+	, CoalescedMessageTypes({ TEXT("task_progress") })
+	, BusyPollMicroseconds(0)
+	, ReceiveBufferLength(0)
+	, bUnixSocketOnly(false)
+	, SharedMemoryRingCapacity(0)
+	, bTaskTopicRouting(true)
+	, SessionCacheSize(0)
+	, SessionTimeout(0)
+	, bKernelTLS(false)
 	, SharedRessources(MakeShared<FRodinWSServerSharedRessourcesManager, ESPMode::ThreadSafe>())
 {
 }
@@ -34,9 +154,9 @@ void IRodinWSServerInternal::SetMaxPayloadLength(const int64 InMaxLifetime)
 	MaxPayloadLength = InMaxLifetime;
 }
 
-void IRodinWSServerInternal::SetIdleTimeout(const int64 InIdleTimeout)
+void IRodinWSServerInternal::SetIdleTimeoutMs(const int64 InIdleTimeoutMs)
 {
-	IdleTimeout = InIdleTimeout;
+	IdleTimeoutMs = InIdleTimeoutMs;
 }
 
 void IRodinWSServerInternal::SetMaxBackPressure(const int64 InMaxBackPressure)
@@ -64,11 +184,137 @@ void IRodinWSServerInternal::SetCompression(ERodinWSCompressOptions InCompressio
 	Compression = InCompression;
 }
 
+void IRodinWSServerInternal::SetCoalescedMessageTypes(TArray<FString>&& InTypes)
+{
+	// Sockets open on the server thread, they only read the copy it owns.
+	FScopeLock Lock(&SharedRessources->LoopAccess);
+
+	CoalescedMessageTypes = MoveTemp(InTypes);
+
+	if (SharedRessources->Loop)
+	{
+		auto LoopWork = [SharedRessources = this->SharedRessources, Types = CoalescedMessageTypes, DeferredCycles = FPlatformTime::Cycles64()]() mutable -> void
+		{
+			NRodinTrace::OnLoopWoken();
+
+			SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+			SharedRessources->CoalescedTypes = MoveTemp(Types);
+		};
+
+		SharedRessources->Stats->OnDeferred();
+		SharedRessources->Loop->defer(MoveTemp(LoopWork));
+	}
+}
+
+void IRodinWSServerInternal::SetBusyPoll(const int32 InMicroseconds)
+{
+	BusyPollMicroseconds = FMath::Max(InMicroseconds, 0);
+}
+
+void IRodinWSServerInternal::SetReceiveBufferSize(const int32 InSizeKB)
+{
+	// uSockets falls back to its default for 0 and raises anything under its minimum.
+	ReceiveBufferLength = FMath::Clamp(InSizeKB, 0, MAX_int32 / 1024 - 1) * 1024;
+}
+
+void IRodinWSServerInternal::SetUnixSocket(FString&& InPath, const bool bInUnixSocketOnly)
+{
+	UnixSocketPath  = MoveTemp(InPath);
+	bUnixSocketOnly = bInUnixSocketOnly && !UnixSocketPath.IsEmpty();
+}
+
+void IRodinWSServerInternal::SetSharedMemory(FString&& InPath, const int32 RingSizeMB)
+{
+#if !PLATFORM_LINUX
+	if (!InPath.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("The shared-memory transport is only available on Linux, Listen will fail."));
+	}
+#endif
+
+	SharedMemoryPath         = MoveTemp(InPath);
+	SharedMemoryRingCapacity = FMath::RoundUpToPowerOfTwo64(static_cast<uint64>(FMath::Clamp(RingSizeMB, 1, 1024)) << 20);
+}
+
+void IRodinWSServerInternal::SetServerThreadMessageHandler(FOnRodinWSServerThreadMessage&& InHandler)
+{
+	// Sockets open on the server thread, they only read the copy it owns.
+	FScopeLock Lock(&SharedRessources->LoopAccess);
+
+	ServerThreadMessageHandler = MoveTemp(InHandler);
+
+	if (SharedRessources->Loop)
+	{
+		auto LoopWork = [SharedRessources = this->SharedRessources, Handler = ServerThreadMessageHandler, DeferredCycles = FPlatformTime::Cycles64()]() -> void
+		{
+			NRodinTrace::OnLoopWoken();
+
+			SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+			SharedRessources->ServerThreadHandler = Handler;
+		};
+
+		SharedRessources->Stats->OnDeferred();
+		SharedRessources->Loop->defer(MoveTemp(LoopWork));
+	}
+}
+
+void IRodinWSServerInternal::SetTaskTopicRouting(const bool bInEnabled)
+{
+	// Sockets open on the server thread, they only read the copy it owns.
+	FScopeLock Lock(&SharedRessources->LoopAccess);
+
+	bTaskTopicRouting = bInEnabled;
+
+	if (SharedRessources->Loop)
+	{
+		auto LoopWork = [SharedRessources = this->SharedRessources, bInEnabled, DeferredCycles = FPlatformTime::Cycles64()]() -> void
+		{
+			NRodinTrace::OnLoopWoken();
+
+			SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+			SharedRessources->bTaskTopicRouting = bInEnabled;
+		};
+
+		SharedRessources->Stats->OnDeferred();
+		SharedRessources->Loop->defer(MoveTemp(LoopWork));
+	}
+}
+
+void IRodinWSServerInternal::SetTaskTimeout(FString&& TaskId, const int64 Milliseconds)
+{
+	auto LoopWork = [SharedRessources = this->SharedRessources, TaskId = MoveTemp(TaskId), Milliseconds, DeferredCycles = FPlatformTime::Cycles64()]() -> void
+	{
+		NRodinTrace::OnLoopWoken();
+
+		SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+		SharedRessources->SetTaskTimeout(TaskId, Milliseconds);
+	};
+
+	{
+		FScopeLock Lock(&SharedRessources->LoopAccess);
+
+		if (SharedRessources->Loop)
+		{
+			SharedRessources->Stats->OnDeferred();
+			SharedRessources->Loop->defer(MoveTemp(LoopWork));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to set a task timeout: the server isn't running."));
+		}
+	}
+}
+
 ERodinWSServerState IRodinWSServerInternal::GetServerState() const
 {
 	return SharedRessources->ServerStatus;
 }
 
+FRodinWSServerStats IRodinWSServerInternal::GetStats() const
+{
+	return SharedRessources->Stats->Snapshot();
+}
+
 void IRodinWSServerInternal::SetSSLOptions(
 	FString&& InKeyFile,
 	FString&& InCertFile,
@@ -83,6 +329,86 @@ void IRodinWSServerInternal::SetSSLOptions(
 	CaFileName = MoveTemp(InCaFileName);
 }
 
+void IRodinWSServerInternal::SetSessionResumption(const bool bInEnabled, const int32 InCacheSize, const int32 InTimeoutSeconds)
+{
+	// uSockets reads a negative cache size as disabled, 0 as OpenSSL's default.
+	SessionCacheSize = bInEnabled ? FMath::Max(InCacheSize, 0) : -1;
+	SessionTimeout   = FMath::Max(InTimeoutSeconds, 0);
+}
+
+void IRodinWSServerInternal::SetKernelTLS(const bool bInKernelTLS)
+{
+#if !PLATFORM_LINUX
+	if (bInKernelTLS)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Kernel TLS is only available on Linux, OpenSSL keeps encrypting."));
+	}
+#endif
+
+	bKernelTLS = bInKernelTLS;
+}
+
+FRodinWSSSLOptions IRodinWSServerInternal::MakeSSLOptions(const FRodinWSCertificate& Certificate) const
+{
+	FRodinWSSSLOptions Options;
+
+	Options.KeyFile          = TCHAR_TO_UTF8(*Certificate.KeyFile);
+	Options.CertFile         = TCHAR_TO_UTF8(*Certificate.CertFile);
+	Options.PassPhrase       = TCHAR_TO_UTF8(*Certificate.PassPhrase);
+
+	// SNI contexts replace the default one for the whole handshake, client certificates included.
+	Options.DhParamsFile     = TCHAR_TO_UTF8(*DhParamsFile);
+	Options.CaFileName       = TCHAR_TO_UTF8(*CaFileName);
+	Options.SessionCacheSize = SessionCacheSize;
+	Options.SessionTimeout   = SessionTimeout;
+	Options.bKernelTLS       = bKernelTLS;
+
+	return Options;
+}
+
+TArray<TPair<FString, FRodinWSSSLOptions>> IRodinWSServerInternal::MakeServerNameOptions() const
+{
+	TArray<TPair<FString, FRodinWSSSLOptions>> Options;
+	Options.Reserve(ServerNames.Num());
+
+	for (const TPair<FString, FRodinWSCertificate>& ServerName : ServerNames)
+	{
+		Options.Emplace(ServerName.Key, MakeSSLOptions(ServerName.Value));
+	}
+
+	return Options;
+}
+
+void IRodinWSServerInternal::StoreCertificate(FString&& HostnamePattern, FRodinWSCertificate&& Certificate)
+{
+	if (HostnamePattern.IsEmpty())
+	{
+		KeyFile    = MoveTemp(Certificate.KeyFile);
+		CertFile   = MoveTemp(Certificate.CertFile);
+		PassPhrase = MoveTemp(Certificate.PassPhrase);
+	}
+	else
+	{
+		ServerNames.Add(MoveTemp(HostnamePattern), MoveTemp(Certificate));
+	}
+}
+
+uWS::SocketContextOptions FRodinWSSSLOptions::ToOptions() const
+{
+	return
+	{
+		/* .key_file_name		 = */ KeyFile     .size() == 0 ? nullptr : KeyFile     .c_str(),
+		/* .cert_file_name		 = */ CertFile    .size() == 0 ? nullptr : CertFile    .c_str(),
+		/* .passphrase			 = */ PassPhrase  .size() == 0 ? nullptr : PassPhrase  .c_str(),
+		/* .dh_params_file_name  = */ DhParamsFile.size() == 0 ? nullptr : DhParamsFile.c_str(),
+		/* .ca_file_name		 = */ CaFileName  .size() == 0 ? nullptr : CaFileName  .c_str(),
+		/* .ssl_prefer_low_memory_usage = */ 0,
+		/* .ssl_session_cache_size = */ SessionCacheSize,
+		/* .ssl_session_timeout	 = */ SessionTimeout,
+		/* .ssl_ktls			 = */ bKernelTLS ? 1 : 0
+	};
+}
+
 namespace NRodinWSUtils
 {
 	uWS::CompressOptions Convert(const ERodinWSCompressOptions Option)
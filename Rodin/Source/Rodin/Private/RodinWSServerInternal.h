@@ -12,6 +12,7 @@
 
 THIRD_PARTY_INCLUDES_START
 #include <thread>
+#include <string>
 #include <string_view>
 THIRD_PARTY_INCLUDES_END
 
@@ -20,8 +21,15 @@ THIRD_PARTY_INCLUDES_END
 #endif
 
 #include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "HAL/FileManager.h"
+#include "Misc/StringBuilder.h"
 #include "RodinWSServer.h"
 #include "RodinWSInternal.h"
+#include "RodinWSServerStats.h"
+#include "RodinTrace.h"
+#include "RodinMessageDispatch.h"
+#include "RodinWSPool.h"
 #include "Rodin.h"
 
 DECLARE_DELEGATE_OneParam(
@@ -47,6 +55,16 @@ DECLARE_DELEGATE(
 	FOnServerClosed
 );
 
+DECLARE_DELEGATE_OneParam(
+	FOnTaskTimeout,
+	const FString&
+);
+
+DECLARE_DELEGATE_OneParam(
+	FOnCertificateUpdated,
+	const bool
+);
+
 #define DEFINE_TYPES()															\
 	using FRodinWS                    = TRodinWS<bSSL>;						\
 	using FRodinWSProxy               = TRodinWSProxy<bSSL>;				\
@@ -89,11 +107,48 @@ public:
 
 	FListenSocketPtr ListenSocket;
 
+	/** Unix domain socket listened on next to or instead of ListenSocket, null when not requested. */
+	FListenSocketPtr UnixListenSocket;
+
 	FAtomicStatus ServerStatus;
 
 	FCriticalSection LoopAccess;
 
 	uWS::Loop* Loop;
+
+	const FRodinWSServerCountersPtr Stats;
+
+	/** Bound before listening, executed on game thread. */
+	FOnTaskTimeout OnTaskTimeout;
+
+	/** Server thread only. Given to WebSocket connections as they open, updated through the loop's queue. */
+	FOnRodinWSServerThreadMessage ServerThreadHandler;
+
+	/** Server thread only. Settings copied by WebSocket connections as they open, updated through the loop's queue. */
+	TArray<FString> CoalescedTypes;
+	bool            bTaskTopicRouting;
+
+public:
+	/** Server thread only. Arms, moves or (with 0) cancels the timeout of a task on the loop's timer wheel. */
+	void SetTaskTimeout(const FString& TaskId, const int64 Milliseconds);
+
+	/** Server thread only, before the loop is freed. */
+	void ClearTaskTimeouts();
+
+	/** Server thread only. Starts accepting shared-memory feeders at Path, their events go to the same callbacks. */
+	bool StartSharedMemory(const FString& Path, const uint64 RingCapacity, const FOnOpened& OnOpened,
+		const FOnMessage& OnMessage, const FOnClosed& OnClosed, const FOnRodinWSServerThreadMessage& ServerThreadHandler);
+
+	/** Server thread only. Closes the feeders' connections, no-op when not started. */
+	void StopSharedMemory();
+
+private:
+	static void OnTaskTimeoutExpired(struct us_timeout_t* Timeout);
+	static void DestroyTaskTimeout(struct us_timeout_t* Timeout);
+
+	TMap<FString, struct us_timeout_t*> TaskTimeouts;
+
+	TSharedPtr<class FRodinShmTransport, ESPMode::ThreadSafe> SharedMemory;
 };
 using FSharedRessourcesPtr = TSharedPtr<class FRodinWSServerSharedRessourcesManager, ESPMode::ThreadSafe>;
 
@@ -150,14 +205,64 @@ public:
 private:
 	void ExecuteOnServerThread(TUniqueFunction<void(FRodinWS*)> Function);
 
+	/** Queues a message for coalesced delivery. Server thread. */
+	void QueueMessage(std::string_view Message, uWS::OpCode Code, FOnMessage&& UserCallback);
+
+	/** Coalescing key of a message whose type is coalesced, empty otherwise. */
+	FString GetCoalesceKey(std::string_view Message) const;
+
+	/**
+	 * Publishes task progress and results to their task's topic and applies task subscriptions.
+	 * True when the message was a subscription, which is not delivered further. Server thread.
+	 */
+	bool RouteTaskMessage(std::string_view Message);
+
+	/** Delivers the queued messages in order, or leaves them queued until the socket is open. Game thread. */
+	void FlushMessages(const bool bFromTicker);
+
 	void SendInternal(FString&& Message, const uWS::OpCode Code);
 
+	void SendFrame(FRodinWS* Socket, std::string_view Data, const uWS::OpCode Code);
+
 private:
 	FRodinWS* RawRodinWS;
 
+	FRodinWSServerCountersPtr Stats;
+
 	TAtomic<bool> bIsSocketValid;
 
-	TStrongObjectPtr<class URodinWS> RodinWS;
+	/** Pooled socket object, released when the close is delivered. */
+	FRodinWSHandle RodinWS;
+
+	struct FPendingMessage
+	{
+		TArray<uint8> Payload;
+		uWS::OpCode   Code;
+		uint64        ReceivedCycles;
+
+		/** Task ID and type of a progress message, empty for messages that are never coalesced. */
+		FString       CoalesceKey;
+	};
+
+	uint64 SocketId;
+
+	/** Copied from the server when the socket opens, like the coalesced types. */
+	FOnRodinWSServerThreadMessage ServerThreadHandler;
+
+	/** Message types delivered at most once per tick per task, copied from the server when the socket opens. */
+	TArray<FString> CoalescedTypes;
+
+	/** Copied from the server when the socket opens. */
+	bool bTaskTopicRouting;
+
+	/** uWS only publishes as a sender, skipping it, for sockets that subscribed once. Server thread. */
+	bool bHasSubscribed;
+
+	FCriticalSection PendingLock;
+	TArray<FPendingMessage> PendingMessages;
+	FOnMessage PendingCallback;
+	bool bTickFlushScheduled;
+	bool bTaskFlushScheduled;
 
 	TWeakPtr<FRodinWSServerInternal, ESPMode::ThreadSafe> RodinWSServer;
 };
@@ -187,6 +292,29 @@ private:
 	FRodinWS* RodinWS;
 };
 
+/** Files of a certificate, as given to CreateSecureRodinWSServer. */
+struct FRodinWSCertificate
+{
+	FString KeyFile;
+	FString CertFile;
+	FString PassPhrase;
+};
+
+/** UTF-8 copy of the SSL settings for one certificate, the options it makes point into it. */
+struct FRodinWSSSLOptions
+{
+	std::string KeyFile;
+	std::string CertFile;
+	std::string PassPhrase;
+	std::string DhParamsFile;
+	std::string CaFileName;
+	int32 SessionCacheSize = 0;
+	int32 SessionTimeout   = 0;
+	bool  bKernelTLS       = false;
+
+	uWS::SocketContextOptions ToOptions() const;
+};
+
 class IRodinWSServerInternal
 {
 private:
@@ -200,6 +328,13 @@ public:
 	virtual void Close() = 0;
 	virtual void Publish(FString&& Topic, FString&& Message, ERodinWSOpCode OpCode) = 0;
 
+	/**
+	 * Secure servers. Replaces the default certificate (empty HostnamePattern) or the one of a SNI host name pattern,
+	 * on the running loop when there is one, else on the next Listen. Callback runs on game thread.
+	 */
+	virtual void SetCertificate(FString&& HostnamePattern, FRodinWSCertificate&& Certificate, FOnCertificateUpdated&& Callback) = 0;
+	virtual void RemoveServerName(FString&& HostnamePattern) = 0;
+
 	virtual ~IRodinWSServerInternal() = default;
 
 public:
@@ -208,6 +343,7 @@ public:
 	FORCEINLINE FOnMessage& OnPong() { return OnPongEvent; }
 	FORCEINLINE FOnMessage& OnPing() { return OnPingEvent; }
 	FORCEINLINE FOnClosed& OnClosed() { return OnClosedEvent; }
+	FORCEINLINE FOnTaskTimeout& OnTaskTimeout() { return SharedRessources->OnTaskTimeout; }
 
 protected:
 	FOnOpened  OnOpenedEvent;
@@ -219,33 +355,71 @@ protected:
 public:
 	void SetMaxLifetime(const int64 InMaxLifetime);
 	void SetMaxPayloadLength(const int64 InMaxLifetime);
-	void SetIdleTimeout(const int64 InIdleTimeout);
+	void SetIdleTimeoutMs(const int64 InIdleTimeoutMs);
 	void SetMaxBackPressure(const int64 InMaxBackPressure);
 	void SetCloseOnBackpressureLimit(const bool bInCloseOnBackpressureLimit);
 	void SetResetIdleTimeoutOnSend(const bool bInResetIdleTimeoutOnSend);
 	void SetSendPingsAutomatically(const bool bInSendPingsAutomatically);
 	void SetCompression(ERodinWSCompressOptions InCompression);
+	void SetCoalescedMessageTypes(TArray<FString>&& InTypes);
+	void SetBusyPoll(const int32 InMicroseconds);
+	void SetReceiveBufferSize(const int32 InSizeKB);
+	void SetUnixSocket(FString&& InPath, const bool bInUnixSocketOnly);
+	void SetSharedMemory(FString&& InPath, const int32 RingSizeMB);
+	void SetServerThreadMessageHandler(FOnRodinWSServerThreadMessage&& InHandler);
+	void SetTaskTopicRouting(const bool bInEnabled);
+
+	FORCEINLINE bool IsTaskTopicRouting() const { return bTaskTopicRouting; }
+
+	/** Defers to the server thread, 0 cancels. */
+	void SetTaskTimeout(FString&& TaskId, const int64 Milliseconds);
 
 	ERodinWSServerState GetServerState() const;
 
+	FRodinWSServerStats GetStats() const;
+
 	void SetSSLOptions(FString&& InKeyFile, FString&& InCertFile, FString&& InPassPhrase,
 		FString&& InDhParamsFile, FString&& InCaFileName);
+	void SetSessionResumption(const bool bInEnabled, const int32 InCacheSize, const int32 InTimeoutSeconds);
+	void SetKernelTLS(const bool bInKernelTLS);
+
+protected:
+	FRodinWSSSLOptions MakeSSLOptions(const FRodinWSCertificate& Certificate) const;
+	TArray<TPair<FString, FRodinWSSSLOptions>> MakeServerNameOptions() const;
+
+	/** Game thread. Remembers a certificate the server took, for the next Listen. */
+	void StoreCertificate(FString&& HostnamePattern, FRodinWSCertificate&& Certificate);
 
 protected:
 	int64 MaxLifetime;
 	int64 MaxPayloadLength;
-	int64 IdleTimeout;
+	int64 IdleTimeoutMs;
 	int64 MaxBackPressure;
 	bool  bCloseOnBackpressureLimit;
 	bool  bResetIdleTimeoutOnSend;
 	bool  bSendPingsAutomatically;
 	ERodinWSCompressOptions Compression;
+	TArray<FString> CoalescedMessageTypes;
+	int32 BusyPollMicroseconds;
+	int32 ReceiveBufferLength;
+	FString UnixSocketPath;
+	bool  bUnixSocketOnly;
+	FString SharedMemoryPath;
+	uint64 SharedMemoryRingCapacity;
+	FOnRodinWSServerThreadMessage ServerThreadMessageHandler;
+	bool  bTaskTopicRouting;
 
 	FString KeyFile;
 	FString CertFile;
 	FString PassPhrase;
 	FString DhParamsFile;
 	FString CaFileName;
+	int32   SessionCacheSize;
+	int32   SessionTimeout;
+	bool    bKernelTLS;
+
+	/** SNI certificates by host name pattern, added by Listen. Game thread. */
+	TMap<FString, FRodinWSCertificate> ServerNames;
 
 protected:
 	FThreadPtr Thread;
@@ -269,6 +443,8 @@ public:
 	virtual void Listen(FString&& Host, FString&& URI, const uint16 Port, FOnRodinWSServerListening&& Callback, FOnServerClosed&& OnClosed);
 	virtual void Close();
 	virtual void Publish(FString&& Topic, FString&& Message, ERodinWSOpCode OpCode);
+	virtual void SetCertificate(FString&& HostnamePattern, FRodinWSCertificate&& Certificate, FOnCertificateUpdated&& Callback);
+	virtual void RemoveServerName(FString&& HostnamePattern);
 
 private:
 	uWSApp App;
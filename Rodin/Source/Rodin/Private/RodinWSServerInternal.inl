@@ -3,7 +3,7 @@
 // Default 
 static constexpr int64 DefaultMaxLifetime		= 0;
 static constexpr int64 DefaultMaxPayloadLength	= 256 * 1024;
-static constexpr int64 DefaultIdleTimeout		= 120;
+static constexpr int64 DefaultIdleTimeoutMs	= 120 * 1000;
 static constexpr int64 DefaultMaxBackPressure	= 256 * 1024;
 
 ///////////////////////////////////////////////////////////////
@@ -66,6 +66,11 @@ template<bool bSSL>
 TRodinWSProxy<bSSL>::TRodinWSProxy()
 	: RawRodinWS(nullptr)
 	, bIsSocketValid(true)
+	, SocketId(0)
+	, bTaskTopicRouting(false)
+	, bHasSubscribed(false)
+	, bTickFlushScheduled(false)
+	, bTaskFlushScheduled(false)
 {
 }
 
@@ -73,8 +78,28 @@ template<bool bSSL>
 void TRodinWSProxy<bSSL>::OnOpen(FRodinWSServerInternalPtr InServer, TRodinWS<bSSL>* InRawRodinWS,
 	FOnOpened UserCallback)
 {
+	RODIN_TRACE_SCOPE("Proxy::OnOpen");
+
 	RawRodinWS    = InRawRodinWS;
 	RodinWSServer = InServer;
+	Stats          = InServer->SharedRessources->Stats;
+	CoalescedTypes = InServer->SharedRessources->CoalescedTypes;
+
+	bTaskTopicRouting = InServer->SharedRessources->bTaskTopicRouting;
+
+	ServerThreadHandler = InServer->SharedRessources->ServerThreadHandler;
+
+	static std::atomic<uint64> NextSocketId(1);
+	SocketId = NextSocketId.fetch_add(1, std::memory_order_relaxed);
+
+	Stats->OnSocketOpened();
+
+	// The upgrade request came after the handshake, whether it was resumed and offloaded is known.
+	if constexpr (bSSL)
+	{
+		us_socket_t* const Socket = reinterpret_cast<us_socket_t*>(InRawRodinWS);
+		Stats->OnTlsHandshake(us_socket_is_session_reused(1, Socket) != 0, us_socket_is_ktls_send(1, Socket) != 0);
+	}
 
 	AsyncTask(ENamedThreads::GameThread,
 		[
@@ -82,13 +107,16 @@ void TRodinWSProxy<bSSL>::OnOpen(FRodinWSServerInternalPtr InServer, TRodinWS<bS
 			UserCallback = MoveTemp(UserCallback)
 		]() -> void
 	{
-		URodinWS* const NewRodinWS = NewObject<URodinWS>();
-
-		Self->RodinWS.Reset(NewRodinWS);
+		Self->RodinWS = FRodinWSPool::Get().Acquire();
 
+		URodinWS* const NewRodinWS = Self->RodinWS.Get();
 		NewRodinWS->SocketProxy = Self;
+		NewRodinWS->SocketId    = Self->SocketId;
 
 		UserCallback.ExecuteIfBound(NewRodinWS);
+
+		// A tick can come before this task, the messages it found were left for here.
+		Self->FlushMessages(false);
 	});
 }
 
@@ -96,26 +124,260 @@ void TRodinWSProxy<bSSL>::OnOpen(FRodinWSServerInternalPtr InServer, TRodinWS<bS
 template<bool bSSL>
 void TRodinWSProxy<bSSL>::OnMessage(std::string_view Message, uWS::OpCode Code, FOnMessage UserCallback)
 {
+	RODIN_TRACE_SCOPE("Proxy::OnMessage");
+
+	Stats->OnMessageReceived(NRodinWSUtils::Convert(Code), Message.size());
+
+	// Followers of the task get its progress and results from here, the editor still gets them below.
+	if (bTaskTopicRouting && Code == uWS::OpCode::TEXT && RouteTaskMessage(Message))
+	{
+		return;
+	}
+
+	if (ServerThreadHandler.IsBound() && (Code == uWS::OpCode::TEXT || Code == uWS::OpCode::BINARY))
+	{
+		RODIN_TRACE_SCOPE("Proxy::ServerThreadHandler");
+
+		const TConstArrayView<uint8> Payload(reinterpret_cast<const uint8*>(Message.data()), static_cast<int32>(Message.size()));
+		if (ServerThreadHandler.Execute(SocketId, Payload, NRodinWSUtils::Convert(Code)))
+		{
+			return;
+		}
+	}
+
+	// Everything goes through the queue once coalescing is on, so results stay behind the progress that preceded them.
+	if (CoalescedTypes.Num() > 0)
+	{
+		QueueMessage(Message, Code, MoveTemp(UserCallback));
+		return;
+	}
+
 	AsyncTask(ENamedThreads::GameThread,
 		[
-			Self         = this->AsShared(),
-			BinMessage   = TArray<uint8>((uint8*)Message.data(), Message.size()),
-			UserCallback = MoveTemp(UserCallback),
+			Self           = this->AsShared(),
+			BinMessage     = TArray<uint8>((uint8*)Message.data(), Message.size()),
+			UserCallback   = MoveTemp(UserCallback),
+			ReceivedCycles = FPlatformTime::Cycles64(),
 			Code
 		]() -> void
 	{
+		RODIN_TRACE_SCOPE("Proxy::DeliverMessage");
+
 		check(Self->RodinWS.IsValid());
 
+		Self->Stats->OnDelivered(ReceivedCycles);
+
 		UserCallback.ExecuteIfBound(Self->RodinWS.Get(), BinMessage, NRodinWSUtils::Convert(Code));
 	});
 }
 
+template<bool bSSL>
+FString TRodinWSProxy<bSSL>::GetCoalesceKey(std::string_view Message) const
+{
+	const TArrayView<const uint8> Bytes(reinterpret_cast<const uint8*>(Message.data()), static_cast<int32>(Message.size()));
+
+	FAnsiStringView Type;
+	if (!NRodinMessageDispatch::PeekString(Bytes, "type", Type))
+	{
+		return FString();
+	}
+
+	const FString TypeString(Type.Len(), Type.GetData());
+	if (!CoalescedTypes.Contains(TypeString))
+	{
+		return FString();
+	}
+
+	FAnsiStringView TaskId;
+	if (!NRodinMessageDispatch::PeekString(Bytes, "sid", TaskId))
+	{
+		TaskId = FAnsiStringView();
+	}
+
+	return FString(TaskId.Len(), TaskId.GetData()) + TEXT("/") + TypeString;
+}
+
+template<bool bSSL>
+bool TRodinWSProxy<bSSL>::RouteTaskMessage(std::string_view Message)
+{
+	RODIN_TRACE_SCOPE("Proxy::RouteTaskMessage");
+
+	const TArrayView<const uint8> Bytes(reinterpret_cast<const uint8*>(Message.data()), static_cast<int32>(Message.size()));
+
+	FAnsiStringView Type;
+	FAnsiStringView TaskId;
+	if (!NRodinMessageDispatch::PeekString(Bytes, "type", Type) || !NRodinMessageDispatch::PeekString(Bytes, "sid", TaskId))
+	{
+		return false;
+	}
+
+	const bool bSubscribe   = Type == "subscribe_task";
+	const bool bUnsubscribe = Type == "unsubscribe_task";
+	const bool bPublish     = Type == "task_progress" || Type == "send_model";
+	if (!bSubscribe && !bUnsubscribe && !bPublish)
+	{
+		return false;
+	}
+
+	TAnsiStringBuilder<64> Topic;
+	if (!NRodinMessageDispatch::MakeTaskTopic(TaskId, !bPublish, Topic))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid task id in a %s message, it is not routed."), *FString(Type.Len(), Type.GetData()));
+		return bSubscribe || bUnsubscribe;
+	}
+
+	const std::string_view TopicView(Topic.GetData(), Topic.Len());
+
+	if (bSubscribe)
+	{
+		RawRodinWS->subscribe(TopicView);
+		bHasSubscribed = true;
+		return true;
+	}
+
+	if (bUnsubscribe)
+	{
+		RawRodinWS->unsubscribe(TopicView);
+		return true;
+	}
+
+	// The socket that submitted the task follows it, publishing as the sender keeps its own message from coming back.
+	if (bHasSubscribed)
+	{
+		RawRodinWS->publish(TopicView, Message, uWS::OpCode::TEXT);
+	}
+	else
+	{
+		using FContextData = uWS::WebSocketContextData<bSSL, FRodinWSData>;
+		us_socket_t* const Socket = reinterpret_cast<us_socket_t*>(RawRodinWS);
+
+		FContextData* const ContextData = static_cast<FContextData*>(us_socket_context_ext(bSSL, us_socket_context(bSSL, Socket)));
+		ContextData->publish(TopicView, Message, uWS::OpCode::TEXT, false);
+	}
+
+	Stats->OnPublished();
+	return false;
+}
+
+template<bool bSSL>
+void TRodinWSProxy<bSSL>::QueueMessage(std::string_view Message, uWS::OpCode Code, FOnMessage&& UserCallback)
+{
+	RODIN_TRACE_SCOPE("Proxy::QueueMessage");
+
+	FString CoalesceKey = Code == uWS::OpCode::TEXT ? GetCoalesceKey(Message) : FString();
+	const bool bCoalesced = !CoalesceKey.IsEmpty();
+
+	bool bScheduleTick = false;
+	bool bScheduleTask = false;
+	{
+		FScopeLock Lock(&PendingLock);
+
+		if (!PendingCallback.IsBound())
+		{
+			PendingCallback = MoveTemp(UserCallback);
+		}
+
+		FPendingMessage* Replaced = nullptr;
+		if (bCoalesced)
+		{
+			// Only look back to the last ordered message, a newer progress can't overtake a result.
+			for (int32 Index = PendingMessages.Num() - 1; Index >= 0 && !PendingMessages[Index].CoalesceKey.IsEmpty(); --Index)
+			{
+				if (PendingMessages[Index].CoalesceKey == CoalesceKey)
+				{
+					Replaced = &PendingMessages[Index];
+					break;
+				}
+			}
+		}
+
+		if (Replaced)
+		{
+			Replaced->Payload        = TArray<uint8>((const uint8*)Message.data(), Message.size());
+			Replaced->ReceivedCycles = FPlatformTime::Cycles64();
+			Stats->OnCoalesced();
+		}
+		else
+		{
+			PendingMessages.Add(FPendingMessage{ TArray<uint8>((const uint8*)Message.data(), Message.size()), Code, FPlatformTime::Cycles64(), MoveTemp(CoalesceKey) });
+		}
+
+		// Progress waits for the next tick, anything else is delivered as soon as the game thread gets to it.
+		if (bCoalesced && !bTickFlushScheduled)
+		{
+			bTickFlushScheduled = bScheduleTick = true;
+		}
+		else if (!bCoalesced && !bTaskFlushScheduled)
+		{
+			bTaskFlushScheduled = bScheduleTask = true;
+		}
+	}
+
+	if (bScheduleTick)
+	{
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Self = this->AsShared()](float) -> bool
+		{
+			Self->FlushMessages(true);
+			return false;
+		}));
+	}
+
+	if (bScheduleTask)
+	{
+		AsyncTask(ENamedThreads::GameThread, [Self = this->AsShared()]() -> void
+		{
+			Self->FlushMessages(false);
+		});
+	}
+}
+
+template<bool bSSL>
+void TRodinWSProxy<bSSL>::FlushMessages(const bool bFromTicker)
+{
+	RODIN_TRACE_SCOPE("Proxy::DeliverMessage");
+	check(IsInGameThread());
+
+	TArray<FPendingMessage> Messages;
+	FOnMessage UserCallback;
+	{
+		FScopeLock Lock(&PendingLock);
+
+		(bFromTicker ? bTickFlushScheduled : bTaskFlushScheduled) = false;
+
+		// The ticker isn't ordered with the open task, keep everything until that task flushes.
+		if (!RodinWS.IsValid())
+		{
+			return;
+		}
+
+		Messages     = MoveTemp(PendingMessages);
+		UserCallback = PendingCallback;
+	}
+
+	if (Messages.Num() == 0)
+	{
+		return;
+	}
+
+	for (FPendingMessage& Message : Messages)
+	{
+		Stats->OnDelivered(Message.ReceivedCycles);
+
+		UserCallback.ExecuteIfBound(RodinWS.Get(), MoveTemp(Message.Payload), NRodinWSUtils::Convert(Message.Code));
+	}
+}
+
 template<bool bSSL>
 void TRodinWSProxy<bSSL>::OnClosed(const int Code, const std::string_view Message, FOnClosed UserCallback)
 {
 	bIsSocketValid = false;
 	RawRodinWS = nullptr;
 
+	if (Stats)
+	{
+		Stats->OnSocketClosed();
+	}
+
 	AsyncTask(ENamedThreads::GameThread,
 		[
 			Self         = this->AsShared(),
@@ -126,12 +388,13 @@ void TRodinWSProxy<bSSL>::OnClosed(const int Code, const std::string_view Messag
 	{		
 		check(Self->RodinWS.IsValid());
 
+		// Messages still waiting for their tick come before the close.
+		Self->FlushMessages(false);
+
 		UserCallback.ExecuteIfBound(Self->RodinWS.Get(), Code, StrMessage);
 
-		if (Self->RodinWS)
-		{
-			Self->RodinWS->SocketProxy = nullptr;
-		}
+		// Also clears the object's SocketProxy.
+		FRodinWSPool::Get().Release(Self->RodinWS);
 	});
 }
 
@@ -163,8 +426,13 @@ void TRodinWSProxy<bSSL>::ExecuteOnServerThread(TUniqueFunction<void(TRodinWS<bS
 
 	auto SharedRessources = Internal->SharedRessources;
 
-	auto ServerThreadWork = [Self = this->AsShared(), Function = MoveTemp(Function)]() -> void
+	auto ServerThreadWork = [Self = this->AsShared(), Function = MoveTemp(Function), DeferredCycles = FPlatformTime::Cycles64()]() -> void
 	{
+		NRodinTrace::OnLoopWoken();
+		RODIN_TRACE_SCOPE("Proxy::ServerThreadWork");
+
+		Self->Stats->OnDeferredExecuted(DeferredCycles);
+
 		if (Self->RawRodinWS)
 		{
 			Function(Self->RawRodinWS);
@@ -176,6 +444,7 @@ void TRodinWSProxy<bSSL>::ExecuteOnServerThread(TUniqueFunction<void(TRodinWS<bS
 
 		if (SharedRessources->Loop)
 		{
+			SharedRessources->Stats->OnDeferred();
 			SharedRessources->Loop->defer(MoveTemp(ServerThreadWork));
 		}
 	}
@@ -184,12 +453,30 @@ void TRodinWSProxy<bSSL>::ExecuteOnServerThread(TUniqueFunction<void(TRodinWS<bS
 template<bool bSSL>
 void TRodinWSProxy<bSSL>::SendInternal(FString&& Message, const uWS::OpCode Code)
 {
-	ExecuteOnServerThread([Message = MoveTemp(Message), Code](FRodinWS* Socket) -> void
+	ExecuteOnServerThread([Self = this->AsShared(), Message = MoveTemp(Message), Code](FRodinWS* Socket) -> void
 	{
-		Socket->send(TCHAR_TO_UTF8(*Message), Code); 
+		RODIN_TRACE_SCOPE("Proxy::SendMessage");
+
+		const FTCHARToUTF8 Utf8Message(*Message);
+		Self->SendFrame(Socket, std::string_view(Utf8Message.Get(), Utf8Message.Length()), Code);
 	});
 }
 
+template<bool bSSL>
+void TRodinWSProxy<bSSL>::SendFrame(FRodinWS* Socket, std::string_view Data, const uWS::OpCode Code)
+{
+	RODIN_TRACE_SCOPE("Proxy::SendFrame");
+
+	// Sends go out uncompressed whatever the server's compression option, so they stay out of the compress ratio.
+	size_t FramedLength = 0;
+	const auto Status = Socket->send(Data, Code, false, &FramedLength);
+
+	Stats->OnMessageSent(NRodinWSUtils::Convert(Code), Data.size(), FramedLength, false,
+		Status == FRodinWS::SendStatus::BACKPRESSURE,
+		Status == FRodinWS::SendStatus::DROPPED,
+		Socket->getBufferedAmount());
+}
+
 template<bool bSSL>
 void TRodinWSProxy<bSSL>::SendMessage(FString&& Message)
 {
@@ -199,10 +486,10 @@ void TRodinWSProxy<bSSL>::SendMessage(FString&& Message)
 template<bool bSSL>
 void TRodinWSProxy<bSSL>::SendData(TArray<uint8>&& Data)
 {
-	ExecuteOnServerThread([Data = MoveTemp(Data)](FRodinWS* Socket) -> void
+	ExecuteOnServerThread([Self = this->AsShared(), Data = MoveTemp(Data)](FRodinWS* Socket) -> void
 	{
 		std::string_view StrData(reinterpret_cast<const char*>(Data.GetData()), Data.Num());
-		Socket->send(StrData, uWS::OpCode::BINARY);
+		Self->SendFrame(Socket, StrData, uWS::OpCode::BINARY);
 	});
 }
 
@@ -240,12 +527,14 @@ template<bool bSSL>
 void TRodinWSProxy<bSSL>::Subscribe(FString&& Topic, FOnRodinWSSubscribed&& Callback, bool bNonStrict)
 {
 	ExecuteOnServerThread([
+		Self     = this->AsShared(),
 		Topic    = MoveTemp(Topic),
 		Callback = MoveTemp(Callback),
 		bNonStrict
 	](FRodinWS* Socket) mutable -> void
 	{
 		const auto Result = Socket->subscribe(TCHAR_TO_UTF8(*Topic), bNonStrict);
+		Self->bHasSubscribed = true;
 
 		if (Callback.IsBound())
 		{
@@ -284,6 +573,7 @@ template<bool bSSL>
 void TRodinWSProxy<bSSL>::Publish(FString&& Topic, FString&& Message, FOnRodinWSPublished&& Callback)
 {
 	ExecuteOnServerThread([
+		Self     = this->AsShared(),
 		Topic    = MoveTemp(Topic),
 		Message  = MoveTemp(Message),
 		Callback = MoveTemp(Callback)
@@ -291,6 +581,8 @@ void TRodinWSProxy<bSSL>::Publish(FString&& Topic, FString&& Message, FOnRodinWS
 	{
 		const bool bSuccess = Socket->publish(TCHAR_TO_UTF8(*Topic), TCHAR_TO_UTF8(*Message));
 
+		Self->Stats->OnPublished();
+
 		if (Callback.IsBound())
 		{
 			AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), bSuccess]() -> void
@@ -310,9 +602,7 @@ bool TRodinWSProxy<bSSL>::IsSocketValid() const
 template<bool bSSL>
 TRodinWSProxy<bSSL>::~TRodinWSProxy()
 {
-	// This proxy should always be destroyed from Game Thread
-	// as it holds a strong reference to an UObject.
-	check(IsInGameThread());
+	// The socket object belongs to the pool, the proxy can go away on any thread.
 }
 
 
@@ -349,24 +639,59 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 
 	UE_LOG(LogTemp, Log, TEXT("Starting server on %s:%d..."), *URI, Port);
 
+	if (!UnixSocketPath.IsEmpty())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Listening on unix socket %s%s."), *UnixSocketPath, bUnixSocketOnly ? TEXT(" only") : TEXT(""));
+	}
+
+	if (!SharedMemoryPath.IsEmpty())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Accepting shared-memory feeders on %s."), *SharedMemoryPath);
+	}
+
+#if defined(LIBUS_USE_IO_URING)
+	// The io_uring build has no epoll fallback, a kernel without io_uring fails the start here instead of in the server thread.
+	if (us_loop_t* const Probe = us_create_loop(nullptr, +[](us_loop_t*) -> void {}, +[](us_loop_t*) -> void {}, +[](us_loop_t*) -> void {}, 0))
+	{
+		us_loop_free(Probe);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to start RodinWS server: io_uring is unavailable, this build needs Linux 5.19 or later."));
+
+		SharedRessources->ServerStatus.Exchange(ERodinWSServerState::Closed);
+
+		AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), OnServerClosed = MoveTemp(OnServerClosed)]() -> void
+		{
+			Callback.ExecuteIfBound(false);
+			OnServerClosed.ExecuteIfBound();
+		});
+		return;
+	}
+#endif
+
 	Thread.Reset(new std::thread(
 	[
 		// Settings
 		Compression					= this->Compression,
 		MaxPayloadLength			= this->MaxPayloadLength,
-		IdleTimeout					= this->IdleTimeout,
+		IdleTimeoutMs				= this->IdleTimeoutMs,
 		MaxBackPressure				= this->MaxBackPressure,
 		bCloseOnBackpressureLimit	= this->bCloseOnBackpressureLimit,
 		bResetIdleTimeoutOnSend		= this->bResetIdleTimeoutOnSend,
 		bSendPingsAutomatically		= this->bSendPingsAutomatically,
 		MaxLifetime					= this->MaxLifetime,
+		BusyPollMicroseconds		= this->BusyPollMicroseconds,
+		ReceiveBufferLength			= this->ReceiveBufferLength,
+		UnixSocketPath				= std::string(TCHAR_TO_UTF8(*UnixSocketPath)),
+		bUnixSocketOnly				= this->bUnixSocketOnly,
+		SharedMemoryPath			= this->SharedMemoryPath,
+		SharedMemoryRingCapacity	= this->SharedMemoryRingCapacity,
+		ServerThreadMessageHandler	= this->ServerThreadMessageHandler,
 
 		// SSL options
-		KeyFile			= std::string(TCHAR_TO_UTF8(*KeyFile)),
-		CertFile		= std::string(TCHAR_TO_UTF8(*CertFile)),
-		PassPhrase		= std::string(TCHAR_TO_UTF8(*PassPhrase)),
-		DhParamsFile	= std::string(TCHAR_TO_UTF8(*DhParamsFile)),
-		CaFileName		= std::string(TCHAR_TO_UTF8(*CaFileName)),
+		SSLOptions		= this->MakeSSLOptions({ KeyFile, CertFile, PassPhrase }),
+		ServerNames		= this->MakeServerNameOptions(),
 
 		// Events
 		OnOpened		= MoveTemp(this->OnOpenedEvent),
@@ -386,11 +711,15 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 		Server			 = this->AsShared()
 	]() mutable -> void
 	{			
+		NRodinTrace::RegisterServerThread();
+		SharedRessources->Stats->CaptureServerThread();
+
 		FRodinWSBehavior Behavior;
 
 		Behavior.compression				= NRodinWSUtils::Convert(Compression);
 		Behavior.maxPayloadLength			= MaxPayloadLength;
-		Behavior.idleTimeout				= IdleTimeout;
+		Behavior.idleTimeout				= 0;
+		Behavior.idleTimeoutMs				= static_cast<unsigned int>(FMath::Clamp<int64>(IdleTimeoutMs, 0, MAX_uint32));
 		Behavior.maxBackpressure			= MaxBackPressure;
 		Behavior.closeOnBackpressureLimit	= bCloseOnBackpressureLimit;
 		Behavior.resetIdleTimeoutOnSend		= bResetIdleTimeoutOnSend;
@@ -411,6 +740,8 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 
 		Behavior.open = [&Server, &OnOpened](FRodinWS* Socket) -> void
 		{
+			NRodinTrace::OnLoopWoken();
+
 			UE_LOG(LogTemp, Verbose, TEXT("New RodinWS connection opened."));
 
 			FRodinWSData* const SocketData = Socket->getUserData();
@@ -420,6 +751,8 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 
 		Behavior.message = [&OnMessage](FRodinWS* Socket, std::string_view Message, uWS::OpCode Code) -> void
 		{
+			NRodinTrace::OnLoopWoken();
+
 			FRodinWSData* const SocketData = Socket->getUserData();
 			SocketData->GetProxy()->OnMessage(Message, Code, OnMessage);
 		};
@@ -433,12 +766,16 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 		{
 			Behavior.ping = [&OnPing](FRodinWS* Socket, std::string_view Data) -> void
 			{
+				NRodinTrace::OnLoopWoken();
+
 				FRodinWSData* const SocketData = Socket->getUserData();
 				SocketData->GetProxy()->OnPing(Data, OnPing);
 			};
 
 			Behavior.pong = [&OnPong](FRodinWS* Socket, std::string_view Data) -> void
 			{
+				NRodinTrace::OnLoopWoken();
+
 				FRodinWSData* const SocketData = Socket->getUserData();
 				SocketData->GetProxy()->OnPong(Data, OnPong);
 			};
@@ -446,6 +783,8 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 
 		Behavior.close = [&OnClosed](FRodinWS* Socket, int Code, std::string_view Message) -> void
 		{
+			NRodinTrace::OnLoopWoken();
+
 			UE_LOG(LogTemp, Verbose, TEXT("RodinWS closed."));
 
 			FRodinWSData* const SocketData = Socket->getUserData();
@@ -456,60 +795,124 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 			Proxy     ->OnClosed(Code, Message, OnClosed);
 		};
 
+		// Before the app, whose SSL context sizes its decrypted read buffer from it.
+		if (!us_loop_set_recv_buffer_length(reinterpret_cast<us_loop_t*>(uWS::Loop::get()), ReceiveBufferLength))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to allocate a %d byte receive buffer, keeping the default."), ReceiveBufferLength);
+		}
+
 		if constexpr (bSSL == true)
 		{
-			Server->App = uWSApp(
+			Server->App = uWSApp(SSLOptions.ToOptions());
+
+			// A bad SNI certificate only affects its host names, they get the default one.
+			for (const TPair<FString, FRodinWSSSLOptions>& ServerName : ServerNames)
 			{
-				/* .key_file_name		 = */ KeyFile     .size() == 0 ? nullptr : KeyFile     .c_str(),
-				/* .cert_file_name		 = */ CertFile    .size() == 0 ? nullptr : CertFile    .c_str(),
-				/* .passphrase			 = */ PassPhrase  .size() == 0 ? nullptr : PassPhrase  .c_str(),
-				/* .dh_params_file_name  = */ DhParamsFile.size() == 0 ? nullptr : DhParamsFile.c_str(),
-				/* .ca_file_name		 = */ CaFileName  .size() == 0 ? nullptr : CaFileName  .c_str()					
-			});
+				if (!Server->App.setServerName(TCHAR_TO_UTF8(*ServerName.Key), ServerName.Value.ToOptions()))
+				{
+					UE_LOG(LogTemp, Error, TEXT("Failed to load the certificate of server name %s."), *ServerName.Key);
+				}
+			}
 		}
 		else
 		{
 			Server->App = uWSApp();
 		}
+
+		uWS::Loop::get()->addPreHandler (SharedRessources.Get(), [](uWS::Loop*) -> void { NRodinTrace::OnLoopPre();  });
+		uWS::Loop::get()->addPostHandler(SharedRessources.Get(), [](uWS::Loop*) -> void { NRodinTrace::OnLoopPost(); });
+
+		us_loop_set_busy_poll(reinterpret_cast<us_loop_t*>(uWS::Loop::get()), BusyPollMicroseconds);
 		
-		Server->App
-		
-		.template ws<FRodinWSData>(TCHAR_TO_UTF8(*URI), MoveTemp(Behavior))
+		Server->App.template ws<FRodinWSData>(TCHAR_TO_UTF8(*URI), MoveTemp(Behavior));
 
-		.listen(TCHAR_TO_UTF8(*Host), Port, [&SharedRessources, &Callback, _URI = URI](us_listen_socket_t* ListenSocket) -> void
-		{
-			check(SharedRessources->ServerStatus == ERodinWSServerState::Starting);
+		// Only a socket file we bound ourselves is ours to remove.
+		bool bUnixSocketBound = false;
 
-			const bool bServerStarted = ([&]() -> bool
+		if (!UnixSocketPath.empty())
+		{
+			Server->App.listen_unix(UnixSocketPath, [&SharedRessources, &UnixSocketPath, &bUnixSocketBound](us_listen_socket_t* ListenSocket) -> void
 			{
 				if (!ListenSocket)
 				{
-					UE_LOG(LogTemp, Error, TEXT("Failed to start RodinWS server."));
-
-					return false;
+					UE_LOG(LogTemp, Error, TEXT("Failed to listen on unix socket %s."), UTF8_TO_TCHAR(UnixSocketPath.c_str()));
 				}
 
-				UE_LOG(LogTemp, Log, TEXT("RodinWS Server started at %s."), *_URI);
+				SharedRessources->UnixListenSocket = ListenSocket;
+				bUnixSocketBound = ListenSocket != nullptr;
+			});
+		}
 
-				SharedRessources->Loop         = uWS::Loop::get();
+		if (!bUnixSocketOnly)
+		{
+			Server->App.listen(TCHAR_TO_UTF8(*Host), Port, [&SharedRessources](us_listen_socket_t* ListenSocket) -> void
+			{
 				SharedRessources->ListenSocket = ListenSocket;
-				SharedRessources->ServerStatus = ERodinWSServerState::Running;
+			});
+		}
 
-				return true;
-			}());
+		// Feeders get the same callbacks as sockets, the transport copies them before the loop moves on.
+		const bool bSharedMemoryStarted = SharedMemoryPath.IsEmpty()
+			|| SharedRessources->StartSharedMemory(SharedMemoryPath, SharedMemoryRingCapacity, OnOpened, OnMessage, OnClosed, ServerThreadMessageHandler);
 
-			if (Callback.IsBound())
+		check(SharedRessources->ServerStatus == ERodinWSServerState::Starting);
+
+		const bool bServerStarted = ([&]() -> bool
+		{
+			// Every requested listener or none, a half started server would look running to clients of the other.
+			if ((!bUnixSocketOnly && !SharedRessources->ListenSocket) || (!UnixSocketPath.empty() && !SharedRessources->UnixListenSocket)
+				|| !bSharedMemoryStarted)
 			{
-				AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), bServerStarted]() -> void
+				UE_LOG(LogTemp, Error, TEXT("Failed to start RodinWS server."));
+
+				SharedRessources->StopSharedMemory();
+
+				for (us_listen_socket_t** const ListenSocket : { &SharedRessources->ListenSocket, &SharedRessources->UnixListenSocket })
 				{
-					Callback.ExecuteIfBound(bServerStarted);
-				});
+					if (*ListenSocket)
+					{
+						us_listen_socket_close(0, *ListenSocket);
+						*ListenSocket = nullptr;
+					}
+				}
+
+				return false;
 			}
-		})
-			
-		.run();
+
+			UE_LOG(LogTemp, Log, TEXT("RodinWS Server started at %s."), *URI);
+
+			{
+				// Handlers set since Listen was called land here, later ones go through the loop's queue.
+				FScopeLock Lock(&SharedRessources->LoopAccess);
+
+				SharedRessources->ServerThreadHandler = Server->ServerThreadMessageHandler;
+				SharedRessources->CoalescedTypes      = Server->CoalescedMessageTypes;
+				SharedRessources->bTaskTopicRouting   = Server->bTaskTopicRouting;
+				SharedRessources->Loop                = uWS::Loop::get();
+			}
+
+			SharedRessources->ServerStatus = ERodinWSServerState::Running;
+
+			return true;
+		}());
+
+		if (Callback.IsBound())
+		{
+			AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), bServerStarted]() -> void
+			{
+				Callback.ExecuteIfBound(bServerStarted);
+			});
+		}
+
+		Server->App.run();
 
 		UE_LOG(LogTemp, Log, TEXT("RodinWS loop exited."));
+
+		// Pending timeouts don't keep the loop alive, drop them with it.
+		SharedRessources->ClearTaskTimeouts();
+
+		// Feeders are told before OnServerClosed, like the sockets the loop closed.
+		SharedRessources->StopSharedMemory();
 		
 		{
 			FScopeLock Lock(&SharedRessources->LoopAccess);
@@ -520,7 +923,15 @@ void TRodinWSServerInternal<bSSL>::Listen(FString&& Host, FString&& URI, const u
 			}
 		}
 
-		SharedRessources->ListenSocket = nullptr;
+		SharedRessources->ListenSocket     = nullptr;
+		SharedRessources->UnixListenSocket = nullptr;
+
+		// Closing the listen socket leaves its file behind, abstract names go away on their own.
+		if (bUnixSocketBound && UnixSocketPath[0] != '@')
+		{
+			IFileManager::Get().Delete(UTF8_TO_TCHAR(UnixSocketPath.c_str()), false, false, true);
+		}
+
 		SharedRessources->ServerStatus.Exchange(ERodinWSServerState::Closed);
 
 		UE_LOG(LogTemp, Log, TEXT("RodinWS Server closed."));
@@ -540,19 +951,28 @@ void TRodinWSServerInternal<bSSL>::Close()
 	ERodinWSServerState Expected = ERodinWSServerState::Running;
 	if (SharedRessources->ServerStatus.CompareExchange(Expected, ERodinWSServerState::Closing))
 	{
-		auto LoopWork = [SharedRessources = this->SharedRessources]() -> void
+		auto LoopWork = [SharedRessources = this->SharedRessources, DeferredCycles = FPlatformTime::Cycles64()]() -> void
 		{
-			if (SharedRessources->ListenSocket)
-			{
-				us_listen_socket_close(0, SharedRessources->ListenSocket);
-				SharedRessources->ListenSocket = nullptr;
+			NRodinTrace::OnLoopWoken();
 
-				UE_LOG(LogTemp, Verbose, TEXT("Closed listening socket."));
-			}
-			else
+			SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+
+			if (!SharedRessources->ListenSocket && !SharedRessources->UnixListenSocket)
 			{
 				UE_LOG(LogTemp, Warning, TEXT("Failed to close server: ListenSocket was nullptr."));
+				return;
+			}
+
+			for (us_listen_socket_t** const ListenSocket : { &SharedRessources->ListenSocket, &SharedRessources->UnixListenSocket })
+			{
+				if (*ListenSocket)
+				{
+					us_listen_socket_close(0, *ListenSocket);
+					*ListenSocket = nullptr;
+				}
 			}
+
+			UE_LOG(LogTemp, Verbose, TEXT("Closed listening socket."));
 		};
 
 		{
@@ -560,6 +980,7 @@ void TRodinWSServerInternal<bSSL>::Close()
 
 			if (SharedRessources->Loop)
 			{
+				SharedRessources->Stats->OnDeferred();
 				SharedRessources->Loop->defer(MoveTemp(LoopWork));
 			}
 			else
@@ -582,10 +1003,19 @@ void TRodinWSServerInternal<bSSL>::Publish(FString&& Topic, FString&& Message, E
 		Self	= this->AsShared(), 
 		Topic	= MoveTemp(Topic), 
 		Message = MoveTemp(Message), 
-		Code    = NRodinWSUtils::Convert(OpCode)
+		Code    = NRodinWSUtils::Convert(OpCode),
+
+		DeferredCycles = FPlatformTime::Cycles64()
 	]() -> void
 	{
+		NRodinTrace::OnLoopWoken();
+		RODIN_TRACE_SCOPE("Server::Publish");
+
+		Self->SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+
 		Self->App.publish(TCHAR_TO_UTF8(*Topic), TCHAR_TO_UTF8(*Message), static_cast<uWS::OpCode>(Code));
+
+		Self->SharedRessources->Stats->OnPublished();
 	};
 
 	{
@@ -593,8 +1023,122 @@ void TRodinWSServerInternal<bSSL>::Publish(FString&& Topic, FString&& Message, E
 
 		if (SharedRessources->Loop)
 		{
+			SharedRessources->Stats->OnDeferred();
 			SharedRessources->Loop->defer(MoveTemp(LoopWork));
 		}
 	}
 }
 
+
+template<bool bSSL>
+void TRodinWSServerInternal<bSSL>::SetCertificate(FString&& HostnamePattern, FRodinWSCertificate&& Certificate, FOnCertificateUpdated&& Callback)
+{
+	if constexpr (!bSSL)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to set a certificate: the server was made with CreateRodinWSServer."));
+
+		Callback.ExecuteIfBound(false);
+		return;
+	}
+
+	{
+		FScopeLock Lock(&SharedRessources->LoopAccess);
+
+		if (SharedRessources->Loop)
+		{
+			FRodinWSSSLOptions Options = this->MakeSSLOptions(Certificate);
+
+			auto LoopWork =
+			[
+				Self			= this->AsShared(),
+				Options			= MoveTemp(Options),
+				HostnamePattern	= MoveTemp(HostnamePattern),
+				Certificate		= MoveTemp(Certificate),
+				Callback		= MoveTemp(Callback),
+
+				DeferredCycles = FPlatformTime::Cycles64()
+			]() mutable -> void
+			{
+				NRodinTrace::OnLoopWoken();
+
+				Self->SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+
+				// New handshakes pick it up right away, open connections keep the certificate they negotiated.
+				const bool bSuccess = HostnamePattern.IsEmpty()
+					? Self->App.reloadCertificate(Options.ToOptions())
+					: Self->App.setServerName(TCHAR_TO_UTF8(*HostnamePattern), Options.ToOptions());
+
+				if (!bSuccess)
+				{
+					UE_LOG(LogTemp, Error, TEXT("Failed to load certificate %s, the previous one stays in use."), *Certificate.CertFile);
+				}
+
+				AsyncTask(ENamedThreads::GameThread,
+				[
+					Self,
+					HostnamePattern = MoveTemp(HostnamePattern),
+					Certificate		= MoveTemp(Certificate),
+					Callback		= MoveTemp(Callback),
+					bSuccess
+				]() mutable -> void
+				{
+					// Only what the server took is kept for the next Listen.
+					if (bSuccess)
+					{
+						Self->StoreCertificate(MoveTemp(HostnamePattern), MoveTemp(Certificate));
+					}
+
+					Callback.ExecuteIfBound(bSuccess);
+				});
+			};
+
+			SharedRessources->Stats->OnDeferred();
+			SharedRessources->Loop->defer(MoveTemp(LoopWork));
+			return;
+		}
+	}
+
+	// The server thread already copied the certificates, it would silently start with the old one.
+	if (SharedRessources->ServerStatus == ERodinWSServerState::Starting)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to set a certificate: the server is starting."));
+
+		Callback.ExecuteIfBound(false);
+		return;
+	}
+
+	StoreCertificate(MoveTemp(HostnamePattern), MoveTemp(Certificate));
+
+	Callback.ExecuteIfBound(true);
+}
+
+template<bool bSSL>
+void TRodinWSServerInternal<bSSL>::RemoveServerName(FString&& HostnamePattern)
+{
+	if constexpr (!bSSL)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to remove a server name: the server was made with CreateRodinWSServer."));
+		return;
+	}
+
+	ServerNames.Remove(HostnamePattern);
+
+	auto LoopWork = [Self = this->AsShared(), HostnamePattern = MoveTemp(HostnamePattern), DeferredCycles = FPlatformTime::Cycles64()]() -> void
+	{
+		NRodinTrace::OnLoopWoken();
+
+		Self->SharedRessources->Stats->OnDeferredExecuted(DeferredCycles);
+
+		Self->App.removeServerName(TCHAR_TO_UTF8(*HostnamePattern));
+	};
+
+	{
+		FScopeLock Lock(&SharedRessources->LoopAccess);
+
+		if (SharedRessources->Loop)
+		{
+			SharedRessources->Stats->OnDeferred();
+			SharedRessources->Loop->defer(MoveTemp(LoopWork));
+		}
+	}
+}
@@ -0,0 +1,471 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinWSServerStats.h"
+
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Misc/ScopeLock.h"
+
+#if PLATFORM_WINDOWS
+#	include "Windows/AllowWindowsPlatformTypes.h"
+#	include <windows.h>
+#	include "Windows/HideWindowsPlatformTypes.h"
+#elif PLATFORM_LINUX
+#	include <pthread.h>
+#endif
+
+DECLARE_STATS_GROUP(TEXT("RodinWS"), STATGROUP_RodinWS, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Connections"),   STAT_RodinWS_ActiveConnections,  STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Total Connections"),    STAT_RodinWS_TotalConnections,   STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Messages Received"),    STAT_RodinWS_MessagesIn,         STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Messages Sent"),        STAT_RodinWS_MessagesOut,        STATGROUP_RodinWS);
+DECLARE_MEMORY_STAT(TEXT("Bytes Received"),                  STAT_RodinWS_BytesIn,            STATGROUP_RodinWS);
+DECLARE_MEMORY_STAT(TEXT("Bytes Sent"),                      STAT_RodinWS_BytesOut,           STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Messages Published"),   STAT_RodinWS_Published,          STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Defer Queue Depth"),    STAT_RodinWS_DeferQueueDepth,    STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Backpressure Events"),  STAT_RodinWS_BackpressureEvents, STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dropped Messages"),     STAT_RodinWS_DroppedMessages,    STATGROUP_RodinWS);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Coalesced Messages"),   STAT_RodinWS_CoalescedMessages,  STATGROUP_RodinWS);
+DECLARE_MEMORY_STAT(TEXT("Peak Buffered Amount"),            STAT_RodinWS_PeakBufferedAmount, STATGROUP_RodinWS);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Compress Ratio"),       STAT_RodinWS_CompressRatio,      STATGROUP_RodinWS);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Delivery Latency P50 (ms)"), STAT_RodinWS_LatencyP50,    STATGROUP_RodinWS);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Delivery Latency P99 (ms)"), STAT_RodinWS_LatencyP99,    STATGROUP_RodinWS);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Wakeup Latency P50 (ms)"),   STAT_RodinWS_WakeupP50,     STATGROUP_RodinWS);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Wakeup Latency P99 (ms)"),   STAT_RodinWS_WakeupP99,     STATGROUP_RodinWS);
+
+CSV_DEFINE_CATEGORY(RodinWS, true);
+
+namespace
+{
+	FCriticalSection RegistryLock;
+	TArray<TWeakPtr<FRodinWSServerCounters, ESPMode::ThreadSafe>> Registry;
+
+	static constexpr std::memory_order Relaxed = std::memory_order_relaxed;
+
+	void AtomicMax(std::atomic<int64>& Target, const int64 Value)
+	{
+		int64 Current = Target.load(Relaxed);
+		while (Current < Value && !Target.compare_exchange_weak(Current, Value, Relaxed))
+		{
+		}
+	}
+
+	// Counts the time elapsed since StartCycles in its log2 microseconds bucket.
+	void Record(std::atomic<int64> (&Histogram)[FRodinWSServerCounters::NumLatencyBuckets], const uint64 StartCycles)
+	{
+		const double Microseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+		const uint64 Whole        = static_cast<uint64>(FMath::Max(Microseconds, 1.0));
+		const int32  Bucket       = FMath::Min<int32>(FMath::FloorLog2_64(Whole), FRodinWSServerCounters::NumLatencyBuckets - 1);
+
+		Histogram[Bucket].fetch_add(1, Relaxed);
+	}
+
+	// Upper bound of the bucket holding the given percentile, in milliseconds.
+	float Percentile(const TArray<int64>& Histogram, const double Fraction)
+	{
+		int64 Total = 0;
+		for (const int64 Count : Histogram)
+		{
+			Total += Count;
+		}
+
+		if (Total == 0)
+		{
+			return 0.f;
+		}
+
+		const int64 Rank = FMath::CeilToInt64(Total * Fraction);
+		int64 Accumulated = 0;
+		for (int32 Bucket = 0; Bucket < Histogram.Num(); ++Bucket)
+		{
+			Accumulated += Histogram[Bucket];
+			if (Accumulated >= Rank)
+			{
+				return static_cast<float>((1ull << (Bucket + 1)) / 1000.0);
+			}
+		}
+
+		return static_cast<float>((1ull << Histogram.Num()) / 1000.0);
+	}
+
+	// Whether anything reads the totals this frame, either a stat display or file or a CSV capture.
+	bool IsPublishingStats()
+	{
+#if STATS
+		if (FThreadStats::IsCollectingData())
+		{
+			return true;
+		}
+#endif
+
+#if CSV_PROFILER
+		if (const FCsvProfiler* Profiler = FCsvProfiler::Get())
+		{
+			if (Profiler->IsCapturing() && Profiler->IsCategoryEnabled(CSV_CATEGORY_INDEX(RodinWS)))
+			{
+				return true;
+			}
+		}
+#endif
+
+		return false;
+	}
+}
+
+FRodinWSServerCounters::FRodinWSServerCounters()
+	: ActiveConnections(0)
+	, TotalConnections(0)
+	, TlsHandshakes(0)
+	, ResumedHandshakes(0)
+	, KernelTlsSockets(0)
+	, Published(0)
+	, DeferQueueDepth(0)
+	, BackpressureEvents(0)
+	, DroppedMessages(0)
+	, CoalescedMessages(0)
+	, PeakBufferedAmount(0)
+	, PayloadBytesOut(0)
+	, FramedBytesOut(0)
+	, bServerThreadCaptured(false)
+#if PLATFORM_LINUX
+	, ServerThreadClock(0)
+#elif PLATFORM_WINDOWS
+	, ServerThreadHandle(nullptr)
+#endif
+{
+	for (int32 Index = 0; Index < NumOpCodes; ++Index)
+	{
+		MessagesIn [Index] = 0;
+		BytesIn    [Index] = 0;
+		MessagesOut[Index] = 0;
+		BytesOut   [Index] = 0;
+	}
+
+	for (int32 Bucket = 0; Bucket < NumLatencyBuckets; ++Bucket)
+	{
+		Latency      [Bucket] = 0;
+		WakeupLatency[Bucket] = 0;
+	}
+}
+
+FRodinWSServerCounters::~FRodinWSServerCounters()
+{
+#if PLATFORM_WINDOWS
+	if (void* const Handle = ServerThreadHandle.load(Relaxed))
+	{
+		::CloseHandle(Handle);
+	}
+#endif
+}
+
+int32 FRodinWSServerCounters::OpCodeIndex(const ERodinWSOpCode Code)
+{
+	switch (Code)
+	{
+	case ERodinWSOpCode::BINARY: return 1;
+	case ERodinWSOpCode::CLOSE:  return 2;
+	case ERodinWSOpCode::PING:   return 3;
+	case ERodinWSOpCode::PONG:   return 4;
+	case ERodinWSOpCode::TEXT:
+	default:                     return 0;
+	}
+}
+
+void FRodinWSServerCounters::OnSocketOpened()
+{
+	ActiveConnections.fetch_add(1, Relaxed);
+	TotalConnections .fetch_add(1, Relaxed);
+}
+
+void FRodinWSServerCounters::OnSocketClosed()
+{
+	ActiveConnections.fetch_sub(1, Relaxed);
+}
+
+void FRodinWSServerCounters::OnTlsHandshake(const bool bResumed, const bool bKernelTls)
+{
+	TlsHandshakes.fetch_add(1, Relaxed);
+
+	if (bResumed)
+	{
+		ResumedHandshakes.fetch_add(1, Relaxed);
+	}
+
+	if (bKernelTls)
+	{
+		KernelTlsSockets.fetch_add(1, Relaxed);
+	}
+}
+
+void FRodinWSServerCounters::OnMessageReceived(const ERodinWSOpCode Code, const SIZE_T Size)
+{
+	const int32 Index = OpCodeIndex(Code);
+
+	MessagesIn[Index].fetch_add(1, Relaxed);
+	BytesIn   [Index].fetch_add(static_cast<int64>(Size), Relaxed);
+}
+
+void FRodinWSServerCounters::OnMessageSent(const ERodinWSOpCode Code, const SIZE_T Size, const SIZE_T FramedSize,
+	const bool bCompressed, const bool bBackpressure, const bool bDropped, const SIZE_T BufferedAmount)
+{
+	if (bDropped)
+	{
+		DroppedMessages.fetch_add(1, Relaxed);
+		return;
+	}
+
+	const int32 Index = OpCodeIndex(Code);
+
+	MessagesOut[Index].fetch_add(1, Relaxed);
+	BytesOut   [Index].fetch_add(static_cast<int64>(Size), Relaxed);
+
+	if (bCompressed)
+	{
+		PayloadBytesOut.fetch_add(static_cast<int64>(Size), Relaxed);
+		FramedBytesOut .fetch_add(static_cast<int64>(FramedSize), Relaxed);
+	}
+
+	if (bBackpressure)
+	{
+		BackpressureEvents.fetch_add(1, Relaxed);
+	}
+
+	AtomicMax(PeakBufferedAmount, static_cast<int64>(BufferedAmount));
+}
+
+void FRodinWSServerCounters::OnPublished()
+{
+	Published.fetch_add(1, Relaxed);
+}
+
+void FRodinWSServerCounters::OnDeferred()
+{
+	DeferQueueDepth.fetch_add(1, Relaxed);
+}
+
+void FRodinWSServerCounters::OnDeferredExecuted(const uint64 DeferredCycles)
+{
+	DeferQueueDepth.fetch_sub(1, Relaxed);
+
+	Record(WakeupLatency, DeferredCycles);
+}
+
+void FRodinWSServerCounters::OnCoalesced()
+{
+	CoalescedMessages.fetch_add(1, Relaxed);
+}
+
+void FRodinWSServerCounters::OnDelivered(const uint64 ReceivedCycles)
+{
+	Record(Latency, ReceivedCycles);
+}
+
+void FRodinWSServerCounters::CaptureServerThread()
+{
+	// A restarted server runs on a new thread.
+	bServerThreadCaptured.store(false, std::memory_order_release);
+
+#if PLATFORM_LINUX
+	clockid_t Clock;
+	if (pthread_getcpuclockid(pthread_self(), &Clock) == 0)
+	{
+		ServerThreadClock.store(Clock, Relaxed);
+		bServerThreadCaptured.store(true, std::memory_order_release);
+	}
+#elif PLATFORM_WINDOWS
+	void* const Handle = ::OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, ::GetCurrentThreadId());
+	if (void* const Previous = ServerThreadHandle.exchange(Handle, Relaxed))
+	{
+		::CloseHandle(Previous);
+	}
+
+	if (Handle)
+	{
+		bServerThreadCaptured.store(true, std::memory_order_release);
+	}
+#endif
+}
+
+double FRodinWSServerCounters::GetServerThreadCpuSeconds() const
+{
+	if (!bServerThreadCaptured.load(std::memory_order_acquire))
+	{
+		return -1.0;
+	}
+
+#if PLATFORM_LINUX
+	struct timespec Time;
+	if (clock_gettime(ServerThreadClock.load(Relaxed), &Time) == 0)
+	{
+		return Time.tv_sec + Time.tv_nsec / 1e9;
+	}
+#elif PLATFORM_WINDOWS
+	FILETIME Creation, Exit, Kernel, User;
+	if (::GetThreadTimes(ServerThreadHandle.load(Relaxed), &Creation, &Exit, &Kernel, &User))
+	{
+		const uint64 Total = (static_cast<uint64>(Kernel.dwHighDateTime) << 32 | Kernel.dwLowDateTime)
+		                   + (static_cast<uint64>(User  .dwHighDateTime) << 32 | User  .dwLowDateTime);
+		return Total / 1e7;
+	}
+#endif
+
+	return -1.0;
+}
+
+FRodinWSServerStats FRodinWSServerCounters::Snapshot() const
+{
+	static const ERodinWSOpCode OpCodes[NumOpCodes] =
+	{
+		ERodinWSOpCode::TEXT, ERodinWSOpCode::BINARY, ERodinWSOpCode::CLOSE, ERodinWSOpCode::PING, ERodinWSOpCode::PONG
+	};
+
+	FRodinWSServerStats Stats;
+
+	Stats.ActiveConnections = ActiveConnections.load(Relaxed);
+	Stats.TotalConnections  = TotalConnections .load(Relaxed);
+
+	Stats.TlsHandshakes     = TlsHandshakes    .load(Relaxed);
+	Stats.ResumedHandshakes = ResumedHandshakes.load(Relaxed);
+	Stats.KernelTlsSockets  = KernelTlsSockets .load(Relaxed);
+
+	for (int32 Index = 0; Index < NumOpCodes; ++Index)
+	{
+		FRodinWSOpCodeStats& In  = Stats.Received.Add(OpCodes[Index]);
+		In.Messages  = MessagesIn[Index].load(Relaxed);
+		In.Bytes     = BytesIn   [Index].load(Relaxed);
+
+		FRodinWSOpCodeStats& Out = Stats.Sent.Add(OpCodes[Index]);
+		Out.Messages = MessagesOut[Index].load(Relaxed);
+		Out.Bytes    = BytesOut   [Index].load(Relaxed);
+	}
+
+	Stats.Published          = Published         .load(Relaxed);
+	Stats.DeferQueueDepth    = DeferQueueDepth   .load(Relaxed);
+	Stats.BackpressureEvents = BackpressureEvents.load(Relaxed);
+	Stats.DroppedMessages    = DroppedMessages   .load(Relaxed);
+	Stats.CoalescedMessages  = CoalescedMessages .load(Relaxed);
+	Stats.PeakBufferedAmount = PeakBufferedAmount.load(Relaxed);
+
+	const int64 Payload = PayloadBytesOut.load(Relaxed);
+	Stats.CompressRatio = Payload > 0 ? static_cast<float>(static_cast<double>(FramedBytesOut.load(Relaxed)) / Payload) : 1.f;
+
+	Stats.LatencyHistogram      .SetNumUninitialized(NumLatencyBuckets);
+	Stats.WakeupLatencyHistogram.SetNumUninitialized(NumLatencyBuckets);
+	for (int32 Bucket = 0; Bucket < NumLatencyBuckets; ++Bucket)
+	{
+		Stats.LatencyHistogram      [Bucket] = Latency      [Bucket].load(Relaxed);
+		Stats.WakeupLatencyHistogram[Bucket] = WakeupLatency[Bucket].load(Relaxed);
+	}
+
+	Stats.LatencyP50Ms       = Percentile(Stats.LatencyHistogram, 0.50);
+	Stats.LatencyP99Ms       = Percentile(Stats.LatencyHistogram, 0.99);
+	Stats.WakeupLatencyP50Ms = Percentile(Stats.WakeupLatencyHistogram, 0.50);
+	Stats.WakeupLatencyP99Ms = Percentile(Stats.WakeupLatencyHistogram, 0.99);
+
+	Stats.ServerThreadCpuSeconds = GetServerThreadCpuSeconds();
+
+	return Stats;
+}
+
+void FRodinWSServerCounters::Register(const TSharedRef<FRodinWSServerCounters, ESPMode::ThreadSafe>& Counters)
+{
+	FScopeLock Lock(&RegistryLock);
+
+	Registry.RemoveAllSwap([](const TWeakPtr<FRodinWSServerCounters, ESPMode::ThreadSafe>& Entry) -> bool
+	{
+		return !Entry.IsValid();
+	});
+
+	Registry.Add(Counters);
+}
+
+bool FRodinWSServerCounters::PublishStats(float DeltaTime)
+{
+	// Snapshots allocate, so idle editors skip them.
+	if (!IsPublishingStats())
+	{
+		return true;
+	}
+
+	TArray<FRodinWSServerStats> Snapshots;
+	{
+		FScopeLock Lock(&RegistryLock);
+
+		for (const TWeakPtr<FRodinWSServerCounters, ESPMode::ThreadSafe>& Entry : Registry)
+		{
+			if (const FRodinWSServerCountersPtr Counters = Entry.Pin())
+			{
+				Snapshots.Add(Counters->Snapshot());
+			}
+		}
+	}
+
+	FRodinWSServerStats Total;
+	int64 MessagesIn = 0, MessagesOut = 0, BytesIn = 0, BytesOut = 0;
+	float LatencyP50 = 0.f, LatencyP99 = 0.f, WakeupP50 = 0.f, WakeupP99 = 0.f, CompressRatio = 1.f;
+
+	for (const FRodinWSServerStats& Stats : Snapshots)
+	{
+		Total.ActiveConnections  += Stats.ActiveConnections;
+		Total.TotalConnections   += Stats.TotalConnections;
+		Total.Published          += Stats.Published;
+		Total.DeferQueueDepth    += Stats.DeferQueueDepth;
+		Total.BackpressureEvents += Stats.BackpressureEvents;
+		Total.DroppedMessages    += Stats.DroppedMessages;
+		Total.CoalescedMessages  += Stats.CoalescedMessages;
+		Total.PeakBufferedAmount  = FMath::Max(Total.PeakBufferedAmount, Stats.PeakBufferedAmount);
+
+		for (const TPair<ERodinWSOpCode, FRodinWSOpCodeStats>& Pair : Stats.Received)
+		{
+			MessagesIn += Pair.Value.Messages;
+			BytesIn    += Pair.Value.Bytes;
+		}
+
+		for (const TPair<ERodinWSOpCode, FRodinWSOpCodeStats>& Pair : Stats.Sent)
+		{
+			MessagesOut += Pair.Value.Messages;
+			BytesOut    += Pair.Value.Bytes;
+		}
+
+		LatencyP50    = FMath::Max(LatencyP50, Stats.LatencyP50Ms);
+		LatencyP99    = FMath::Max(LatencyP99, Stats.LatencyP99Ms);
+		WakeupP50     = FMath::Max(WakeupP50,  Stats.WakeupLatencyP50Ms);
+		WakeupP99     = FMath::Max(WakeupP99,  Stats.WakeupLatencyP99Ms);
+		CompressRatio = FMath::Min(CompressRatio, Stats.CompressRatio);
+	}
+
+	SET_DWORD_STAT (STAT_RodinWS_ActiveConnections,  Total.ActiveConnections);
+	SET_DWORD_STAT (STAT_RodinWS_TotalConnections,   Total.TotalConnections);
+	SET_DWORD_STAT (STAT_RodinWS_MessagesIn,         MessagesIn);
+	SET_DWORD_STAT (STAT_RodinWS_MessagesOut,        MessagesOut);
+	SET_MEMORY_STAT(STAT_RodinWS_BytesIn,            BytesIn);
+	SET_MEMORY_STAT(STAT_RodinWS_BytesOut,           BytesOut);
+	SET_DWORD_STAT (STAT_RodinWS_Published,          Total.Published);
+	SET_DWORD_STAT (STAT_RodinWS_DeferQueueDepth,    Total.DeferQueueDepth);
+	SET_DWORD_STAT (STAT_RodinWS_BackpressureEvents, Total.BackpressureEvents);
+	SET_DWORD_STAT (STAT_RodinWS_DroppedMessages,    Total.DroppedMessages);
+	SET_DWORD_STAT (STAT_RodinWS_CoalescedMessages,  Total.CoalescedMessages);
+	SET_MEMORY_STAT(STAT_RodinWS_PeakBufferedAmount, Total.PeakBufferedAmount);
+	SET_FLOAT_STAT (STAT_RodinWS_CompressRatio,      CompressRatio);
+	SET_FLOAT_STAT (STAT_RodinWS_LatencyP50,         LatencyP50);
+	SET_FLOAT_STAT (STAT_RodinWS_LatencyP99,         LatencyP99);
+	SET_FLOAT_STAT (STAT_RodinWS_WakeupP50,          WakeupP50);
+	SET_FLOAT_STAT (STAT_RodinWS_WakeupP99,          WakeupP99);
+
+	CSV_CUSTOM_STAT(RodinWS, ActiveConnections, static_cast<int32>(Total.ActiveConnections), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, MessagesIn,        static_cast<int32>(MessagesIn),              ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, MessagesOut,       static_cast<int32>(MessagesOut),             ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, BytesInMB,         static_cast<float>(BytesIn  / (1024.0 * 1024.0)), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, BytesOutMB,        static_cast<float>(BytesOut / (1024.0 * 1024.0)), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, DeferQueueDepth,   static_cast<int32>(Total.DeferQueueDepth),   ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, DroppedMessages,   static_cast<int32>(Total.DroppedMessages),   ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, CoalescedMessages, static_cast<int32>(Total.CoalescedMessages), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, CompressRatio,     CompressRatio,                               ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, LatencyP50Ms,      LatencyP50,                                  ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, LatencyP99Ms,      LatencyP99,                                  ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, WakeupP50Ms,       WakeupP50,                                   ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(RodinWS, WakeupP99Ms,       WakeupP99,                                   ECsvCustomStatOp::Set);
+
+	return true;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSServer.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <atomic>
+#if PLATFORM_LINUX
+#	include <time.h>
+#endif
+THIRD_PARTY_INCLUDES_END
+
+/**
+ * Per-server runtime counters.
+ * Written from the server thread (and the game thread for delivery latency) with relaxed atomics,
+ * read through Snapshot() from any thread.
+ */
+class FRodinWSServerCounters
+{
+public:
+	static constexpr int32 NumOpCodes        = 5;
+	static constexpr int32 NumLatencyBuckets = 24;
+
+	FRodinWSServerCounters();
+	~FRodinWSServerCounters();
+
+	void OnSocketOpened();
+	void OnSocketClosed();
+
+	/** Secure servers only, once per socket. */
+	void OnTlsHandshake(const bool bResumed, const bool bKernelTls);
+
+	void OnMessageReceived(const ERodinWSOpCode Code, const SIZE_T Size);
+
+	/** FramedSize is 0 when the frame was dropped before being framed. Only compressed frames count towards the compress ratio. */
+	void OnMessageSent(const ERodinWSOpCode Code, const SIZE_T Size, const SIZE_T FramedSize,
+		const bool bCompressed, const bool bBackpressure, const bool bDropped, const SIZE_T BufferedAmount);
+	void OnPublished();
+
+	void OnDeferred();
+
+	/** Called on the server thread with the cycle count taken when the work was deferred, feeds the wakeup latency. */
+	void OnDeferredExecuted(const uint64 DeferredCycles);
+
+	/** A queued progress message was replaced by a newer one before delivery. */
+	void OnCoalesced();
+
+	/** Called on game thread with the cycle count taken when the frame was received. */
+	void OnDelivered(const uint64 ReceivedCycles);
+
+	/** Called once from the server thread so its CPU time can be sampled from other threads. */
+	void CaptureServerThread();
+
+	/** CPU time consumed by the captured server thread, negative when unavailable on this platform. */
+	double GetServerThreadCpuSeconds() const;
+
+	FRodinWSServerStats Snapshot() const;
+
+public:
+	/** Makes the counters visible to the stat/CSV publisher. */
+	static void Register(const TSharedRef<FRodinWSServerCounters, ESPMode::ThreadSafe>& Counters);
+
+	/** Sums all live counters into the STATGROUP_RodinWS stats and the RodinWS CSV category, while either is being read. */
+	static bool PublishStats(float DeltaTime);
+
+private:
+	static int32 OpCodeIndex(const ERodinWSOpCode Code);
+
+private:
+	std::atomic<int64> ActiveConnections;
+	std::atomic<int64> TotalConnections;
+
+	std::atomic<int64> TlsHandshakes;
+	std::atomic<int64> ResumedHandshakes;
+	std::atomic<int64> KernelTlsSockets;
+
+	std::atomic<int64> MessagesIn [NumOpCodes];
+	std::atomic<int64> BytesIn    [NumOpCodes];
+	std::atomic<int64> MessagesOut[NumOpCodes];
+	std::atomic<int64> BytesOut   [NumOpCodes];
+
+	std::atomic<int64> Published;
+	std::atomic<int64> DeferQueueDepth;
+	std::atomic<int64> BackpressureEvents;
+	std::atomic<int64> DroppedMessages;
+	std::atomic<int64> CoalescedMessages;
+	std::atomic<int64> PeakBufferedAmount;
+
+	std::atomic<int64> PayloadBytesOut;
+	std::atomic<int64> FramedBytesOut;
+
+	std::atomic<int64> Latency[NumLatencyBuckets];
+	std::atomic<int64> WakeupLatency[NumLatencyBuckets];
+
+	std::atomic<bool> bServerThreadCaptured;
+#if PLATFORM_LINUX
+	std::atomic<clockid_t> ServerThreadClock;
+#elif PLATFORM_WINDOWS
+	std::atomic<void*> ServerThreadHandle;
+#endif
+};
+
+using FRodinWSServerCountersPtr = TSharedPtr<FRodinWSServerCounters, ESPMode::ThreadSafe>;
@@ -0,0 +1,383 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RodinWSTestClient.h"
+
+#include "Rodin.h"
+
+namespace
+{
+	FORCEINLINE FRodinWSTestClient*& GetClient(us_socket_t* Socket)
+	{
+		return *static_cast<FRodinWSTestClient**>(us_socket_ext(0, Socket));
+	}
+}
+
+struct FRodinWSTestClient::FProtocol
+{
+	static bool refusePayloadLength(uint64_t /*Length*/, uWS::WebSocketState<false>* /*State*/, void* /*User*/)
+	{
+		return false;
+	}
+
+	static bool setCompressed(uWS::WebSocketState<false>* /*State*/, void* User)
+	{
+		FRodinWSTestClient* const Client = static_cast<FRodinWSTestClient*>(User);
+
+		Client->bCompressed = Client->bDeflate;
+		return Client->bDeflate;
+	}
+
+	static void forceClose(uWS::WebSocketState<false>* /*State*/, void* User, std::string_view /*Reason*/ = {})
+	{
+		static_cast<FRodinWSTestClient*>(User)->Close();
+	}
+
+	static bool handleFragment(char* Data, size_t Length, unsigned int RemainingBytes, int OpCode, bool bFin,
+		uWS::WebSocketState<false>* /*State*/, void* User)
+	{
+		return static_cast<FRodinWSTestClient*>(User)->HandleFragment(Data, Length, RemainingBytes, OpCode, bFin);
+	}
+};
+
+FRodinWSTestClient::~FRodinWSTestClient()
+{
+	if (Socket)
+	{
+		// Never call back into a destroyed client.
+		GetClient(Socket) = nullptr;
+	}
+
+	if (bInflateReady)
+	{
+		inflateEnd(&InflateStream);
+	}
+}
+
+void FRodinWSTestClient::InitContext(us_socket_context_t* Context)
+{
+	us_socket_context_on_open         (0, Context, &FRodinWSTestClient::HandleOpen);
+	us_socket_context_on_data         (0, Context, &FRodinWSTestClient::HandleData);
+	us_socket_context_on_writable     (0, Context, &FRodinWSTestClient::HandleWritable);
+	us_socket_context_on_close        (0, Context, &FRodinWSTestClient::HandleClose);
+	us_socket_context_on_connect_error(0, Context, &FRodinWSTestClient::HandleConnectError);
+	us_socket_context_on_end          (0, Context, &FRodinWSTestClient::HandleEnd);
+	us_socket_context_on_timeout      (0, Context, &FRodinWSTestClient::HandleTimeout);
+}
+
+bool FRodinWSTestClient::Connect(us_socket_context_t* Context, const FString& Host, const int32 Port, const FString& Path, const bool bOfferDeflate)
+{
+	check(!Socket);
+
+	PrepareUpgrade(FString::Printf(TEXT("%s:%d"), *Host, Port), Path, bOfferDeflate);
+
+	return Attach(us_socket_context_connect(0, Context, TCHAR_TO_UTF8(*Host), Port, nullptr, 0, sizeof(FRodinWSTestClient*)));
+}
+
+bool FRodinWSTestClient::ConnectUnix(us_socket_context_t* Context, const FString& SocketPath, const FString& Path, const bool bOfferDeflate)
+{
+	check(!Socket);
+
+	PrepareUpgrade(TEXT("localhost"), Path, bOfferDeflate);
+
+	return Attach(us_socket_context_connect_unix(0, Context, TCHAR_TO_UTF8(*SocketPath), 0, sizeof(FRodinWSTestClient*)));
+}
+
+void FRodinWSTestClient::PrepareUpgrade(const FString& HostHeader, const FString& Path, const bool bOfferDeflate)
+{
+	FString Upgrade = FString::Printf(
+		TEXT("GET %s HTTP/1.1\r\n")
+		TEXT("Host: %s\r\n")
+		TEXT("Upgrade: websocket\r\n")
+		TEXT("Connection: Upgrade\r\n")
+		TEXT("Sec-WebSocket-Key: x3JJHMbDL1EzLkh9GBhXDw==\r\n")
+		TEXT("Sec-WebSocket-Version: 13\r\n"),
+		*Path, *HostHeader);
+
+	if (bOfferDeflate)
+	{
+		Upgrade += TEXT("Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover\r\n");
+	}
+
+	Upgrade += TEXT("\r\n");
+
+	Request = TCHAR_TO_UTF8(*Upgrade);
+}
+
+bool FRodinWSTestClient::Attach(us_socket_t* const InSocket)
+{
+	Socket = InSocket;
+	if (!Socket)
+	{
+		return false;
+	}
+
+	GetClient(Socket) = this;
+	return true;
+}
+
+void FRodinWSTestClient::Send(const char* Data, const SIZE_T Length, const uWS::OpCode Code, const SIZE_T FragmentSize)
+{
+	if (!IsUpgraded())
+	{
+		return;
+	}
+
+	const SIZE_T Step = FragmentSize > 0 ? FragmentSize : FMath::Max<SIZE_T>(Length, 1);
+
+	SIZE_T Offset = 0;
+	do
+	{
+		const SIZE_T Chunk  = FMath::Min(Step, Length - Offset);
+		const bool   bFirst = Offset == 0;
+		const bool   bLast  = Offset + Chunk == Length;
+
+		// Header, mask and payload.
+		Frame.resize(uWS::protocol::messageFrameSize(Chunk) + 4);
+
+		const size_t FrameSize = uWS::protocol::formatMessage<false>(Frame.data(), Data + Offset, Chunk, Code, Chunk, false);
+
+		// formatMessage always writes a final frame, patch FIN and the continuation opcode in.
+		Frame[0] = static_cast<char>((bLast ? 128 : 0) | (bFirst ? Code : 0));
+
+		Write(Frame.data(), FrameSize);
+
+		Offset += Chunk;
+	}
+	while (Offset < Length);
+}
+
+void FRodinWSTestClient::Close()
+{
+	if (!Socket)
+	{
+		return;
+	}
+
+	if (us_socket_is_established(0, Socket))
+	{
+		us_socket_close(0, Socket, 0, nullptr);
+	}
+	else
+	{
+		us_socket_close_connecting(0, Socket);
+		Detach();
+	}
+}
+
+void FRodinWSTestClient::Write(const char* Data, const SIZE_T Length)
+{
+	if (!Socket)
+	{
+		return;
+	}
+
+	if (!Pending.empty())
+	{
+		Pending.append(Data, Length);
+		return;
+	}
+
+	const int Written = us_socket_write(0, Socket, Data, static_cast<int>(Length), 0);
+	if (static_cast<SIZE_T>(Written) < Length)
+	{
+		Pending.append(Data + Written, Length - Written);
+	}
+}
+
+void FRodinWSTestClient::Detach()
+{
+	const bool bWasUpgraded = bUpgraded;
+
+	Socket    = nullptr;
+	bUpgraded = false;
+	Pending.clear();
+
+	OnClosed(bWasUpgraded);
+}
+
+void FRodinWSTestClient::ConsumeHandshake(char*& Data, int& Length)
+{
+	const size_t Previous = Handshake.size();
+	Handshake.append(Data, Length);
+
+	const size_t End = Handshake.find("\r\n\r\n");
+	if (End == std::string::npos)
+	{
+		Length = 0;
+		return;
+	}
+
+	if (Handshake.compare(0, 12, "HTTP/1.1 101") != 0)
+	{
+		UE_LOG(LogWSServer, Warning, TEXT("WebSocket upgrade refused: %s"), *FString(UTF8_TO_TCHAR(Handshake.substr(0, Handshake.find("\r\n")).c_str())));
+
+		Length = 0;
+		Close();
+		return;
+	}
+
+	bUpgraded = true;
+
+	if (Handshake.find("permessage-deflate") < End)
+	{
+		bDeflate      = true;
+		bInflateReady = inflateInit2(&InflateStream, -15) == Z_OK;
+	}
+
+	// Frames may follow the response in the same read.
+	const size_t Consumed = End + 4 - Previous;
+	Data   += Consumed;
+	Length -= static_cast<int>(Consumed);
+
+	Handshake.clear();
+	Handshake.shrink_to_fit();
+
+	OnUpgraded();
+}
+
+bool FRodinWSTestClient::Inflate()
+{
+	static const char Tail[] = { 0x00, 0x00, char(0xff), char(0xff) };
+	Fragment.append(Tail, sizeof(Tail));
+
+	Inflated.clear();
+
+	InflateStream.next_in  = reinterpret_cast<Bytef*>(Fragment.data());
+	InflateStream.avail_in = static_cast<uInt>(Fragment.size());
+
+	char Buffer[16 * 1024];
+	int  Error;
+	do
+	{
+		InflateStream.next_out  = reinterpret_cast<Bytef*>(Buffer);
+		InflateStream.avail_out = sizeof(Buffer);
+
+		Error = inflate(&InflateStream, Z_SYNC_FLUSH);
+		Inflated.append(Buffer, sizeof(Buffer) - InflateStream.avail_out);
+	}
+	while (Error == Z_OK && InflateStream.avail_out == 0);
+
+	return Error == Z_OK || Error == Z_BUF_ERROR;
+}
+
+bool FRodinWSTestClient::HandleFragment(const char* Data, const SIZE_T Length, const unsigned int RemainingBytes, const int OpCode, const bool bFin)
+{
+	// Pings are not answered, the server doesn't require it.
+	if (OpCode >= uWS::OpCode::CLOSE)
+	{
+		return false;
+	}
+
+	const bool bComplete = RemainingBytes == 0 && bFin;
+
+	if (bComplete && Fragment.empty() && !bCompressed)
+	{
+		OnMessage(Data, Length, static_cast<uWS::OpCode>(OpCode));
+		return !Socket;
+	}
+
+	Fragment.append(Data, Length);
+
+	if (!bComplete)
+	{
+		return false;
+	}
+
+	if (bCompressed)
+	{
+		bCompressed = false;
+
+		if (!bInflateReady || !Inflate())
+		{
+			Fragment.clear();
+			Close();
+			return true;
+		}
+
+		OnMessage(Inflated.data(), Inflated.size(), static_cast<uWS::OpCode>(OpCode));
+	}
+	else
+	{
+		OnMessage(Fragment.data(), Fragment.size(), static_cast<uWS::OpCode>(OpCode));
+	}
+
+	Fragment.clear();
+
+	return !Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleOpen(us_socket_t* Socket, int /*bIsClient*/, char* /*Ip*/, int /*IpLength*/)
+{
+	if (FRodinWSTestClient* const Client = GetClient(Socket))
+	{
+		Client->Write(Client->Request.data(), Client->Request.size());
+	}
+
+	return Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleData(us_socket_t* Socket, char* Data, int Length)
+{
+	FRodinWSTestClient* const Client = GetClient(Socket);
+	if (!Client)
+	{
+		return Socket;
+	}
+
+	if (!Client->bUpgraded)
+	{
+		Client->ConsumeHandshake(Data, Length);
+	}
+
+	if (Length > 0 && Client->IsUpgraded())
+	{
+		// The receive buffer is padded, the parser may spill its partial header in front of Data.
+		uWS::WebSocketProtocol<false, FProtocol>::consume(Data, static_cast<unsigned int>(Length), &Client->State, Client);
+	}
+
+	return Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleWritable(us_socket_t* Socket)
+{
+	FRodinWSTestClient* const Client = GetClient(Socket);
+
+	if (Client && !Client->Pending.empty())
+	{
+		const int Written = us_socket_write(0, Socket, Client->Pending.data(), static_cast<int>(Client->Pending.size()), 0);
+		Client->Pending.erase(0, Written);
+	}
+
+	return Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleClose(us_socket_t* Socket, int /*Code*/, void* /*Reason*/)
+{
+	if (FRodinWSTestClient* const Client = GetClient(Socket))
+	{
+		Client->Detach();
+	}
+
+	return Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleConnectError(us_socket_t* Socket, int /*Code*/)
+{
+	// The socket is closed right after without a close event.
+	if (FRodinWSTestClient* const Client = GetClient(Socket))
+	{
+		Client->Detach();
+	}
+
+	return Socket;
+}
+
+us_socket_t* FRodinWSTestClient::HandleEnd(us_socket_t* Socket)
+{
+	return us_socket_close(0, Socket, 0, nullptr);
+}
+
+us_socket_t* FRodinWSTestClient::HandleTimeout(us_socket_t* Socket)
+{
+	return Socket;
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RodinWSInternal.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <string>
+#include <zlib.h>
+THIRD_PARTY_INCLUDES_END
+
+/**
+ * Minimal WebSocket client connection on a raw uSockets context, for loopback tooling.
+ * The vendored uWebSockets only ships the server side: the upgrade is done by hand,
+ * frames are built with uWS::protocol::formatMessage and parsed with uWS::WebSocketProtocol.
+ * Everything runs on the thread driving the context's loop.
+ */
+class FRodinWSTestClient
+{
+public:
+	FRodinWSTestClient() = default;
+	FRodinWSTestClient(const FRodinWSTestClient&) = delete;
+	virtual ~FRodinWSTestClient();
+
+	/** Installs the client callbacks on a plain TCP context. */
+	static void InitContext(us_socket_context_t* Context);
+
+	bool Connect(us_socket_context_t* Context, const FString& Host, const int32 Port, const FString& Path, const bool bOfferDeflate);
+
+	/** Same over a Unix domain socket, see us_socket_context_connect_unix for how SocketPath is read. */
+	bool ConnectUnix(us_socket_context_t* Context, const FString& SocketPath, const FString& Path, const bool bOfferDeflate);
+
+	/** Sends one message, split in continuation frames of at most FragmentSize bytes when FragmentSize isn't 0. */
+	void Send(const char* Data, const SIZE_T Length, const uWS::OpCode Code, const SIZE_T FragmentSize = 0);
+
+	void Close();
+
+	FORCEINLINE bool IsOpen()     const { return Socket != nullptr; }
+	FORCEINLINE bool IsUpgraded() const { return Socket != nullptr && bUpgraded; }
+
+protected:
+	virtual void OnUpgraded() {}
+
+	/** Complete, unmasked and inflated message. */
+	virtual void OnMessage(const char* Data, const SIZE_T Length, const uWS::OpCode Code) = 0;
+
+	/** Connection failed, was refused or got closed. */
+	virtual void OnClosed(const bool bWasUpgraded) {}
+
+private:
+	struct FProtocol;
+	friend struct FProtocol;
+
+	static us_socket_t* HandleOpen(us_socket_t* Socket, int bIsClient, char* Ip, int IpLength);
+	static us_socket_t* HandleData(us_socket_t* Socket, char* Data, int Length);
+	static us_socket_t* HandleWritable(us_socket_t* Socket);
+	static us_socket_t* HandleClose(us_socket_t* Socket, int Code, void* Reason);
+	static us_socket_t* HandleConnectError(us_socket_t* Socket, int Code);
+	static us_socket_t* HandleEnd(us_socket_t* Socket);
+	static us_socket_t* HandleTimeout(us_socket_t* Socket);
+
+	void PrepareUpgrade(const FString& HostHeader, const FString& Path, const bool bOfferDeflate);
+	bool Attach(us_socket_t* const InSocket);
+
+	void Write(const char* Data, const SIZE_T Length);
+	void ConsumeHandshake(char*& Data, int& Length);
+	bool HandleFragment(const char* Data, const SIZE_T Length, const unsigned int RemainingBytes, const int OpCode, const bool bFin);
+	bool Inflate();
+
+	void Detach();
+
+private:
+	us_socket_t* Socket = nullptr;
+
+	std::string Request;
+	std::string Handshake;
+	std::string Fragment;
+	std::string Inflated;
+	std::string Pending;
+	std::string Frame;
+
+	bool bUpgraded     = false;
+	bool bDeflate      = false;
+	bool bCompressed   = false;
+	bool bInflateReady = false;
+
+	uWS::WebSocketState<false> State;
+
+	z_stream InflateStream = {};
+};
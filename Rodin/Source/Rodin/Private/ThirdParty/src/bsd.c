@@ -27,6 +27,7 @@
 #include "internal/internal.h"
 
 #include <stdio.h>
+#include <stddef.h>
 
 #ifndef _WIN32
 //#define _GNU_SOURCE
@@ -34,6 +35,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <netdb.h>
 #include <string.h>
 #include <unistd.h>
@@ -42,6 +45,9 @@
 #endif
 
 #ifdef _WIN32
+#include <afunix.h>
+#include <io.h>
+#include <string.h>
 #pragma warning(pop)
 #endif
 
@@ -65,6 +71,7 @@ LIBUS_SOCKET_DESCRIPTOR bsd_set_nonblocking(LIBUS_SOCKET_DESCRIPTOR fd) {
 }
 
 void bsd_socket_nodelay(LIBUS_SOCKET_DESCRIPTOR fd, int enabled) {
+    /* Fails harmlessly on unix domain sockets, they have no Nagle to disable */
     setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *) &enabled, sizeof(enabled));
 }
 
@@ -123,6 +130,8 @@ void internal_finalize_bsd_addr(struct bsd_addr_t *addr) {
         addr->ip_length = sizeof(struct in_addr);
         addr->port = ntohs(((struct sockaddr_in *) addr)->sin_port);
     } else {
+        /* Unix domain peers have no address we report, only an empty ip */
+        addr->ip = (char *) &addr->mem;
         addr->ip_length = 0;
         addr->port = -1;
     }
@@ -316,3 +325,74 @@ LIBUS_SOCKET_DESCRIPTOR bsd_create_connect_socket(const char *host, int port, co
 
     return fd;
 }
+
+/* Fills in a unix domain address, a leading '@' maps to the abstract namespace. Returns the address length or 0 */
+static socklen_t bsd_unix_addr(const char *path, struct sockaddr_un *addr) {
+    size_t path_length = strlen(path);
+    if (!path_length || path_length >= sizeof(addr->sun_path)) {
+        return 0;
+    }
+
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, path_length);
+
+#ifdef __linux__
+    if (path[0] == '@') {
+        /* Abstract names are not null terminated, their length is all there is */
+        addr->sun_path[0] = 0;
+        return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + path_length);
+    }
+#endif
+
+    return (socklen_t) sizeof(struct sockaddr_un);
+}
+
+LIBUS_SOCKET_DESCRIPTOR bsd_create_listen_socket_unix(const char *path, int options) {
+    struct sockaddr_un server_address;
+    socklen_t server_address_length = bsd_unix_addr(path, &server_address);
+    if (!server_address_length) {
+        return LIBUS_SOCKET_ERROR;
+    }
+
+    LIBUS_SOCKET_DESCRIPTOR listenFd = bsd_create_socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd == LIBUS_SOCKET_ERROR) {
+        return LIBUS_SOCKET_ERROR;
+    }
+
+    /* A socket file left behind by an earlier run would fail the bind, exclusive listens keep it and fail instead */
+    if (server_address.sun_path[0] && !(options & LIBUS_LISTEN_EXCLUSIVE_PORT)) {
+#ifdef _WIN32
+        _unlink(path);
+#else
+        struct stat st;
+        if (!stat(path, &st) && S_ISSOCK(st.st_mode)) {
+            unlink(path);
+        }
+#endif
+    }
+
+    if (bind(listenFd, (struct sockaddr *) &server_address, server_address_length) || listen(listenFd, 512)) {
+        bsd_close_socket(listenFd);
+        return LIBUS_SOCKET_ERROR;
+    }
+
+    return listenFd;
+}
+
+LIBUS_SOCKET_DESCRIPTOR bsd_create_connect_socket_unix(const char *path, int options) {
+    struct sockaddr_un server_address;
+    socklen_t server_address_length = bsd_unix_addr(path, &server_address);
+    if (!server_address_length) {
+        return LIBUS_SOCKET_ERROR;
+    }
+
+    LIBUS_SOCKET_DESCRIPTOR fd = bsd_create_socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == LIBUS_SOCKET_ERROR) {
+        return LIBUS_SOCKET_ERROR;
+    }
+
+    connect(fd, (struct sockaddr *) &server_address, server_address_length);
+
+    return fd;
+}
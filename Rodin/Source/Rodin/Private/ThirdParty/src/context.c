@@ -38,7 +38,7 @@ int default_ignore_data_handler(struct us_socket_t *s) {
 /* Shared with SSL */
 
 unsigned short us_socket_context_timestamp(int ssl, struct us_socket_context_t *context) {
-    return context->timestamp;
+    return (unsigned short) ((us_internal_monotonic_us() / (LIBUS_TIMEOUT_GRANULARITY * 1000000)) & 0x7fff);
 }
 
 void us_listen_socket_close(int ssl, struct us_listen_socket_t *ls) {
@@ -60,10 +60,8 @@ void us_listen_socket_close(int ssl, struct us_listen_socket_t *ls) {
 }
 
 void us_internal_socket_context_unlink(struct us_socket_context_t *context, struct us_socket_t *s) {
-    /* We have to properly update the iterator used to sweep sockets for timeouts */
-    if (s == context->iterator) {
-        context->iterator = s->next;
-    }
+    /* Unlinked sockets are closing or about to move in memory, either way their timeout goes */
+    us_internal_wheel_cancel(context->loop, &s->timeout);
 
     if (s->prev == s->next) {
         context->head = 0;
@@ -82,7 +80,7 @@ void us_internal_socket_context_unlink(struct us_socket_context_t *context, stru
 /* We always add in the top, so we don't modify any s.next */
 void us_internal_socket_context_link(struct us_socket_context_t *context, struct us_socket_t *s) {
     s->context = context;
-    s->timeout = 0;
+    us_internal_socket_timeout_init(s);
     s->next = context->head;
     s->prev = 0;
     if (context->head) {
@@ -115,6 +113,26 @@ void us_socket_context_remove_server_name(int ssl, struct us_socket_context_t *c
 #endif
 }
 
+/* Add or replace SNI context, keeps the previous one on failure */
+int us_socket_context_set_server_name(int ssl, struct us_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return us_internal_ssl_socket_context_set_server_name((struct us_internal_ssl_socket_context_t *) context, hostname_pattern, options);
+    }
+#endif
+    return 0;
+}
+
+/* Replace the default certificate for new connections, keeps the previous one on failure */
+int us_socket_context_reload_certificate(int ssl, struct us_socket_context_t *context, struct us_socket_context_options_t options) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return us_internal_ssl_socket_context_reload_certificate((struct us_internal_ssl_socket_context_t *) context, options);
+    }
+#endif
+    return 0;
+}
+
 /* I don't like this one - maybe rename it to on_missing_server_name? */
 
 /* Called when SNI matching fails - not if a match could be made.
@@ -156,13 +174,9 @@ struct us_socket_context_t *us_create_socket_context(int ssl, struct us_loop_t *
     struct us_socket_context_t *context = (struct us_socket_context_t*)malloc(sizeof(struct us_socket_context_t) + context_ext_size);
     context->loop = loop;
     context->head = 0;
-    context->iterator = 0;
     context->next = 0;
     context->ignore_data = default_ignore_data_handler;
 
-    /* Begin at 0 */
-    context->timestamp = 0;
-
     us_internal_loop_link(loop, context);
 
     /* If we are called from within SSL code, SSL code will make further changes to us */
@@ -185,15 +199,8 @@ void us_socket_context_free(int ssl, struct us_socket_context_t *context) {
     free(context);
 }
 
-struct us_listen_socket_t *us_socket_context_listen(int ssl, struct us_socket_context_t *context, const char *host, int port, int options, int socket_ext_size) {
-#ifndef LIBUS_NO_SSL
-    if (ssl) {
-        return us_internal_ssl_socket_context_listen((struct us_internal_ssl_socket_context_t *) context, host, port, options, socket_ext_size);
-    }
-#endif
-
-    LIBUS_SOCKET_DESCRIPTOR listen_socket_fd = bsd_create_listen_socket(host, port, options);
-
+/* Takes over a listening fd, shared by TCP and unix domain listens */
+static struct us_listen_socket_t *us_internal_socket_context_listen_fd(struct us_socket_context_t *context, LIBUS_SOCKET_DESCRIPTOR listen_socket_fd, int socket_ext_size) {
     if (listen_socket_fd == LIBUS_SOCKET_ERROR) {
         return 0;
     }
@@ -205,7 +212,6 @@ struct us_listen_socket_t *us_socket_context_listen(int ssl, struct us_socket_co
     struct us_listen_socket_t *ls = (struct us_listen_socket_t *) p;
 
     ls->s.context = context;
-    ls->s.timeout = 0;
     ls->s.next = 0;
     us_internal_socket_context_link(context, &ls->s);
 
@@ -214,14 +220,28 @@ struct us_listen_socket_t *us_socket_context_listen(int ssl, struct us_socket_co
     return ls;
 }
 
-struct us_socket_t *us_socket_context_connect(int ssl, struct us_socket_context_t *context, const char *host, int port, const char *source_host, int options, int socket_ext_size) {
+struct us_listen_socket_t *us_socket_context_listen(int ssl, struct us_socket_context_t *context, const char *host, int port, int options, int socket_ext_size) {
 #ifndef LIBUS_NO_SSL
     if (ssl) {
-        return (struct us_socket_t *) us_internal_ssl_socket_context_connect((struct us_internal_ssl_socket_context_t *) context, host, port, source_host, options, socket_ext_size);
+        return us_internal_ssl_socket_context_listen((struct us_internal_ssl_socket_context_t *) context, host, port, options, socket_ext_size);
     }
 #endif
 
-    LIBUS_SOCKET_DESCRIPTOR connect_socket_fd = bsd_create_connect_socket(host, port, source_host, options);
+    return us_internal_socket_context_listen_fd(context, bsd_create_listen_socket(host, port, options), socket_ext_size);
+}
+
+struct us_listen_socket_t *us_socket_context_listen_unix(int ssl, struct us_socket_context_t *context, const char *path, int options, int socket_ext_size) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return us_internal_ssl_socket_context_listen_unix((struct us_internal_ssl_socket_context_t *) context, path, options, socket_ext_size);
+    }
+#endif
+
+    return us_internal_socket_context_listen_fd(context, bsd_create_listen_socket_unix(path, options), socket_ext_size);
+}
+
+/* Takes over a connecting fd, shared by TCP and unix domain connects */
+static struct us_socket_t *us_internal_socket_context_connect_fd(struct us_socket_context_t *context, LIBUS_SOCKET_DESCRIPTOR connect_socket_fd, int socket_ext_size) {
     if (connect_socket_fd == LIBUS_SOCKET_ERROR) {
         return 0;
     }
@@ -240,6 +260,26 @@ struct us_socket_t *us_socket_context_connect(int ssl, struct us_socket_context_
     return connect_socket;
 }
 
+struct us_socket_t *us_socket_context_connect(int ssl, struct us_socket_context_t *context, const char *host, int port, const char *source_host, int options, int socket_ext_size) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return (struct us_socket_t *) us_internal_ssl_socket_context_connect((struct us_internal_ssl_socket_context_t *) context, host, port, source_host, options, socket_ext_size);
+    }
+#endif
+
+    return us_internal_socket_context_connect_fd(context, bsd_create_connect_socket(host, port, source_host, options), socket_ext_size);
+}
+
+struct us_socket_t *us_socket_context_connect_unix(int ssl, struct us_socket_context_t *context, const char *path, int options, int socket_ext_size) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return (struct us_socket_t *) us_internal_ssl_socket_context_connect_unix((struct us_internal_ssl_socket_context_t *) context, path, options, socket_ext_size);
+    }
+#endif
+
+    return us_internal_socket_context_connect_fd(context, bsd_create_connect_socket_unix(path, options), socket_ext_size);
+}
+
 struct us_socket_context_t *us_create_child_socket_context(int ssl, struct us_socket_context_t *context, int context_ext_size) {
 #ifndef LIBUS_NO_SSL
     if (ssl) {
@@ -265,7 +305,7 @@ struct us_socket_t *us_socket_context_adopt_socket(int ssl, struct us_socket_con
         return s;
     }
 
-    /* This properly updates the iterator if in on_timeout */
+    /* This also takes the socket off the timer wheel before it moves */
     us_internal_socket_context_unlink(s->context, s);
 
     struct us_socket_t *new_s = (struct us_socket_t *) us_poll_resize(&s->p, s->context->loop, sizeof(struct us_socket_t) + ext_size);
@@ -27,6 +27,7 @@ extern "C" {
 void *sni_new();
 void sni_free(void *sni, void(*cb)(void *));
 int sni_add(void *sni, const char *hostname, void *user);
+void *sni_replace(void *sni, const char *hostname, void *user);
 void *sni_remove(void *sni, const char *hostname);
 void *sni_find(void *sni, const char *hostname);
 
@@ -56,6 +57,37 @@ void *sni_find(void *sni, const char *hostname);
 #pragma warning(pop)
 #endif
 
+/* kTLS needs Linux and an OpenSSL built with it (3.0+). OpenSSL hands the keys to the BIO once the
+ * handshake is done, our custom BIO then passes them to the kernel and sends plaintext from there on.
+ * Only the sending side is offloaded, received records still go through SSL_read */
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define LIBUS_USE_KTLS
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/tls.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+/* These controls are internal to OpenSSL (include/internal/bio.h) but their values are fixed */
+#ifndef BIO_CTRL_SET_KTLS
+#define BIO_CTRL_SET_KTLS 72
+#endif
+#ifndef BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG
+#define BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG 74
+#endif
+#ifndef BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG
+#define BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG 75
+#endif
+#endif
+
 /* We do not want to block the loop with tons and tons of CPU-intensive work.
  * Spread it out during many loop iterations, prioritizing already open connections,
  * they are far easier on CPU */
@@ -70,6 +102,9 @@ struct loop_ssl_data {
     int last_write_was_msg_more;
     int msg_more;
 
+    /* Record type of the next write when it isn't application data and the kernel frames it (kTLS), 0 otherwise */
+    int ktls_record_type;
+
     // these are used to throttle SSL handshakes per loop iteration
     long long last_iteration_nr;
     int handshake_budget;
@@ -107,6 +142,7 @@ struct us_internal_ssl_socket_t {
     SSL *ssl;
     int ssl_write_wants_read; // we use this for now
     int ssl_read_wants_write;
+    int ktls_send;
 };
 
 int passphrase_cb(char *buf, int size, int rwflag, void *u) {
@@ -122,10 +158,108 @@ int BIO_s_custom_create(BIO *bio) {
     return 1;
 }
 
+#ifdef LIBUS_USE_KTLS
+/* Size of the crypto info OpenSSL passes for this cipher, its own struct has the length after a union we can't rely on */
+static socklen_t ktls_crypto_info_length(const struct tls_crypto_info *crypto_info) {
+    switch (crypto_info->cipher_type) {
+    case TLS_CIPHER_AES_GCM_128:
+        return sizeof(struct tls12_crypto_info_aes_gcm_128);
+    case TLS_CIPHER_AES_GCM_256:
+        return sizeof(struct tls12_crypto_info_aes_gcm_256);
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case TLS_CIPHER_CHACHA20_POLY1305:
+        return sizeof(struct tls12_crypto_info_chacha20_poly1305);
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* Called by OpenSSL when the write keys are ready, returns 1 once the kernel has them */
+static long ktls_start_send(struct loop_ssl_data *loop_ssl_data, const struct tls_crypto_info *crypto_info) {
+    struct us_internal_ssl_socket_t *s = (struct us_internal_ssl_socket_t *) loop_ssl_data->ssl_socket;
+    socklen_t length = ktls_crypto_info_length(crypto_info);
+
+    if (!s || !length || s->ktls_send) {
+        return 0;
+    }
+
+    LIBUS_SOCKET_DESCRIPTOR fd = us_poll_fd((struct us_poll_t *) s);
+
+    /* Fails without the tls module or on a unix socket, OpenSSL then keeps encrypting */
+    if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) && errno != EEXIST) {
+        return 0;
+    }
+
+    if (setsockopt(fd, SOL_TLS, TLS_TX, crypto_info, length)) {
+        return 0;
+    }
+
+    s->ktls_send = 1;
+    return 1;
+}
+
+/* Alerts and post-handshake messages carry their record type in a control message */
+static int ktls_send_record(BIO *bio, struct loop_ssl_data *loop_ssl_data, const char *data, int length) {
+    struct us_socket_t *s = loop_ssl_data->ssl_socket;
+
+    char control[CMSG_SPACE(sizeof(unsigned char))] = {0};
+    struct iovec vector = {(void *) data, (size_t) length};
+
+    struct msghdr message = {0};
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_TLS;
+    header->cmsg_type = TLS_SET_RECORD_TYPE;
+    header->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+    *CMSG_DATA(header) = (unsigned char) loop_ssl_data->ktls_record_type;
+
+    ssize_t written;
+    do {
+        written = sendmsg(us_poll_fd((struct us_poll_t *) s), &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (written < 0 && errno == EINTR);
+
+    if (written != length) {
+        s->context->loop->data.last_write_failed = 1;
+        us_poll_change(&s->p, s->context->loop, LIBUS_SOCKET_READABLE | LIBUS_SOCKET_WRITABLE);
+    }
+
+    if (written <= 0) {
+        BIO_set_flags(bio, BIO_FLAGS_SHOULD_RETRY | BIO_FLAGS_WRITE);
+        return -1;
+    }
+
+    loop_ssl_data->ktls_record_type = 0;
+    return (int) written;
+}
+#endif
+
 long BIO_s_custom_ctrl(BIO *bio, int cmd, long num, void *user) {
+#ifdef LIBUS_USE_KTLS
+    struct loop_ssl_data *loop_ssl_data = (struct loop_ssl_data *) BIO_get_data(bio);
+#endif
+
     switch(cmd) {
     case BIO_CTRL_FLUSH:
         return 1;
+#ifdef LIBUS_USE_KTLS
+    case BIO_CTRL_SET_KTLS:
+        /* num tells the direction, receiving stays in userspace */
+        return num ? ktls_start_send(loop_ssl_data, (const struct tls_crypto_info *) user) : 0;
+    case BIO_CTRL_GET_KTLS_SEND:
+        /* OpenSSL skips encryption when this says so, it must be about the socket being written */
+        return loop_ssl_data->ssl_socket && ((struct us_internal_ssl_socket_t *) loop_ssl_data->ssl_socket)->ktls_send;
+    case BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+        loop_ssl_data->ktls_record_type = (int) num;
+        return 1;
+    case BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+        loop_ssl_data->ktls_record_type = 0;
+        return 1;
+#endif
     default:
         return 0;
     }
@@ -136,6 +270,12 @@ int BIO_s_custom_write(BIO *bio, const char *data, int length) {
 
     //printf("BIO_s_custom_write\n");
 
+#ifdef LIBUS_USE_KTLS
+    if (loop_ssl_data->ktls_record_type) {
+        return ktls_send_record(bio, loop_ssl_data, data, length);
+    }
+#endif
+
     loop_ssl_data->last_write_was_msg_more = loop_ssl_data->msg_more || length == 16413;
     int written = us_socket_write(0, loop_ssl_data->ssl_socket, data, length, loop_ssl_data->last_write_was_msg_more);
 
@@ -179,6 +319,7 @@ struct us_internal_ssl_socket_t *ssl_on_open(struct us_internal_ssl_socket_t *s,
     s->ssl = SSL_new(context->ssl_context);
     s->ssl_write_wants_read = 0;
     s->ssl_read_wants_write = 0;
+    s->ktls_send = 0;
     SSL_set_bio(s->ssl, loop_ssl_data->shared_rbio, loop_ssl_data->shared_wbio);
 
     BIO_up_ref(loop_ssl_data->shared_rbio);
@@ -256,9 +397,10 @@ struct us_internal_ssl_socket_t *ssl_on_data(struct us_internal_ssl_socket_t *s,
 
     // bug checking: this loop needs a lot of attention and clean-ups and check-ups
     int read = 0;
+    const int recv_buf_length = loop->data.recv_buf_length;
     restart:
     while (1) {
-        int just_read = SSL_read(s->ssl, loop_ssl_data->ssl_read_output + LIBUS_RECV_BUFFER_PADDING + read, LIBUS_RECV_BUFFER_LENGTH - read);
+        int just_read = SSL_read(s->ssl, loop_ssl_data->ssl_read_output + LIBUS_RECV_BUFFER_PADDING + read, recv_buf_length - read);
 
         if (just_read <= 0) {
             int err = SSL_get_error(s->ssl, just_read);
@@ -306,7 +448,7 @@ struct us_internal_ssl_socket_t *ssl_on_data(struct us_internal_ssl_socket_t *s,
         read += just_read;
 
         // at this point we might be full and need to emit the data to application and start over
-        if (read == LIBUS_RECV_BUFFER_LENGTH) {
+        if (read == recv_buf_length) {
 
             context = (struct us_internal_ssl_socket_context_t *) us_socket_context(0, &s->s);
 
@@ -316,6 +458,9 @@ struct us_internal_ssl_socket_t *ssl_on_data(struct us_internal_ssl_socket_t *s,
                 return s;
             }
 
+            // the application may have written to other sockets, what OpenSSL writes from here on is ours
+            loop_ssl_data->ssl_socket = &s->s;
+
             read = 0;
             goto restart;
         }
@@ -377,7 +522,9 @@ void us_internal_init_loop_ssl_data(struct us_loop_t *loop) {
     if (!loop->data.ssl_data) {
         struct loop_ssl_data *loop_ssl_data = (struct loop_ssl_data*)malloc(sizeof(struct loop_ssl_data));
 
-        loop_ssl_data->ssl_read_output = (char*)malloc(LIBUS_RECV_BUFFER_LENGTH + LIBUS_RECV_BUFFER_PADDING * 2);
+        loop_ssl_data->ssl_read_output = (char*)malloc(loop->data.recv_buf_length + LIBUS_RECV_BUFFER_PADDING * 2);
+        loop_ssl_data->ssl_socket = NULL;
+        loop_ssl_data->ktls_record_type = 0;
 
         OPENSSL_init_ssl(0, NULL);
 
@@ -401,6 +548,23 @@ void us_internal_init_loop_ssl_data(struct us_loop_t *loop) {
 }
 
 /* Called by loop free, clears any loop ssl data */
+/* Decrypted data is emitted in chunks as large as the loop's receive buffer */
+int us_internal_resize_loop_ssl_data(struct us_loop_t *loop, int recv_buf_length) {
+    struct loop_ssl_data *loop_ssl_data = (struct loop_ssl_data *) loop->data.ssl_data;
+
+    if (loop_ssl_data) {
+        char *ssl_read_output = (char*)malloc(recv_buf_length + LIBUS_RECV_BUFFER_PADDING * 2);
+        if (!ssl_read_output) {
+            return 0;
+        }
+
+        free(loop_ssl_data->ssl_read_output);
+        loop_ssl_data->ssl_read_output = ssl_read_output;
+    }
+
+    return 1;
+}
+
 void us_internal_free_loop_ssl_data(struct us_loop_t *loop) {
     struct loop_ssl_data *loop_ssl_data = (struct loop_ssl_data *) loop->data.ssl_data;
 
@@ -492,6 +656,30 @@ SSL_CTX *create_ssl_context_from_options(struct us_socket_context_options_t opti
     /* Anything below TLS 1.2 is disabled */
     SSL_CTX_set_min_proto_version(ssl_context, TLS1_2_VERSION);
 
+    /* Reconnecting clients skip the full handshake, through the session cache (TLS 1.2) or tickets.
+     * The id context is required for resuming sessions once client certificates are verified */
+    if (options.ssl_session_cache_size < 0) {
+        SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(ssl_context, SSL_OP_NO_TICKET);
+        SSL_CTX_set_num_tickets(ssl_context, 0);
+    } else {
+        SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_set_session_id_context(ssl_context, (const unsigned char *) "uSockets", sizeof("uSockets") - 1);
+
+        if (options.ssl_session_cache_size > 0) {
+            SSL_CTX_sess_set_cache_size(ssl_context, options.ssl_session_cache_size);
+        }
+        if (options.ssl_session_timeout > 0) {
+            SSL_CTX_set_timeout(ssl_context, options.ssl_session_timeout);
+        }
+    }
+
+#ifdef LIBUS_USE_KTLS
+    if (options.ssl_ktls) {
+        SSL_CTX_set_options(ssl_context, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
     /* The following are helpers. You may easily implement whatever you want by using the native handle directly */
 
     /* Important option for lowering memory usage, but lowers performance slightly */
@@ -603,6 +791,55 @@ void us_internal_ssl_socket_context_remove_server_name(struct us_internal_ssl_so
     free_ssl_context(sni_node_ssl_context);
 }
 
+/* Adds or replaces a name in one step. The new SSL_CTX is loaded first so a failure keeps the previous one,
+ * connections already negotiated with the previous one hold their own reference on it */
+int us_internal_ssl_socket_context_set_server_name(struct us_internal_ssl_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options) {
+
+    SSL_CTX *ssl_context = create_ssl_context_from_options(options);
+    if (!ssl_context) {
+        return 0;
+    }
+
+    /* The node's pointer is swapped, the name is served by one of the two at any time */
+    free_ssl_context((SSL_CTX *) sni_replace(context->sni, hostname_pattern, ssl_context));
+
+    return 1;
+}
+
+/* Swaps certificate, chain and key of the live SSL_CTX. Child contexts point to it and existing SSL
+ * objects keep the certificate they copied, so nothing is recreated and session tickets stay valid */
+int us_internal_ssl_socket_context_reload_certificate(struct us_internal_ssl_socket_context_t *context, struct us_socket_context_options_t options) {
+
+    if (!options.cert_file_name || !options.key_file_name) {
+        return 0;
+    }
+
+    /* Files are loaded and matched against each other in a scratch context, the live one is untouched on failure */
+    SSL_CTX *loaded = create_ssl_context_from_options(options);
+    if (!loaded) {
+        return 0;
+    }
+
+    X509 *certificate = SSL_CTX_get0_certificate(loaded);
+    EVP_PKEY *key = SSL_CTX_get0_privatekey(loaded);
+    STACK_OF(X509) *chain = NULL;
+    SSL_CTX_get0_chain_certs(loaded, &chain);
+
+    /* OpenSSL keeps one certificate per key type and can't drop one, the previous would still be served */
+    EVP_PKEY *live_key = SSL_CTX_get0_privatekey(context->ssl_context);
+
+    int success = certificate && key
+        && (!live_key || EVP_PKEY_base_id(live_key) == EVP_PKEY_base_id(key))
+        && SSL_CTX_use_certificate(context->ssl_context, certificate) == 1
+        && SSL_CTX_use_PrivateKey(context->ssl_context, key) == 1
+        && SSL_CTX_set1_chain(context->ssl_context, chain) == 1;
+
+    free_ssl_context(loaded);
+    ERR_clear_error();
+
+    return success;
+}
+
 /* Returns NULL or SSL_CTX. May call missing server name callback */
 SSL_CTX *resolve_context(struct us_internal_ssl_socket_context_t *context, const char *hostname) {
 
@@ -707,10 +944,18 @@ struct us_listen_socket_t *us_internal_ssl_socket_context_listen(struct us_inter
     return us_socket_context_listen(0, &context->sc, host, port, options, sizeof(struct us_internal_ssl_socket_t) - sizeof(struct us_socket_t) + socket_ext_size);
 }
 
+struct us_listen_socket_t *us_internal_ssl_socket_context_listen_unix(struct us_internal_ssl_socket_context_t *context, const char *path, int options, int socket_ext_size) {
+    return us_socket_context_listen_unix(0, &context->sc, path, options, sizeof(struct us_internal_ssl_socket_t) - sizeof(struct us_socket_t) + socket_ext_size);
+}
+
 struct us_internal_ssl_socket_t *us_internal_ssl_socket_context_connect(struct us_internal_ssl_socket_context_t *context, const char *host, int port, const char *source_host, int options, int socket_ext_size) {
     return (struct us_internal_ssl_socket_t *) us_socket_context_connect(0, &context->sc, host, port, source_host, options, sizeof(struct us_internal_ssl_socket_t) - sizeof(struct us_socket_t) + socket_ext_size);
 }
 
+struct us_internal_ssl_socket_t *us_internal_ssl_socket_context_connect_unix(struct us_internal_ssl_socket_context_t *context, const char *path, int options, int socket_ext_size) {
+    return (struct us_internal_ssl_socket_t *) us_socket_context_connect_unix(0, &context->sc, path, options, sizeof(struct us_internal_ssl_socket_t) - sizeof(struct us_socket_t) + socket_ext_size);
+}
+
 void us_internal_ssl_socket_context_on_open(struct us_internal_ssl_socket_context_t *context, struct us_internal_ssl_socket_t *(*on_open)(struct us_internal_ssl_socket_t *s, int is_client, char *ip, int ip_length)) {
     us_socket_context_on_open(0, &context->sc, (struct us_socket_t *(*)(struct us_socket_t *, int, char *, int)) ssl_on_open);
     context->on_open = on_open;
@@ -753,6 +998,14 @@ void *us_internal_ssl_socket_get_native_handle(struct us_internal_ssl_socket_t *
     return s->ssl;
 }
 
+int us_internal_ssl_socket_is_session_reused(struct us_internal_ssl_socket_t *s) {
+    return SSL_session_reused(s->ssl);
+}
+
+int us_internal_ssl_socket_is_ktls_send(struct us_internal_ssl_socket_t *s) {
+    return s->ktls_send;
+}
+
 int us_internal_ssl_socket_write(struct us_internal_ssl_socket_t *s, const char *data, int length, int msg_more) {
     if (us_socket_is_closed(0, &s->s) || us_internal_ssl_socket_is_shut_down(s)) {
         return 0;
@@ -172,6 +172,36 @@ extern "C" {
         return 0;
     }
 
+    /* Sets the data of a name, adding it if needed. Returns the data it held before, or null */
+    void *sni_replace(void *sni, const char *hostname, void *user) {
+        struct sni_node *root = (struct sni_node *) sni;
+
+        /* Traverse all labels in hostname */
+        for (std::string_view view(hostname, strlen(hostname)), label;
+            view.length(); view.remove_prefix(std::min(view.length(), label.length() + 1))) {
+            /* Label is the token separated by dot */
+            label = view.substr(0, view.find('.', 0));
+
+            auto it = root->children.find(label);
+            if (it == root->children.end()) {
+                /* Duplicate this label for our kept string_view of it */
+                void *labelString = malloc(label.length());
+                memcpy(labelString, label.data(), label.length());
+
+                it = root->children.emplace(std::string_view((char *) labelString, label.length()),
+                                            std::make_unique<sni_node>()).first;
+            }
+
+            root = it->second.get();
+        }
+
+        /* Swapped in place, the name is never left without data */
+        void *previous = root->user;
+        root->user = user;
+
+        return previous;
+    }
+
     /* Removes the exact match. Wildcards are treated as the verbatim asterisk char, not as an actual wildcard */
     void *sni_remove(void *sni, const char *hostname) {
         struct sni_node *root = (struct sni_node *) sni;
@@ -129,12 +129,26 @@ void us_loop_run(struct us_loop_t *loop) {
         /* Emit pre callback */
         us_internal_loop_pre(loop);
 
-        /* Fetch ready polls */
+        /* Fetch ready polls, without blocking for a while after activity when busy polling */
+        loop->num_ready_polls = 0;
+        while (us_internal_loop_busy_polling(loop) && !loop->num_ready_polls) {
 #ifdef LIBUS_USE_EPOLL
-        loop->num_ready_polls = epoll_wait(loop->fd, loop->ready_polls, 1024, -1);
+            loop->num_ready_polls = epoll_wait(loop->fd, loop->ready_polls, 1024, 0);
 #else
-        loop->num_ready_polls = kevent(loop->fd, NULL, 0, loop->ready_polls, 1024, NULL);
+            struct timespec no_wait = {0, 0};
+            loop->num_ready_polls = kevent(loop->fd, NULL, 0, loop->ready_polls, 1024, &no_wait);
 #endif
+        }
+        if (!loop->num_ready_polls) {
+#ifdef LIBUS_USE_EPOLL
+            loop->num_ready_polls = epoll_wait(loop->fd, loop->ready_polls, 1024, -1);
+#else
+            loop->num_ready_polls = kevent(loop->fd, NULL, 0, loop->ready_polls, 1024, NULL);
+#endif
+        }
+        if (loop->num_ready_polls > 0) {
+            us_internal_loop_busy_poll_extend(loop);
+        }
 
         /* Iterate ready polls, dispatching them by type */
         for (loop->current_ready_poll = 0; loop->current_ready_poll < loop->num_ready_polls; loop->current_ready_poll++) {
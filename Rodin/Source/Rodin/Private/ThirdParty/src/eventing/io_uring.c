@@ -0,0 +1,662 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "libusockets.h"
+#include "internal/internal.h"
+#include <stdlib.h>
+
+#ifdef LIBUS_USE_IO_URING
+
+/* Talks to the ring through raw system calls, there is no liburing in the toolchain */
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+/* Completions of cancel requests carry this, they have nothing to dispatch */
+#define RING_IGNORED_USER_DATA ((__u64) -1)
+
+/* Buffer group of the provided receive buffers */
+#define RING_BUFFER_GROUP 0
+
+/* Receive buffers keep the padding uWS parsers may write around the data */
+#define RING_BUFFER_STRIDE (LIBUS_IO_URING_BUFFER_LENGTH + LIBUS_RECV_BUFFER_PADDING * 2)
+
+enum {
+    RING_OP_POLL,
+    RING_OP_ACCEPT,
+    RING_OP_RECV
+};
+
+enum {
+    RING_NO_MULTISHOT_ACCEPT = 1,
+    RING_NO_MULTISHOT_RECV = 2
+};
+
+/* Defined in context.c, sockets of contexts which may postpone data (SSL) keep reading through recv */
+int default_ignore_data_handler(struct us_socket_t *s);
+
+static int ring_enter(struct us_loop_t *loop, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+    return (int) syscall(__NR_io_uring_enter, loop->fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/* Publishes queued entries and optionally waits for a completion */
+static void ring_submit(struct us_loop_t *loop, int wait) {
+    __atomic_store_n(loop->sq_ktail, loop->sq_tail, __ATOMIC_RELEASE);
+    unsigned int to_submit = loop->sq_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE);
+
+    /* Nothing to wait for when completions are already there */
+    if (wait && *loop->cq_head != __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE)) {
+        wait = 0;
+    }
+
+    if (!to_submit && !wait) {
+        return;
+    }
+
+    while (ring_enter(loop, to_submit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0) < 0 && errno == EINTR) {
+        to_submit = loop->sq_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE);
+    }
+}
+
+static struct io_uring_sqe *ring_get_sqe(struct us_loop_t *loop, __u64 user_data) {
+    /* Full, hand what we have to the kernel first */
+    if (loop->sq_tail - __atomic_load_n(loop->sq_head, __ATOMIC_ACQUIRE) >= loop->sq_entries) {
+        ring_submit(loop, 0);
+    }
+
+    struct io_uring_sqe *sqe = &loop->sqes[loop->sq_tail & loop->sq_mask];
+    loop->sq_tail++;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->user_data = user_data;
+    return sqe;
+}
+
+static int ring_alloc_op(struct us_loop_t *loop, struct us_poll_t *p, int kind) {
+    if (loop->free_op == -1) {
+        int num_ops = loop->num_ops ? loop->num_ops * 2 : 256;
+        loop->ops = realloc(loop->ops, sizeof(struct us_internal_ring_op) * num_ops);
+        for (int i = num_ops - 1; i >= loop->num_ops; i--) {
+            loop->ops[i].poll = 0;
+            loop->ops[i].next_free = loop->free_op;
+            loop->free_op = i;
+        }
+        loop->num_ops = num_ops;
+    }
+
+    int index = loop->free_op;
+    loop->free_op = loop->ops[index].next_free;
+    loop->ops[index].poll = p;
+    loop->ops[index].kind = kind;
+    return index;
+}
+
+static void ring_free_op(struct us_loop_t *loop, int index) {
+    loop->ops[index].poll = 0;
+    loop->ops[index].next_free = loop->free_op;
+    loop->free_op = index;
+}
+
+/* The slot lives on until the request's last completion, which is then dropped */
+static void ring_cancel_op(struct us_loop_t *loop, int index) {
+    struct io_uring_sqe *sqe = ring_get_sqe(loop, RING_IGNORED_USER_DATA);
+    sqe->opcode = loop->ops[index].kind == RING_OP_POLL ? IORING_OP_POLL_REMOVE : IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (__u64) index;
+
+    /* A multishot accept holds the listening socket open, release the port right away */
+    if (loop->ops[index].kind == RING_OP_ACCEPT) {
+        ring_submit(loop, 0);
+    }
+
+    loop->ops[index].poll = 0;
+}
+
+static void ring_recycle_buffer(struct us_loop_t *loop, unsigned short bid) {
+    struct io_uring_buf *buf = &loop->buf_ring->bufs[loop->buf_tail & (LIBUS_IO_URING_BUFFER_COUNT - 1)];
+    buf->addr = (__u64) (uintptr_t) (loop->buffers + (size_t) bid * RING_BUFFER_STRIDE + LIBUS_RECV_BUFFER_PADDING);
+    buf->len = LIBUS_IO_URING_BUFFER_LENGTH;
+    buf->bid = bid;
+
+    loop->buf_tail++;
+    __atomic_store_n(&loop->buf_ring->tail, loop->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int ring_register_buffers(struct us_loop_t *loop) {
+    size_t ring_size = sizeof(struct io_uring_buf) * LIBUS_IO_URING_BUFFER_COUNT;
+    void *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (__u64) (uintptr_t) ring;
+    reg.ring_entries = LIBUS_IO_URING_BUFFER_COUNT;
+    reg.bgid = RING_BUFFER_GROUP;
+
+    if (syscall(__NR_io_uring_register, loop->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, ring_size);
+        return -1;
+    }
+
+    loop->buf_ring = (struct io_uring_buf_ring *) ring;
+    loop->buffers = malloc((size_t) RING_BUFFER_STRIDE * LIBUS_IO_URING_BUFFER_COUNT);
+    loop->buf_tail = 0;
+
+    for (int i = 0; i < LIBUS_IO_URING_BUFFER_COUNT; i++) {
+        ring_recycle_buffer(loop, (unsigned short) i);
+    }
+    return 0;
+}
+
+static int ring_setup(struct us_loop_t *loop) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = LIBUS_IO_URING_ENTRIES * 4;
+
+    loop->fd = (int) syscall(__NR_io_uring_setup, LIBUS_IO_URING_ENTRIES, &params);
+    if (loop->fd < 0) {
+        return -1;
+    }
+
+    loop->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    loop->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    loop->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    /* Both rings share one mapping on any kernel having what we need, map them apart otherwise */
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (loop->cq_ring_size > loop->sq_ring_size) {
+            loop->sq_ring_size = loop->cq_ring_size;
+        }
+        loop->cq_ring_size = 0;
+    }
+
+    loop->sq_ring = mmap(NULL, loop->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, loop->fd, IORING_OFF_SQ_RING);
+    loop->cq_ring = loop->cq_ring_size ? mmap(NULL, loop->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, loop->fd, IORING_OFF_CQ_RING) : loop->sq_ring;
+    loop->sqes = mmap(NULL, loop->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, loop->fd, IORING_OFF_SQES);
+    if (loop->sq_ring == MAP_FAILED || loop->cq_ring == MAP_FAILED || loop->sqes == MAP_FAILED) {
+        return -1;
+    }
+
+    char *sq = (char *) loop->sq_ring;
+    loop->sq_head = (unsigned int *) (sq + params.sq_off.head);
+    loop->sq_ktail = (unsigned int *) (sq + params.sq_off.tail);
+    loop->sq_array = (unsigned int *) (sq + params.sq_off.array);
+    loop->sq_mask = *(unsigned int *) (sq + params.sq_off.ring_mask);
+    loop->sq_entries = params.sq_entries;
+    loop->sq_tail = *loop->sq_ktail;
+
+    /* Entries are always used in order, so the indirection array is set once */
+    for (unsigned int i = 0; i < loop->sq_entries; i++) {
+        loop->sq_array[i] = i;
+    }
+
+    char *cq = (char *) loop->cq_ring;
+    loop->cq_head = (unsigned int *) (cq + params.cq_off.head);
+    loop->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+    loop->cq_mask = *(unsigned int *) (cq + params.cq_off.ring_mask);
+    loop->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    /* Without a buffer ring every socket reads on readiness, like with epoll */
+    if (ring_register_buffers(loop)) {
+        loop->disabled_features |= RING_NO_MULTISHOT_RECV;
+    }
+
+    return 0;
+}
+
+static void ring_start_poll(struct us_loop_t *loop, struct us_poll_t *p, int events) {
+    p->poll_op = ring_alloc_op(loop, p, RING_OP_POLL);
+    p->poll_op_events = (unsigned short) events;
+
+    /* Oneshot, rearmed after each completion. This keeps epoll's level triggered behavior */
+    struct io_uring_sqe *sqe = ring_get_sqe(loop, (__u64) p->poll_op);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = p->state.fd;
+    sqe->poll32_events = (__u32) events;
+}
+
+static void ring_start_data(struct us_loop_t *loop, struct us_poll_t *p, int kind) {
+    p->data_op = ring_alloc_op(loop, p, kind);
+
+    struct io_uring_sqe *sqe = ring_get_sqe(loop, (__u64) p->data_op);
+    sqe->fd = p->state.fd;
+    if (kind == RING_OP_ACCEPT) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    } else {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RING_BUFFER_GROUP;
+    }
+}
+
+/* How the poll reads: accepts or receives through the ring, or 0 when it waits for readiness */
+static int ring_data_kind(struct us_loop_t *loop, struct us_poll_t *p) {
+    if (!(us_poll_events(p) & LIBUS_SOCKET_READABLE)) {
+        return 0;
+    }
+
+    if (p->listening) {
+        return (loop->disabled_features & RING_NO_MULTISHOT_ACCEPT) ? 0 : RING_OP_ACCEPT;
+    }
+
+    int poll_type = us_internal_poll_type(p);
+    if ((poll_type == POLL_TYPE_SOCKET || poll_type == POLL_TYPE_SOCKET_SHUT_DOWN) && !(loop->disabled_features & RING_NO_MULTISHOT_RECV)) {
+        struct us_socket_t *s = (struct us_socket_t *) p;
+        return s->context->ignore_data == default_ignore_data_handler ? RING_OP_RECV : 0;
+    }
+
+    return 0;
+}
+
+/* Brings the requests in flight in line with what the poll polls for */
+static void ring_update_poll(struct us_loop_t *loop, struct us_poll_t *p) {
+    int data_kind = ring_data_kind(loop, p);
+    int poll_events = us_poll_events(p) & ~(data_kind ? LIBUS_SOCKET_READABLE : 0);
+
+    if (p->data_op != -1 && loop->ops[p->data_op].kind != data_kind) {
+        ring_cancel_op(loop, p->data_op);
+        p->data_op = -1;
+    }
+    if (p->data_op == -1 && data_kind) {
+        ring_start_data(loop, p, data_kind);
+    }
+
+    if (p->poll_op != -1 && p->poll_op_events != poll_events) {
+        ring_cancel_op(loop, p->poll_op);
+        p->poll_op = -1;
+    }
+    if (p->poll_op == -1 && poll_events) {
+        ring_start_poll(loop, p, poll_events);
+    }
+}
+
+static void ring_dispatch_accept(struct us_loop_t *loop, struct us_poll_t *p, int res) {
+    if (res < 0) {
+        /* Todo: start timer here, like the polled accept */
+        return;
+    }
+
+    /* Multishot accepts have no room for the address */
+    struct bsd_addr_t addr;
+    if (bsd_remote_addr(res, &addr)) {
+        bsd_close_socket(res);
+        return;
+    }
+
+    us_internal_accept_socket((struct us_listen_socket_t *) p, res, &addr);
+}
+
+static void ring_dispatch_recv(struct us_loop_t *loop, struct us_poll_t *p, int res, unsigned int flags) {
+    if (res == -ENOBUFS) {
+        /* Rearmed already, buffers come back as this iteration's data is consumed */
+        return;
+    }
+
+    if (res > 0) {
+        unsigned short bid = (unsigned short) (flags >> IORING_CQE_BUFFER_SHIFT);
+        us_internal_dispatch_received((struct us_socket_t *) p, loop->buffers + (size_t) bid * RING_BUFFER_STRIDE + LIBUS_RECV_BUFFER_PADDING, res);
+    } else {
+        us_internal_dispatch_received((struct us_socket_t *) p, NULL, res ? LIBUS_SOCKET_ERROR : 0);
+    }
+}
+
+static void ring_dispatch_completion(struct us_loop_t *loop, __u64 user_data, int res, unsigned int flags) {
+    if (user_data == RING_IGNORED_USER_DATA) {
+        return;
+    }
+
+    int index = (int) user_data;
+    struct us_poll_t *p = loop->ops[index].poll;
+    int kind = loop->ops[index].kind;
+
+    /* Whatever we are going to do, this buffer is done with once we return */
+    int bid = (flags & IORING_CQE_F_BUFFER) ? (int) (flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        if (p) {
+            if (kind == RING_OP_POLL) {
+                p->poll_op = -1;
+            } else {
+                p->data_op = -1;
+            }
+        }
+        ring_free_op(loop, index);
+
+        /* This kernel has no such multishot request, fall back to readiness for good */
+        if (p && res == -EINVAL && kind != RING_OP_POLL) {
+            loop->disabled_features |= kind == RING_OP_ACCEPT ? RING_NO_MULTISHOT_ACCEPT : RING_NO_MULTISHOT_RECV;
+        }
+
+        /* Rearm before dispatching, closing or changing the poll in there cancels as usual */
+        if (p && res != -ECANCELED && (kind != RING_OP_RECV || res > 0 || res == -ENOBUFS || res == -EINVAL)) {
+            ring_update_poll(loop, p);
+        }
+    }
+
+    if (p && res != -ECANCELED && !(res == -EINVAL && kind != RING_OP_POLL)) {
+        switch (kind) {
+        case RING_OP_POLL: {
+                int events = res > 0 ? (res & us_poll_events(p)) : 0;
+                int error = res < 0 || (res & (POLLERR | POLLHUP));
+                if (events || error) {
+                    us_internal_dispatch_ready_poll(p, error, events);
+                }
+            }
+            break;
+        case RING_OP_ACCEPT:
+            ring_dispatch_accept(loop, p, res);
+            break;
+        case RING_OP_RECV:
+            ring_dispatch_recv(loop, p, res, flags);
+            break;
+        }
+    }
+
+    /* Accepted after the listen socket closed, nobody is left to take it */
+    if (!p && kind == RING_OP_ACCEPT && res >= 0) {
+        bsd_close_socket(res);
+    }
+
+    if (bid != -1) {
+        ring_recycle_buffer(loop, (unsigned short) bid);
+    }
+}
+
+/* Loop */
+void us_loop_free(struct us_loop_t *loop) {
+    us_internal_loop_data_free(loop);
+
+    /* Closing the ring cancels whatever is still in flight */
+    close(loop->fd);
+    munmap(loop->sqes, loop->sqes_size);
+    if (loop->cq_ring_size) {
+        munmap(loop->cq_ring, loop->cq_ring_size);
+    }
+    munmap(loop->sq_ring, loop->sq_ring_size);
+
+    if (loop->buf_ring) {
+        munmap(loop->buf_ring, sizeof(struct io_uring_buf) * LIBUS_IO_URING_BUFFER_COUNT);
+        free(loop->buffers);
+    }
+    free(loop->ops);
+    free(loop);
+}
+
+/* Poll */
+struct us_poll_t *us_create_poll(struct us_loop_t *loop, int fallthrough, unsigned int ext_size) {
+    if (!fallthrough) {
+        loop->num_polls++;
+    }
+    return malloc(sizeof(struct us_poll_t) + ext_size);
+}
+
+/* Todo: this one should be us_internal_poll_free */
+void us_poll_free(struct us_poll_t *p, struct us_loop_t *loop) {
+    /* Stopped polls have nothing in flight, this only guards the slots against dangling */
+    if (p->poll_op != -1) {
+        ring_cancel_op(loop, p->poll_op);
+    }
+    if (p->data_op != -1) {
+        ring_cancel_op(loop, p->data_op);
+    }
+
+    loop->num_polls--;
+    free(p);
+}
+
+void *us_poll_ext(struct us_poll_t *p) {
+    return p + 1;
+}
+
+void us_poll_init(struct us_poll_t *p, LIBUS_SOCKET_DESCRIPTOR fd, int poll_type) {
+    p->state.fd = fd;
+    p->state.poll_type = poll_type;
+    p->poll_op = -1;
+    p->data_op = -1;
+    p->poll_op_events = 0;
+    p->listening = 0;
+}
+
+int us_poll_events(struct us_poll_t *p) {
+    return ((p->state.poll_type & POLL_TYPE_POLLING_IN) ? LIBUS_SOCKET_READABLE : 0) | ((p->state.poll_type & POLL_TYPE_POLLING_OUT) ? LIBUS_SOCKET_WRITABLE : 0);
+}
+
+LIBUS_SOCKET_DESCRIPTOR us_poll_fd(struct us_poll_t *p) {
+    return p->state.fd;
+}
+
+/* Returns any of listen socket, socket, shut down socket or callback */
+int us_internal_poll_type(struct us_poll_t *p) {
+    return p->state.poll_type & 3;
+}
+
+/* Bug: doesn't really SET, rather read and change, so needs to be inited first! */
+void us_internal_poll_set_type(struct us_poll_t *p, int poll_type) {
+    p->state.poll_type = poll_type | (p->state.poll_type & 12);
+}
+
+/* Timer */
+void *us_timer_ext(struct us_timer_t *timer) {
+    return ((struct us_internal_callback_t *) timer) + 1;
+}
+
+struct us_loop_t *us_timer_loop(struct us_timer_t *t) {
+    struct us_internal_callback_t *internal_cb = (struct us_internal_callback_t *) t;
+
+    return internal_cb->loop;
+}
+
+/* Loop */
+struct us_loop_t *us_create_loop(void *hint, void (*wakeup_cb)(struct us_loop_t *loop), void (*pre_cb)(struct us_loop_t *loop), void (*post_cb)(struct us_loop_t *loop), unsigned int ext_size) {
+    struct us_loop_t *loop = (struct us_loop_t *) calloc(1, sizeof(struct us_loop_t) + ext_size);
+    loop->num_polls = 0;
+    loop->free_op = -1;
+
+    /* Fails on kernels before 5.19 and in sandboxes denying io_uring, those need the epoll build */
+    if (ring_setup(loop)) {
+        if (loop->fd >= 0) {
+            close(loop->fd);
+        }
+        free(loop);
+        return 0;
+    }
+
+    us_internal_loop_data_init(loop, wakeup_cb, pre_cb, post_cb);
+    return loop;
+}
+
+void us_loop_run(struct us_loop_t *loop) {
+    us_loop_integrate(loop);
+
+    /* While we have non-fallthrough polls we shouldn't fall through */
+    while (loop->num_polls) {
+        /* Emit pre callback */
+        us_internal_loop_pre(loop);
+
+        /* Submit this iteration's changes and wait for completions, in one system call.
+         * When busy polling, submit and reap without blocking for a while after activity */
+        ring_submit(loop, 0);
+        while (us_internal_loop_busy_polling(loop) && *loop->cq_head == __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE)) {
+            ring_enter(loop, 0, 0, IORING_ENTER_GETEVENTS);
+        }
+        ring_submit(loop, 1);
+
+        /* Dispatch what completed, each entry is copied out so the kernel can reuse it right away */
+        unsigned int head = *loop->cq_head;
+        unsigned int tail = __atomic_load_n(loop->cq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            us_internal_loop_busy_poll_extend(loop);
+        }
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &loop->cqes[head & loop->cq_mask];
+            __u64 user_data = cqe->user_data;
+            int res = cqe->res;
+            unsigned int flags = cqe->flags;
+            __atomic_store_n(loop->cq_head, head + 1, __ATOMIC_RELEASE);
+
+            ring_dispatch_completion(loop, user_data, res, flags);
+        }
+
+        /* Emit post callback */
+        us_internal_loop_post(loop);
+    }
+}
+
+struct us_poll_t *us_poll_resize(struct us_poll_t *p, struct us_loop_t *loop, unsigned int ext_size) {
+    struct us_poll_t *new_p = realloc(p, sizeof(struct us_poll_t) + ext_size);
+
+    /* Completions find their poll through the slots, pending ones included */
+    if (new_p->poll_op != -1) {
+        loop->ops[new_p->poll_op].poll = new_p;
+    }
+    if (new_p->data_op != -1) {
+        loop->ops[new_p->data_op].poll = new_p;
+    }
+
+    return new_p;
+}
+
+void us_poll_start(struct us_poll_t *p, struct us_loop_t *loop, int events) {
+    p->state.poll_type = us_internal_poll_type(p) | ((events & LIBUS_SOCKET_READABLE) ? POLL_TYPE_POLLING_IN : 0) | ((events & LIBUS_SOCKET_WRITABLE) ? POLL_TYPE_POLLING_OUT : 0);
+
+    /* Listen sockets are the semi-sockets started for readable, connecting ones start for writable */
+    if (us_internal_poll_type(p) == POLL_TYPE_SEMI_SOCKET && events == LIBUS_SOCKET_READABLE) {
+        p->listening = 1;
+    }
+
+    ring_update_poll(loop, p);
+}
+
+void us_poll_change(struct us_poll_t *p, struct us_loop_t *loop, int events) {
+    int old_events = us_poll_events(p);
+    if (old_events != events) {
+
+        p->state.poll_type = us_internal_poll_type(p) | ((events & LIBUS_SOCKET_READABLE) ? POLL_TYPE_POLLING_IN : 0) | ((events & LIBUS_SOCKET_WRITABLE) ? POLL_TYPE_POLLING_OUT : 0);
+
+        ring_update_poll(loop, p);
+    }
+}
+
+void us_poll_stop(struct us_poll_t *p, struct us_loop_t *loop) {
+    /* Completions already queued for us are dropped along with the slots */
+    if (p->poll_op != -1) {
+        ring_cancel_op(loop, p->poll_op);
+        p->poll_op = -1;
+    }
+    if (p->data_op != -1) {
+        ring_cancel_op(loop, p->data_op);
+        p->data_op = -1;
+    }
+}
+
+unsigned int us_internal_accept_poll_event(struct us_poll_t *p) {
+    int fd = us_poll_fd(p);
+    uint64_t buf;
+    int read_length = read(fd, &buf, 8);
+    (void)read_length;
+    return buf;
+}
+
+/* Timer */
+struct us_timer_t *us_create_timer(struct us_loop_t *loop, int fallthrough, unsigned int ext_size) {
+    struct us_poll_t *p = us_create_poll(loop, fallthrough, sizeof(struct us_internal_callback_t) + ext_size);
+    us_poll_init(p, timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC), POLL_TYPE_CALLBACK);
+
+    struct us_internal_callback_t *cb = (struct us_internal_callback_t *) p;
+    cb->loop = loop;
+    cb->cb_expects_the_loop = 0;
+
+    return (struct us_timer_t *) cb;
+}
+
+void us_timer_close(struct us_timer_t *timer) {
+    struct us_internal_callback_t *cb = (struct us_internal_callback_t *) timer;
+
+    us_poll_stop(&cb->p, cb->loop);
+    close(us_poll_fd(&cb->p));
+
+    /* (regular) sockets are the only polls which are not freed immediately */
+    us_poll_free((struct us_poll_t *) timer, cb->loop);
+}
+
+void us_timer_set(struct us_timer_t *t, void (*cb)(struct us_timer_t *t), int ms, int repeat_ms) {
+    struct us_internal_callback_t *internal_cb = (struct us_internal_callback_t *) t;
+
+    internal_cb->cb = (void (*)(struct us_internal_callback_t *)) cb;
+
+    struct itimerspec timer_spec = {
+        {repeat_ms / 1000, (long) (repeat_ms % 1000) * (long) 1000000},
+        {ms / 1000, (long) (ms % 1000) * (long) 1000000}
+    };
+
+    timerfd_settime(us_poll_fd((struct us_poll_t *) t), 0, &timer_spec, NULL);
+    us_poll_start((struct us_poll_t *) t, internal_cb->loop, LIBUS_SOCKET_READABLE);
+}
+
+/* Async (internal helper for loop's wakeup feature) */
+struct us_internal_async *us_internal_create_async(struct us_loop_t *loop, int fallthrough, unsigned int ext_size) {
+    struct us_poll_t *p = us_create_poll(loop, fallthrough, sizeof(struct us_internal_callback_t) + ext_size);
+    us_poll_init(p, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), POLL_TYPE_CALLBACK);
+
+    struct us_internal_callback_t *cb = (struct us_internal_callback_t *) p;
+    cb->loop = loop;
+    cb->cb_expects_the_loop = 1;
+
+    return (struct us_internal_async *) cb;
+}
+
+void us_internal_async_close(struct us_internal_async *a) {
+    struct us_internal_callback_t *cb = (struct us_internal_callback_t *) a;
+
+    us_poll_stop(&cb->p, cb->loop);
+    close(us_poll_fd(&cb->p));
+
+    /* (regular) sockets are the only polls which are not freed immediately */
+    us_poll_free((struct us_poll_t *) a, cb->loop);
+}
+
+void us_internal_async_set(struct us_internal_async *a, void (*cb)(struct us_internal_async *)) {
+    struct us_internal_callback_t *internal_cb = (struct us_internal_callback_t *) a;
+
+    internal_cb->cb = (void (*)(struct us_internal_callback_t *)) cb;
+
+    us_poll_start((struct us_poll_t *) a, internal_cb->loop, LIBUS_SOCKET_READABLE);
+}
+
+void us_internal_async_wakeup(struct us_internal_async *a) {
+    /* Any thread, so it goes through the eventfd and never touches the ring */
+    uint64_t one = 1;
+    int written = write(us_poll_fd((struct us_poll_t *) a), &one, 8);
+    (void)written;
+}
+
+#endif
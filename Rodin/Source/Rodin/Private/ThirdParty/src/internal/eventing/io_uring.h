@@ -0,0 +1,107 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include "internal/loop_data.h"
+
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+
+/* Multishot receive into provided buffers is the newest feature we rely on */
+#ifndef IORING_RECV_MULTISHOT
+#error "LIBUS_USE_IO_URING needs linux/io_uring.h from Linux 6.0 or later"
+#endif
+
+#define LIBUS_SOCKET_READABLE POLLIN
+#define LIBUS_SOCKET_WRITABLE POLLOUT
+
+/* Submission queue entries, the completion queue is made 4 times larger */
+#ifndef LIBUS_IO_URING_ENTRIES
+#define LIBUS_IO_URING_ENTRIES 1024
+#endif
+
+/* Receive buffers registered with the ring, count must be a power of 2 */
+#ifndef LIBUS_IO_URING_BUFFER_COUNT
+#define LIBUS_IO_URING_BUFFER_COUNT 256
+#endif
+#ifndef LIBUS_IO_URING_BUFFER_LENGTH
+#define LIBUS_IO_URING_BUFFER_LENGTH 16384
+#endif
+
+/* One request in flight on the ring, its index is the user_data of its completions */
+struct us_internal_ring_op {
+    /* Null once the poll stopped or was freed, the slot is recycled on the last completion */
+    struct us_poll_t *poll;
+    int kind;
+    int next_free;
+};
+
+struct us_loop_t {
+    alignas(LIBUS_EXT_ALIGNMENT) struct us_internal_loop_data_t data;
+
+    /* Number of non-fallthrough polls in the loop */
+    int num_polls;
+
+    /* Loop's own file descriptor, the ring */
+    int fd;
+
+    /* Multishot requests the kernel turned down, we then poll for readiness instead */
+    int disabled_features;
+
+    /* Submission queue, sq_tail is ours until published on submit */
+    unsigned int *sq_head, *sq_ktail, *sq_array;
+    unsigned int sq_tail, sq_mask, sq_entries;
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    unsigned int *cq_head, *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+
+    /* Slots of requests in flight, grown on demand */
+    struct us_internal_ring_op *ops;
+    int num_ops;
+    int free_op;
+
+    /* Provided buffer ring multishot receives land in, null when the kernel has none */
+    struct io_uring_buf_ring *buf_ring;
+    char *buffers;
+    unsigned short buf_tail;
+};
+
+struct us_poll_t {
+    alignas(LIBUS_EXT_ALIGNMENT) struct {
+        signed int fd : 28; // we could have this unsigned if we wanted to, -1 should never be used
+        unsigned int poll_type : 4;
+    } state;
+
+    /* Requests in flight for this poll, -1 when none: a readiness poll and a multishot accept or receive */
+    int poll_op;
+    int data_op;
+
+    /* What poll_op waits for */
+    unsigned short poll_op_events;
+
+    /* Started as a listen socket, it accepts through the ring */
+    unsigned char listening;
+};
+
+#endif // IO_URING_H
@@ -31,6 +31,9 @@
 #if defined(LIBUS_USE_EPOLL) || defined(LIBUS_USE_KQUEUE)
 #include "internal/eventing/epoll_kqueue.h"
 #endif
+#ifdef LIBUS_USE_IO_URING
+#include "internal/eventing/io_uring.h"
+#endif
 #ifdef LIBUS_USE_LIBUV
 #include "internal/eventing/libuv.h"
 #endif
@@ -53,7 +56,12 @@ enum {
 
 /* Loop related */
 void us_internal_dispatch_ready_poll(struct us_poll_t *p, int error, int events);
-void us_internal_timer_sweep(struct us_loop_t *loop);
+void us_internal_accept_socket(struct us_listen_socket_t *listen_socket, LIBUS_SOCKET_DESCRIPTOR client_fd, struct bsd_addr_t *addr);
+struct us_socket_t *us_internal_dispatch_received(struct us_socket_t *s, char *data, int length);
+void us_internal_wheel_set(struct us_loop_t *loop, struct us_internal_wheel_entry_t *entry, unsigned int ms);
+void us_internal_wheel_cancel(struct us_loop_t *loop, struct us_internal_wheel_entry_t *entry);
+void us_internal_socket_timeout_init(struct us_socket_t *s);
+long long us_internal_monotonic_us();
 void us_internal_free_closed_sockets(struct us_loop_t *loop);
 void us_internal_loop_link(struct us_loop_t *loop, struct us_socket_context_t *context);
 void us_internal_loop_unlink(struct us_loop_t *loop, struct us_socket_context_t *context);
@@ -62,6 +70,8 @@ void us_internal_loop_data_init(struct us_loop_t *loop, void (*wakeup_cb)(struct
 void us_internal_loop_data_free(struct us_loop_t *loop);
 void us_internal_loop_pre(struct us_loop_t *loop);
 void us_internal_loop_post(struct us_loop_t *loop);
+int us_internal_loop_busy_polling(struct us_loop_t *loop);
+void us_internal_loop_busy_poll_extend(struct us_loop_t *loop);
 
 /* Asyncs (old) */
 struct us_internal_async *us_internal_create_async(struct us_loop_t *loop, int fallthrough, unsigned int ext_size);
@@ -77,6 +87,8 @@ void us_internal_poll_set_type(struct us_poll_t *p, int poll_type);
 /* SSL loop data */
 void us_internal_init_loop_ssl_data(struct us_loop_t *loop);
 void us_internal_free_loop_ssl_data(struct us_loop_t *loop);
+/* Returns 0 and keeps the current buffer when out of memory */
+int us_internal_resize_loop_ssl_data(struct us_loop_t *loop, int recv_buf_length);
 
 /* Socket context related */
 void us_internal_socket_context_link(struct us_socket_context_t *context, struct us_socket_t *s);
@@ -87,7 +99,7 @@ struct us_socket_t {
     alignas(LIBUS_EXT_ALIGNMENT) struct us_poll_t p;
     struct us_socket_context_t *context;
     struct us_socket_t *prev, *next;
-    unsigned short timeout;
+    struct us_internal_wheel_entry_t timeout;
 };
 
 /* Internal callback types are polls just like sockets */
@@ -98,6 +110,13 @@ struct us_internal_callback_t {
     void (*cb)(struct us_internal_callback_t *cb);
 };
 
+/* One-shot timeouts live on the loop's timer wheel only */
+struct us_timeout_t {
+    alignas(LIBUS_EXT_ALIGNMENT) struct us_internal_wheel_entry_t entry;
+    struct us_loop_t *loop;
+    void (*cb)(struct us_timeout_t *t);
+};
+
 /* Listen sockets are sockets */
 struct us_listen_socket_t {
     alignas(LIBUS_EXT_ALIGNMENT) struct us_socket_t s;
@@ -106,9 +125,7 @@ struct us_listen_socket_t {
 
 struct us_socket_context_t {
     alignas(LIBUS_EXT_ALIGNMENT) struct us_loop_t *loop;
-    unsigned short timestamp;
     struct us_socket_t *head;
-    struct us_socket_t *iterator;
     struct us_socket_context_t *prev, *next;
 
     struct us_socket_t *(*on_open)(struct us_socket_t *, int is_client, char *ip, int ip_length);
@@ -131,9 +148,13 @@ struct us_internal_ssl_socket_t;
 /* SNI functions */
 void us_internal_ssl_socket_context_add_server_name(struct us_internal_ssl_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options);
 void us_internal_ssl_socket_context_remove_server_name(struct us_internal_ssl_socket_context_t *context, const char *hostname_pattern);
+int us_internal_ssl_socket_context_set_server_name(struct us_internal_ssl_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options);
+int us_internal_ssl_socket_context_reload_certificate(struct us_internal_ssl_socket_context_t *context, struct us_socket_context_options_t options);
 void us_internal_ssl_socket_context_on_server_name(struct us_internal_ssl_socket_context_t *context, void (*cb)(struct us_internal_ssl_socket_context_t *, const char *));
 
 void *us_internal_ssl_socket_get_native_handle(struct us_internal_ssl_socket_t *s);
+int us_internal_ssl_socket_is_session_reused(struct us_internal_ssl_socket_t *s);
+int us_internal_ssl_socket_is_ktls_send(struct us_internal_ssl_socket_t *s);
 void *us_internal_ssl_socket_context_get_native_handle(struct us_internal_ssl_socket_context_t *context);
 
 struct us_internal_ssl_socket_context_t *us_internal_create_ssl_socket_context(struct us_loop_t *loop,
@@ -164,9 +185,15 @@ void us_internal_ssl_socket_context_on_connect_error(struct us_internal_ssl_sock
 struct us_listen_socket_t *us_internal_ssl_socket_context_listen(struct us_internal_ssl_socket_context_t *context,
     const char *host, int port, int options, int socket_ext_size);
 
+struct us_listen_socket_t *us_internal_ssl_socket_context_listen_unix(struct us_internal_ssl_socket_context_t *context,
+    const char *path, int options, int socket_ext_size);
+
 struct us_internal_ssl_socket_t *us_internal_ssl_socket_context_connect(struct us_internal_ssl_socket_context_t *context,
     const char *host, int port, const char *source_host, int options, int socket_ext_size);
 
+struct us_internal_ssl_socket_t *us_internal_ssl_socket_context_connect_unix(struct us_internal_ssl_socket_context_t *context,
+    const char *path, int options, int socket_ext_size);
+
 int us_internal_ssl_socket_write(struct us_internal_ssl_socket_t *s, const char *data, int length, int msg_more);
 void us_internal_ssl_socket_timeout(struct us_internal_ssl_socket_t *s, unsigned int seconds);
 void *us_internal_ssl_socket_context_ext(struct us_internal_ssl_socket_context_t *s);
@@ -18,19 +18,55 @@
 #ifndef LOOP_DATA_H
 #define LOOP_DATA_H
 
+/* The timer wheel has 4 levels of 64 slots, level N slots span 64^N milliseconds, about 4.6 hours in total.
+ * Later deadlines park in the last slot reachable and are placed again once it comes due. At most 6 slot bits */
+#ifndef LIBUS_WHEEL_LEVELS
+#define LIBUS_WHEEL_LEVELS 4
+#endif
+#ifndef LIBUS_WHEEL_SLOT_BITS
+#define LIBUS_WHEEL_SLOT_BITS 6
+#endif
+#define LIBUS_WHEEL_SLOTS (1 << LIBUS_WHEEL_SLOT_BITS)
+
+/* One pending deadline, embedded in whatever times out (sockets, us_timeout_t) */
+struct us_internal_wheel_entry_t {
+    struct us_internal_wheel_entry_t *prev, *next;
+    void (*cb)(struct us_internal_wheel_entry_t *entry);
+    long long expires;
+    /* Index into slots, -1 when not pending */
+    int slot;
+};
+
+struct us_internal_timer_wheel_t {
+    /* Last millisecond processed, slots are relative to it */
+    long long now;
+    /* Millisecond the loop's wheel timer fires at, 0 when disarmed */
+    long long armed;
+    int num_entries;
+    int advancing;
+    /* One bit per non-empty slot, per level */
+    unsigned long long occupied[LIBUS_WHEEL_LEVELS];
+    struct us_internal_wheel_entry_t *slots[LIBUS_WHEEL_LEVELS * LIBUS_WHEEL_SLOTS];
+};
+
 struct us_internal_loop_data_t {
-    struct us_timer_t *sweep_timer;
+    struct us_timer_t *wheel_timer;
+    struct us_internal_timer_wheel_t wheel;
     struct us_internal_async *wakeup_async;
     int last_write_failed;
     struct us_socket_context_t *head;
-    struct us_socket_context_t *iterator;
     char *recv_buf;
+    /* Bytes read at most per call, without the padding */
+    int recv_buf_length;
     void *ssl_data;
     void (*pre_cb)(struct us_loop_t *);
     void (*post_cb)(struct us_loop_t *);
     struct us_socket_t *closed_head;
     /* We do not care if this flips or not, it doesn't matter */
     long long iteration_nr;
+    /* Busy poll budget and the monotonic time, in microseconds, until which waits don't block */
+    int busy_poll_us;
+    long long busy_poll_until;
 };
 
 #endif // LOOP_DATA_H
@@ -86,6 +86,12 @@ int bsd_would_block();
 // listen both on ipv6 and ipv4
 LIBUS_SOCKET_DESCRIPTOR bsd_create_listen_socket(const char *host, int port, int options);
 
+// return LIBUS_SOCKET_ERROR or the fd that represents a listen socket on a unix domain path,
+// a leading '@' names a socket in the abstract namespace (Linux only)
+LIBUS_SOCKET_DESCRIPTOR bsd_create_listen_socket_unix(const char *path, int options);
+
 LIBUS_SOCKET_DESCRIPTOR bsd_create_connect_socket(const char *host, int port, const char *source_host, int options);
 
+LIBUS_SOCKET_DESCRIPTOR bsd_create_connect_socket_unix(const char *path, int options);
+
 #endif // BSD_H
@@ -18,9 +18,10 @@
 #ifndef LIBUSOCKETS_H
 #define LIBUSOCKETS_H
 
-/* 512kb shared receive buffer */
+/* 512kb shared receive buffer by default, see us_loop_set_recv_buffer_length */
 #define LIBUS_RECV_BUFFER_LENGTH 524288
-/* A timeout granularity of 4 seconds means give or take 4 seconds from set timeout */
+#define LIBUS_RECV_BUFFER_MIN_LENGTH 16384
+/* Unit of us_socket_context_timestamp in seconds, timeouts themselves have millisecond resolution */
 #define LIBUS_TIMEOUT_GRANULARITY 4
 /* 32 byte padding of receive buffer ends */
 #define LIBUS_RECV_BUFFER_PADDING 32
@@ -85,6 +86,24 @@ WIN32_EXPORT void us_timer_set(struct us_timer_t *timer, void (*cb)(struct us_ti
 /* Returns the loop for this timer */
 WIN32_EXPORT struct us_loop_t *us_timer_loop(struct us_timer_t *t);
 
+/* Public interfaces for timeouts */
+
+/* One-shot deadlines on the loop's timer wheel, the one socket timeouts use: millisecond resolution,
+ * O(1) set and cancel, no file descriptor each. Pending timeouts do not keep the loop alive */
+struct us_timeout_t;
+
+WIN32_EXPORT struct us_timeout_t *us_create_timeout(struct us_loop_t *loop, void (*cb)(struct us_timeout_t *t), unsigned int ext_size);
+
+/* Cancels and frees, may be called from its own callback */
+WIN32_EXPORT void us_timeout_close(struct us_timeout_t *t);
+
+/* Fires once in ms milliseconds, replacing any pending deadline. 0 cancels. Loop thread only */
+WIN32_EXPORT void us_timeout_set(struct us_timeout_t *t, unsigned int ms);
+
+WIN32_EXPORT void *us_timeout_ext(struct us_timeout_t *t);
+
+WIN32_EXPORT struct us_loop_t *us_timeout_loop(struct us_timeout_t *t);
+
 /* Public interfaces for contexts */
 
 struct us_socket_context_options_t {
@@ -94,14 +113,22 @@ struct us_socket_context_options_t {
     const char *dh_params_file_name;
     const char *ca_file_name;
     int ssl_prefer_low_memory_usage; /* Todo: rename to prefer_low_memory_usage and apply for TCP as well */
+    int ssl_session_cache_size; /* Sessions kept for resumption, 0 keeps the OpenSSL default, negative disables resumption and tickets */
+    int ssl_session_timeout; /* Seconds a session or ticket can be resumed, 0 keeps the OpenSSL default */
+    int ssl_ktls; /* Linux: after the handshake the kernel encrypts what is sent (kTLS), falls back to OpenSSL when unavailable */
 };
 
-/* Return 15-bit timestamp for this context */
+/* Return 15-bit timestamp, in LIBUS_TIMEOUT_GRANULARITY seconds */
 WIN32_EXPORT unsigned short us_socket_context_timestamp(int ssl, struct us_socket_context_t *context);
 
 /* Adds SNI domain and cert in asn1 format */
 WIN32_EXPORT void us_socket_context_add_server_name(int ssl, struct us_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options);
 WIN32_EXPORT void us_socket_context_remove_server_name(int ssl, struct us_socket_context_t *context, const char *hostname_pattern);
+/* Adds or replaces a SNI context in one step, returns 0 and keeps the previous one if options fail to load */
+WIN32_EXPORT int us_socket_context_set_server_name(int ssl, struct us_socket_context_t *context, const char *hostname_pattern, struct us_socket_context_options_t options);
+/* Replaces certificate and key of new connections, existing ones keep theirs. The key type must stay the same.
+ * Returns 0 and changes nothing on failure */
+WIN32_EXPORT int us_socket_context_reload_certificate(int ssl, struct us_socket_context_t *context, struct us_socket_context_options_t options);
 WIN32_EXPORT void us_socket_context_on_server_name(int ssl, struct us_socket_context_t *context, void (*cb)(struct us_socket_context_t *, const char *hostname));
 
 /* Returns the underlying SSL native handle, such as SSL_CTX or nullptr */
@@ -139,6 +166,11 @@ WIN32_EXPORT void *us_socket_context_ext(int ssl, struct us_socket_context_t *co
 WIN32_EXPORT struct us_listen_socket_t *us_socket_context_listen(int ssl, struct us_socket_context_t *context,
     const char *host, int port, int options, int socket_ext_size);
 
+/* Listen on a unix domain socket path instead, a leading '@' names one in the abstract namespace (Linux only).
+ * Peers have no ip, on_open gets a zero ip length. */
+WIN32_EXPORT struct us_listen_socket_t *us_socket_context_listen_unix(int ssl, struct us_socket_context_t *context,
+    const char *path, int options, int socket_ext_size);
+
 /* listen_socket.c/.h */
 WIN32_EXPORT void us_listen_socket_close(int ssl, struct us_listen_socket_t *ls);
 
@@ -146,6 +178,10 @@ WIN32_EXPORT void us_listen_socket_close(int ssl, struct us_listen_socket_t *ls)
 WIN32_EXPORT struct us_socket_t *us_socket_context_connect(int ssl, struct us_socket_context_t *context,
     const char *host, int port, const char *source_host, int options, int socket_ext_size);
 
+/* Connect to a unix domain socket path, same naming as us_socket_context_listen_unix */
+WIN32_EXPORT struct us_socket_t *us_socket_context_connect_unix(int ssl, struct us_socket_context_t *context,
+    const char *path, int options, int socket_ext_size);
+
 /* Is this socket established? Can be used to check if a connecting socket has fired the on_open event yet.
  * Can also be used to determine if a socket is a listen_socket or not, but you probably know that already. */
 WIN32_EXPORT int us_socket_is_established(int ssl, struct us_socket_t *s);
@@ -191,6 +227,15 @@ WIN32_EXPORT void us_loop_integrate(struct us_loop_t *loop);
 /* Returns the loop iteration number */
 WIN32_EXPORT long long us_loop_iteration_number(struct us_loop_t *loop);
 
+/* Keeps polling without blocking for this many microseconds after the last event, trading CPU for wakeup latency.
+ * 0, the default, always blocks. Loop thread only, ignored by libuv and GCD */
+WIN32_EXPORT void us_loop_set_busy_poll(struct us_loop_t *loop, int microseconds);
+
+/* Bytes read from a socket (decrypted, for SSL) per call into on_data, 0 for LIBUS_RECV_BUFFER_LENGTH.
+ * Loop thread only, not from within a callback. Returns 0 and keeps the current size when out of memory.
+ * The io_uring backend keeps LIBUS_IO_URING_BUFFER_LENGTH for plain sockets */
+WIN32_EXPORT int us_loop_set_recv_buffer_length(struct us_loop_t *loop, int length);
+
 /* Public interfaces for polls */
 
 /* A fallthrough poll does not keep the loop running, it falls through */
@@ -225,15 +270,24 @@ WIN32_EXPORT struct us_poll_t *us_poll_resize(struct us_poll_t *p, struct us_loo
  * In the case of file descriptor, the value of pointer is fd. */
 WIN32_EXPORT void *us_socket_get_native_handle(int ssl, struct us_socket_t *s);
 
+/* Whether the TLS handshake of an SSL socket resumed an earlier session, 0 for non-SSL sockets */
+WIN32_EXPORT int us_socket_is_session_reused(int ssl, struct us_socket_t *s);
+
+/* Whether the kernel encrypts what an SSL socket sends (kTLS), 0 for non-SSL sockets */
+WIN32_EXPORT int us_socket_is_ktls_send(int ssl, struct us_socket_t *s);
+
 /* Write up to length bytes of data. Returns actual bytes written.
  * Will call the on_writable callback of active socket context on failure to write everything off in one go.
  * Set hint msg_more if you have more immediate data to write. */
 WIN32_EXPORT int us_socket_write(int ssl, struct us_socket_t *s, const char *data, int length, int msg_more);
 
-/* Set a low precision, high performance timer on a socket. A socket can only have one single active timer
- * at any given point in time. Will remove any such pre set timer */
+/* Set a high performance timer on a socket, on the loop's timer wheel. A socket can only have one single active timer
+ * at any given point in time. Will remove any such pre set timer, 0 only removes it */
 WIN32_EXPORT void us_socket_timeout(int ssl, struct us_socket_t *s, unsigned int seconds);
 
+/* Same as us_socket_timeout, in milliseconds */
+WIN32_EXPORT void us_socket_timeout_ms(int ssl, struct us_socket_t *s, unsigned int ms);
+
 /* Return the user data extension of this socket */
 WIN32_EXPORT void *us_socket_ext(int ssl, struct us_socket_t *s);
 
@@ -271,7 +325,7 @@ WIN32_EXPORT void us_socket_remote_address(int ssl, struct us_socket_t *s, char
 #endif
 
 /* Decide what eventing system to use by default */
-#if !defined(LIBUS_USE_EPOLL) && !defined(LIBUS_USE_LIBUV) && !defined(LIBUS_USE_GCD) && !defined(LIBUS_USE_KQUEUE)
+#if !defined(LIBUS_USE_EPOLL) && !defined(LIBUS_USE_IO_URING) && !defined(LIBUS_USE_LIBUV) && !defined(LIBUS_USE_GCD) && !defined(LIBUS_USE_KQUEUE)
 #if defined(_WIN32)
 #define LIBUS_USE_LIBUV
 #elif defined(__APPLE__) || defined(__FreeBSD__)
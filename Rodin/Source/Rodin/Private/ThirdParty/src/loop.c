@@ -24,6 +24,15 @@
 #include "libusockets.h"
 #include "internal/internal.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifndef _WIN32
+#include <time.h>
+#endif
 
 #ifdef _WIN32
 #pragma warning(pop)
@@ -32,16 +41,20 @@
 /* The loop has 2 fallthrough polls */
 void us_internal_loop_data_init(struct us_loop_t *loop, void (*wakeup_cb)(struct us_loop_t *loop),
     void (*pre_cb)(struct us_loop_t *loop), void (*post_cb)(struct us_loop_t *loop)) {
-    loop->data.sweep_timer = us_create_timer(loop, 1, 0);
+    loop->data.wheel_timer = us_create_timer(loop, 1, 0);
+    memset(&loop->data.wheel, 0, sizeof(loop->data.wheel));
+    loop->data.wheel.now = us_internal_monotonic_us() / 1000;
+    loop->data.recv_buf_length = LIBUS_RECV_BUFFER_LENGTH;
     loop->data.recv_buf = (char*)malloc(LIBUS_RECV_BUFFER_LENGTH + LIBUS_RECV_BUFFER_PADDING * 2);
     loop->data.ssl_data = 0;
     loop->data.head = 0;
-    loop->data.iterator = 0;
     loop->data.closed_head = 0;
 
     loop->data.pre_cb = pre_cb;
     loop->data.post_cb = post_cb;
     loop->data.iteration_nr = 0;
+    loop->data.busy_poll_us = 0;
+    loop->data.busy_poll_until = 0;
 
     loop->data.wakeup_async = us_internal_create_async(loop, 1, 0);
     us_internal_async_set(loop->data.wakeup_async, (void (*)(struct us_internal_async *)) wakeup_cb);
@@ -54,7 +67,7 @@ void us_internal_loop_data_free(struct us_loop_t *loop) {
 
     free(loop->data.recv_buf);
 
-    us_timer_close(loop->data.sweep_timer);
+    us_timer_close(loop->data.wheel_timer);
     us_internal_async_close(loop->data.wakeup_async);
 }
 
@@ -62,6 +75,58 @@ void us_wakeup_loop(struct us_loop_t *loop) {
     us_internal_async_wakeup(loop->data.wakeup_async);
 }
 
+void us_loop_set_busy_poll(struct us_loop_t *loop, int microseconds) {
+    loop->data.busy_poll_us = microseconds > 0 ? microseconds : 0;
+    loop->data.busy_poll_until = 0;
+}
+
+int us_loop_set_recv_buffer_length(struct us_loop_t *loop, int length) {
+    if (length <= 0) {
+        length = LIBUS_RECV_BUFFER_LENGTH;
+    } else if (length < LIBUS_RECV_BUFFER_MIN_LENGTH) {
+        length = LIBUS_RECV_BUFFER_MIN_LENGTH;
+    }
+
+    char *recv_buf = (char*)malloc(length + LIBUS_RECV_BUFFER_PADDING * 2);
+    if (!recv_buf) {
+        return 0;
+    }
+
+#ifndef LIBUS_NO_SSL
+    if (!us_internal_resize_loop_ssl_data(loop, length)) {
+        free(recv_buf);
+        return 0;
+    }
+#endif
+
+    free(loop->data.recv_buf);
+    loop->data.recv_buf = recv_buf;
+    loop->data.recv_buf_length = length;
+    return 1;
+}
+
+long long us_internal_monotonic_us() {
+#ifndef _WIN32
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#else
+    return (long long) GetTickCount64() * 1000;
+#endif
+}
+
+/* Whether the next wait should only poll: we are within the busy poll budget after the last event */
+int us_internal_loop_busy_polling(struct us_loop_t *loop) {
+    return loop->data.busy_poll_us && us_internal_monotonic_us() < loop->data.busy_poll_until;
+}
+
+/* Called when a wait returned events, the budget starts over */
+void us_internal_loop_busy_poll_extend(struct us_loop_t *loop) {
+    if (loop->data.busy_poll_us) {
+        loop->data.busy_poll_until = us_internal_monotonic_us() + loop->data.busy_poll_us;
+    }
+}
+
 void us_internal_loop_link(struct us_loop_t *loop, struct us_socket_context_t *context) {
     /* Insert this context as the head of loop */
     context->next = loop->data.head;
@@ -89,57 +154,234 @@ void us_internal_loop_unlink(struct us_loop_t *loop, struct us_socket_context_t
     }
 }
 
-/* This functions should never run recursively */
-void us_internal_timer_sweep(struct us_loop_t *loop) {
-    struct us_internal_loop_data_t *loop_data = &loop->data;
-    /* For all socket contexts in this loop */
-    for (loop_data->iterator = loop_data->head; loop_data->iterator; loop_data->iterator = loop_data->iterator->next) {
+/* Timer wheel: O(1) set and cancel, millisecond resolution. The loop's wheel timer is armed for the next slot
+ * that expires or cascades into a lower level, it stays disarmed while nothing is pending */
+static int us_internal_wheel_ctz(unsigned long long bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int) index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
 
-        struct us_socket_context_t *context = loop_data->iterator;
+/* Millisecond at which the wheel next has something to do, meaningless when empty */
+static long long us_internal_wheel_next(struct us_internal_timer_wheel_t *wheel) {
+    long long next = LLONG_MAX;
+    for (int level = 0; level < LIBUS_WHEEL_LEVELS; level++) {
+        unsigned long long occupied = wheel->occupied[level];
+        if (!occupied) {
+            continue;
+        }
 
-        /* Update this context's 15-bit timestamp */
-        context->timestamp = (context->timestamp + 1) & 0x7fff;
+        /* Rotate so that bit 0 is the slot right after the current one, which wraps around last */
+        int shift = level * LIBUS_WHEEL_SLOT_BITS;
+        long long period = wheel->now >> shift;
+        int first = (int) ((period + 1) & (LIBUS_WHEEL_SLOTS - 1));
+        unsigned long long rotated = (occupied >> first) | (occupied << ((LIBUS_WHEEL_SLOTS - first) & (LIBUS_WHEEL_SLOTS - 1)));
 
-        /* Update our 16-bit full timestamp (the needle in the haystack) */
-        unsigned short needle = 0x8000 | context->timestamp;
+        long long at = (period + 1 + us_internal_wheel_ctz(rotated)) << shift;
+        if (at < next) {
+            next = at;
+        }
+    }
+    return next;
+}
 
-        /* Begin at head */
-        struct us_socket_t *s = context->head;
-        while (s) {
-            /* Seek until end or timeout found (tightest loop) */
-            while (1) {
-                /* We only read from 1 random cache line here */
-                if (needle == s->timeout) {
-                    break;
-                }
+static void us_internal_wheel_place(struct us_internal_timer_wheel_t *wheel, struct us_internal_wheel_entry_t *entry) {
+    long long at = entry->expires;
+    long long delta = at - wheel->now;
 
-                /* Did we reach the end without a find? */
-                if ((s = s->next) == 0) {
-                    goto next_context;
-                }
-            }
+    /* Too far out for the last level, come back here when the furthest slot is reached */
+    if (delta >= 1LL << (LIBUS_WHEEL_LEVELS * LIBUS_WHEEL_SLOT_BITS)) {
+        delta = (1LL << (LIBUS_WHEEL_LEVELS * LIBUS_WHEEL_SLOT_BITS)) - 1;
+        at = wheel->now + delta;
+    }
 
-            /* Here we have a timeout to emit (slow path) */
-            s->timeout = 0;
-            context->iterator = s;
+    int level = 0;
+    while (level < LIBUS_WHEEL_LEVELS - 1 && delta >= 1LL << ((level + 1) * LIBUS_WHEEL_SLOT_BITS)) {
+        level++;
+    }
 
-            context->on_socket_timeout(s);
+    int index = (int) ((at >> (level * LIBUS_WHEEL_SLOT_BITS)) & (LIBUS_WHEEL_SLOTS - 1));
+    int slot = level * LIBUS_WHEEL_SLOTS + index;
 
-            /* Check for unlink / link (if the event handler did not modify the chain, we step 1) */
-            if (s == context->iterator) {
-                s = s->next;
-            } else {
-                /* The iterator was changed by event handler */
-                s = context->iterator;
+    entry->slot = slot;
+    entry->prev = 0;
+    entry->next = wheel->slots[slot];
+    if (entry->next) {
+        entry->next->prev = entry;
+    } else {
+        wheel->occupied[level] |= 1ULL << index;
+    }
+    wheel->slots[slot] = entry;
+    wheel->num_entries++;
+}
+
+static void us_internal_wheel_unlink(struct us_internal_timer_wheel_t *wheel, struct us_internal_wheel_entry_t *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        wheel->slots[entry->slot] = entry->next;
+        if (!entry->next) {
+            wheel->occupied[entry->slot / LIBUS_WHEEL_SLOTS] &= ~(1ULL << (entry->slot % LIBUS_WHEEL_SLOTS));
+        }
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    entry->slot = -1;
+    wheel->num_entries--;
+}
+
+static void wheel_timer_cb(struct us_internal_callback_t *cb);
+
+static void us_internal_wheel_arm(struct us_loop_t *loop) {
+    struct us_internal_timer_wheel_t *wheel = &loop->data.wheel;
+    long long next = us_internal_wheel_next(wheel);
+
+    /* Firing early is harmless, so only an earlier deadline needs the timer moved */
+    if (wheel->armed && wheel->armed <= next) {
+        return;
+    }
+    wheel->armed = next;
+
+    long long ms = next - us_internal_monotonic_us() / 1000;
+    us_timer_set(loop->data.wheel_timer, (void (*)(struct us_timer_t *)) wheel_timer_cb, ms < 1 ? 1 : (int) (ms < INT_MAX ? ms : INT_MAX), 0);
+}
+
+void us_internal_wheel_set(struct us_loop_t *loop, struct us_internal_wheel_entry_t *entry, unsigned int ms) {
+    struct us_internal_timer_wheel_t *wheel = &loop->data.wheel;
+
+    if (entry->slot != -1) {
+        us_internal_wheel_unlink(wheel, entry);
+    }
+    if (!ms) {
+        return;
+    }
+
+    long long now = us_internal_monotonic_us() / 1000;
+    if (!wheel->num_entries && !wheel->advancing) {
+        /* Nothing is placed relative to the old time, catch up for free */
+        wheel->now = now;
+    }
+
+    entry->expires = now + ms;
+    us_internal_wheel_place(wheel, entry);
+
+    if (!wheel->advancing) {
+        us_internal_wheel_arm(loop);
+    }
+}
+
+void us_internal_wheel_cancel(struct us_loop_t *loop, struct us_internal_wheel_entry_t *entry) {
+    if (entry->slot != -1) {
+        us_internal_wheel_unlink(&loop->data.wheel, entry);
+    }
+}
+
+/* Expires everything due by now, cascading slots of higher levels as their time comes */
+static void us_internal_wheel_advance(struct us_loop_t *loop, long long now) {
+    struct us_internal_timer_wheel_t *wheel = &loop->data.wheel;
+    wheel->advancing = 1;
+
+    while (wheel->num_entries) {
+        long long at = us_internal_wheel_next(wheel);
+        if (at > now) {
+            break;
+        }
+        wheel->now = at;
+
+        /* Top level first so entries can fall through several levels at once */
+        for (int level = LIBUS_WHEEL_LEVELS - 1; level > 0; level--) {
+            int shift = level * LIBUS_WHEEL_SLOT_BITS;
+            if (at & ((1LL << shift) - 1)) {
+                continue;
+            }
+
+            int slot = level * LIBUS_WHEEL_SLOTS + (int) ((at >> shift) & (LIBUS_WHEEL_SLOTS - 1));
+            struct us_internal_wheel_entry_t *entry = wheel->slots[slot];
+            wheel->slots[slot] = 0;
+            wheel->occupied[level] &= ~(1ULL << (slot % LIBUS_WHEEL_SLOTS));
+
+            while (entry) {
+                struct us_internal_wheel_entry_t *next = entry->next;
+                wheel->num_entries--;
+                us_internal_wheel_place(wheel, entry);
+                entry = next;
             }
         }
-        /* We always store a 0 to context->iterator here since we are no longer iterating this context */
-        next_context:
-        context->iterator = 0;
+
+        /* Callbacks may set or cancel any entry, so always restart from the head */
+        int slot = (int) (at & (LIBUS_WHEEL_SLOTS - 1));
+        struct us_internal_wheel_entry_t *entry;
+        while ((entry = wheel->slots[slot])) {
+            us_internal_wheel_unlink(wheel, entry);
+            entry->cb(entry);
+        }
     }
+
+    if (wheel->now < now) {
+        wheel->now = now;
+    }
+    wheel->advancing = 0;
+}
+
+static void wheel_timer_cb(struct us_internal_callback_t *cb) {
+    struct us_loop_t *loop = cb->loop;
+
+    loop->data.wheel.armed = 0;
+    us_internal_wheel_advance(loop, us_internal_monotonic_us() / 1000);
+
+    if (loop->data.wheel.num_entries) {
+        us_internal_wheel_arm(loop);
+    }
+}
+
+/* Sockets time out through their context */
+static void us_internal_socket_timeout_cb(struct us_internal_wheel_entry_t *entry) {
+    struct us_socket_t *s = (struct us_socket_t *) ((char *) entry - offsetof(struct us_socket_t, timeout));
+    s->context->on_socket_timeout(s);
+}
+
+void us_internal_socket_timeout_init(struct us_socket_t *s) {
+    s->timeout.cb = us_internal_socket_timeout_cb;
+    s->timeout.slot = -1;
+}
+
+static void us_internal_timeout_cb(struct us_internal_wheel_entry_t *entry) {
+    struct us_timeout_t *t = (struct us_timeout_t *) entry;
+    t->cb(t);
+}
+
+struct us_timeout_t *us_create_timeout(struct us_loop_t *loop, void (*cb)(struct us_timeout_t *t), unsigned int ext_size) {
+    struct us_timeout_t *t = (struct us_timeout_t *) malloc(sizeof(struct us_timeout_t) + ext_size);
+    t->entry.cb = us_internal_timeout_cb;
+    t->entry.slot = -1;
+    t->loop = loop;
+    t->cb = cb;
+    return t;
 }
 
-/* Note: Properly takes the linked list and timeout sweep into account */
+void us_timeout_set(struct us_timeout_t *t, unsigned int ms) {
+    us_internal_wheel_set(t->loop, &t->entry, ms);
+}
+
+void us_timeout_close(struct us_timeout_t *t) {
+    us_internal_wheel_cancel(t->loop, &t->entry);
+    free(t);
+}
+
+void *us_timeout_ext(struct us_timeout_t *t) {
+    return t + 1;
+}
+
+struct us_loop_t *us_timeout_loop(struct us_timeout_t *t) {
+    return t->loop;
+}
+
+/* Note: Properly takes the linked list into account */
 void us_internal_free_closed_sockets(struct us_loop_t *loop) {
     /* Free all closed sockets (maybe it is better to reverse order?) */
     if (loop->data.closed_head) {
@@ -152,10 +394,6 @@ void us_internal_free_closed_sockets(struct us_loop_t *loop) {
     }
 }
 
-void sweep_timer_cb(struct us_internal_callback_t *cb) {
-    us_internal_timer_sweep(cb->loop);
-}
-
 long long us_loop_iteration_number(struct us_loop_t *loop) {
     return loop->data.iteration_nr;
 }
@@ -171,6 +409,47 @@ void us_internal_loop_post(struct us_loop_t *loop) {
     loop->data.post_cb(loop);
 }
 
+/* Wraps an accepted fd in a socket of the listen socket's context, shared by polled and completion based accepts */
+void us_internal_accept_socket(struct us_listen_socket_t *listen_socket, LIBUS_SOCKET_DESCRIPTOR client_fd, struct bsd_addr_t *addr) {
+    struct us_poll_t *accepted_p = us_create_poll(us_socket_context(0, &listen_socket->s)->loop, 0, sizeof(struct us_socket_t) - sizeof(struct us_poll_t) + listen_socket->socket_ext_size);
+    us_poll_init(accepted_p, client_fd, POLL_TYPE_SOCKET);
+
+    struct us_socket_t *s = (struct us_socket_t *) accepted_p;
+
+    /* Set before polling, some eventing picks how to read by context */
+    s->context = listen_socket->s.context;
+
+    us_poll_start(accepted_p, listen_socket->s.context->loop, LIBUS_SOCKET_READABLE);
+
+    /* We always use nodelay */
+    bsd_socket_nodelay(client_fd, 1);
+
+    us_internal_socket_context_link(listen_socket->s.context, s);
+
+    listen_socket->s.context->on_open(s, 0, bsd_addr_get_ip(addr), bsd_addr_get_ip_length(addr));
+}
+
+/* Emits the outcome of one read: data, FIN when length is 0, or an error closing the socket when negative */
+struct us_socket_t *us_internal_dispatch_received(struct us_socket_t *s, char *data, int length) {
+    if (length > 0) {
+        s = s->context->on_data(s, data, length);
+    } else if (!length) {
+        if (us_socket_is_shut_down(0, s)) {
+            /* We got FIN back after sending it */
+            /* Todo: We should give "CLEAN SHUTDOWN" as reason here */
+            s = us_socket_close(0, s, 0, NULL);
+        } else {
+            /* We got FIN, so stop polling for readable */
+            us_poll_change(&s->p, us_socket_context(0, s)->loop, us_poll_events(&s->p) & LIBUS_SOCKET_WRITABLE);
+            s = s->context->on_end(s);
+        }
+    } else {
+        /* Todo: decide also here what kind of reason we should give */
+        s = us_socket_close(0, s, 0, NULL);
+    }
+    return s;
+}
+
 void us_internal_dispatch_ready_poll(struct us_poll_t *p, int error, int events) {
     switch (us_internal_poll_type(p)) {
     case POLL_TYPE_CALLBACK: {
@@ -221,20 +500,7 @@ void us_internal_dispatch_ready_poll(struct us_poll_t *p, int error, int events)
                     /* Todo: stop timer if any */
 
                     do {
-                        struct us_poll_t *accepted_p = us_create_poll(us_socket_context(0, &listen_socket->s)->loop, 0, sizeof(struct us_socket_t) - sizeof(struct us_poll_t) + listen_socket->socket_ext_size);
-                        us_poll_init(accepted_p, client_fd, POLL_TYPE_SOCKET);
-                        us_poll_start(accepted_p, listen_socket->s.context->loop, LIBUS_SOCKET_READABLE);
-
-                        struct us_socket_t *s = (struct us_socket_t *) accepted_p;
-
-                        s->context = listen_socket->s.context;
-
-                        /* We always use nodelay */
-                        bsd_socket_nodelay(client_fd, 1);
-
-                        us_internal_socket_context_link(listen_socket->s.context, s);
-
-                        listen_socket->s.context->on_open(s, 0, bsd_addr_get_ip(&addr), bsd_addr_get_ip_length(&addr));
+                        us_internal_accept_socket(listen_socket, client_fd, &addr);
 
                         /* Exit accept loop if listen socket was closed in on_open handler */
                         if (us_socket_is_closed(0, &listen_socket->s)) {
@@ -282,22 +548,9 @@ void us_internal_dispatch_ready_poll(struct us_poll_t *p, int error, int events)
                     break;
                 }
 
-                int length = bsd_recv(us_poll_fd(&s->p), s->context->loop->data.recv_buf + LIBUS_RECV_BUFFER_PADDING, LIBUS_RECV_BUFFER_LENGTH, 0);
-                if (length > 0) {
-                    s = s->context->on_data(s, s->context->loop->data.recv_buf + LIBUS_RECV_BUFFER_PADDING, length);
-                } else if (!length) {
-                    if (us_socket_is_shut_down(0, s)) {
-                        /* We got FIN back after sending it */
-                        /* Todo: We should give "CLEAN SHUTDOWN" as reason here */
-                        s = us_socket_close(0, s, 0, NULL);
-                    } else {
-                        /* We got FIN, so stop polling for readable */
-                        us_poll_change(&s->p, us_socket_context(0, s)->loop, us_poll_events(&s->p) & LIBUS_SOCKET_WRITABLE);
-                        s = s->context->on_end(s);
-                    }
-                } else if (length == LIBUS_SOCKET_ERROR && !bsd_would_block()) {
-                    /* Todo: decide also here what kind of reason we should give */
-                    s = us_socket_close(0, s, 0, NULL);
+                int length = bsd_recv(us_poll_fd(&s->p), s->context->loop->data.recv_buf + LIBUS_RECV_BUFFER_PADDING, s->context->loop->data.recv_buf_length, 0);
+                if (length != LIBUS_SOCKET_ERROR || !bsd_would_block()) {
+                    s = us_internal_dispatch_received(s, s->context->loop->data.recv_buf + LIBUS_RECV_BUFFER_PADDING, length);
                 }
             }
         }
@@ -305,9 +558,12 @@ void us_internal_dispatch_ready_poll(struct us_poll_t *p, int error, int events)
     }
 }
 
-/* Integration only requires the timer to be set up */
+/* Integration only requires the wheel timer to be set up, it is armed on demand */
 void us_loop_integrate(struct us_loop_t *loop) {
-    us_timer_set(loop->data.sweep_timer, (void (*)(struct us_timer_t *)) sweep_timer_cb, LIBUS_TIMEOUT_GRANULARITY * 1000, LIBUS_TIMEOUT_GRANULARITY * 1000);
+    if (loop->data.wheel.num_entries) {
+        loop->data.wheel.armed = 0;
+        us_internal_wheel_arm(loop);
+    }
 }
 
 void *us_loop_ext(struct us_loop_t *loop) {
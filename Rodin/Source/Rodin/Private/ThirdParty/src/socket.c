@@ -61,10 +61,13 @@ struct us_socket_context_t *us_socket_context(int ssl, struct us_socket_t *s) {
 }
 
 void us_socket_timeout(int ssl, struct us_socket_t *s, unsigned int seconds) {
-    if (seconds) {
-        s->timeout = 0x8000 | (s->context->timestamp + (seconds >> 2));
-    } else {
-        s->timeout = 0;
+    us_socket_timeout_ms(ssl, s, seconds * 1000);
+}
+
+void us_socket_timeout_ms(int ssl, struct us_socket_t *s, unsigned int ms) {
+    /* Closed sockets left the wheel for good, they are freed after this iteration */
+    if (!us_socket_is_closed(0, s)) {
+        us_internal_wheel_set(s->context->loop, &s->timeout, ms);
     }
 }
 
@@ -133,6 +136,26 @@ void *us_socket_get_native_handle(int ssl, struct us_socket_t *s) {
     return (void *) (uintptr_t) us_poll_fd((struct us_poll_t *) s);
 }
 
+int us_socket_is_session_reused(int ssl, struct us_socket_t *s) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return us_internal_ssl_socket_is_session_reused((struct us_internal_ssl_socket_t *) s);
+    }
+#endif
+
+    return 0;
+}
+
+int us_socket_is_ktls_send(int ssl, struct us_socket_t *s) {
+#ifndef LIBUS_NO_SSL
+    if (ssl) {
+        return us_internal_ssl_socket_is_ktls_send((struct us_internal_ssl_socket_t *) s);
+    }
+#endif
+
+    return 0;
+}
+
 int us_socket_write(int ssl, struct us_socket_t *s, const char *data, int length, int msg_more) {
 #ifndef LIBUS_NO_SSL
     if (ssl) {
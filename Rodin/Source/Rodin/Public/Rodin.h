@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Containers/Ticker.h"
 
 #if WITH_EDITOR
 #	include "ToolMenus.h"
@@ -33,4 +34,6 @@ private:
 
 private:
 	TSharedPtr<class FUICommandList> PluginCommands;
+
+	FTSTicker::FDelegateHandle StatsTickerHandle;
 };
@@ -8,6 +8,7 @@
 
 class URodinWS;
 class URodinWSServer;
+class UTexture;
 
 UENUM(BlueprintType)
 enum class ERodinTaskStatus : uint8
@@ -68,6 +69,244 @@ enum class ERodinWSServerState : uint8
     Running
 };
 
+UENUM(BlueprintType)
+enum class ERodinImageEncoding : uint8
+{
+    PNG     UMETA(DisplayName = "PNG"),
+
+    JPEG    UMETA(DisplayName = "JPEG")
+};
+
+/** Uncompressed 8-bit BGRA image, as read back from a texture or render target. */
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinImagePixels
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadWrite, Category = "RodinWS|Image")
+    int32 Width = 0;
+
+    UPROPERTY(BlueprintReadWrite, Category = "RodinWS|Image")
+    int32 Height = 0;
+
+    /** Width * Height pixels, row major. */
+    UPROPERTY(BlueprintReadWrite, Category = "RodinWS|Image")
+    TArray<FColor> Pixels;
+};
+
+UENUM(BlueprintType)
+enum class ERodinConditionKind : uint8
+{
+    /** Triangles as GLB. */
+    Mesh    UMETA(DisplayName = "Mesh"),
+
+    /** Centers of the surface voxels as a PLY point cloud. */
+    Voxels  UMETA(DisplayName = "Voxels"),
+
+    /** Surface samples as a PLY point cloud. */
+    Points  UMETA(DisplayName = "Points")
+};
+
+/** How actors are turned into the condition model of a submission. */
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinMeshExportOptions
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export")
+    ERodinConditionKind Kind = ERodinConditionKind::Mesh;
+
+    /** Cells along the longest side of the bounds, at most 1024. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export", meta = (EditCondition = "Kind == ERodinConditionKind::Voxels", ClampMin = "1", ClampMax = "1024"))
+    int32 VoxelResolution = 64;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export", meta = (EditCondition = "Kind == ERodinConditionKind::Points", ClampMin = "1"))
+    int32 PointCount = 16384;
+
+    /** Mesh only. Merge vertices sharing a WeldTolerance sized cell, mesh seams and split normals otherwise duplicate them. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export")
+    bool bWeld = true;
+
+    /** In centimeters. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export", meta = (EditCondition = "bWeld", ClampMin = "0"))
+    float WeldTolerance = 0.1f;
+
+    /** Mesh only. 16-bit positions over the bounds of the export instead of floats. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Export")
+    bool bQuantize = true;
+};
+
+/** Downsizing of submitted images, off by default. */
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinImagePreprocessOptions
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Image")
+    bool bEnabled = false;
+
+    /** Longest edge after downsizing, in pixels. Smaller images are uploaded as they are. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Image", meta = (ClampMin = "64"))
+    int32 MaxEdge = 2048;
+
+    /** JPEG quality of downsized JPEGs. PNGs stay lossless. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Image", meta = (ClampMin = "1", ClampMax = "100"))
+    int32 Quality = 90;
+
+    /** Memory kept for already processed images, keyed by content hash. 0 disables the cache. */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RodinWS|Image", meta = (ClampMin = "0"))
+    int64 CacheBytes = 64 * 1024 * 1024;
+};
+
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinImagePreprocessStats
+{
+    GENERATED_BODY()
+
+    /** Images that went through the preprocessing stage, cache hits excluded. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 Images = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 Resized = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 CacheHits = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 BytesIn = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 BytesOut = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Image")
+    int64 BytesSaved = 0;
+};
+
+/** Bounds of an actor and its attached actors, measured from static, instanced and skeletal mesh components. */
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinActorBounds
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    AActor* Actor = nullptr;
+
+    /** False when the actor is invalid or has no mesh component, the boxes are then empty. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    bool bValid = false;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    int32 Components = 0;
+
+    /** Axis aligned in world space, from the components' current bounds. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    FBox WorldBox = FBox(ForceInit);
+
+    /** Box aligned with the actor's rotation, from the mesh assets' bounds. Location is its center, scale is 1. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    FTransform OrientedTransform;
+
+    /** Half size of the oriented box along the actor's axes. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Bounds")
+    FVector OrientedExtent = FVector::ZeroVector;
+};
+
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinWSOpCodeStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 Messages = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 Bytes = 0;
+};
+
+/**
+ * Snapshot of the runtime counters of a server.
+ * Counters are updated lock-free from the server thread, this is a copy taken at call time.
+ */
+USTRUCT(BlueprintType)
+struct RODIN_API FRodinWSServerStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 ActiveConnections = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 TotalConnections = 0;
+
+    /** Secure servers: connections that completed a TLS handshake. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 TlsHandshakes = 0;
+
+    /** Handshakes that resumed an earlier session instead of a full key exchange. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 ResumedHandshakes = 0;
+
+    /** Connections whose sent data the kernel encrypts (kTLS). */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 KernelTlsSockets = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    TMap<ERodinWSOpCode, FRodinWSOpCodeStats> Received;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    TMap<ERodinWSOpCode, FRodinWSOpCodeStats> Sent;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 Published = 0;
+
+    /** Work items deferred to the server loop and not yet executed. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 DeferQueueDepth = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 BackpressureEvents = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 DroppedMessages = 0;
+
+    /** Progress messages dropped because a newer one for the same task arrived before the next tick. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 CoalescedMessages = 0;
+
+    /** Highest per-socket buffered amount seen after a send, in bytes. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    int64 PeakBufferedAmount = 0;
+
+    /** Bytes put on the wire divided by payload bytes, over the data frames that were sent compressed. 1 when none were. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    float CompressRatio = 1.f;
+
+    /** Frame receipt to game thread delivery. Bucket N counts deliveries in [2^N, 2^(N+1)[ microseconds. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    TArray<int64> LatencyHistogram;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    float LatencyP50Ms = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    float LatencyP99Ms = 0.f;
+
+    /** Work handed to the server thread until it runs there, same buckets as LatencyHistogram. Shows what busy polling saves. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    TArray<int64> WakeupLatencyHistogram;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    float WakeupLatencyP50Ms = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    float WakeupLatencyP99Ms = 0.f;
+
+    /** CPU time used by the server thread since it started. Negative when the platform can't report it. */
+    UPROPERTY(BlueprintReadOnly, Category = "RodinWS|Stats")
+    double ServerThreadCpuSeconds = -1.0;
+};
+
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(
     FOnRodinWSOpened,
@@ -95,6 +334,60 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(
     const FString&, Message
 );
 
+/** Handler for one message type. Message is the JSON text, Type its top-level "type" value. */
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(
+    FOnRodinWSTypedMessage,
+    class URodinWS*, Socket,
+    const FString&, Type,
+    const FString&, Message
+);
+
+/** Native handler for one message type, given the UTF-8 payload as received. */
+DECLARE_DELEGATE_TwoParams(
+    FOnRodinWSTypedMessageNative,
+    class URodinWS*,
+    TArrayView<const uint8>
+);
+
+/** Native counterparts of the server events, broadcast on the game thread without reflection or payload copies. */
+DECLARE_MULTICAST_DELEGATE_OneParam(
+    FOnRodinWSNativeOpened,
+    class URodinWS*
+);
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(
+    FOnRodinWSNativeMessage,
+    class URodinWS*,
+    TConstArrayView<uint8>,
+    ERodinWSOpCode
+);
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(
+    FOnRodinWSNativeText,
+    class URodinWS*,
+    FUtf8StringView
+);
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(
+    FOnRodinWSNativeClosed,
+    class URodinWS*,
+    const int32,
+    const FString&
+);
+
+/**
+ * Called on the server thread for every data frame, with the ID of the socket (see URodinWS::GetSocketId).
+ * Shared-memory connections call it on the transport thread instead.
+ * Returning true consumes the message: it is never sent to the game thread.
+ */
+DECLARE_DELEGATE_RetVal_ThreeParams(
+    bool,
+    FOnRodinWSServerThreadMessage,
+    uint64,
+    TConstArrayView<uint8>,
+    ERodinWSOpCode
+);
+
 DECLARE_DELEGATE_OneParam(
     FOnRodinWSServerListening,
     bool 
@@ -102,6 +395,25 @@ DECLARE_DELEGATE_OneParam(
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnRodinWSServerClosed);
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(
+    FOnRodinTaskTimeout,
+    const FString&, TaskId
+);
+
+/** HostnamePattern is empty for the default certificate. */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(
+    FOnRodinCertificateUpdated,
+    const FString&, HostnamePattern,
+    bool, bSuccess
+);
+
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(
+    FOnRodinSubmitEncoded,
+    bool, loadFileSuccess,
+    const FString&, OutJson,
+    const FString&, taskID
+);
+
 
 DECLARE_DELEGATE_TwoParams(
     FOnRodinWSSubscribed,
@@ -115,6 +427,26 @@ DECLARE_DELEGATE_OneParam(
 );
 
 
+/**
+ * Reference to a URodinWS for one connection. Socket objects are reused for later connections once theirs
+ * closes, code keeping a socket past the event it got it from should keep one of these and go through Get().
+ * Holds no strong reference, so its owner can be destroyed from any thread.
+ */
+struct RODIN_API FRodinWSHandle
+{
+    URodinWS* Object = nullptr;
+    uint32 Generation = 0;
+
+    /** Game thread only, like any access to the object. */
+    bool IsValid() const;
+
+    /** The object while it still stands for the connection this handle was made for, null afterwards. */
+    URodinWS* Get() const
+    {
+        return IsValid() ? Object : nullptr;
+    }
+};
+
 UCLASS(BlueprintType)
 class RODIN_API URodinWS : public UObject
 {
@@ -122,6 +454,10 @@ class RODIN_API URodinWS : public UObject
 private:
     template<bool bSSL>
     friend class TRodinWSProxy;
+    friend class FRodinShmProxy;
+    friend class FRodinWSPool;
+    friend struct FRodinWSHandle;
+    friend class URodinWSServer;
 
 public:
     URodinWS() = default;
@@ -167,8 +503,25 @@ public:
     UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
     UPARAM(DisplayName = "Is Connected") bool IsConnected() const;
 
+    /**
+     * Changes once the connection is closed, after which the object may be reused for another connection.
+     * Keep the generation along with the object and check it still matches before acting on it.
+     */
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
+    UPARAM(DisplayName = "Generation") int64 GetGeneration() const;
+
+    /** Handle to this object for its current connection, see FRodinWSHandle. */
+    FRodinWSHandle GetHandle() const;
+
+    /** Unique per connection, the ID server thread handlers are given. 0 when not connected. */
+    uint64 GetSocketId() const;
+
 private:
     TWeakPtr<class IRodinWSProxy, ESPMode::ThreadSafe> SocketProxy;
+
+    uint32 Generation = 0;
+
+    uint64 SocketId = 0;
 };
 
 UCLASS(BlueprintType)
@@ -198,6 +551,26 @@ public:
     UPROPERTY(BlueprintAssignable, Category = "RodinWS|Server")
     FOnRodinWSServerClosed OnRodinWSServerClosed;
 
+    /** A task armed with SetTaskTimeout didn't finish in time. The status is TIMEOUT when this fires. */
+    UPROPERTY(BlueprintAssignable, Category = "RodinWS|Server")
+    FOnRodinTaskTimeout OnRodinTaskTimeout;
+
+    /** Outcome of ReloadCertificate and SetServerNameCertificate. */
+    UPROPERTY(BlueprintAssignable, Category = "RodinWS|Server")
+    FOnRodinCertificateUpdated OnRodinCertificateUpdated;
+
+    /** Broadcast before the dynamic events. Payloads are only valid during the call. */
+    FOnRodinWSNativeOpened  OnOpenedNative;
+    FOnRodinWSNativeMessage OnMessageNative;
+    FOnRodinWSNativeText    OnTextNative;
+    FOnRodinWSNativeClosed  OnClosedNative;
+
+    /**
+     * Applies to connections opened afterwards, a running server takes it on its own thread. Shared-memory feeders keep
+     * the handler the server started with. Unbind to deliver everything to the game thread.
+     */
+    void SetServerThreadMessageHandler(FOnRodinWSServerThreadMessage Handler);
+
     UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
     static UPARAM(DisplayName = "Create Normal Server") URodinWSServer* CreateRodinWSServer();
 
@@ -217,6 +590,13 @@ public:
     UFUNCTION(BlueprintCallable, Category = "RodinWS|BP")
     static UTexture2D* BP_PreviewImg(FString imgPath);
 
+    /** Applies to every submission made after the call, from files or pixels. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|BP")
+    static void SetImagePreprocessOptions(const FRodinImagePreprocessOptions& Options);
+
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|BP")
+    static FRodinImagePreprocessStats GetImagePreprocessStats();
+
     UFUNCTION(BlueprintCallable,  Category = "RodinWS|Server|BP")
     void ST_SubmitInfo(
         FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
@@ -235,11 +615,54 @@ public:
         float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
         bool& loadFileSuccess, bool& sendSuccess, FString& OutJson, FString& taskID);
 
+    /**
+     * Same as ST_SubmitInfo_Multi, from textures or render targets instead of files.
+     * Pixels are read back on the calling thread, compression, hashing and serialization run on a worker
+     * and OnEncoded is called on the game thread with the fetch_task_return message.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server|BP")
+    void ST_SubmitInfo_Textures(
+        FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+        bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+        FString resolution_mat, FString align_noneMode, TArray<UTexture*> Images, ERodinImageEncoding Encoding,
+        FString polygons, FString modelFilePath, FString voxel_condition_cfg, FString modeGenerationExpansion,
+        float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+        FOnRodinSubmitEncoded OnEncoded);
+
+    /** Same as ST_SubmitInfo_Textures, from raw pixel buffers. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server|BP")
+    void ST_SubmitInfo_Pixels(
+        FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+        bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+        FString resolution_mat, FString align_noneMode, TArray<FRodinImagePixels> Images, ERodinImageEncoding Encoding,
+        FString polygons, FString modelFilePath, FString voxel_condition_cfg, FString modeGenerationExpansion,
+        float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+        FOnRodinSubmitEncoded OnEncoded);
+
+    /**
+     * Same as ST_SubmitInfo_Multi with the static meshes of ConditionActors (the editor selection when empty)
+     * as condition model. Geometry is copied on the calling thread, the mesh, voxel or point export runs on a worker
+     * and OnEncoded is called on the game thread with the fetch_task_return message.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server|BP")
+    void ST_SubmitInfo_Actors(
+        FString mode_controlNet, FString prompt_partMode, FString mode_windowsClick,
+        bool bUseShaded, bool bUsePBR, bool bBypass, bool bTextTo,
+        FString resolution_mat, FString align_noneMode, TArray<FString> ImagePaths,
+        FString polygons, TArray<AActor*> ConditionActors, FRodinMeshExportOptions ExportOptions,
+        FString voxel_condition_cfg, FString modeGenerationExpansion,
+        float height_model, float voxel_condition_weight, float pcd_condition_uncertainty, int quality,
+        FOnRodinSubmitEncoded OnEncoded);
+
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server|BP")
     void ST_MessageParse(FString JsonString, bool& endDownload, FString& modelPath);
     
     UFUNCTION(BlueprintCallable, Category = "RodinWS|BP", meta = (DisplayName = "Get Actor Size"))
     static void BP_actorSize(AActor* TargetActor, float& sizeX, float& sizeY, float& sizeZ);
+
+    /** Bounds of every actor in one call, one result per actor in the same order. Measured in parallel from cached bounds. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|BP", meta = (DisplayName = "Get Actors Bounds"))
+    static void BP_actorsBounds(const TArray<AActor*>& TargetActors, TArray<FRodinActorBounds>& OutBounds);
     
     void ST_Push();
     void ST_Run();
@@ -255,9 +678,14 @@ public:
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
     void StopListening();
 
+    /** Seconds without traffic before a socket is pinged, then closed. 0 disables. Applies on the next Listen. */
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
     void SetIdleTimeout( UPARAM(DisplayName = "Idle Timeout") const int64 InIdleTimeout);
 
+    /** Same as SetIdleTimeout in milliseconds, the server's timer wheel is exact to the millisecond. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetIdleTimeoutMs(const int64 Milliseconds);
+
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
     void SetMaxLifetime(const int64 InMaxLifetime);
 
@@ -279,22 +707,156 @@ public:
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
     void SetCompression(const ERodinWSCompressOptions InCompression);
 
+    /**
+     * Message types of which only the latest per task ("sid") is delivered, once per tick. Other messages keep their order.
+     * Defaults to task_progress, empty delivers every message as it arrives. Applies to sockets opened afterwards.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetCoalescedMessageTypes(const TArray<FString>& Types);
+
+    /**
+     * Sends task traffic only to the sockets following the task, on its topic (GetTaskTopic). On by default,
+     * applies to sockets opened afterwards.
+     * An ST_SubmitInfo* called while a socket's message is handled subscribes that socket to the task.
+     * task_progress and send_model messages are published to the topic of their "sid" by the server thread.
+     * Their sender is skipped, and the editor still receives them.
+     * Other clients, like dashboards or a second editor, opt in with {"type":"subscribe_task","sid":"<id>"}.
+     * A "+" id follows every task, and unsubscribe_task opts out. Those two messages are not delivered.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetTaskTopicRouting(const bool bEnabled);
+
+    /**
+     * Keeps the server loop spinning for this many microseconds after the last event instead of sleeping right away.
+     * Lowers wakeup latency at the cost of server thread CPU, compare both in GetServerStats(). 0 (default) always blocks.
+     * Applies on the next Listen. Ignored on platforms where the loop runs on libuv.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetBusyPoll(const int32 Microseconds);
+
+    /**
+     * Size of the buffer the server loop reads sockets into, decrypted data for secure servers. Larger ones take
+     * big result frames in fewer reads, smaller ones save memory. 512 KB by default, at least 16 KB, 0 for the default.
+     * Applies on the next Listen.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetReceiveBufferSize(const int32 SizeKB = 512);
+
+    /**
+     * Also listens on a Unix domain socket at Path, or only there with bUnixSocketOnly. A leading '@' names a socket
+     * in the abstract namespace (Linux only), otherwise a stale socket file at Path is replaced. Local clients skip
+     * the TCP stack entirely. Empty (default) listens on TCP only. Applies on the next Listen.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetUnixSocket(const FString& Path, const bool bUnixSocketOnly = false);
+
+    /**
+     * Also accepts feeders on the same machine through shared memory (Linux only): they connect to a Unix socket at Path
+     * and exchange messages through two rings of RingSizeMB each (rounded up to a power of 2), without copies through
+     * the kernel. They appear as regular URodinWS with the same events, but can't subscribe to topics.
+     * See FRodinShmClient for the feeder side. Empty (default) disables it. Applies on the next Listen.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetSharedMemoryTransport(const FString& Path, const int32 RingSizeMB = 64);
+
+    /**
+     * Secure servers: lets reconnecting clients resume their TLS session (session cache and tickets) instead of
+     * a full handshake. Enabled by default. CacheSize and TimeoutSeconds, 0 for OpenSSL's defaults (20480 sessions,
+     * 300 s), bound how many sessions are kept and for how long. Sessions don't survive a restart. Applies on the next Listen.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetSessionResumption(const bool bEnabled, const int32 CacheSize = 0, const int32 TimeoutSeconds = 0);
+
+    /**
+     * Secure servers on Linux: once the handshake is done, the kernel encrypts what is sent (kTLS), which brings large
+     * sends close to plaintext throughput. Received data is still decrypted by OpenSSL. Needs the tls kernel module and
+     * an AES-GCM or ChaCha20 cipher, sockets fall back to OpenSSL otherwise: see KernelTlsSockets in GetServerStats().
+     * Disabled by default. Applies on the next Listen.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetKernelTLS(const bool bEnabled);
+
+    /**
+     * Secure servers: replaces the default certificate without a restart. On a running server new handshakes use it as
+     * soon as it is loaded, open connections and their in-flight tasks keep the previous one, resumed sessions stay valid.
+     * A certificate that fails to load leaves the previous one in use, so does one with another key type (RSA, EC...)
+     * while running: that change needs a restart. OnRodinCertificateUpdated tells the outcome.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void ReloadCertificate(const FString& KeyFile, const FString& CertFile, const FString& PassPhrase);
+
+    /**
+     * Secure servers: clients asking for a host name matching HostnamePattern (SNI) get this certificate instead of
+     * the default one. A '*' label matches any one label, as in "*.example.com". Adds or replaces the pattern's
+     * certificate like ReloadCertificate does the default one, and is kept across restarts.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetServerNameCertificate(const FString& HostnamePattern, const FString& KeyFile, const FString& CertFile, const FString& PassPhrase);
+
+    /** Clients asking for HostnamePattern get the default certificate again, open connections are left alone. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void RemoveServerNameCertificate(const FString& HostnamePattern);
+
+    /**
+     * Times the task out if it hasn't finished within Milliseconds: the status becomes TIMEOUT and OnRodinTaskTimeout fires.
+     * Setting it again restarts the countdown, 0 cancels it. Its result arriving cancels it too. Needs a running server.
+     */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void SetTaskTimeout(const FString& TaskId, const int64 Milliseconds);
+
     UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
     void Publish(const FString& Topic, const FString& Message, ERodinWSOpCode OpCode = ERodinWSOpCode::TEXT);
     void Publish(const FString& Topic, FString&& Message, ERodinWSOpCode OpCode = ERodinWSOpCode::TEXT);
     void Publish(FString&& Topic, const FString& Message, ERodinWSOpCode OpCode = ERodinWSOpCode::TEXT);
     void Publish(FString&& Topic, FString&& Message, ERodinWSOpCode OpCode = ERodinWSOpCode::TEXT);
 
+    /** Topic the messages of a task are published to, "task/<TaskId>". */
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
+    static FString GetTaskTopic(const FString& TaskId);
+
+    /** Sends Message to the sockets following the task only, instead of to every client. */
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void PublishToTask(const FString& TaskId, const FString& Message);
+
     UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
     UPARAM(DisplayName = "State") ERodinWSServerState GetServerState() const;
 
+    UFUNCTION(BlueprintCallable, BlueprintPure, Category = "RodinWS|Server")
+    UPARAM(DisplayName = "Stats") FRodinWSServerStats GetServerStats() const;
+
+    /**
+     * Text messages whose top-level "type" has a handler go to that handler instead of OnRodinWSMessage.
+     * The type is found by scanning the message, so unhandled types and native handlers never pay for a JSON parse.
+     * Native handlers take precedence over Blueprint ones for the same type.
+     */
+    void SetMessageHandler(const FName Type, FOnRodinWSTypedMessageNative Handler);
+    void ClearMessageHandler(const FName Type);
+
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void BindMessageType(const FString& Type, FOnRodinWSTypedMessage Handler);
+
+    UFUNCTION(BlueprintCallable, Category = "RodinWS|Server")
+    void UnbindMessageType(const FString& Type);
+
 private:
     void InternalOnServerClosed();
+    void InternalOnTaskTimeout(const FString&);
+    void InternalOnCertificateUpdated(const bool, FString);
     void InternalOnRodinWSOpened(URodinWS*);
     void InternalOnRodinWSMessage(URodinWS*, TArray<uint8>, ERodinWSOpCode);
     void InternalOnRodinWSClosed(URodinWS*, const int32, const FString&);
+    bool DispatchTypedMessage(URodinWS*, const TArray<uint8>&);
+
+    /** Subscribes the socket whose message is being handled to the task, when task routing is on. */
+    void FollowTaskFromHandledSocket(const FString& TaskId);
 
     TSharedPtr<class IRodinWSServerInternal, ESPMode::ThreadSafe> Internal;
+
+    TMap<FName, FOnRodinWSTypedMessageNative> NativeMessageHandlers;
+    TMap<FName, FOnRodinWSTypedMessage> MessageHandlers;
+
+    /** Sender of the message being delivered, null outside of message events. */
+    URodinWS* HandledSocket = nullptr;
     
     ERodinTaskStatus Status;
 };
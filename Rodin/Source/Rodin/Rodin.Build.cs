@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 using UnrealBuildTool;
+using System;
 using System.IO;
 
 public class Rodin : ModuleRules
@@ -89,5 +90,11 @@ public class Rodin : ModuleRules
         PrivateIncludePaths.Add(Path.Combine(uWebSocketsRootDir, "includes"));
 
         PublicDefinitions.Add("WITH_WEBSOCKET_SERVER=1");
+
+        // Opt-in io_uring eventing for the embedded uSockets, needs Linux 5.19 at runtime. Linux builds use epoll otherwise.
+        if (Target.Platform == UnrealTargetPlatform.Linux && Environment.GetEnvironmentVariable("RODIN_USE_IO_URING") == "1")
+        {
+            PrivateDefinitions.Add("LIBUS_USE_IO_URING=1");
+        }
     }
 }
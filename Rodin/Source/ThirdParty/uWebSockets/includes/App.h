@@ -37,6 +37,9 @@ namespace uWS {
         const char *dh_params_file_name = nullptr;
         const char *ca_file_name = nullptr;
         int ssl_prefer_low_memory_usage = 0;
+        int ssl_session_cache_size = 0;
+        int ssl_session_timeout = 0;
+        int ssl_ktls = 0;
 
         /* Conversion operator used internally */
         operator struct us_socket_context_options_t() const {
@@ -70,6 +73,18 @@ public:
         return std::move(*this);
     }
 
+    /* Adds or replaces the certificate of a server name, false keeps the previous one */
+    bool setServerName(std::string hostname_pattern, SocketContextOptions options = {}) {
+
+        return us_socket_context_set_server_name(SSL, (struct us_socket_context_t *) httpContext, hostname_pattern.c_str(), options);
+    }
+
+    /* Replaces the default certificate for new connections, false keeps the previous one */
+    bool reloadCertificate(SocketContextOptions options) {
+
+        return us_socket_context_reload_certificate(SSL, (struct us_socket_context_t *) httpContext, options);
+    }
+
     TemplatedApp &&missingServerName(MoveOnlyFunction<void(const char *hostname)> handler) {
 
         if (!constructorFailed()) {
@@ -153,6 +168,8 @@ public:
         unsigned int maxPayloadLength = 16 * 1024;
         /* 2 minutes timeout is good */
         unsigned short idleTimeout = 120;
+        /* Same in milliseconds, used instead of idleTimeout when not 0 */
+        unsigned int idleTimeoutMs = 0;
         /* 64kb backpressure is probably good */
         unsigned int maxBackpressure = 64 * 1024;
         bool closeOnBackpressureLimit = false;
@@ -181,16 +198,6 @@ public:
             return std::move(*this);
         }
 
-        /* Terminate on misleading idleTimeout values */
-        if (behavior.idleTimeout && behavior.idleTimeout < 8) {
-            std::cerr << "Error: idleTimeout must be either 0 or greater than 8!" << std::endl;
-            std::terminate();
-        }
-
-        if (behavior.idleTimeout % 4) {
-            std::cerr << "Warning: idleTimeout should be a multiple of 4!" << std::endl;
-        }
-
         /* Every route has its own websocket context with its own behavior and user data type */
         auto *webSocketContext = WebSocketContext<SSL, true, UserData>::create(Loop::get(), (us_socket_context_t *) httpContext);
 
@@ -238,7 +245,7 @@ public:
         webSocketContext->getExt()->compression = behavior.compression;
 
         /* Calculate idleTimeoutCompnents */
-        webSocketContext->getExt()->calculateIdleTimeoutCompnents(behavior.idleTimeout);
+        webSocketContext->getExt()->calculateIdleTimeoutCompnents(behavior.idleTimeoutMs ? behavior.idleTimeoutMs : behavior.idleTimeout * 1000u);
 
         httpContext->onHttp("get", pattern, [webSocketContext, behavior = std::move(behavior)](auto *res, auto *req) mutable {
 
@@ -370,6 +377,18 @@ public:
         return std::move(*this);
     }
 
+    /* Unix domain socket path, callback */
+    TemplatedApp &&listen_unix(std::string path, MoveOnlyFunction<void(us_listen_socket_t *)> &&handler) {
+        handler(httpContext ? httpContext->listen_unix(path.c_str(), 0) : nullptr);
+        return std::move(*this);
+    }
+
+    /* Unix domain socket path, options, callback */
+    TemplatedApp &&listen_unix(std::string path, int options, MoveOnlyFunction<void(us_listen_socket_t *)> &&handler) {
+        handler(httpContext ? httpContext->listen_unix(path.c_str(), options) : nullptr);
+        return std::move(*this);
+    }
+
     TemplatedApp &&run() {
         uWS::run();
         return std::move(*this);
@@ -59,6 +59,10 @@ protected:
         us_socket_timeout(SSL, (us_socket_t *) this, seconds);
     }
 
+    void timeoutMs(unsigned int ms) {
+        us_socket_timeout_ms(SSL, (us_socket_t *) this, ms);
+    }
+
     /* Shutdown socket without any automatic drainage */
     void shutdown() {
         us_socket_shutdown(SSL, (us_socket_t *) this);
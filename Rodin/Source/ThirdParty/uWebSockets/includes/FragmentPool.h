@@ -0,0 +1,174 @@
+/*
+ * Authored by Alex Hultman, 2018-2020.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UWS_FRAGMENTPOOL_H
+#define UWS_FRAGMENTPOOL_H
+
+/* Fragmented and partially received messages are reassembled in buffers taken from
+ * power of two size classes of the loop, and given back once dispatched */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace uWS {
+
+struct FragmentPool {
+    /* Classes go from 4 KB to 64 MB, larger buffers are allocated exactly and never kept */
+    static const unsigned int MIN_CLASS_SHIFT = 12;
+    static const unsigned int NUM_CLASSES = 15;
+
+    /* Free buffers kept over all classes, what goes beyond is freed */
+    static const size_t MAX_CACHED_BYTES = 64 * 1024 * 1024;
+
+private:
+    std::vector<char *> freeLists[NUM_CLASSES];
+    size_t cachedBytes = 0;
+
+    static size_t classCapacity(unsigned int sizeClass) {
+        return (size_t) 1 << (MIN_CLASS_SHIFT + sizeClass);
+    }
+
+    /* Smallest class holding length bytes, NUM_CLASSES if none does */
+    static unsigned int classOf(size_t length) {
+        unsigned int sizeClass = 0;
+        while (sizeClass < NUM_CLASSES && classCapacity(sizeClass) < length) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+
+public:
+    FragmentPool() = default;
+    FragmentPool(const FragmentPool &) = delete;
+
+    ~FragmentPool() {
+        for (std::vector<char *> &freeList : freeLists) {
+            for (char *buffer : freeList) {
+                free(buffer);
+            }
+        }
+    }
+
+    /* Returns a buffer of at least length bytes and sets its capacity, nullptr when out of memory */
+    char *acquire(size_t length, size_t &capacity) {
+        unsigned int sizeClass = classOf(length);
+        if (sizeClass == NUM_CLASSES) {
+            capacity = length;
+            return (char *) malloc(length);
+        }
+
+        capacity = classCapacity(sizeClass);
+        if (!freeLists[sizeClass].empty()) {
+            char *buffer = freeLists[sizeClass].back();
+            freeLists[sizeClass].pop_back();
+            cachedBytes -= capacity;
+            return buffer;
+        }
+        return (char *) malloc(capacity);
+    }
+
+    /* Takes back a buffer acquire returned along with its capacity */
+    void release(char *buffer, size_t capacity) {
+        unsigned int sizeClass = classOf(capacity);
+        if (sizeClass == NUM_CLASSES || classCapacity(sizeClass) != capacity || cachedBytes + capacity > MAX_CACHED_BYTES) {
+            free(buffer);
+            return;
+        }
+
+        freeLists[sizeClass].push_back(buffer);
+        cachedBytes += capacity;
+    }
+};
+
+/* Byte buffer of one socket whose memory comes from the loop's FragmentPool */
+struct FragmentBuffer {
+private:
+    FragmentPool *pool = nullptr;
+    char *buffer = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    void releaseBuffer() {
+        if (buffer) {
+            pool->release(buffer, capacity);
+            buffer = nullptr;
+            capacity = 0;
+        }
+    }
+
+public:
+    FragmentBuffer() = default;
+    FragmentBuffer(const FragmentBuffer &) = delete;
+
+    ~FragmentBuffer() {
+        releaseBuffer();
+    }
+
+    size_t length() const {
+        return size;
+    }
+
+    char *data() {
+        return buffer;
+    }
+
+    /* Makes room for length bytes in total, moving what we hold to a larger buffer. False when out of memory */
+    bool reserve(FragmentPool *fragmentPool, size_t length) {
+        if (length <= capacity) {
+            return true;
+        }
+
+        size_t newCapacity;
+        char *newBuffer = fragmentPool->acquire(length, newCapacity);
+        if (!newBuffer) {
+            return false;
+        }
+
+        if (size) {
+            memcpy(newBuffer, buffer, size);
+        }
+        releaseBuffer();
+
+        pool = fragmentPool;
+        buffer = newBuffer;
+        capacity = newCapacity;
+        return true;
+    }
+
+    /* Room must have been reserved */
+    void append(const char *data, size_t length) {
+        memcpy(buffer + size, data, length);
+        size += length;
+    }
+
+    /* Shrinks only, the buffer goes back to the pool once empty */
+    void resize(size_t length) {
+        size = length;
+        if (!size) {
+            releaseBuffer();
+        }
+    }
+
+    void clear() {
+        resize(0);
+    }
+};
+
+}
+
+#endif // UWS_FRAGMENTPOOL_H
@@ -25,6 +25,7 @@
 #include <map>
 
 #include "PerMessageDeflate.h"
+#include "FragmentPool.h"
 
 #include "MoveOnlyFunction.h"
 
@@ -68,6 +69,9 @@ public:
     ZlibContext *zlibContext = nullptr;
     InflationStream *inflationStream = nullptr;
     DeflationStream *deflationStream = nullptr;
+
+    /* Reassembly buffers of fragmented messages */
+    FragmentPool fragmentPool;
 };
 
 }
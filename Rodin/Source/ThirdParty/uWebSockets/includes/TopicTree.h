@@ -18,15 +18,18 @@
 #ifndef UWS_TOPICTREE_H
 #define UWS_TOPICTREE_H
 
-#include <iostream>
+/* Topics are kept flat: every node lives in one open addressing index keyed by {parent, segment},
+ * subscribers of a topic are a sorted array and everything published between two drains is
+ * appended once to a shared batch. Once warmed up, publishing and draining allocate nothing */
+
+#include <algorithm>
 #include <vector>
-#include <map>
+#include <deque>
+#include <string>
 #include <string_view>
-#include <functional>
-#include <set>
-#include <chrono>
-#include <list>
 #include <cstring>
+#include <cstdint>
+#include <climits>
 
 /* We use std::function here, not MoveOnlyFunction */
 #include <functional>
@@ -35,25 +38,23 @@ namespace uWS {
 
 /* A Subscriber is an extension of a socket */
 struct Subscriber {
-    std::list<struct Topic *> subscriptions;
+    /* Subscribers are likely to have very few subscriptions (20 or fewer) */
+    std::vector<struct Topic *> subscriptions;
     void *user;
 
     Subscriber(void *user) : user(user) {}
 };
 
 struct Topic {
-    /* Memory for our name */
-    char *name;
-    size_t length;
-
     /* Our parent or nullptr */
     Topic *parent = nullptr;
 
-    /* Next triggered Topic */
-    bool triggered = false;
+    /* Full name is used when iterating topics, our own segment is its last length bytes */
+    std::string fullName;
+    size_t length = 0;
 
-    /* Exact string matches */
-    std::map<std::string_view, Topic *> children;
+    /* Exact and wildcard children, they are found through the tree's index */
+    unsigned int numChildren = 0;
 
     /* Wildcard child */
     Topic *wildcardChild = nullptr;
@@ -61,16 +62,25 @@ struct Topic {
     /* Terminating wildcard child */
     Topic *terminatingWildcardChild = nullptr;
 
-    /* What we published, {inflated, deflated} */
-    std::map<unsigned int, std::pair<std::string, std::string>> messages;
-
-    std::set<Subscriber *> subs;
+    /* Next triggered Topic */
+    bool triggered = false;
 
     /* Locked or not, used only when iterating over a Subscriber's topics */
     bool locked = false;
 
-    /* Full name is used when iterating topcis */
-    std::string fullName;
+    /* Ids of the batched messages published to us since the last drain, ascending */
+    std::vector<unsigned int> messageIds;
+
+    /* Sorted by address */
+    std::vector<Subscriber *> subs;
+
+    std::string_view name() const {
+        return std::string_view(fullName).substr(fullName.length() - length);
+    }
+
+    bool hasSubscriber(Subscriber *subscriber) const {
+        return std::binary_search(subs.begin(), subs.end(), subscriber, std::less<Subscriber *>());
+    }
 };
 
 struct Hole {
@@ -78,11 +88,30 @@ struct Hole {
     unsigned int messageId;
 };
 
+/* Ascending ids of the messages one subscriber published itself during the batch */
+struct SenderHoles {
+    const unsigned int *first = nullptr;
+    const unsigned int *last = nullptr;
+
+    const unsigned int *begin() const {
+        return first;
+    }
+
+    const unsigned int *end() const {
+        return last;
+    }
+};
+
 struct Intersection {
-    std::pair<std::string, std::string> dataChannels;
+    /* {inflated, deflated}, views into the batch or into storage */
+    std::pair<std::string_view, std::string_view> dataChannels;
     std::vector<Hole> holes;
 
-    void forSubscriber(std::vector<unsigned int> &senderForMessages, std::function<void(std::pair<std::string_view, std::string_view>, bool)> cb) {
+    /* Copy of the messages when they are not next to each other in the batch, kept between drains */
+    std::pair<std::string, std::string> storage;
+
+    template <typename F>
+    void forSubscriber(SenderHoles senderForMessages, F &&cb) {
         /* How far we already emitted of the two dataChannels */
         std::pair<size_t, size_t> emitted = {};
 
@@ -90,26 +119,28 @@ struct Intersection {
          * holes in this intersection - they are sorted, though */
         unsigned int examinedHoles = 0;
 
+        /* Messages of others since the last segment, emitted along with the next skipped one */
+        std::pair<size_t, size_t> toEmit = {};
+
         /* This is a slow path of sorts, most subscribers will be observers, not active senders */
         for (unsigned int id : senderForMessages) {
-            std::pair<size_t, size_t> toEmit = {};
-            std::pair<size_t, size_t> toIgnore = {};
-
             /* This linear search is most probably very small - it could be made log2 if every hole
              * knows about its previous accumulated length, which is easy to set up. However this
              * log2 search will most likely never be a warranted perf. gain */
-            for (; examinedHoles < holes.size(); examinedHoles++) {
-                if (holes[examinedHoles].messageId == id) {
-                    toIgnore.first += holes[examinedHoles].lengths.first;
-                    toIgnore.second += holes[examinedHoles].lengths.second;
-                    examinedHoles++;
-                    break;
-                }
-                /* We are not the sender of this message so we should emit it in this segment */
+            for (; examinedHoles < holes.size() && holes[examinedHoles].messageId < id; examinedHoles++) {
+                /* We are not the sender of this message so we should emit it */
                 toEmit.first += holes[examinedHoles].lengths.first;
                 toEmit.second += holes[examinedHoles].lengths.second;
             }
 
+            /* The sender's message went to other topics only, nothing to skip here */
+            if (examinedHoles == holes.size() || holes[examinedHoles].messageId != id) {
+                continue;
+            }
+
+            std::pair<size_t, size_t> toIgnore = holes[examinedHoles].lengths;
+            examinedHoles++;
+
             /* Emit this segment */
             if (toEmit.first || toEmit.second) {
                 std::pair<std::string_view, std::string_view> cutDataChannels = {
@@ -123,6 +154,7 @@ struct Intersection {
 
             emitted.first += toEmit.first + toIgnore.first;
             emitted.second += toEmit.second + toIgnore.second;
+            toEmit = {};
         }
 
         if (emitted.first == dataChannels.first.length() && emitted.second == dataChannels.second.length()) {
@@ -138,76 +170,177 @@ struct Intersection {
     }
 };
 
-struct TopicTree {
+/* Open addressing index of every Topic by {parent, segment}, the edges of the tree */
+struct TopicIndex {
 private:
-    std::function<int(Subscriber *, Intersection &)> cb;
+    struct Slot {
+        size_t hash;
+        Topic *topic;
+    };
+
+    /* Power of two sized, linear probing, at most half full */
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    static size_t hashOf(const Topic *parent, std::string_view segment) {
+        /* FNV-1a over the segment, seeded by the parent */
+        uint64_t hash = 14695981039346656037ull ^ ((uint64_t) (uintptr_t) parent * 0x9E3779B97F4A7C15ull);
+        for (unsigned char c : segment) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return (size_t) (hash ^ (hash >> 32));
+    }
 
-    Topic *root = new Topic;
+    void place(Slot slot) {
+        size_t mask = slots.size() - 1;
+        size_t i = slot.hash & mask;
+        while (slots[i].topic) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
 
-    /* Global messageId for deduplication of overlapping topics and ordering between topics */
-    unsigned int messageId = 0;
+    void grow() {
+        std::vector<Slot> old(std::max<size_t>(16, slots.size() * 2), Slot{0, nullptr});
+        old.swap(slots);
+        for (Slot &slot : old) {
+            if (slot.topic) {
+                place(slot);
+            }
+        }
+    }
 
-    /* Sender holes */
-    std::map<Subscriber *, std::vector<unsigned int>> senderHoles;
+public:
+    Topic *find(const Topic *parent, std::string_view segment) const {
+        if (!count) {
+            return nullptr;
+        }
 
-    /* The triggered topics */
-    Topic *triggeredTopics[64];
-    int numTriggeredTopics = 0;
-    Subscriber *min = (Subscriber *) UINTPTR_MAX;
+        size_t hash = hashOf(parent, segment);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; slots[i].topic; i = (i + 1) & mask) {
+            if (slots[i].hash == hash && slots[i].topic->parent == parent && slots[i].topic->name() == segment) {
+                return slots[i].topic;
+            }
+        }
+        return nullptr;
+    }
 
-    /* Returns Topic, or nullptr. Topic can be root if empty string given. */
-    Topic *lookupTopic(std::string_view topic) {
-        /* Lookup exact Topic ptr from string */
-        Topic *iterator = root;
-        for (size_t start = 0, stop = 0; stop != std::string::npos; start = stop + 1) {
-            stop = topic.find('/', start);
-            std::string_view segment = topic.substr(start, stop - start);
+    /* The topic must have its parent and name set, and not be indexed already */
+    void insert(Topic *topic) {
+        if ((count + 1) * 2 > slots.size()) {
+            grow();
+        }
+        place({hashOf(topic->parent, topic->name()), topic});
+        count++;
+    }
 
-            std::map<std::string_view, Topic *>::iterator it = iterator->children.find(segment);
-            if (it == iterator->children.end()) {
-                /* This topic does not even exist */
-                return nullptr;
+    void erase(Topic *topic) {
+        size_t mask = slots.size() - 1;
+        size_t i = hashOf(topic->parent, topic->name()) & mask;
+        while (slots[i].topic != topic) {
+            if (!slots[i].topic) {
+                return;
             }
+            i = (i + 1) & mask;
+        }
 
-            iterator = it->second;
+        /* Shift following entries back so that probing never meets a hole in their run */
+        slots[i].topic = nullptr;
+        count--;
+        for (size_t j = (i + 1) & mask; slots[j].topic; j = (j + 1) & mask) {
+            size_t home = slots[j].hash & mask;
+            bool inPlace = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!inPlace) {
+                slots[i] = slots[j];
+                slots[j].topic = nullptr;
+                i = j;
+            }
         }
+    }
 
-        return iterator;
+    template <typename F>
+    void forEach(F &&cb) {
+        for (Slot &slot : slots) {
+            if (slot.topic) {
+                cb(slot.topic);
+            }
+        }
     }
+};
+
+struct TopicTree {
+private:
+    /* Batches larger than this are freed after their drain instead of being kept for the next one */
+    static const size_t MAX_RETAINED_BATCH_BYTES = 4 * 1024 * 1024;
+
+    std::function<int(Subscriber *, Intersection &)> cb;
+
+    Topic *root = new Topic;
+
+    /* Every Topic but the root */
+    TopicIndex index;
+
+    /* Everything published since the last drain, appended once however many topics it matched.
+     * A message id is its position in messages, which gives deduplication and ordering between topics */
+    struct BatchedMessage {
+        std::pair<size_t, size_t> offsets;
+        std::pair<size_t, size_t> lengths;
+    };
+    std::pair<std::string, std::string> batch;
+    std::vector<BatchedMessage> messages;
+
+    /* The message being published, only batched once it matches a topic */
+    std::pair<std::string_view, std::string_view> publishing;
+    Subscriber *publishingSender = nullptr;
+    bool publishingBatched = false;
+
+    /* Sender holes {sender, messageId}, sorted by sender when draining */
+    std::vector<std::pair<Subscriber *, unsigned int>> senderHoles;
+    std::vector<unsigned int> senderHoleIds;
+    Subscriber *draining = nullptr;
+    SenderHoles drainingHoles;
+
+    /* Subscribers of the triggered topics with the index of their topic, sorted when draining */
+    std::vector<std::pair<Subscriber *, int>> drainOrder;
+
+    /* The triggered topics */
+    Topic *triggeredTopics[64];
+    int numTriggeredTopics = 0;
+
+    /* Intersections of the ongoing drain by bitmask of triggered topics, their memory is reused.
+     * A deque since handed out intersections may view into their own storage and must not move */
+    std::deque<Intersection> intersections;
+    std::vector<uint64_t> intersectionMasks;
+    std::vector<std::pair<uint64_t, unsigned int>> intersectionSlots;
+    unsigned int numIntersections = 0;
 
     /* Cull or trim unused Topic nodes from leaf to root */
     void trimTree(Topic *topic) {
-        while (!topic->subs.size() && !topic->children.size() && !topic->terminatingWildcardChild && !topic->wildcardChild) {
+        while (!topic->subs.size() && !topic->numChildren) {
             Topic *parent = topic->parent;
 
-            if (topic->length == 1) {
-                if (topic->name[0] == '#') {
-                    parent->terminatingWildcardChild = nullptr;
-                } else if (topic->name[0] == '+') {
-                    parent->wildcardChild = nullptr;
-                }
+            if (parent->terminatingWildcardChild == topic) {
+                parent->terminatingWildcardChild = nullptr;
+            } else if (parent->wildcardChild == topic) {
+                parent->wildcardChild = nullptr;
             }
-            /* Erase us from our parents set (wildcards also live here) */
-            parent->children.erase(std::string_view(topic->name, topic->length));
+            /* Erase us from the index (wildcards also live here) */
+            index.erase(topic);
+            parent->numChildren--;
 
             /* If this node is triggered, make sure to remove it from the triggered list */
             if (topic->triggered) {
-                Topic *tmp[64];
                 int length = 0;
                 for (int i = 0; i < numTriggeredTopics; i++) {
                     if (triggeredTopics[i] != topic) {
-                        tmp[length++] = triggeredTopics[i];
+                        triggeredTopics[length++] = triggeredTopics[i];
                     }
                 }
-
-                for (int i = 0; i < length; i++) {
-                    triggeredTopics[i] = tmp[i];
-                }
                 numTriggeredTopics = length;
             }
 
-            /* Free various memory for the node */
-            delete [] topic->name;
             delete topic;
 
             if (parent == root) {
@@ -218,8 +351,42 @@ private:
         }
     }
 
+    /* Adds the message being published to this topic */
+    void trigger(Topic *topic) {
+        /* Add this topic to triggered */
+        if (!topic->triggered) {
+            /* If we already have 64 triggered topics make sure to drain it here */
+            if (numTriggeredTopics == 64) {
+                drain();
+            }
+
+            triggeredTopics[numTriggeredTopics++] = topic;
+            topic->triggered = true;
+        }
+
+        /* Batch the message on its first match */
+        if (!publishingBatched) {
+            unsigned int messageId = (unsigned int) messages.size();
+            messages.push_back({{batch.first.length(), batch.second.length()}, {publishing.first.length(), publishing.second.length()}});
+            batch.first.append(publishing.first);
+            batch.second.append(publishing.second);
+
+            /* Add a hole for the sender if one */
+            if (publishingSender) {
+                senderHoles.push_back({publishingSender, messageId});
+            }
+            publishingBatched = true;
+        }
+
+        /* Overlapping wildcards may match the same topic twice */
+        unsigned int messageId = (unsigned int) messages.size() - 1;
+        if (topic->messageIds.empty() || topic->messageIds.back() != messageId) {
+            topic->messageIds.push_back(messageId);
+        }
+    }
+
     /* Publishes to all matching topics and wildcards. Returns whether at least one topic was a match. */
-    bool publish(Topic *iterator, size_t start, size_t stop, std::string_view topic, std::pair<std::string_view, std::string_view> message) {
+    bool publish(Topic *iterator, size_t start, size_t stop, std::string_view topic) {
 
         /* Whether we matched with at least one topic */
         bool didMatch = false;
@@ -243,52 +410,149 @@ private:
 
             /* Do we have a terminating wildcard child? */
             if (iterator->terminatingWildcardChild) {
-                iterator->terminatingWildcardChild->messages[messageId] = message;
-
-                /* Add this topic to triggered */
-                if (!iterator->terminatingWildcardChild->triggered) {
-                    /* If we already have 64 triggered topics make sure to drain it here */
-                    if (numTriggeredTopics == 64) {
-                        drain();
-                    }
-
-                    triggeredTopics[numTriggeredTopics++] = iterator->terminatingWildcardChild;
-                    iterator->terminatingWildcardChild->triggered = true;
-                }
-
+                trigger(iterator->terminatingWildcardChild);
                 didMatch = true;
             }
 
             /* Do we have a wildcard child? */
             if (iterator->wildcardChild) {
-                didMatch |= publish(iterator->wildcardChild, stop + 1, stop, topic, message);
+                didMatch |= publish(iterator->wildcardChild, stop + 1, stop, topic);
             }
 
-            std::map<std::string_view, Topic *>::iterator it = iterator->children.find(segment);
-            if (it == iterator->children.end()) {
+            Topic *child = index.find(iterator, segment);
+            if (!child) {
                 /* Stop trying to match by exact string */
                 return didMatch;
             }
 
-            iterator = it->second;
+            iterator = child;
         }
 
         /* If we went all the way we matched exactly */
-        iterator->messages[messageId] = message;
+        trigger(iterator);
 
-        /* Add this topic to triggered */
-        if (!iterator->triggered) {
-            /* If we already have 64 triggered topics make sure to drain it here */
-            if (numTriggeredTopics == 64) {
-                drain();
+        /* We obviously matches exactly here */
+        return true;
+    }
+
+    /* Returns the cached union of the triggered topics in mask, building it on first use */
+    Intersection &intersectionFor(uint64_t mask) {
+        if ((numIntersections + 1) * 2 > intersectionSlots.size()) {
+            intersectionSlots.assign(std::max<size_t>(16, intersectionSlots.size() * 2), {0, 0});
+            for (unsigned int i = 0; i < numIntersections; i++) {
+                placeIntersection(intersectionMasks[i], i);
             }
+        }
 
-            triggeredTopics[numTriggeredTopics++] = iterator;
-            iterator->triggered = true;
+        size_t slotMask = intersectionSlots.size() - 1;
+        size_t i = (size_t) ((mask * 0x9E3779B97F4A7C15ull) >> 32) & slotMask;
+        for (; intersectionSlots[i].first; i = (i + 1) & slotMask) {
+            if (intersectionSlots[i].first == mask) {
+                return intersections[intersectionSlots[i].second];
+            }
         }
 
-        /* We obviously matches exactly here */
-        return true;
+        if (numIntersections == intersections.size()) {
+            intersections.emplace_back();
+            intersectionMasks.push_back(0);
+        }
+        Intersection &intersection = intersections[numIntersections];
+        buildIntersection(intersection, mask);
+        intersectionMasks[numIntersections] = mask;
+        intersectionSlots[i] = {mask, numIntersections++};
+        return intersection;
+    }
+
+    void placeIntersection(uint64_t mask, unsigned int position) {
+        size_t slotMask = intersectionSlots.size() - 1;
+        size_t i = (size_t) ((mask * 0x9E3779B97F4A7C15ull) >> 32) & slotMask;
+        while (intersectionSlots[i].first) {
+            i = (i + 1) & slotMask;
+        }
+        intersectionSlots[i] = {mask, position};
+    }
+
+    /* Merges the ascending message ids of the topics in mask without duplicates */
+    void buildIntersection(Intersection &intersection, uint64_t mask) {
+        const unsigned int *cursors[64], *ends[64];
+        int numCursors = 0;
+        for (int i = 0; i < numTriggeredTopics; i++) {
+            if (mask & ((uint64_t) 1 << i)) {
+                cursors[numCursors] = triggeredTopics[i]->messageIds.data();
+                ends[numCursors++] = triggeredTopics[i]->messageIds.data() + triggeredTopics[i]->messageIds.size();
+            }
+        }
+
+        intersection.holes.clear();
+        std::pair<size_t, size_t> total = {};
+        while (true) {
+            unsigned int next = UINT_MAX;
+            for (int i = 0; i < numCursors; i++) {
+                if (cursors[i] != ends[i] && *cursors[i] < next) {
+                    next = *cursors[i];
+                }
+            }
+            if (next == UINT_MAX) {
+                break;
+            }
+            for (int i = 0; i < numCursors; i++) {
+                if (cursors[i] != ends[i] && *cursors[i] == next) {
+                    cursors[i]++;
+                }
+            }
+
+            /* Appends {id, length, length} */
+            intersection.holes.push_back({messages[next].lengths, next});
+            total.first += messages[next].lengths.first;
+            total.second += messages[next].lengths.second;
+        }
+
+        if (intersection.holes.empty()) {
+            intersection.dataChannels = {};
+            return;
+        }
+
+        /* Messages published back to back are already laid out as we would send them */
+        const BatchedMessage &first = messages[intersection.holes.front().messageId];
+        const BatchedMessage &last = messages[intersection.holes.back().messageId];
+        if (last.offsets.first + last.lengths.first - first.offsets.first == total.first &&
+            last.offsets.second + last.lengths.second - first.offsets.second == total.second) {
+            intersection.dataChannels = {
+                std::string_view(batch.first.data() + first.offsets.first, total.first),
+                std::string_view(batch.second.data() + first.offsets.second, total.second)
+            };
+            return;
+        }
+
+        /* Create the linear cache, {inflated, deflated} */
+        intersection.storage.first.clear();
+        intersection.storage.second.clear();
+        for (Hole &hole : intersection.holes) {
+            const BatchedMessage &message = messages[hole.messageId];
+            intersection.storage.first.append(batch.first, message.offsets.first, message.lengths.first);
+            intersection.storage.second.append(batch.second, message.offsets.second, message.lengths.second);
+        }
+        intersection.dataChannels = {intersection.storage.first, intersection.storage.second};
+    }
+
+    /* Forgets the batch, keeping its memory unless it grew past what we want to hold on to */
+    void resetBatch() {
+        for (std::string *data : {&batch.first, &batch.second}) {
+            if (data->capacity() > MAX_RETAINED_BATCH_BYTES) {
+                std::string().swap(*data);
+            }
+            data->clear();
+        }
+        for (unsigned int i = 0; i < numIntersections; i++) {
+            for (std::string *data : {&intersections[i].storage.first, &intersections[i].storage.second}) {
+                if (data->capacity() > MAX_RETAINED_BATCH_BYTES) {
+                    std::string().swap(*data);
+                }
+            }
+        }
+        messages.clear();
+        senderHoles.clear();
+        publishingBatched = false;
     }
 
 public:
@@ -298,19 +562,36 @@ public:
     }
 
     ~TopicTree() {
+        index.forEach([](Topic *topic) {
+            delete topic;
+        });
         delete root;
     }
 
-    /* This is part of the fast path, so should be optimal */
-    std::vector<unsigned int> &getSenderFor(Subscriber *s) {
-        static thread_local std::vector<unsigned int> emptyVector;
+    /* Returns Topic, or nullptr. Topic can be root if empty string given. */
+    Topic *lookupTopic(std::string_view topic) {
+        /* Lookup exact Topic ptr from string */
+        Topic *iterator = root;
+        for (size_t start = 0, stop = 0; stop != std::string::npos; start = stop + 1) {
+            stop = topic.find('/', start);
+            std::string_view segment = topic.substr(start, stop - start);
 
-        auto it = senderHoles.find(s);
-        if (it != senderHoles.end()) {
-            return it->second;
+            iterator = index.find(iterator, segment);
+            if (!iterator) {
+                /* This topic does not even exist */
+                return nullptr;
+            }
         }
 
-        return emptyVector;
+        return iterator;
+    }
+
+    /* This is part of the fast path, so should be optimal. Only valid while draining */
+    SenderHoles getSenderFor(Subscriber *s) {
+        if (s == draining) {
+            return drainingHoles;
+        }
+        return {};
     }
 
     /* Returns number of subscribers after the call and whether or not we were successful in subscribing */
@@ -323,43 +604,37 @@ public:
             stop = topic.find('/', start);
             std::string_view segment = topic.substr(start, stop - start);
 
-            auto lb = iterator->children.lower_bound(segment);
-
-            if (lb != iterator->children.end() && !(iterator->children.key_comp()(segment, lb->first))) {
-                iterator = lb->second;
-            } else {
+            Topic *child = index.find(iterator, segment);
+            if (!child) {
                 /* Allocate and insert new node */
-                Topic *newTopic = new Topic;
-                newTopic->parent = iterator;
-                newTopic->name = new char[segment.length()];
-                newTopic->length = segment.length();
-                newTopic->terminatingWildcardChild = nullptr;
-                newTopic->wildcardChild = nullptr;
-                memcpy(newTopic->name, segment.data(), segment.length());
+                child = new Topic;
+                child->parent = iterator;
+                child->length = segment.length();
 
                 /* Set fullname as parent's name plus our name */
-                newTopic->fullName.reserve(newTopic->parent->fullName.length() + 1 + segment.length());
-                newTopic->fullName.append(newTopic->parent->fullName);
-                newTopic->fullName.append("/");
-                newTopic->fullName.append(segment);
+                child->fullName.reserve(iterator->fullName.length() + 1 + segment.length());
+                child->fullName.append(iterator->fullName);
+                child->fullName.append("/");
+                child->fullName.append(segment);
 
                 /* For simplicity we do insert wildcards with text */
-                iterator->children.insert(lb, {std::string_view(newTopic->name, segment.length()), newTopic});
+                index.insert(child);
+                iterator->numChildren++;
 
                 /* Store fast lookup to wildcards */
                 if (segment.length() == 1) {
                     /* If this segment is '+' it is a wildcard */
                     if (segment[0] == '+') {
-                        iterator->wildcardChild = newTopic;
+                        iterator->wildcardChild = child;
                     }
                     /* If this segment is '#' it is a terminating wildcard */
                     if (segment[0] == '#') {
-                        iterator->terminatingWildcardChild = newTopic;
+                        iterator->terminatingWildcardChild = child;
                     }
                 }
-
-                iterator = newTopic;
             }
+
+            iterator = child;
         }
 
         /* If this topic is triggered, drain the tree before we join */
@@ -369,72 +644,63 @@ public:
             }
         }
 
-        /* Add socket to Topic's Set */
-        auto [it, inserted] = iterator->subs.insert(subscriber);
+        /* Add socket to Topic's subscribers, keeping them sorted */
+        auto it = std::lower_bound(iterator->subs.begin(), iterator->subs.end(), subscriber, std::less<Subscriber *>());
+        if (it != iterator->subs.end() && *it == subscriber) {
+            return {(unsigned int) iterator->subs.size(), false};
+        }
+        iterator->subs.insert(it, subscriber);
 
         /* Add Topic to list of subscriptions only if we weren't already subscribed */
-        if (inserted) {
-            subscriber->subscriptions.push_back(iterator);
-            return {(unsigned int) iterator->subs.size(), true};
-        }
-        return {(unsigned int) iterator->subs.size(), false};
+        subscriber->subscriptions.push_back(iterator);
+        return {(unsigned int) iterator->subs.size(), true};
     }
 
     bool publish(std::string_view topic, std::pair<std::string_view, std::string_view> message, Subscriber *sender = nullptr) {
-        /* Add a hole for the sender if one */
-        if (sender) {
-            senderHoles[sender].push_back(messageId);
-        }
+        publishing = message;
+        publishingSender = sender;
+        publishingBatched = false;
+
+        bool ret = publish(root, 0, 0, topic);
 
-        auto ret = publish(root, 0, 0, topic, message);
-        /* MessageIDs are reset on drain - this should be fine since messages itself are cleared on drain */
-        messageId++;
+        publishing = {};
+        publishingSender = nullptr;
+        publishingBatched = false;
         return ret;
     }
 
     /* Returns a pair of numSubscribers after operation, and whether we were subscribed prior */
     std::pair<unsigned int, bool> unsubscribe(std::string_view topic, Subscriber *subscriber, bool nonStrict = false) {
-        /* Subscribers are likely to have very few subscriptions (20 or fewer) */
         if (subscriber) {
-            /* Lookup exact Topic ptr from string */
-            Topic *iterator = root;
-            for (size_t start = 0, stop = 0; stop != std::string::npos; start = stop + 1) {
-                stop = topic.find('/', start);
-                std::string_view segment = topic.substr(start, stop - start);
-
-                std::map<std::string_view, Topic *>::iterator it = iterator->children.find(segment);
-                if (it == iterator->children.end()) {
-                    /* This topic does not even exist */
-                    return {0, false};
-                }
-
-                iterator = it->second;
+            Topic *iterator = lookupTopic(topic);
+            if (!iterator) {
+                /* This topic does not even exist */
+                return {0, false};
             }
 
             /* Is this topic locked? If so, we cannot unsubscribe from it */
             if (iterator->locked) {
-                return {iterator->subs.size(), false};
+                return {(unsigned int) iterator->subs.size(), false};
             }
 
             /* Try and remove this topic from our list */
-            for (auto it = subscriber->subscriptions.begin(); it != subscriber->subscriptions.end(); it++) {
-                if (*it == iterator) {
-                    /* If this topic is triggered, drain the tree before we leave */
-                    if (iterator->triggered) {
-                        if (!nonStrict) {
-                            drain();
-                        }
+            auto it = std::find(subscriber->subscriptions.begin(), subscriber->subscriptions.end(), iterator);
+            if (it != subscriber->subscriptions.end()) {
+                /* If this topic is triggered, drain the tree before we leave */
+                if (iterator->triggered) {
+                    if (!nonStrict) {
+                        drain();
                     }
+                }
 
-                    /* Remove topic ptr from our list */
-                    subscriber->subscriptions.erase(it);
+                /* Remove topic ptr from our list */
+                subscriber->subscriptions.erase(it);
 
-                    /* Remove us from Topic's subs */
-                    iterator->subs.erase(subscriber);
-                    unsigned int numSubscribers = (unsigned int) iterator->subs.size();
-                    trimTree(iterator);
-                    return {numSubscribers, true};
-                }
+                /* Remove us from Topic's subs */
+                iterator->subs.erase(std::lower_bound(iterator->subs.begin(), iterator->subs.end(), subscriber, std::less<Subscriber *>()));
+                unsigned int numSubscribers = (unsigned int) iterator->subs.size();
+                trimTree(iterator);
+                return {numSubscribers, true};
             }
         }
         return {0, false};
@@ -453,8 +719,8 @@ public:
                     drain();
                 }
 
-                /* Remove us from the topic's set */
-                topic->subs.erase(subscriber);
+                /* Remove us from the topic's subscribers */
+                topic->subs.erase(std::lower_bound(topic->subs.begin(), topic->subs.end(), subscriber, std::less<Subscriber *>()));
                 trimTree(topic);
             }
             subscriber->subscriptions.clear();
@@ -478,119 +744,74 @@ public:
             } else {
                 /* If we no longer have any subscribers, yet still keep this Topic alive (parent),
                  * make sure to clear its potential messages. */
-                triggeredTopics[i]->messages.clear();
+                triggeredTopics[i]->messageIds.clear();
                 triggeredTopics[i]->triggered = false;
             }
         }
         numTriggeredTopics = numFilteredTriggeredTopics;
 
-        if (!numTriggeredTopics) {
-            senderHoles.clear();
-            messageId = 0;
-            return;
-        }
-
-        /* bug fix: update min, as the one tracked via subscribe gets invalid as you unsubscribe */
-        min = (Subscriber *)UINTPTR_MAX;
-        for (int i = 0; i < numTriggeredTopics; i++) {
-            if ((triggeredTopics[i]->subs.size()) && (min > *triggeredTopics[i]->subs.begin())) {
-                min = *triggeredTopics[i]->subs.begin();
+        if (numTriggeredTopics) {
+            /* Sender holes in the order we visit subscribers, ids ascending per sender */
+            std::sort(senderHoles.begin(), senderHoles.end(), [](const std::pair<Subscriber *, unsigned int> &a, const std::pair<Subscriber *, unsigned int> &b) {
+                return a.first == b.first ? a.second < b.second : std::less<Subscriber *>()(a.first, b.first);
+            });
+            senderHoleIds.clear();
+            for (std::pair<Subscriber *, unsigned int> &hole : senderHoles) {
+                senderHoleIds.push_back(hole.second);
             }
-        }
+            size_t nextHole = 0;
 
-        /* Check if we really have any sockets still */
-        if (min != (Subscriber *)UINTPTR_MAX) {
-
-            /* Up to 64 triggered Topics per batch */
-            std::map<uint64_t, Intersection> intersectionCache;
+            /* Forget the intersections of the previous drain, keeping their memory */
+            if (numIntersections) {
+                std::fill(intersectionSlots.begin(), intersectionSlots.end(), std::pair<uint64_t, unsigned int>{0, 0});
+                numIntersections = 0;
+            }
 
-            /* Loop over these here */
-            std::set<Subscriber *>::iterator it[64];
-            std::set<Subscriber *>::iterator end[64];
+            /* Every {subscriber, topic} pair of the triggered topics, grouped by subscriber */
+            drainOrder.clear();
             for (int i = 0; i < numTriggeredTopics; i++) {
-                it[i] = triggeredTopics[i]->subs.begin();
-                end[i] = triggeredTopics[i]->subs.end();
+                for (Subscriber *subscriber : triggeredTopics[i]->subs) {
+                    drainOrder.push_back({subscriber, i});
+                }
             }
+            std::sort(drainOrder.begin(), drainOrder.end(), [](const std::pair<Subscriber *, int> &a, const std::pair<Subscriber *, int> &b) {
+                return std::less<Subscriber *>()(a.first, b.first);
+            });
 
-            /* Empty all sets from unique subscribers */
-            for (int nonEmpty = numTriggeredTopics; nonEmpty; ) {
-
-                Subscriber *nextMin = (Subscriber *)UINTPTR_MAX;
-
-                /* The message sets relevant for this intersection */
-                std::map<unsigned int, std::pair<std::string, std::string>> *perSubscriberIntersectingTopicMessages[64];
-                int numPerSubscriberIntersectingTopicMessages = 0;
+            /* Visit every unique subscriber once */
+            for (size_t next = 0; next < drainOrder.size(); ) {
+                Subscriber *min = drainOrder[next].first;
 
+                /* Mark this intersection */
                 uint64_t intersection = 0;
-
-                for (int i = 0; i < numTriggeredTopics; i++) {
-                    if ((it[i] != end[i]) && (*it[i] == min)) {
-
-                        /* Mark this intersection */
-                        intersection |= ((uint64_t)1 << i);
-                        perSubscriberIntersectingTopicMessages[numPerSubscriberIntersectingTopicMessages++] = &triggeredTopics[i]->messages;
-
-                        it[i]++;
-                        if (it[i] == end[i]) {
-                            nonEmpty--;
-                        }
-                        else {
-                            if (nextMin > *it[i]) {
-                                nextMin = *it[i];
-                            }
-                        }
-                    }
-                    else {
-                        /* We need to lower nextMin to us, in the case of min being the last in a set */
-                        if ((it[i] != end[i]) && (nextMin > *it[i])) {
-                            nextMin = *it[i];
-                        }
-                    }
+                for (; next < drainOrder.size() && drainOrder[next].first == min; next++) {
+                    intersection |= ((uint64_t) 1 << drainOrder[next].second);
                 }
 
-                /* Generate cache for intersection */
-                if (intersectionCache[intersection].dataChannels.first.length() == 0) {
-
-                    /* Build the union in order without duplicates */
-                    std::map<unsigned int, std::pair<std::string, std::string>> complete;
-                    for (int i = 0; i < numPerSubscriberIntersectingTopicMessages; i++) {
-                        complete.insert(perSubscriberIntersectingTopicMessages[i]->begin(), perSubscriberIntersectingTopicMessages[i]->end());
-                    }
-
-                    /* Create the linear cache, {inflated, deflated} */
-                    Intersection res;
-                    for (auto &p : complete) {
-                        res.dataChannels.first.append(p.second.first);
-                        res.dataChannels.second.append(p.second.second);
-
-                        /* Appends {id, length, length}
-                         * We could possibly append byte offset also,
-                         * if we want to use log2 search later. */
-                        Hole h;
-                        h.lengths.first = p.second.first.length();
-                        h.lengths.second = p.second.second.length();
-                        h.messageId = p.first;
-                        res.holes.push_back(h);
-                    }
-
-                    cb(min, intersectionCache[intersection] = std::move(res));
+                /* Find what min published itself */
+                while (nextHole < senderHoles.size() && std::less<Subscriber *>()(senderHoles[nextHole].first, min)) {
+                    nextHole++;
                 }
-                else {
-                    cb(min, intersectionCache[intersection]);
+                size_t firstHole = nextHole;
+                while (nextHole < senderHoles.size() && senderHoles[nextHole].first == min) {
+                    nextHole++;
                 }
+                draining = min;
+                drainingHoles = {senderHoleIds.data() + firstHole, senderHoleIds.data() + nextHole};
 
-                min = nextMin;
+                cb(min, intersectionFor(intersection));
             }
+            draining = nullptr;
+            drainingHoles = {};
         }
 
         /* Clear messages of triggered Topics */
         for (int i = 0; i < numTriggeredTopics; i++) {
-            triggeredTopics[i]->messages.clear();
+            triggeredTopics[i]->messageIds.clear();
             triggeredTopics[i]->triggered = false;
         }
         numTriggeredTopics = 0;
-        senderHoles.clear();
-        messageId = 0;
+        resetBatch();
     }
 };
 
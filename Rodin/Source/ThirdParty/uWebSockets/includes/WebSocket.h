@@ -63,8 +63,9 @@ public:
     };
 
     /* Send or buffer a WebSocket frame, compressed or not. Returns BACKPRESSURE on increased user space backpressure,
-     * DROPPED on dropped message (due to backpressure) or SUCCCESS if you are free to send even more now. */
-    SendStatus send(std::string_view message, OpCode opCode = OpCode::BINARY, bool compress = false) {
+     * DROPPED on dropped message (due to backpressure) or SUCCCESS if you are free to send even more now.
+     * If framedLength is given it receives the size of the frame as put on the wire (after compression). */
+    SendStatus send(std::string_view message, OpCode opCode = OpCode::BINARY, bool compress = false, size_t *framedLength = nullptr) {
         WebSocketContextData<SSL, USERDATA> *webSocketContextData = (WebSocketContextData<SSL, USERDATA> *) us_socket_context_ext(SSL,
             (us_socket_context_t *) us_socket_context(SSL, (us_socket_t *) this)
         );
@@ -105,6 +106,9 @@ public:
 
         /* Get size, alloate size, write if needed */
         size_t messageFrameSize = protocol::messageFrameSize(message.length());
+        if (framedLength) {
+            *framedLength = messageFrameSize;
+        }
         auto [sendBuffer, requiresWrite] = Super::getSendBuffer(messageFrameSize);
         protocol::formatMessage<isServer>(sendBuffer, message.data(), message.length(), opCode, message.length(), compress);
         /* This is the slow path, when we couldn't cork for the user */
@@ -130,7 +134,7 @@ public:
 
         /* Every successful send resets the timeout */
         if (webSocketContextData->resetIdleTimeoutOnSend) {
-            Super::timeout(webSocketContextData->idleTimeoutComponents.first);
+            Super::timeoutMs(webSocketContextData->idleTimeoutComponents.first);
             WebSocketData *webSocketData = (WebSocketData *) Super::getAsyncSocketData();
             webSocketData->hasTimedOut = false;
         }
@@ -228,9 +232,14 @@ public:
             (us_socket_context_t *) us_socket_context(SSL, (us_socket_t *) this)
         );
 
-        Topic *t = webSocketContextData->lookupTopic(topic);
+        WebSocketData *webSocketData = (WebSocketData *) us_socket_ext(SSL, (us_socket_t *) this);
+        if (!webSocketData->subscriber) {
+            return false;
+        }
+
+        Topic *t = webSocketContextData->topicTree.lookupTopic(topic);
         if (t) {
-            return t->subs.find(this) != t->subs.end();
+            return t->hasSubscriber(webSocketData->subscriber);
         }
 
         return false;
@@ -242,9 +251,9 @@ public:
             (us_socket_context_t *) us_socket_context(SSL, (us_socket_t *) this)
         );
 
-        Topic *t = webSocketContextData->lookupTopic(topic);
+        Topic *t = webSocketContextData->topicTree.lookupTopic(topic);
         if (t) {
-            return t->subs.size();
+            return (unsigned int) t->subs.size();
         }
 
         return 0;
@@ -258,13 +267,20 @@ public:
         WebSocketData *webSocketData = (WebSocketData *) us_socket_ext(SSL, (us_socket_t *) this);
 
         if (webSocketData->subscriber) {
-            for (Topic *t : webSocketData->subscriber->subscriptions) {
+            /* Subscriptions are a vector that the callback may grow or shrink, so go by index */
+            for (size_t i = 0; i < webSocketData->subscriber->subscriptions.size(); i++) {
+                Topic *t = webSocketData->subscriber->subscriptions[i];
+
                 /* Lock this topic so that nobody may unsubscribe from it during this callback */
                 t->locked = true;
 
                 cb(t->fullName, (unsigned int) t->subs.size());
 
                 t->locked = false;
+
+                /* Topics before ours may have been removed, continue right after ours */
+                std::vector<Topic *> &subscriptions = webSocketData->subscriber->subscriptions;
+                i = (size_t) (std::find(subscriptions.begin(), subscriptions.end(), t) - subscriptions.begin());
             }
         }
     }
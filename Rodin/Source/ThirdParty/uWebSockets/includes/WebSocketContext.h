@@ -96,12 +96,17 @@ private:
                     }
                 }
             } else {
-                /* Allocate fragment buffer up front first time */
-                if (!webSocketData->fragmentBuffer.length()) {
-                    webSocketData->fragmentBuffer.reserve(length + remainingBytes);
+                /* Fragments forming a big message are not caught until the frame that overflows starts */
+                if (refusePayloadLength(webSocketData->fragmentBuffer.length() + length + remainingBytes, webSocketState, s)) {
+                    forceClose(webSocketState, s, ERR_TOO_BIG_MESSAGE);
+                    return true;
                 }
-                /* Fragments forming a big message are not caught until appending them */
-                if (refusePayloadLength(length + webSocketData->fragmentBuffer.length(), webSocketState, s)) {
+
+                /* Room for the whole frame its header announced, along with what came before it and the inflation padding.
+                 * Taken from the loop's pool, a message of several frames moves up a size class at most once per frame */
+                LoopData *loopData = (LoopData *) us_loop_ext(us_socket_context_loop(SSL, us_socket_context(SSL, (us_socket_t *) s)));
+                size_t padding = webSocketData->compressionStatus == WebSocketData::CompressionStatus::COMPRESSED_FRAME ? 9 : 0;
+                if (!webSocketData->fragmentBuffer.reserve(&loopData->fragmentPool, webSocketData->fragmentBuffer.length() + length + remainingBytes + padding)) {
                     forceClose(webSocketState, s, ERR_TOO_BIG_MESSAGE);
                     return true;
                 }
@@ -116,13 +121,11 @@ private:
                             webSocketData->compressionStatus = WebSocketData::CompressionStatus::ENABLED;
 
                             /* 9 bytes of padding for libdeflate */
-                            webSocketData->fragmentBuffer.append("123456789");
-
-                            LoopData *loopData = (LoopData *) us_loop_ext(
-                                us_socket_context_loop(SSL,
-                                    us_socket_context(SSL, (us_socket_t *) s)
-                                )
-                            );
+                            if (!webSocketData->fragmentBuffer.reserve(&loopData->fragmentPool, webSocketData->fragmentBuffer.length() + 9)) {
+                                forceClose(webSocketState, s, ERR_TOO_BIG_MESSAGE);
+                                return true;
+                            }
+                            webSocketData->fragmentBuffer.append("123456789", 9);
 
                             auto inflatedFrame = loopData->inflationStream->inflate(loopData->zlibContext, {webSocketData->fragmentBuffer.data(), webSocketData->fragmentBuffer.length() - 9}, webSocketContextData->maxPayloadLength);
                             if (!inflatedFrame.has_value()) {
@@ -154,7 +157,7 @@ private:
                         }
                     }
 
-                    /* If we shutdown or closed, this will be taken care of elsewhere */
+                    /* Back to the pool. If we shutdown or closed, this will be taken care of elsewhere */
                     webSocketData->fragmentBuffer.clear();
                 }
             }
@@ -187,6 +190,11 @@ private:
                 }
             } else {
                 /* Here we never mind any size optimizations as we are in the worst possible path */
+                LoopData *loopData = (LoopData *) us_loop_ext(us_socket_context_loop(SSL, us_socket_context(SSL, (us_socket_t *) s)));
+                if (!webSocketData->fragmentBuffer.reserve(&loopData->fragmentPool, webSocketData->fragmentBuffer.length() + length + remainingBytes)) {
+                    forceClose(webSocketState, s, ERR_TOO_BIG_MESSAGE);
+                    return true;
+                }
                 webSocketData->fragmentBuffer.append(data, length);
                 webSocketData->controlTipLength += (unsigned int) length;
 
@@ -276,7 +284,7 @@ private:
             auto *asyncSocket = (AsyncSocket<SSL> *) s;
 
             /* Every time we get data and not in shutdown state we simply reset the timeout */
-            asyncSocket->timeout(webSocketContextData->idleTimeoutComponents.first);
+            asyncSocket->timeoutMs(webSocketContextData->idleTimeoutComponents.first);
             webSocketData->hasTimedOut = false;
 
             /* We always cork on data */
@@ -326,7 +334,7 @@ private:
             /* Also reset timeout if we came here with 0 backpressure */
             if (!backpressure || backpressure > asyncSocket->getBufferedAmount()) {
                 auto *webSocketContextData = (WebSocketContextData<SSL, USERDATA> *) us_socket_context_ext(SSL, us_socket_context(SSL, (us_socket_t *) s));
-                asyncSocket->timeout(webSocketContextData->idleTimeoutComponents.first);
+                asyncSocket->timeoutMs(webSocketContextData->idleTimeoutComponents.first);
                 webSocketData->hasTimedOut = false;
             }
 
@@ -366,7 +374,7 @@ private:
 
             if (webSocketContextData->sendPingsAutomatically && !webSocketData->hasTimedOut) {
                 webSocketData->hasTimedOut = true;
-                us_socket_timeout(SSL, s, webSocketContextData->idleTimeoutComponents.second);
+                us_socket_timeout_ms(SSL, s, webSocketContextData->idleTimeoutComponents.second);
                 /* Send ping without being corked */
                 ((AsyncSocket<SSL> *) s)->write("\x89\x00", 2);
                 return s;
@@ -20,6 +20,7 @@
 
 #include "MoveOnlyFunction.h"
 #include <string_view>
+#include <algorithm>
 
 #include "WebSocketProtocol.h"
 #include "TopicTree.h"
@@ -67,25 +68,33 @@ public:
     bool resetIdleTimeoutOnSend;
     bool sendPingsAutomatically;
 
-    /* These are calculated on creation */
-    std::pair<unsigned short, unsigned short> idleTimeoutComponents;
+    /* These are calculated on creation, in milliseconds */
+    std::pair<unsigned int, unsigned int> idleTimeoutComponents;
 
     /* Each websocket context has a topic tree for pub/sub */
     TopicTree topicTree;
 
     /* This is run once on start-up */
-    void calculateIdleTimeoutCompnents(unsigned short idleTimeout) {
-        unsigned short margin = 4;
+    void calculateIdleTimeoutCompnents(unsigned int idleTimeoutMs) {
+        /* No timeout at all */
+        if (!idleTimeoutMs) {
+            idleTimeoutComponents = {0, 0};
+            return;
+        }
+
+        unsigned int margin = 4000;
         /* 4, 8 or 16 seconds margin based on idleTimeout */
-        while ((int) idleTimeout - margin * 2 >= margin * 2 && margin < 16) {
-            margin = (unsigned short) (margin << 2);
+        while ((long long) idleTimeoutMs - margin * 2 >= margin * 2 && margin < 16000) {
+            margin = margin << 2;
         }
+        /* The timer wheel is exact to the millisecond, short timeouts keep half for the pong */
+        margin = std::max(1u, std::min(margin, idleTimeoutMs / 2));
         /* We should have no margin if not using sendPingsAutomatically */
         if (!sendPingsAutomatically) {
             margin = 0;
         }
         idleTimeoutComponents = {
-            idleTimeout - margin,
+            std::max(1u, idleTimeoutMs - margin),
             margin
         };
     }
@@ -179,7 +188,7 @@ public:
                     if (this->resetIdleTimeoutOnSend) {
                         auto *webSocketData = (WebSocketData *) us_socket_ext(SSL, (us_socket_t *) asyncSocket);
                         webSocketData->hasTimedOut = false;
-                        asyncSocket->timeout(this->idleTimeoutComponents.first);
+                        asyncSocket->timeoutMs(this->idleTimeoutComponents.first);
                     }
                 }
             });
@@ -195,7 +204,7 @@ public:
                 if (this->resetIdleTimeoutOnSend) {
                     auto *webSocketData = (WebSocketData *) us_socket_ext(SSL, (us_socket_t *) asyncSocket);
                     webSocketData->hasTimedOut = false;
-                    asyncSocket->timeout(this->idleTimeoutComponents.first);
+                    asyncSocket->timeoutMs(this->idleTimeoutComponents.first);
                 }
             }
         }
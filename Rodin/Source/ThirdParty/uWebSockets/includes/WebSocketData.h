@@ -22,6 +22,7 @@
 #include "AsyncSocketData.h"
 #include "PerMessageDeflate.h"
 #include "TopicTree.h"
+#include "FragmentPool.h"
 
 #include <string>
 
@@ -34,7 +35,7 @@ struct WebSocketData : AsyncSocketData<false>, WebSocketState<true> {
     template <bool, bool, typename> friend struct WebSocket;
     template <bool> friend struct HttpContext;
 private:
-    std::string fragmentBuffer;
+    FragmentBuffer fragmentBuffer;
     unsigned int controlTipLength = 0;
     bool isShuttingDown = 0;
     bool hasTimedOut = false;